@@ -5,6 +5,7 @@ macro(test_case)
 
   add_executable(${trgt} $<TARGET_OBJECTS:catch_main> "${trgt}_test.cpp")
   target_include_directories(${trgt} PRIVATE "${CMAKE_SOURCE_DIR}/test/common")
+  target_compile_definitions(${trgt} PRIVATE CATCH_CONFIG_ENABLE_BENCHMARKING)
   target_link_libraries(${trgt} PRIVATE celestia ${libs})
   add_test(${trgt} ${trgt})
   set_target_properties(${trgt} PROPERTIES FOLDER test/unit)
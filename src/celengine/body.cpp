@@ -186,7 +186,11 @@ FrameTree* Body::getFrameTree() const
 FrameTree* Body::getOrCreateFrameTree()
 {
     if (!frameTree)
+    {
         frameTree = new FrameTree(this);
+        // The trees containing this body now have a new subtree to account for
+        markChanged();
+    }
     return frameTree;
 }
 
@@ -1092,7 +1096,12 @@ Body::getReferenceMarks() const
  */
 void Body::setVisible(bool _visible)
 {
+    if (visible == _visible)
+        return;
+
     visible = _visible;
+    // Let anything keeping state about the frame tree know that it changed
+    markChanged();
 }
 
 
@@ -0,0 +1,173 @@
+// bodyindex.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Bounding volume hierarchy over the children of a frame tree at a single
+// instant, used to cull bodies against view and pick cones.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include <Eigen/Geometry>
+
+#include "bodyindex.h"
+
+
+namespace
+{
+
+// Maximum number of entries stored in a leaf node
+constexpr std::uint32_t MaxLeafEntries = 4;
+
+// Deep enough for any tree built by median splits of 2^32 entries
+constexpr std::size_t MaxTraversalDepth = 64;
+
+
+// Conservative test for whether a sphere intersects a cone; this is the
+// same test the renderer applies to individual bodies.
+bool
+SphereIntersectsCone(const Eigen::Vector3d& center,
+                     double radius,
+                     const Eigen::Vector3d& apex,
+                     const Eigen::Vector3d& axis,
+                     double sinHalfAngle,
+                     double invCosHalfAngle)
+{
+    Eigen::Vector3d v = center - apex;
+    double distAlongAxis = axis.dot(v);
+    if (distAlongAxis <= -radius)
+        return false;
+
+    double maxPerpDist = (radius + distAlongAxis * sinHalfAngle) * invCosHalfAngle;
+    if (maxPerpDist < 0.0)
+        return false;
+
+    double perpDistSq = (v - distAlongAxis * axis).squaredNorm();
+    return perpDistSq <= maxPerpDist * maxPerpDist;
+}
+
+} // end unnamed namespace
+
+
+BodySpatialIndex::BodySpatialIndex(std::vector<Entry>&& _entries,
+                                   std::vector<unsigned int>&& _alwaysVisited,
+                                   double tdb,
+                                   double _maxAge) :
+    entries(std::move(_entries)),
+    alwaysVisited(std::move(_alwaysVisited)),
+    time(tdb),
+    maxAge(_maxAge)
+{
+    if (entries.empty())
+        return;
+
+    auto count = static_cast<std::uint32_t>(entries.size());
+    nodes.reserve(2 * (count / MaxLeafEntries + 1));
+    build(0, count);
+}
+
+
+void
+BodySpatialIndex::build(std::uint32_t first, std::uint32_t count)
+{
+    Eigen::AlignedBox<double, 3> bounds;
+    Eigen::AlignedBox<double, 3> centerBounds;
+    for (std::uint32_t i = first; i < first + count; i++)
+    {
+        const Entry& entry = entries[i];
+        bounds.extend(entry.position - Eigen::Vector3d::Constant(entry.radius));
+        bounds.extend(entry.position + Eigen::Vector3d::Constant(entry.radius));
+        centerBounds.extend(entry.position);
+    }
+
+    Eigen::Vector3d center = bounds.center();
+    double radius = 0.0;
+    for (std::uint32_t i = first; i < first + count; i++)
+        radius = std::max(radius, (entries[i].position - center).norm() + entries[i].radius);
+
+    auto nodeIndex = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back({ center, radius, first, count });
+
+    Eigen::Index axis;
+    double extent = centerBounds.sizes().maxCoeff(&axis);
+    if (count <= MaxLeafEntries || extent <= 0.0)
+        return;
+
+    // Split at the median position along the longest axis
+    std::uint32_t half = count / 2;
+    std::nth_element(entries.begin() + first, entries.begin() + first + half, entries.begin() + first + count,
+                     [axis](const Entry& a, const Entry& b)
+                     {
+                         return a.position[axis] < b.position[axis];
+                     });
+
+    build(first, half);
+    auto rightIndex = static_cast<std::uint32_t>(nodes.size());
+    build(first + half, count - half);
+
+    nodes[nodeIndex].first = rightIndex;
+    nodes[nodeIndex].count = 0;
+}
+
+
+void
+BodySpatialIndex::findInCone(const Eigen::Vector3d& apex,
+                             const Eigen::Vector3d& axis,
+                             double cosHalfAngle,
+                             std::vector<unsigned int>& children) const
+{
+    auto firstResult = children.size();
+    children.insert(children.end(), alwaysVisited.begin(), alwaysVisited.end());
+
+    if (cosHalfAngle <= 0.0)
+    {
+        for (const Entry& entry : entries)
+            children.push_back(entry.child);
+        std::sort(children.begin() + firstResult, children.end());
+        return;
+    }
+
+    if (nodes.empty())
+    {
+        std::sort(children.begin() + firstResult, children.end());
+        return;
+    }
+
+    double sinHalfAngle = std::sqrt(std::max(0.0, 1.0 - cosHalfAngle * cosHalfAngle));
+    double invCosHalfAngle = 1.0 / cosHalfAngle;
+
+    std::array<std::uint32_t, MaxTraversalDepth> stack;
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        std::uint32_t nodeIndex = stack[--stackSize];
+        const Node& node = nodes[nodeIndex];
+        if (!SphereIntersectsCone(node.center, node.radius, apex, axis, sinHalfAngle, invCosHalfAngle))
+            continue;
+
+        if (node.count == 0)
+        {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = nodeIndex + 1;
+            continue;
+        }
+
+        for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+        {
+            const Entry& entry = entries[i];
+            if (SphereIntersectsCone(entry.position, entry.radius, apex, axis, sinHalfAngle, invCosHalfAngle))
+                children.push_back(entry.child);
+        }
+    }
+
+    std::sort(children.begin() + firstResult, children.end());
+}
@@ -0,0 +1,90 @@
+// bodyindex.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Bounding volume hierarchy over the children of a frame tree around a single
+// instant, used to cull bodies against view and pick cones.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+
+class BodySpatialIndex
+{
+ public:
+    // Frame trees with fewer children than this are scanned linearly
+    static constexpr unsigned int MinChildren = 128;
+
+    struct Entry
+    {
+        // Position relative to the center of the frame tree, in km
+        Eigen::Vector3d position;
+        // Radius of a sphere containing the body and its whole subtree
+        double radius;
+        // Index of the timeline phase in the frame tree
+        unsigned int child;
+    };
+
+    /*! Build the index at time tdb. Children listed in alwaysVisited are
+     *  not indexed, but reported by every query; this is intended for the
+     *  few bodies whose influence, e.g. planetshine, reaches beyond their
+     *  bounding sphere.
+     *
+     *  The index may be used for times less than maxAge days away from
+     *  tdb, provided the entry radii cover the motion of the children over
+     *  that interval.
+     */
+    BodySpatialIndex(std::vector<Entry>&& entries,
+                     std::vector<unsigned int>&& alwaysVisited,
+                     double tdb,
+                     double maxAge = 0.0);
+
+    double getTime() const { return time; }
+    bool isValidAt(double tdb) const
+    {
+        return tdb == time || std::abs(tdb - time) < maxAge;
+    }
+    std::size_t getEntryCount() const { return entries.size(); }
+
+    /*! Append to children the indices of all children whose bounding
+     *  sphere may intersect the cone with the given apex (relative to the
+     *  tree center), unit axis and half angle cosine, along with the always
+     *  visited children. The result is sorted in ascending order, so that
+     *  callers visit children in the same order as a linear scan would.
+     *  Cones with half angles of 90 degrees or more accept every child.
+     */
+    void findInCone(const Eigen::Vector3d& apex,
+                    const Eigen::Vector3d& axis,
+                    double cosHalfAngle,
+                    std::vector<unsigned int>& children) const;
+
+ private:
+    // Interior nodes have count == 0; their left child immediately follows
+    // them and first is the index of the right child. Leaf nodes reference
+    // count entries starting at first.
+    struct Node
+    {
+        Eigen::Vector3d center;
+        double radius;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    void build(std::uint32_t first, std::uint32_t count);
+
+    std::vector<Node> nodes;
+    std::vector<Entry> entries;
+    std::vector<unsigned int> alwaysVisited;
+    double time;
+    double maxAge;
+};
@@ -24,7 +24,8 @@
 #include <celutil/utf8.h>
 #include <celutil/tokenizer.h>
 #include "astro.h"
-#include "parser.h"
+#include "parsedcatalog.h"
+#include "value.h"
 #include "parseobject.h"
 #include "multitexture.h"
 #include "meshmanager.h"
@@ -209,6 +210,59 @@ void DSODatabase::findCloseDSOs(DSOHandler&     dsoHandler,
 }
 
 
+void DSODatabase::findDSOsAlongRay(DSORayHandler&  dsoHandler,
+                                   const Vector3d& origin,
+                                   const Vector3d& direction,
+                                   float           limitingMag) const
+{
+    octreeRoot->processObjectsAlongRay(dsoHandler,
+                                       origin,
+                                       direction.normalized(),
+                                       limitingMag,
+                                       DSO_OCTREE_ROOT_SIZE);
+}
+
+
+void DSODatabase::findNearestDSOs(vector<pair<DeepSkyObject*, double>>& dsos,
+                                  const Vector3d& position,
+                                  unsigned int count,
+                                  double maxDistance) const
+{
+    vector<pair<DeepSkyObject* const*, double>> nearest;
+    octreeRoot->findNearestObjects(position,
+                                   count,
+                                   maxDistance,
+                                   DSO_OCTREE_ROOT_SIZE,
+                                   nearest);
+
+    dsos.clear();
+    dsos.reserve(nearest.size());
+    for (const auto& [dso, distance] : nearest)
+        dsos.emplace_back(*dso, distance);
+}
+
+
+void DSODatabase::findDSOsInCone(vector<pair<DeepSkyObject*, double>>& dsos,
+                                 const Vector3d& origin,
+                                 const Vector3d& direction,
+                                 double halfAngle,
+                                 double maxDistance) const
+{
+    vector<pair<DeepSkyObject* const*, double>> found;
+    octreeRoot->findObjectsInCone(origin,
+                                  direction.normalized(),
+                                  halfAngle,
+                                  maxDistance,
+                                  DSO_OCTREE_ROOT_SIZE,
+                                  found);
+
+    dsos.clear();
+    dsos.reserve(found.size());
+    for (const auto& [dso, distance] : found)
+        dsos.emplace_back(*dso, distance);
+}
+
+
 DSONameDatabase* DSODatabase::getNameDatabase() const
 {
     return namesDB;
@@ -223,34 +277,38 @@ void DSODatabase::setNameDatabase(DSONameDatabase* _namesDB)
 
 bool DSODatabase::load(istream& in, const fs::path& resourcePath)
 {
-    Tokenizer tokenizer(&in);
-    Parser    parser(&tokenizer);
+    ParsedCatalog catalog(in);
+    return load(catalog, resourcePath);
+}
+
 
+bool DSODatabase::load(ParsedCatalog& catalog, const fs::path& resourcePath)
+{
 #ifdef ENABLE_NLS
     string s = resourcePath.string();
     const char *d = s.c_str();
     bindtextdomain(d, d); // domain name is the same as resource path
 #endif
 
-    while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+    while (catalog.nextToken() != Tokenizer::TokenEnd)
     {
         string objType;
         string objName;
 
-        if (tokenizer.getTokenType() != Tokenizer::TokenName)
+        if (catalog.getTokenType() != Tokenizer::TokenName)
         {
             GetLogger()->error("Error parsing deep sky catalog file.\n");
             return false;
         }
-        objType = tokenizer.getStringValue();
+        objType = catalog.getStringValue();
 
         bool autoGenCatalogNumber = true;
         AstroCatalog::IndexNumber objCatalogNumber = AstroCatalog::InvalidIndex;
-        if (tokenizer.getTokenType() == Tokenizer::TokenNumber)
+        if (catalog.getTokenType() == Tokenizer::TokenNumber)
         {
             autoGenCatalogNumber   = false;
-            objCatalogNumber       = (AstroCatalog::IndexNumber) tokenizer.getNumberValue();
-            tokenizer.nextToken();
+            objCatalogNumber       = (AstroCatalog::IndexNumber) catalog.getNumberValue();
+            catalog.nextToken();
         }
 
         if (autoGenCatalogNumber)
@@ -258,14 +316,14 @@ bool DSODatabase::load(istream& in, const fs::path& resourcePath)
             objCatalogNumber   = nextAutoCatalogNumber--;
         }
 
-        if (tokenizer.nextToken() != Tokenizer::TokenString)
+        if (catalog.nextToken() != Tokenizer::TokenString)
         {
             GetLogger()->error("Error parsing deep sky catalog file: bad name.\n");
             return false;
         }
-        objName = tokenizer.getStringValue();
+        objName = catalog.getStringValue();
 
-        Value* objParamsValue    = parser.readValue();
+        Value* objParamsValue    = catalog.readValue();
         if (objParamsValue == nullptr ||
             objParamsValue->getType() != Value::HashType)
         {
@@ -20,6 +20,7 @@
 #include <celengine/dsooctree.h>
 #include <celengine/parser.h>
 
+class ParsedCatalog;
 
 constexpr inline unsigned int MAX_DSO_NAMES = 10;
 
@@ -54,6 +55,22 @@ class DSODatabase
                        const Eigen::Vector3d& obsPosition,
                        float radius) const;
 
+    void findDSOsAlongRay(DSORayHandler& dsoHandler,
+                          const Eigen::Vector3d& origin,
+                          const Eigen::Vector3d& direction,
+                          float limitingMag) const;
+
+    void findNearestDSOs(std::vector<std::pair<DeepSkyObject*, double>>& dsos,
+                         const Eigen::Vector3d& position,
+                         unsigned int count,
+                         double maxDistance) const;
+
+    void findDSOsInCone(std::vector<std::pair<DeepSkyObject*, double>>& dsos,
+                        const Eigen::Vector3d& origin,
+                        const Eigen::Vector3d& direction,
+                        double halfAngle,
+                        double maxDistance) const;
+
     std::string getDSOName    (const DeepSkyObject* const &, bool i18n = false) const;
     std::string getDSONameList(const DeepSkyObject* const &, const unsigned int maxNames = MAX_DSO_NAMES) const;
 
@@ -61,6 +78,7 @@ class DSODatabase
     void setNameDatabase(DSONameDatabase*);
 
     bool load(std::istream&, const fs::path& resourcePath = fs::path());
+    bool load(ParsedCatalog&, const fs::path& resourcePath = fs::path());
     bool loadBinary(std::istream&);
     void finish();
 
@@ -66,6 +66,30 @@ template<> DynamicDSOOctree::ExclusionFactorDecayFunction*
 
 
 // total specialization of the StaticOctree template process*() methods for DSOs:
+template<>
+void DSOOctree::processNodeObjects(DSOHandler&      processor,
+                                   const PointType& obsPosition,
+                                   float            limitingFactor,
+                                   double           minDistance) const
+{
+    double dimmest     = minDistance > 0.0 ? astro::appToAbsMag((double) limitingFactor, minDistance) : 1000.0;
+
+    for (unsigned int i=0; i<nObjects; ++i)
+    {
+        DeepSkyObject* _obj = _firstObject[i];
+        float  absMag      = _obj->getAbsoluteMagnitude();
+        if (absMag < dimmest)
+        {
+            double distance    = (obsPosition - _obj->getPosition()).norm() - _obj->getBoundingSphereRadius();
+            float appMag = (float) ((distance >= 32.6167) ? astro::absToAppMag((double) absMag, distance) : absMag);
+
+            if ( appMag < limitingFactor)
+                processor.process(_obj, distance, absMag);
+        }
+    }
+}
+
+
 template<>
 void DSOOctree::processVisibleObjects(DSOHandler&    processor,
                                       const PointType& obsPosition,
@@ -100,25 +124,11 @@ void DSOOctree::processVisibleObjects(DSOHandler&    processor,
     double minDistance = (obsPosition - cellCenterPos).norm() - scale * DSOOctree::SQRT3;
 
     // Process the objects in this node
-    double dimmest     = minDistance > 0.0 ? astro::appToAbsMag((double) limitingFactor, minDistance) : 1000.0;
-
-    for (unsigned int i=0; i<nObjects; ++i)
-    {
 #ifdef OCTREE_DEBUG
-        if (stats != nullptr)
-            stats->objects++;
+    if (stats != nullptr)
+        stats->objects += nObjects;
 #endif
-        DeepSkyObject* _obj = _firstObject[i];
-        float  absMag      = _obj->getAbsoluteMagnitude();
-        if (absMag < dimmest)
-        {
-            double distance    = (obsPosition - _obj->getPosition()).norm() - _obj->getBoundingSphereRadius();
-            float appMag = (float) ((distance >= 32.6167) ? astro::absToAppMag((double) absMag, distance) : absMag);
-
-            if ( appMag < limitingFactor)
-                processor.process(_obj, distance, absMag);
-        }
-    }
+    processNodeObjects(processor, obsPosition, limitingFactor, minDistance);
 
     // See if any of the objects in child nodes are potentially included
     // that we need to recurse deeper.
@@ -20,5 +20,12 @@
 typedef DynamicOctree  <DeepSkyObject*, double> DynamicDSOOctree;
 typedef StaticOctree   <DeepSkyObject*, double> DSOOctree;
 typedef OctreeProcessor<DeepSkyObject*, double> DSOHandler;
+typedef OctreeRayProcessor<DeepSkyObject*, double> DSORayHandler;
+
+template<>
+inline DSOOctree::PointType DSOOctree::objectPosition(DeepSkyObject* const & dso)
+{
+    return dso->getPosition();
+}
 
 #endif  // _CELENGINE_DSOOCTREE_H_
@@ -12,6 +12,7 @@
 #include <celengine/deepskyobj.h>
 #include <celmath/geomutil.h>
 #include "glsupport.h"
+#include "labelmanager.h"
 #include "render.h"
 #include "vecgl.h"
 #include "dsorenderer.h"
@@ -174,12 +175,13 @@ void DSORenderer::process(DeepSkyObject* const &dso,
             labelColor.alpha(distr * labelColor.alpha());
 
             renderer->addBackgroundAnnotation(rep,
-                                              dsoDB->getDSOName(dso, true),
+                                              renderer->getLabelManager().getDSOName(dso, *dsoDB),
                                               labelColor,
                                               relPos,
                                               Renderer::AlignLeft,
                                               Renderer::VerticalAlignCenter,
-                                              symbolSize);
+                                              symbolSize,
+                                              dso);
         }
     }     // labels enabled
 }
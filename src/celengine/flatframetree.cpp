@@ -0,0 +1,59 @@
+// flatframetree.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// A compact copy of a frame tree hierarchy, laid out in contiguous
+// memory for fast traversal.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <atomic>
+#include <limits>
+
+#include <celephem/orbit.h>
+
+#include "body.h"
+#include "flatframetree.h"
+#include "frametree.h"
+#include "timelinephase.h"
+
+
+FlatFrameTree::FlatFrameTree(const FrameTree& root)
+{
+    static std::atomic<std::uint64_t> nextId{ 0 };
+    id = nextId++;
+
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    nodes.push_back({ nullptr, nullptr, nullptr, nullptr, &root, -infinity, infinity, 0.0f, NoParent, 0, 0 });
+
+    // Breadth first, so that the children of each node end up adjacent
+    for (std::uint32_t i = 0; i < nodes.size(); i++)
+    {
+        const FrameTree* tree = nodes[i].subtree;
+        if (tree == nullptr)
+            continue;
+
+        auto firstChild = static_cast<std::uint32_t>(nodes.size());
+        unsigned int childCount = tree->childCount();
+        for (unsigned int j = 0; j < childCount; j++)
+        {
+            const TimelinePhase& phase = *tree->getChild(j);
+            Body* body = phase.body();
+            nodes.push_back({ body,
+                              phase.orbit(),
+                              dynamic_cast<const EllipticalOrbit*>(phase.orbit()),
+                              phase.orbitFrame().get(),
+                              body->getFrameTree(),
+                              phase.startTime(),
+                              phase.endTime(),
+                              body->getCullingRadius(),
+                              i, 0, 0 });
+        }
+
+        nodes[i].firstChild = firstChild;
+        nodes[i].childCount = childCount;
+    }
+}
@@ -0,0 +1,85 @@
+// flatframetree.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// A compact copy of a frame tree hierarchy, laid out in contiguous
+// memory for fast traversal.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Body;
+class EllipticalOrbit;
+class FrameTree;
+class Orbit;
+class ReferenceFrame;
+
+
+/*! A FlatFrameTree holds one node for every timeline phase in a frame tree
+ *  and all of its subtrees, with the data needed to traverse the hierarchy
+ *  stored inline rather than behind shared pointers. Node 0 stands for the
+ *  root tree itself. The children of a node, in the same order as the
+ *  phases of the node's frame tree, occupy a contiguous range of nodes.
+ *
+ *  The nodes refer to the phases' bodies, orbits and frames without owning
+ *  them, so a FlatFrameTree must be discarded whenever the frame tree it
+ *  was built from changes.
+ */
+class FlatFrameTree
+{
+ public:
+    static constexpr std::uint32_t NoParent = ~static_cast<std::uint32_t>(0);
+
+    struct Node
+    {
+        Body* body;
+        const Orbit* orbit;
+        // The orbit if it is a Keplerian orbit, whose positions can be
+        // computed in batches; otherwise nullptr
+        const EllipticalOrbit* ellipticalOrbit;
+        const ReferenceFrame* orbitFrame;
+        // Frame tree of the node's children, or nullptr if there are none
+        const FrameTree* subtree;
+        double startTime;
+        double endTime;
+        float cullingRadius;
+        std::uint32_t parent;
+        std::uint32_t firstChild;
+        std::uint32_t childCount;
+
+        bool includes(double t) const
+        {
+            return startTime <= t && t < endTime;
+        }
+    };
+
+    explicit FlatFrameTree(const FrameTree& root);
+
+    const Node& getNode(std::uint32_t index) const
+    {
+        return nodes[index];
+    }
+
+    std::size_t getNodeCount() const
+    {
+        return nodes.size();
+    }
+
+    //! Unique for every flattened tree built, even at a reused address
+    std::uint64_t getId() const
+    {
+        return id;
+    }
+
+ private:
+    std::vector<Node> nodes;
+    std::uint64_t id;
+};
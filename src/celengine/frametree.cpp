@@ -12,7 +12,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include "celengine/frametree.h"
+#include "celengine/bodyindex.h"
+#include "celengine/flatframetree.h"
 #include "celengine/timeline.h"
 #include "celengine/timelinephase.h"
 #include "celengine/frame.h"
@@ -39,6 +42,13 @@
  * objects themselves. Change tracking is performed whenever the frame tree
  * is modified: adding a node, removing a node, or changing the radius of an
  * object will all cause the tree to be marked as changed.
+ *
+ * Trees with many children, such as the asteroids and TNOs of the Sun,
+ * additionally keep a spatial index of their children's positions, so that
+ * culling and picking don't need to test every child. The index is reused
+ * for a while after it's built, with bounding spheres enlarged to cover
+ * how far each child can move in that time. The root tree of a solar system also keeps a flattened
+ * copy of the whole hierarchy, which is what traversals actually walk.
  */
 
 using namespace std;
@@ -68,6 +78,9 @@ FrameTree::FrameTree(Body* body) :
 }
 
 
+FrameTree::~FrameTree() = default;
+
+
 /*! Return the default reference frame for the object a frame tree is associated
  *  with.
  */
@@ -84,6 +97,8 @@ FrameTree::getDefaultReferenceFrame() const
 void
 FrameTree::markChanged()
 {
+    m_spatialIndex = nullptr;
+    m_flattened = nullptr;
     if (!m_changed)
     {
         m_changed = true;
@@ -188,3 +203,89 @@ FrameTree::childCount() const
 {
     return children.size();
 }
+
+
+namespace
+{
+// Longest time in days for which a spatial index is reused
+constexpr double MaxSpatialIndexAge = 1.0 / 24.0;
+}
+
+
+/*! Return a spatial index of the children that are active at time tdb, or
+ *  nullptr if the tree has too few children to benefit from one. The index
+ *  relies on the bounding spheres of subtrees, so it's only available when
+ *  they're up to date. It's rebuilt whenever the tree changes or tdb is
+ *  outside the interval for which the index is valid.
+ */
+const BodySpatialIndex*
+FrameTree::getSpatialIndex(double tdb) const
+{
+    if (m_changed || children.size() < BodySpatialIndex::MinChildren)
+        return nullptr;
+
+    if (m_spatialIndex != nullptr && m_spatialIndex->isValidAt(tdb))
+        return m_spatialIndex.get();
+
+    // The set of active children must stay the same while the index is in
+    // use, so it mustn't extend past the start or end of any phase.
+    double maxAge = MaxSpatialIndexAge;
+    for (const auto& phase : children)
+    {
+        maxAge = min(maxAge, abs(phase->startTime() - tdb));
+        maxAge = min(maxAge, abs(phase->endTime() - tdb));
+    }
+
+    std::vector<BodySpatialIndex::Entry> entries;
+    std::vector<unsigned int> alwaysVisited;
+    entries.reserve(children.size());
+    for (unsigned int i = 0; i < children.size(); i++)
+    {
+        const TimelinePhase& phase = *children[i];
+        if (!phase.includes(tdb))
+            continue;
+
+        // The planetshine of secondary illuminators reaches well beyond
+        // their culling radius, so they're tested individually.
+        const Body* body = phase.body();
+        const FrameTree* subtree = body->getFrameTree();
+        if (body->isSecondaryIlluminator() ||
+            (subtree != nullptr && subtree->containsSecondaryIlluminators()))
+        {
+            alwaysVisited.push_back(i);
+            continue;
+        }
+
+        const Orbit* orbit = phase.orbit();
+        Eigen::Vector3d position = phase.orbitFrame()->getOrientation(tdb).conjugate() *
+                                   orbit->positionAtTime(tdb);
+        double radius = max(body->getCullingRadius(), body->getRadius());
+        if (subtree != nullptr)
+            radius = max(radius, subtree->boundingSphereRadius());
+
+        // Wherever the child moves, it stays within the bounding radius of
+        // its orbit. When the orbit frame doesn't rotate, the distance it
+        // covers before the index expires is also limited by its speed.
+        double motion = position.norm() + orbit->getBoundingRadius();
+        if (phase.orbitFrame()->isInertial())
+            motion = min(motion, orbit->getMaximumSpeed() * maxAge);
+        entries.push_back({ position, radius + motion, i });
+    }
+
+    m_spatialIndex = std::make_unique<BodySpatialIndex>(std::move(entries), std::move(alwaysVisited), tdb, maxAge);
+    return m_spatialIndex.get();
+}
+
+
+/*! Return a flattened copy of the hierarchy rooted at this tree. Like the
+ *  bounding spheres, the copy is only valid once the changes to the tree
+ *  have been processed with recomputeBoundingSphere() and markUpdated().
+ */
+const FlatFrameTree&
+FrameTree::getFlattened() const
+{
+    assert(!m_changed);
+    if (m_flattened == nullptr)
+        m_flattened = std::make_unique<FlatFrameTree>(*this);
+    return *m_flattened;
+}
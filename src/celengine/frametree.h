@@ -21,13 +21,15 @@
 
 class Star;
 class Body;
+class BodySpatialIndex;
+class FlatFrameTree;
 
 class FrameTree
 {
 public:
     FrameTree(Star*);
     FrameTree(Body*);
-    ~FrameTree() = default;
+    ~FrameTree();
 
     /*! Return the star that this tree is associated with; it will be
      *  nullptr for frame trees associated with solar system bodies.
@@ -89,6 +91,9 @@ public:
         return m_childClassMask;
     }
 
+    const BodySpatialIndex* getSpatialIndex(double tdb) const;
+    const FlatFrameTree& getFlattened() const;
+
 private:
     Star* starParent;
     Body* bodyParent;
@@ -101,6 +106,9 @@ private:
     int m_childClassMask{ 0 };
 
     ReferenceFrame::SharedConstPtr defaultFrame;
+
+    mutable std::unique_ptr<BodySpatialIndex> m_spatialIndex;
+    mutable std::unique_ptr<FlatFrameTree> m_flattened;
 };
 
 #endif // _CELENGINE_FRAMETREE_H_
@@ -232,6 +232,39 @@ GLProgram::link()
 }
 
 
+void
+GLProgram::setBinaryRetrievable()
+{
+#ifndef GL_ES
+    glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+}
+
+
+bool
+GLProgram::getBinary(GLenum& format, vector<char>& binary) const
+{
+    GLint length = 0;
+#ifdef GL_ES
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+#else
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+#endif
+    if (length <= 0)
+        return false;
+
+    binary.resize(length);
+    GLsizei written = 0;
+#ifdef GL_ES
+    glGetProgramBinaryOES(id, length, &written, &format, binary.data());
+#else
+    glGetProgramBinary(id, length, &written, &format, binary.data());
+#endif
+    binary.resize(written);
+    return written > 0;
+}
+
+
 //************* GLShaderLoader ************
 
 GLShaderStatus
@@ -376,6 +409,36 @@ GLShaderLoader::CreateProgram(const string& vsSource,
 }
 
 
+// Create a program from a binary retrieved with GLProgram::getBinary. This
+// fails when the driver rejects the binary, e.g. after a driver update.
+GLShaderStatus
+GLShaderLoader::CreateProgramFromBinary(GLenum format,
+                                        const vector<char>& binary,
+                                        GLProgram** progOut)
+{
+    GLuint progid = glCreateProgram();
+
+    auto* prog = new GLProgram(progid);
+#ifdef GL_ES
+    glProgramBinaryOES(progid, format, binary.data(), static_cast<GLint>(binary.size()));
+#else
+    glProgramBinary(progid, format, binary.data(), static_cast<GLsizei>(binary.size()));
+#endif
+
+    GLint linkSuccess;
+    glGetProgramiv(progid, GL_LINK_STATUS, &linkSuccess);
+    if (linkSuccess != GL_TRUE)
+    {
+        delete prog;
+        return ShaderStatus_LinkError;
+    }
+
+    *progOut = prog;
+
+    return ShaderStatus_OK;
+}
+
+
 const string
 GetInfoLog(GLuint obj)
 {
@@ -75,6 +75,12 @@ class GLProgram
 
     GLShaderStatus link();
 
+    // Retrieve the binary of a linked program; requires program binary
+    // support, and on desktop GL, that the program was linked after
+    // setBinaryRetrievable() was called.
+    void setBinaryRetrievable();
+    bool getBinary(GLenum& format, std::vector<char>& binary) const;
+
     void use() const;
     GLuint getID() const { return id; }
 
@@ -184,6 +190,9 @@ class GLShaderLoader
     static GLShaderStatus CreateProgram(const std::string& vsSource,
                                         const std::string& fsSource,
                                         GLProgram**);
+    static GLShaderStatus CreateProgramFromBinary(GLenum format,
+                                                  const std::vector<char>& binary,
+                                                  GLProgram**);
 };
 
 
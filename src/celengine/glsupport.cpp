@@ -7,9 +7,11 @@ namespace celestia::gl
 #ifdef GL_ES
 bool OES_vertex_array_object        = false;
 bool OES_texture_border_clamp       = false;
+bool OES_get_program_binary         = false;
 #else
 bool ARB_vertex_array_object        = false;
 bool EXT_framebuffer_object         = false;
+bool ARB_get_program_binary         = false;
 #endif
 bool ARB_shader_texture_lod         = false;
 bool EXT_texture_compression_s3tc   = false;
@@ -38,9 +40,11 @@ bool init(util::array_view<std::string> ignore) noexcept
 #ifdef GL_ES
     OES_vertex_array_object        = check_extension(ignore, "GL_OES_vertex_array_object");
     OES_texture_border_clamp       = check_extension(ignore, "GL_OES_texture_border_clamp") || check_extension(ignore, "GL_EXT_texture_border_clamp") ;
+    OES_get_program_binary         = check_extension(ignore, "GL_OES_get_program_binary");
 #else
     ARB_vertex_array_object        = check_extension(ignore, "GL_ARB_vertex_array_object");
     EXT_framebuffer_object         = check_extension(ignore, "GL_EXT_framebuffer_object");
+    ARB_get_program_binary         = check_extension(ignore, "GL_ARB_get_program_binary");
 #endif
     ARB_shader_texture_lod         = check_extension(ignore, "GL_ARB_shader_texture_lod");
     EXT_texture_compression_s3tc   = check_extension(ignore, "GL_EXT_texture_compression_s3tc");
@@ -61,6 +65,18 @@ bool init(util::array_view<std::string> ignore) noexcept
 
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
 
+    // Some drivers advertise program binaries without supporting any format
+    GLint binaryFormats = 0;
+#ifdef GL_ES
+    if (OES_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &binaryFormats);
+    OES_get_program_binary = binaryFormats > 0;
+#else
+    if (ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    ARB_get_program_binary = binaryFormats > 0;
+#endif
+
     if (gl::EXT_texture_filter_anisotropic)
         glGetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxTextureAnisotropy);
 
@@ -28,9 +28,11 @@ extern bool MESA_pack_invert;
 #ifdef GL_ES
 extern bool OES_vertex_array_object;
 extern bool OES_texture_border_clamp;
+extern bool OES_get_program_binary;
 #else
 extern bool ARB_vertex_array_object;
 extern bool EXT_framebuffer_object;
+extern bool ARB_get_program_binary;
 #endif
 extern GLint maxPointSize;
 extern GLint maxTextureSize;
@@ -28,23 +28,53 @@ AssociativeArray::~AssociativeArray()
 }
 
 
-Value* AssociativeArray::getValue(const string& key) const
+Value* AssociativeArray::getValue(std::string_view key) const
 {
-    map<string, Value*>::const_iterator iter = assoc.find(key);
-    if (iter == assoc.end())
-        return nullptr;
+    for (const auto& entry : assoc)
+    {
+        if (entry.first == key)
+            return entry.second;
+    }
+
+    return nullptr;
+}
+
+
+void AssociativeArray::addValue(std::string key, Value& val)
+{
+    // Like std::map::insert, keep the first value added for a key
+    if (getValue(key) != nullptr)
+    {
+        delete &val;
+        return;
+    }
 
-    return iter->second;
+    assoc.emplace_back(std::move(key), &val);
 }
 
 
-void AssociativeArray::addValue(const string& key, Value& val)
+/**
+ * Looks up the unit annotation "key%suffix" without building the key.
+ */
+Value* AssociativeArray::getUnitValue(std::string_view key, std::string_view suffix) const
 {
-    assoc.insert(map<string, Value*>::value_type(key, &val));
+    for (const auto& entry : assoc)
+    {
+        std::string_view name = entry.first;
+        if (name.size() == key.size() + suffix.size() + 1
+            && name.compare(0, key.size(), key) == 0
+            && name[key.size()] == '%'
+            && name.compare(key.size() + 1, suffix.size(), suffix) == 0)
+        {
+            return entry.second;
+        }
+    }
+
+    return nullptr;
 }
 
 
-bool AssociativeArray::getNumber(const string& key, double& val) const
+bool AssociativeArray::getNumber(std::string_view key, double& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::NumberType)
@@ -55,7 +85,7 @@ bool AssociativeArray::getNumber(const string& key, double& val) const
 }
 
 
-bool AssociativeArray::getNumber(const string& key, float& val) const
+bool AssociativeArray::getNumber(std::string_view key, float& val) const
 {
     double dval;
 
@@ -67,7 +97,7 @@ bool AssociativeArray::getNumber(const string& key, float& val) const
 }
 
 
-bool AssociativeArray::getNumber(const string& key, int& val) const
+bool AssociativeArray::getNumber(std::string_view key, int& val) const
 {
     double ival;
 
@@ -79,7 +109,7 @@ bool AssociativeArray::getNumber(const string& key, int& val) const
 }
 
 
-bool AssociativeArray::getNumber(const string& key, uint32_t& val) const
+bool AssociativeArray::getNumber(std::string_view key, uint32_t& val) const
 {
     double ival;
 
@@ -91,7 +121,7 @@ bool AssociativeArray::getNumber(const string& key, uint32_t& val) const
 }
 
 
-bool AssociativeArray::getString(const string& key, string& val) const
+bool AssociativeArray::getString(std::string_view key, string& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::StringType)
@@ -102,7 +132,7 @@ bool AssociativeArray::getString(const string& key, string& val) const
 }
 
 
-bool AssociativeArray::getPath(const string& key, fs::path& val) const
+bool AssociativeArray::getPath(std::string_view key, fs::path& val) const
 {
     string v;
     if (getString(key, v))
@@ -114,7 +144,7 @@ bool AssociativeArray::getPath(const string& key, fs::path& val) const
 }
 
 
-bool AssociativeArray::getBoolean(const string& key, bool& val) const
+bool AssociativeArray::getBoolean(std::string_view key, bool& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::BooleanType)
@@ -125,7 +155,7 @@ bool AssociativeArray::getBoolean(const string& key, bool& val) const
 }
 
 
-bool AssociativeArray::getVector(const string& key, Vector3d& val) const
+bool AssociativeArray::getVector(std::string_view key, Vector3d& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::ArrayType)
@@ -149,7 +179,7 @@ bool AssociativeArray::getVector(const string& key, Vector3d& val) const
 }
 
 
-bool AssociativeArray::getVector(const string& key, Vector3f& val) const
+bool AssociativeArray::getVector(std::string_view key, Vector3f& val) const
 {
     Vector3d vecVal;
 
@@ -161,7 +191,7 @@ bool AssociativeArray::getVector(const string& key, Vector3f& val) const
 }
 
 
-bool AssociativeArray::getVector(const string& key, Vector4d& val) const
+bool AssociativeArray::getVector(std::string_view key, Vector4d& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::ArrayType)
@@ -187,7 +217,7 @@ bool AssociativeArray::getVector(const string& key, Vector4d& val) const
 }
 
 
-bool AssociativeArray::getVector(const string& key, Vector4f& val) const
+bool AssociativeArray::getVector(std::string_view key, Vector4f& val) const
 {
     Vector4d vecVal;
 
@@ -209,7 +239,7 @@ bool AssociativeArray::getVector(const string& key, Vector4f& val) const
  * @param[out] val A quaternion representing the value if present, unaffected if not.
  * @return True if the key exists in the hash, false otherwise.
  */
-bool AssociativeArray::getRotation(const string& key, Eigen::Quaternionf& val) const
+bool AssociativeArray::getRotation(std::string_view key, Eigen::Quaternionf& val) const
 {
     Value* v = getValue(key);
     if (v == nullptr || v->getType() != Value::ArrayType)
@@ -245,7 +275,7 @@ bool AssociativeArray::getRotation(const string& key, Eigen::Quaternionf& val) c
 }
 
 
-bool AssociativeArray::getColor(const string& key, Color& val) const
+bool AssociativeArray::getColor(std::string_view key, Color& val) const
 {
     Vector4d vec4;
     if (getVector(key, vec4))
@@ -282,7 +312,7 @@ bool AssociativeArray::getColor(const string& key, Color& val) const
  * @return True if the key exists in the hash, false otherwise.
  */
 bool
-AssociativeArray::getAngle(const string& key, double& val, double outputScale, double defaultScale) const
+AssociativeArray::getAngle(std::string_view key, double& val, double outputScale, double defaultScale) const
 {
     if (!getNumber(key, val))
         return false;
@@ -305,7 +335,7 @@ AssociativeArray::getAngle(const string& key, double& val, double outputScale, d
 
 /** @copydoc AssociativeArray::getAngle() */
 bool
-AssociativeArray::getAngle(const string& key, float& val, double outputScale, double defaultScale) const
+AssociativeArray::getAngle(std::string_view key, float& val, double outputScale, double defaultScale) const
 {
     double dval;
 
@@ -327,7 +357,7 @@ AssociativeArray::getAngle(const string& key, float& val, double outputScale, do
  * @return True if the key exists in the hash, false otherwise.
  */
 bool
-AssociativeArray::getLength(const string& key, double& val, double outputScale, double defaultScale) const
+AssociativeArray::getLength(std::string_view key, double& val, double outputScale, double defaultScale) const
 {
     if(!getNumber(key, val))
         return false;
@@ -349,7 +379,7 @@ AssociativeArray::getLength(const string& key, double& val, double outputScale,
 
 
 /** @copydoc AssociativeArray::getLength() */
-bool AssociativeArray::getLength(const string& key, float& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getLength(std::string_view key, float& val, double outputScale, double defaultScale) const
 {
     double dval;
 
@@ -370,7 +400,7 @@ bool AssociativeArray::getLength(const string& key, float& val, double outputSca
  * @param[in] defaultScale If no units are specified, use this scale. Defaults to outputScale.
  * @return True if the key exists in the hash, false otherwise.
  */
-bool AssociativeArray::getTime(const string& key, double& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getTime(std::string_view key, double& val, double outputScale, double defaultScale) const
 {
     if(!getNumber(key, val))
         return false;
@@ -392,7 +422,7 @@ bool AssociativeArray::getTime(const string& key, double& val, double outputScal
 
 
 /** @copydoc AssociativeArray::getTime() */
-bool AssociativeArray::getTime(const string& key, float& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getTime(std::string_view key, float& val, double outputScale, double defaultScale) const
 {
     double dval;
 
@@ -413,7 +443,7 @@ bool AssociativeArray::getTime(const string& key, float& val, double outputScale
  * @param[in] defaultScale If no units are specified, use this scale. Defaults to outputScale.
  * @return True if the key exists in the hash, false otherwise.
  */
-bool AssociativeArray::getMass(const string& key, double& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getMass(std::string_view key, double& val, double outputScale, double defaultScale) const
 {
     if(!getNumber(key, val))
         return false;
@@ -435,7 +465,7 @@ bool AssociativeArray::getMass(const string& key, double& val, double outputScal
 
 
 /** @copydoc AssociativeArray::getMass() */
-bool AssociativeArray::getMass(const string& key, float& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getMass(std::string_view key, float& val, double outputScale, double defaultScale) const
 {
     double dval;
 
@@ -456,7 +486,7 @@ bool AssociativeArray::getMass(const string& key, float& val, double outputScale
  * @param[in] defaultScale If no units are specified, use this scale. Defaults to outputScale.
  * @return True if the key exists in the hash, false otherwise.
  */
-bool AssociativeArray::getLengthVector(const string& key, Eigen::Vector3d& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getLengthVector(std::string_view key, Eigen::Vector3d& val, double outputScale, double defaultScale) const
 {
     if(!getVector(key, val))
         return false;
@@ -478,7 +508,7 @@ bool AssociativeArray::getLengthVector(const string& key, Eigen::Vector3d& val,
 
 
 /** @copydoc AssociativeArray::getLengthVector() */
-bool AssociativeArray::getLengthVector(const string& key, Eigen::Vector3f& val, double outputScale, double defaultScale) const
+bool AssociativeArray::getLengthVector(std::string_view key, Eigen::Vector3f& val, double outputScale, double defaultScale) const
 {
     Vector3d vecVal;
 
@@ -496,7 +526,7 @@ bool AssociativeArray::getLengthVector(const string& key, Eigen::Vector3f& val,
  * @param[out] val The returned tuple in units of degrees and kilometers if present, unaffected if not.
  * @return True if the key exists in the hash, false otherwise.
  */
-bool AssociativeArray::getSphericalTuple(const string& key, Vector3d& val) const
+bool AssociativeArray::getSphericalTuple(std::string_view key, Vector3d& val) const
 {
     if(!getVector(key, val))
         return false;
@@ -517,7 +547,7 @@ bool AssociativeArray::getSphericalTuple(const string& key, Vector3d& val) const
 
 
 /** @copydoc AssociativeArray::getSphericalTuple */
-bool AssociativeArray::getSphericalTuple(const string& key, Vector3f& val) const
+bool AssociativeArray::getSphericalTuple(std::string_view key, Vector3f& val) const
 {
     Vector3d vecVal;
 
@@ -535,20 +565,18 @@ bool AssociativeArray::getSphericalTuple(const string& key, Vector3f& val) const
  * @param[out] scale The returned angle unit scaled to degrees if present, unaffected if not.
  * @return True if an angle unit has been specified for the property, false otherwise.
  */
-bool AssociativeArray::getAngleScale(const string& key, double& scale) const
+bool AssociativeArray::getAngleScale(std::string_view key, double& scale) const
 {
-    string unitKey(key + "%Angle");
-    string unit;
-
-    if (!getString(unitKey, unit))
+    Value* unit = getUnitValue(key, "Angle");
+    if (unit == nullptr || unit->getType() != Value::StringType)
         return false;
 
-    return astro::getAngleScale(unit, scale);
+    return astro::getAngleScale(unit->getStringView(), scale);
 }
 
 
 /** @copydoc AssociativeArray::getAngleScale() */
-bool AssociativeArray::getAngleScale(const string& key, float& scale) const
+bool AssociativeArray::getAngleScale(std::string_view key, float& scale) const
 {
     double dscale;
     if (!getAngleScale(key, dscale))
@@ -565,20 +593,18 @@ bool AssociativeArray::getAngleScale(const string& key, float& scale) const
  * @param[out] scale The returned length unit scaled to kilometers if present, unaffected if not.
  * @return True if a length unit has been specified for the property, false otherwise.
  */
-bool AssociativeArray::getLengthScale(const string& key, double& scale) const
+bool AssociativeArray::getLengthScale(std::string_view key, double& scale) const
 {
-    string unitKey(key + "%Length");
-    string unit;
-
-    if (!getString(unitKey, unit))
+    Value* unit = getUnitValue(key, "Length");
+    if (unit == nullptr || unit->getType() != Value::StringType)
         return false;
 
-    return astro::getLengthScale(unit, scale);
+    return astro::getLengthScale(unit->getStringView(), scale);
 }
 
 
 /** @copydoc AssociativeArray::getLengthScale() */
-bool AssociativeArray::getLengthScale(const string& key, float& scale) const
+bool AssociativeArray::getLengthScale(std::string_view key, float& scale) const
 {
     double dscale;
     if (!getLengthScale(key, dscale))
@@ -595,20 +621,18 @@ bool AssociativeArray::getLengthScale(const string& key, float& scale) const
  * @param[out] scale The returned time unit scaled to days if present, unaffected if not.
  * @return True if a time unit has been specified for the property, false otherwise.
  */
-bool AssociativeArray::getTimeScale(const string& key, double& scale) const
+bool AssociativeArray::getTimeScale(std::string_view key, double& scale) const
 {
-    string unitKey(key + "%Time");
-    string unit;
-
-    if (!getString(unitKey, unit))
+    Value* unit = getUnitValue(key, "Time");
+    if (unit == nullptr || unit->getType() != Value::StringType)
         return false;
 
-    return astro::getTimeScale(unit, scale);
+    return astro::getTimeScale(unit->getStringView(), scale);
 }
 
 
 /** @copydoc AssociativeArray::getTimeScale() */
-bool AssociativeArray::getTimeScale(const string& key, float& scale) const
+bool AssociativeArray::getTimeScale(std::string_view key, float& scale) const
 {
     double dscale;
     if (!getTimeScale(key, dscale))
@@ -625,20 +649,18 @@ bool AssociativeArray::getTimeScale(const string& key, float& scale) const
  * @param[out] scale The returned mass unit scaled to Earth mass if present, unaffected if not.
  * @return True if a mass unit has been specified for the property, false otherwise.
  */
-bool AssociativeArray::getMassScale(const string& key, double& scale) const
+bool AssociativeArray::getMassScale(std::string_view key, double& scale) const
 {
-    string unitKey(key + "%Mass");
-    string unit;
-
-    if (!getString(unitKey, unit))
+    Value* unit = getUnitValue(key, "Mass");
+    if (unit == nullptr || unit->getType() != Value::StringType)
         return false;
 
-    return astro::getMassScale(unit, scale);
+    return astro::getMassScale(unit->getStringView(), scale);
 }
 
 
 /** @copydoc AssociativeArray::getMassScale() */
-bool AssociativeArray::getMassScale(const string& key, float& scale) const
+bool AssociativeArray::getMassScale(std::string_view key, float& scale) const
 {
     double dscale;
     if (!getMassScale(key, dscale))
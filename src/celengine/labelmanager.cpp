@@ -0,0 +1,293 @@
+// labelmanager.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Name caching and screen space decluttering for star and deep sky
+// object labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <celttf/truetypefont.h>
+#include "dsodb.h"
+#include "labelmanager.h"
+#include "stardb.h"
+
+
+namespace
+{
+
+// Upper bound on the number of cached names; the cache is simply
+// discarded when it fills up.
+constexpr std::size_t MaxCachedNames = 65536;
+
+// Priority bonus for labels that were shown in the previous frame; the
+// label opacity used as the base priority ranges from 0 to 1.
+constexpr float HysteresisBonus = 0.25f;
+
+// Empty space kept around each label, in pixels
+constexpr float LabelPadding = 1.0f;
+
+template<typename DB>
+std::uint32_t
+namesChangeCount(const DB* db)
+{
+    if (db == nullptr || db->getNameDatabase() == nullptr)
+        return 0;
+    return db->getNameDatabase()->getChangeCount();
+}
+
+} // end unnamed namespace
+
+
+void
+LabelManager::beginFrame(const StarDatabase* starDB, const DSODatabase* dsoDB)
+{
+    std::uint32_t starChanges = namesChangeCount(starDB);
+    std::uint32_t dsoChanges = namesChangeCount(dsoDB);
+    if (starDB != namesStarDB || dsoDB != namesDSODB ||
+        starChanges != starNamesChangeCount || dsoChanges != dsoNamesChangeCount ||
+        names.size() >= MaxCachedNames)
+    {
+        names.clear();
+        namesStarDB = starDB;
+        namesDSODB = dsoDB;
+        starNamesChangeCount = starChanges;
+        dsoNamesChangeCount = dsoChanges;
+    }
+}
+
+
+const std::string&
+LabelManager::getStarName(const Star& star, const StarDatabase& starDB)
+{
+    auto [iter, inserted] = names.try_emplace(&star);
+    if (inserted)
+    {
+        StarDatabase::NameBuffer buffer;
+        iter->second.name = starDB.getStarName(star, buffer, true);
+    }
+    return iter->second.name;
+}
+
+
+const std::string&
+LabelManager::getDSOName(const DeepSkyObject* dso, const DSODatabase& dsoDB)
+{
+    auto [iter, inserted] = names.try_emplace(dso);
+    if (inserted)
+        iter->second.name = dsoDB.getDSOName(dso, true);
+    return iter->second.name;
+}
+
+
+int
+LabelManager::getWidth(const void* object, const std::string& text, const TextureFont& font)
+{
+    auto iter = names.find(object);
+    if (iter == names.end())
+        return font.getWidth(text);
+
+    if (iter->second.width < 0)
+        iter->second.width = font.getWidth(text);
+    return iter->second.width;
+}
+
+
+void
+LabelManager::declutter(std::vector<Renderer::Annotation>& annotations,
+                        const TextureFont& font,
+                        int windowWidth,
+                        int windowHeight)
+{
+    if (&font != widthFont)
+    {
+        for (auto& entry : names)
+            entry.second.width = -1;
+        widthFont = &font;
+    }
+
+    for (Renderer::Annotation& a : annotations)
+    {
+        if (a.object != nullptr && a.labelWidth < 0 && !a.getLabelText().empty())
+            a.labelWidth = getWidth(a.object, a.getLabelText(), font);
+    }
+
+    declutter(annotations, font.getHeight(), windowWidth, windowHeight);
+}
+
+
+void
+LabelManager::declutter(std::vector<Renderer::Annotation>& annotations,
+                        int fontHeight,
+                        int windowWidth,
+                        int windowHeight)
+{
+    candidates.clear();
+    for (std::size_t i = 0; i < annotations.size(); i++)
+    {
+        const Renderer::Annotation& a = annotations[i];
+        if (a.object != nullptr && !a.getLabelText().empty())
+            candidates.push_back({ i, a.object, a.position.head<2>(), a.color.alpha(), false });
+    }
+
+    // When paused with a still camera, every label lands exactly where it
+    // did in the previous frame.
+    bool unchanged = std::equal(candidates.begin(), candidates.end(),
+                                previousCandidates.begin(), previousCandidates.end(),
+                                [](const Candidate& a, const Candidate& b)
+                                {
+                                    return a.object == b.object && a.position == b.position;
+                                });
+    if (unchanged)
+    {
+        for (std::size_t i = 0; i < candidates.size(); i++)
+            candidates[i].shown = previousCandidates[i].shown;
+    }
+    else
+    {
+        layout(fontHeight, annotations, windowWidth, windowHeight);
+    }
+
+    previouslyShown.clear();
+    for (const Candidate& c : candidates)
+    {
+        if (c.shown)
+            previouslyShown.insert(c.object);
+        else
+            annotations[c.annotation].hideLabel();
+    }
+
+    annotations.erase(std::remove_if(annotations.begin(), annotations.end(),
+                                     [](const Renderer::Annotation& a)
+                                     {
+                                         return a.getLabelText().empty() && a.markerRep == nullptr;
+                                     }),
+                      annotations.end());
+
+    std::swap(candidates, previousCandidates);
+}
+
+
+void
+LabelManager::layout(int fontHeight,
+                     const std::vector<Renderer::Annotation>& annotations,
+                     int windowWidth,
+                     int windowHeight)
+{
+    auto height = static_cast<float>(fontHeight);
+
+    // Bucket the placed labels into a grid of cells a few labels tall, so
+    // that each new label is only tested against its neighbors.
+    float cellSize = std::max(4.0f * height, 32.0f);
+    int columns = std::max(1, static_cast<int>(std::ceil(static_cast<float>(windowWidth) / cellSize)));
+    int rows = std::max(1, static_cast<int>(std::ceil(static_cast<float>(windowHeight) / cellSize)));
+    grid.resize(static_cast<std::size_t>(columns * rows));
+    for (auto& cell : grid)
+        cell.clear();
+    boxes.clear();
+
+    order.resize(candidates.size());
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        order[i] = i;
+        if (previouslyShown.count(candidates[i].object) != 0)
+            candidates[i].priority += HysteresisBonus;
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [this](std::size_t a, std::size_t b)
+                     {
+                         return candidates[a].priority > candidates[b].priority;
+                     });
+
+    for (std::size_t index : order)
+    {
+        Candidate& c = candidates[index];
+        const Renderer::Annotation& a = annotations[c.annotation];
+        auto width = static_cast<float>(std::max(a.labelWidth, 0));
+
+        // Offsets match the ones used by Renderer::renderAnnotations
+        float hOffset = 2.0f;
+        switch (a.halign)
+        {
+        case Renderer::AlignCenter:
+            hOffset = -std::floor(width / 2.0f);
+            break;
+        case Renderer::AlignRight:
+            hOffset = -(width + 2.0f);
+            break;
+        case Renderer::AlignLeft:
+            if (a.markerRep != nullptr)
+                hOffset = 2.0f + std::floor(a.markerRep->size() / 2.0f);
+            break;
+        }
+
+        float vOffset = 0.0f;
+        switch (a.valign)
+        {
+        case Renderer::VerticalAlignCenter:
+            vOffset = -std::floor(height / 2.0f);
+            break;
+        case Renderer::VerticalAlignTop:
+            vOffset = -height;
+            break;
+        case Renderer::VerticalAlignBottom:
+            break;
+        }
+
+        Box box;
+        box.x0 = c.position.x() + hOffset - LabelPadding;
+        box.y0 = c.position.y() + vOffset - LabelPadding;
+        box.x1 = box.x0 + width + 2.0f * LabelPadding;
+        box.y1 = box.y0 + height + 2.0f * LabelPadding;
+
+        // Labels entirely off screen can't hide anything
+        if (box.x1 < 0.0f || box.y1 < 0.0f ||
+            box.x0 > static_cast<float>(windowWidth) || box.y0 > static_cast<float>(windowHeight))
+        {
+            c.shown = true;
+            continue;
+        }
+
+        int col0 = std::clamp(static_cast<int>(box.x0 / cellSize), 0, columns - 1);
+        int col1 = std::clamp(static_cast<int>(box.x1 / cellSize), 0, columns - 1);
+        int row0 = std::clamp(static_cast<int>(box.y0 / cellSize), 0, rows - 1);
+        int row1 = std::clamp(static_cast<int>(box.y1 / cellSize), 0, rows - 1);
+
+        bool overlaps = false;
+        for (int row = row0; row <= row1 && !overlaps; row++)
+        {
+            for (int col = col0; col <= col1 && !overlaps; col++)
+            {
+                for (std::uint32_t other : grid[row * columns + col])
+                {
+                    const Box& b = boxes[other];
+                    if (box.x0 < b.x1 && b.x0 < box.x1 && box.y0 < b.y1 && b.y0 < box.y1)
+                    {
+                        overlaps = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (overlaps)
+            continue;
+
+        auto boxIndex = static_cast<std::uint32_t>(boxes.size());
+        boxes.push_back(box);
+        for (int row = row0; row <= row1; row++)
+        {
+            for (int col = col0; col <= col1; col++)
+                grid[row * columns + col].push_back(boxIndex);
+        }
+        c.shown = true;
+    }
+}
@@ -0,0 +1,122 @@
+// labelmanager.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Name caching and screen space decluttering for star and deep sky
+// object labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "render.h"
+
+class DeepSkyObject;
+class DSODatabase;
+class Star;
+class StarDatabase;
+class TextureFont;
+
+
+class LabelManager
+{
+ public:
+    LabelManager() = default;
+    ~LabelManager() = default;
+
+    LabelManager(const LabelManager&) = delete;
+    LabelManager& operator=(const LabelManager&) = delete;
+
+    /*! Start a new frame. Cached names are dropped when the star or deep
+     *  sky object catalog has been replaced, when names have been added to
+     *  either since the previous frame, or when the cache is full.
+     */
+    void beginFrame(const StarDatabase* starDB, const DSODatabase* dsoDB);
+
+    /*! Return the localized label text for a star or deep sky object.
+     *  Names are looked up once and cached. The reference remains valid
+     *  until the next call to beginFrame(), so annotations can refer to it
+     *  instead of holding a copy.
+     */
+    const std::string& getStarName(const Star& star, const StarDatabase& starDB);
+    const std::string& getDSOName(const DeepSkyObject* dso, const DSODatabase& dsoDB);
+
+    /*! Remove the labels of annotations that would overlap a label of
+     *  higher priority, and drop annotations that are left with neither a
+     *  label nor a marker. Only annotations with an object are considered.
+     *  Priority follows the label opacity, which fades with apparent
+     *  brightness; labels shown in the previous frame are favored so that
+     *  the layout stays put while the camera moves slowly. If no label has
+     *  moved since the previous frame, its layout is reused as is.
+     *
+     *  The label widths of these annotations are set from the cache.
+     */
+    void declutter(std::vector<Renderer::Annotation>& annotations,
+                   const TextureFont& font,
+                   int windowWidth,
+                   int windowHeight);
+
+    /*! Declutter annotations whose label widths have already been set,
+     *  for labels of the given height.
+     */
+    void declutter(std::vector<Renderer::Annotation>& annotations,
+                   int fontHeight,
+                   int windowWidth,
+                   int windowHeight);
+
+ private:
+    struct CachedName
+    {
+        std::string name;
+        int width{ -1 };
+    };
+
+    struct Candidate
+    {
+        std::size_t annotation;
+        const void* object;
+        Eigen::Vector2f position;
+        float priority;
+        bool shown;
+    };
+
+    struct Box
+    {
+        float x0;
+        float y0;
+        float x1;
+        float y1;
+    };
+
+    int getWidth(const void* object, const std::string& text, const TextureFont& font);
+    void layout(int fontHeight,
+                const std::vector<Renderer::Annotation>& annotations,
+                int windowWidth,
+                int windowHeight);
+
+    std::unordered_map<const void*, CachedName> names;
+    const StarDatabase* namesStarDB{ nullptr };
+    const DSODatabase* namesDSODB{ nullptr };
+    std::uint32_t starNamesChangeCount{ 0 };
+    std::uint32_t dsoNamesChangeCount{ 0 };
+    const TextureFont* widthFont{ nullptr };
+
+    std::vector<Candidate> candidates;
+    std::vector<Candidate> previousCandidates;
+    std::unordered_set<const void*> previouslyShown;
+    std::vector<std::size_t> order;
+    std::vector<Box> boxes;
+    std::vector<std::vector<std::uint32_t>> grid;
+};
@@ -12,8 +12,10 @@
 #include <cassert>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
+#include <celutil/logger.h>
 #include "glsupport.h"
 #include "lodspheremesh.h"
 #include "shadermanager.h"
@@ -21,6 +23,7 @@
 using namespace std;
 using namespace Eigen;
 using namespace celmath;
+using celestia::util::GetLogger;
 
 constexpr const int maxDivisions = 16384;
 constexpr const int thetaDivisions = maxDivisions;
@@ -39,6 +42,10 @@ static float* cosTheta = nullptr;
 //     tex coords - 2 floats * MAX_SPHERE_MESH_TEXTURES
 constexpr const int MaxVertexSize = 3 + 3 + 3 + MAX_SPHERE_MESH_TEXTURES * 2;
 
+// Upper bound on the GPU memory used for cached patch vertex buffers. A
+// full resolution patch with four texture coordinate sets is about 0.5 MB.
+constexpr const std::size_t MaxPatchCacheBytes = 32 * 1024 * 1024;
+
 // TODO: figure out how to use std eigen's methods instead
 static Vector3f intersect3(const Frustum::PlaneType& p0,
                            const Frustum::PlaneType& p1,
@@ -120,6 +127,9 @@ LODSphereMesh::LODSphereMesh()
 
 LODSphereMesh::~LODSphereMesh()
 {
+    for (const auto& [key, patch] : patchCache)
+        glDeleteBuffers(1, &patch.vertexBuffer);
+
     delete[] vertices;
     delete[] indices;
 }
@@ -260,38 +270,44 @@ void LODSphereMesh::render(unsigned int attributes,
     }
 
     currentVB = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVB]);
 
-    // Set up the mesh vertices
+    // Set up the mesh indices; all sections drawn with the same step share
+    // them, so they only need to be uploaded when the step changes.
     int nRings = phiExtent / ri.step;
     int nSlices = thetaExtent / ri.step;
 
-    int n2 = 0;
-    for (i = 0; i < nRings; i++)
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    if (nRings != indexRings || nSlices != indexSlices)
     {
-        if (i > 0)
+        int n2 = 0;
+        for (i = 0; i < nRings; i++)
         {
-            indices[n2 + 0] = i * (nSlices + 1) + 0;
-            n2++;
-        }
-        for (int j = 0; j <= nSlices; j++)
-        {
-            indices[n2 + 0] = i * (nSlices + 1) + j;
-            indices[n2 + 1] = (i + 1) * (nSlices + 1) + j;
-            n2 += 2;
-        }
-        if (i < nRings - 1)
-        {
-            indices[n2] = (i + 1) * (nSlices + 1) + nSlices;
-            n2++;
+            if (i > 0)
+            {
+                indices[n2 + 0] = i * (nSlices + 1) + 0;
+                n2++;
+            }
+            for (int j = 0; j <= nSlices; j++)
+            {
+                indices[n2 + 0] = i * (nSlices + 1) + j;
+                indices[n2 + 1] = (i + 1) * (nSlices + 1) + j;
+                n2 += 2;
+            }
+            if (i < nRings - 1)
+            {
+                indices[n2] = (i + 1) * (nSlices + 1) + nSlices;
+                n2++;
+            }
         }
-    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 nIndices * sizeof(indices[0]),
-                 indices,
-                 GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     n2 * sizeof(indices[0]),
+                     indices,
+                     GL_DYNAMIC_DRAW);
+        stats.bytesUploaded += n2 * sizeof(indices[0]);
+        indexRings = nRings;
+        indexSlices = nSlices;
+    }
 
     // Compute the size of a vertex
     vertexSize = 3;
@@ -458,9 +474,72 @@ void LODSphereMesh::renderPatches(int phi0, int theta0,
 }
 
 
-void LODSphereMesh::renderSection(int phi0, int theta0, int extent,
-                                  const RenderInfo& ri)
+void LODSphereMesh::beginFrame()
+{
+    if (stats.bytesUploaded > 0)
+    {
+        GetLogger()->debug("Sphere patches: {} drawn, {} from cache, {} bytes uploaded, {} bytes cached\n",
+                           stats.patchesDrawn, stats.patchCacheHits,
+                           stats.bytesUploaded, stats.patchCacheBytes);
+    }
 
+    frameNumber++;
+    stats.bytesUploaded = 0;
+    stats.patchesDrawn = 0;
+    stats.patchCacheHits = 0;
+}
+
+
+bool LODSphereMesh::PatchKey::operator==(const PatchKey& other) const
+{
+    return step == other.step && phi0 == other.phi0 && theta0 == other.theta0 &&
+           extent == other.extent && attributes == other.attributes &&
+           nTextures == other.nTextures && texCoords == other.texCoords;
+}
+
+
+std::size_t LODSphereMesh::PatchKeyHash::operator()(const PatchKey& key) const
+{
+    std::size_t h = std::hash<int>()(key.step);
+    auto combine = [&h](std::size_t v) { h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2); };
+    combine(std::hash<int>()(key.phi0));
+    combine(std::hash<int>()(key.theta0));
+    combine(std::hash<int>()(key.extent));
+    combine(std::hash<unsigned int>()(key.attributes));
+    for (int i = 0; i < key.nTextures * 4; i++)
+        combine(std::hash<float>()(key.texCoords[i]));
+    return h;
+}
+
+
+// Make room for required bytes in the patch cache by deleting the least
+// recently used patches. Patches drawn in the current frame are kept, so
+// this fails if they alone would exceed the budget.
+bool LODSphereMesh::evictPatches(std::size_t required)
+{
+    if (required > MaxPatchCacheBytes)
+        return false;
+
+    while (stats.patchCacheBytes + required > MaxPatchCacheBytes)
+    {
+        if (patchLRU.empty())
+            return false;
+
+        auto oldest = patchCache.find(patchLRU.back());
+        if (oldest->second.lastUsed == frameNumber)
+            return false;
+
+        glDeleteBuffers(1, &oldest->second.vertexBuffer);
+        stats.patchCacheBytes -= oldest->second.size;
+        patchCache.erase(oldest);
+        patchLRU.pop_back();
+    }
+
+    return true;
+}
+
+
+void LODSphereMesh::setVertexPointers(const RenderInfo& ri)
 {
     auto stride = (GLsizei) (vertexSize * sizeof(float));
     int texCoordOffset = ((ri.attributes & Tangents) != 0) ? 6 : 3;
@@ -489,15 +568,88 @@ void LODSphereMesh::renderSection(int phi0, int theta0, int extent,
                               3, GL_FLOAT, GL_FALSE,
                               stride, vertexBase + 3); // 3 == tangentOffset
     }
+}
+
+
+// Generate the vertices of a section into the vertices array; returns the
+// number of floats written.
+int LODSphereMesh::fillSectionVertices(int phi0, int theta0, int extent,
+                                       const RenderInfo& ri,
+                                       const float* u0, const float* v0,
+                                       const float* du, const float* dv)
+{
+    int theta1 = theta0 + extent;
+    int phi1 = phi0 + extent / 2;
+
+    int vindex = 0;
+    for (int phi = phi0; phi <= phi1; phi += ri.step)
+    {
+        float cphi = cosPhi[phi];
+        float sphi = sinPhi[phi];
+
+        if ((ri.attributes & Tangents) != 0)
+        {
+            for (int theta = theta0; theta <= theta1; theta += ri.step)
+            {
+                float ctheta = cosTheta[theta];
+                float stheta = sinTheta[theta];
+
+                vertices[vindex]      = cphi * ctheta;
+                vertices[vindex + 1]  = sphi;
+                vertices[vindex + 2]  = cphi * stheta;
+
+                // Compute the tangent--required for bump mapping
+                vertices[vindex + 3] = stheta;
+                vertices[vindex + 4] = 0.0f;
+                vertices[vindex + 5] = -ctheta;
+
+                vindex += 6;
+
+                for (int tex = 0; tex < nTexturesUsed; tex++)
+                {
+                    vertices[vindex]     = u0[tex] - theta * du[tex];
+                    vertices[vindex + 1] = v0[tex] - phi * dv[tex];
+                    vindex += 2;
+                }
+            }
+        }
+        else
+        {
+            for (int theta = theta0; theta <= theta1; theta += ri.step)
+            {
+                float ctheta = cosTheta[theta];
+                float stheta = sinTheta[theta];
+
+                vertices[vindex]      = cphi * ctheta;
+                vertices[vindex + 1]  = sphi;
+                vertices[vindex + 2]  = cphi * stheta;
+
+                vindex += 3;
+
+                for (int tex = 0; tex < nTexturesUsed; tex++)
+                {
+                    vertices[vindex]     = u0[tex] - theta * du[tex];
+                    vertices[vindex + 1] = v0[tex] - phi * dv[tex];
+                    vindex += 2;
+                }
+            }
+        }
+    }
 
+    return vindex;
+}
+
+
+void LODSphereMesh::renderSection(int phi0, int theta0, int extent,
+                                  const RenderInfo& ri)
+
+{
     // assert(ri.step >= minStep);
     // assert(phi0 + extent <= maxDivisions);
     // assert(theta0 + extent / 2 < maxDivisions);
     // assert(isPow2(extent));
     int thetaExtent = extent;
     int phiExtent = extent / 2;
-    int theta1 = theta0 + thetaExtent;
-    int phi1 = phi0 + phiExtent;
 
     float du[MAX_SPHERE_MESH_TEXTURES];
     float dv[MAX_SPHERE_MESH_TEXTURES];
@@ -558,62 +710,51 @@ void LODSphereMesh::renderSection(int phi0, int theta0, int extent,
         }
     }
 
-    int vindex = 0;
-    for (int phi = phi0; phi <= phi1; phi += ri.step)
+    PatchKey key{ ri.step, phi0, theta0, extent, ri.attributes & Tangents, nTexturesUsed, {} };
+    for (int tex = 0; tex < nTexturesUsed; tex++)
     {
-        float cphi = cosPhi[phi];
-        float sphi = sinPhi[phi];
-
-        if ((ri.attributes & Tangents) != 0)
-        {
-            for (int theta = theta0; theta <= theta1; theta += ri.step)
-            {
-                float ctheta = cosTheta[theta];
-                float stheta = sinTheta[theta];
-
-                vertices[vindex]      = cphi * ctheta;
-                vertices[vindex + 1]  = sphi;
-                vertices[vindex + 2]  = cphi * stheta;
+        key.texCoords[tex * 4 + 0] = u0[tex];
+        key.texCoords[tex * 4 + 1] = v0[tex];
+        key.texCoords[tex * 4 + 2] = du[tex];
+        key.texCoords[tex * 4 + 3] = dv[tex];
+    }
 
-                // Compute the tangent--required for bump mapping
-                vertices[vindex + 3] = stheta;
-                vertices[vindex + 4] = 0.0f;
-                vertices[vindex + 5] = -ctheta;
+    if (auto iter = patchCache.find(key); iter != patchCache.end())
+    {
+        iter->second.lastUsed = frameNumber;
+        patchLRU.splice(patchLRU.begin(), patchLRU, iter->second.lruPosition);
+        glBindBuffer(GL_ARRAY_BUFFER, iter->second.vertexBuffer);
+        stats.patchCacheHits++;
+    }
+    else
+    {
+        int vindex = fillSectionVertices(phi0, theta0, extent, ri, u0, v0, du, dv);
+        std::size_t size = vindex * sizeof(float);
 
-                vindex += 6;
+        GLuint vertexBuffer = 0;
+        if (evictPatches(size))
+            glGenBuffers(1, &vertexBuffer);
 
-                for (int tex = 0; tex < nTexturesUsed; tex++)
-                {
-                    vertices[vindex]     = u0[tex] - theta * du[tex];
-                    vertices[vindex + 1] = v0[tex] - phi * dv[tex];
-                    vindex += 2;
-                }
-            }
+        if (vertexBuffer != 0)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+            patchLRU.push_front(key);
+            patchCache.try_emplace(key, CachedPatch{ vertexBuffer, size, frameNumber, patchLRU.begin() });
+            stats.patchCacheBytes += size;
         }
         else
         {
-            for (int theta = theta0; theta <= theta1; theta += ri.step)
-            {
-                float ctheta = cosTheta[theta];
-                float stheta = sinTheta[theta];
-
-                vertices[vindex]      = cphi * ctheta;
-                vertices[vindex + 1]  = sphi;
-                vertices[vindex + 2]  = cphi * stheta;
-
-                vindex += 3;
-
-                for (int tex = 0; tex < nTexturesUsed; tex++)
-                {
-                    vertices[vindex]     = u0[tex] - theta * du[tex];
-                    vertices[vindex + 1] = v0[tex] - phi * dv[tex];
-                    vindex += 2;
-                }
-            }
+            // The cache is full of patches needed for this frame; stream the
+            // vertices, cycling through the vertex buffers.
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVB]);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+            currentVB = (currentVB + 1) % NUM_SPHERE_VERTEX_BUFFERS;
         }
+        stats.bytesUploaded += size;
     }
 
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vindex * sizeof(float), vertices);
+    setVertexPointers(ri);
 
     int nRings = phiExtent / ri.step;
     int nSlices = thetaExtent / ri.step;
@@ -621,10 +762,5 @@ void LODSphereMesh::renderSection(int phi0, int theta0, int extent,
                    nRings * (nSlices + 2) * 2 - 2,
                    GL_UNSIGNED_SHORT,
                    nullptr);
-
-    // Cycle through the vertex buffers
-    currentVB++;
-    if (currentVB == NUM_SPHERE_VERTEX_BUFFERS)
-        currentVB = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVB]);
+    stats.patchesDrawn++;
 }
@@ -11,6 +11,11 @@
 #ifndef CELENGINE_LODSPHEREMESH_H_
 #define CELENGINE_LODSPHEREMESH_H_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 #include <celengine/texture.h>
 #include <Eigen/Geometry>
 #include <celmath/frustum.h>
@@ -39,6 +44,18 @@ public:
         Tangents   = 0x02,
     };
 
+    struct Statistics
+    {
+        std::size_t bytesUploaded{ 0 };     // vertex and index data sent this frame
+        unsigned int patchesDrawn{ 0 };
+        unsigned int patchCacheHits{ 0 };
+        std::size_t patchCacheBytes{ 0 };   // GPU memory held by cached patches
+    };
+
+    // Reset the per-frame statistics; call once at the start of each frame.
+    void beginFrame();
+    const Statistics& getStatistics() const { return stats; }
+
  private:
     struct RenderInfo
     {
@@ -63,6 +80,41 @@ public:
                        const RenderInfo&);
 
     void renderSection(int phi0, int theta0, int extent, const RenderInfo&);
+    int fillSectionVertices(int phi0, int theta0, int extent, const RenderInfo&,
+                            const float* u0, const float* v0,
+                            const float* du, const float* dv);
+    void setVertexPointers(const RenderInfo&);
+
+    // Generated section vertices only depend on the patch location, the
+    // LOD step, the vertex layout and the texture coordinate mapping, so
+    // they can be kept in a vertex buffer and reused across frames.
+    struct PatchKey
+    {
+        int step;
+        int phi0;
+        int theta0;
+        int extent;
+        unsigned int attributes;
+        int nTextures;
+        std::array<float, MAX_SPHERE_MESH_TEXTURES * 4> texCoords;
+
+        bool operator==(const PatchKey& other) const;
+    };
+
+    struct PatchKeyHash
+    {
+        std::size_t operator()(const PatchKey&) const;
+    };
+
+    struct CachedPatch
+    {
+        GLuint vertexBuffer;
+        std::size_t size;
+        std::uint64_t lastUsed;
+        std::list<PatchKey>::iterator lruPosition;
+    };
+
+    bool evictPatches(std::size_t required);
 
     float* vertices{ nullptr };
 
@@ -80,6 +132,14 @@ public:
     GLuint currentVB{ 0 };
     GLuint vertexBuffers[NUM_SPHERE_VERTEX_BUFFERS];
     GLuint indexBuffer{ 0 };
+    int indexRings{ 0 };
+    int indexSlices{ 0 };
+
+    std::unordered_map<PatchKey, CachedPatch, PatchKeyHash> patchCache;
+    // Keys of the cached patches, most recently used first
+    std::list<PatchKey> patchLRU;
+    std::uint64_t frameNumber{ 0 };
+    Statistics stats;
 };
 
 #endif // CELENGINE_LODSPHEREMESH_H_
@@ -26,11 +26,13 @@ void NameDatabase::add(const AstroCatalog::IndexNumber catalogNumber, const std:
         if (lname != fname)
             localizedNameIndex[lname] = catalogNumber;
         numberIndex.insert(NumberIndex::value_type(catalogNumber, fname));
+        ++changeCount;
     }
 }
 void NameDatabase::erase(const AstroCatalog::IndexNumber catalogNumber)
 {
     numberIndex.erase(catalogNumber);
+    ++changeCount;
 }
 
 AstroCatalog::IndexNumber NameDatabase::getCatalogNumberByName(const std::string& name, bool i18n) const
@@ -44,12 +44,18 @@ class NameDatabase
 
     NumberIndex::const_iterator getFirstNameIter(const AstroCatalog::IndexNumber catalogNumber) const;
     NumberIndex::const_iterator getFinalNameIter() const;
+    const NumberIndex& getNumberIndex() const { return numberIndex; }
 
     std::vector<std::string> getCompletion(const std::string& name, bool i18n) const;
 
+    // Incremented whenever names are added or erased, so that users can
+    // tell when names they've cached are out of date.
+    uint32_t getChangeCount() const { return changeCount; }
+
  protected:
     NameIndex   nameIndex;
     NameIndex   localizedNameIndex;
     NumberIndex numberIndex;
+    uint32_t    changeCount{ 0 };
 };
 
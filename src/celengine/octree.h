@@ -15,7 +15,13 @@
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <celengine/astro.h>
 #include <celengine/observer.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
 #include <vector>
 
 // The DynamicOctree and StaticOctree template arguments are:
@@ -42,6 +48,17 @@ template <class OBJ, class PREC> class OctreeProcessor
 };
 
 
+// Processor for ray traversals of the octree. maxAngle() is the largest
+// angle in radians between the ray and an object that could still be
+// accepted; it normally shrinks as closer objects are processed, which
+// lets the traversal terminate early.
+template <class OBJ, class PREC> class OctreeRayProcessor : public OctreeProcessor<OBJ, PREC>
+{
+ public:
+    virtual PREC maxAngle() const = 0;
+};
+
+
 
 struct OctreeLevelStatistics
 {
@@ -142,6 +159,54 @@ template <class OBJ, class PREC> class StaticOctree
                              PREC                               boundingRadius,
                              PREC                               scale) const;
 
+    // Invoke the processor for the objects in this node (not its children)
+    // that are brighter than limitingFactor as seen from obsPosition;
+    // minDistance is the distance from obsPosition to the node.
+    void processNodeObjects(OctreeProcessor<OBJ, PREC>&        processor,
+                            const PointType&                   obsPosition,
+                            float                              limitingFactor,
+                            PREC                               minDistance) const;
+
+    // Ray traversal for picking: invoke the processor for the objects
+    // brighter than limitingFactor in the nodes that may hold an object
+    // within processor.maxAngle() of the ray from origin along the unit
+    // vector direction. Nodes are visited in order of increasing angular
+    // distance from the ray, with the nodes the ray passes through (found
+    // by a slab test) visited front to back, and the traversal stops once
+    // no remaining node can beat the closest object found so far.
+    void processObjectsAlongRay(OctreeRayProcessor<OBJ, PREC>&     processor,
+                                const PointType&                   origin,
+                                const PointType&                   direction,
+                                float                              limitingFactor,
+                                PREC                               scale) const;
+
+    // Spatial queries returning (object, distance) pairs, where distance is
+    // measured from the query position to the object's position. Unlike the
+    // process methods above these do not depend on the object type beyond
+    // objectPosition(), so they are implemented once for all octrees.
+
+    // Find the count objects nearest to position and no farther than
+    // maxDistance, sorted by increasing distance. Nodes are visited
+    // nearest first, so only the part of the tree that can still improve
+    // the result is traversed.
+    void findNearestObjects(const PointType&                         position,
+                            unsigned int                             count,
+                            PREC                                     maxDistance,
+                            PREC                                     scale,
+                            std::vector<std::pair<const OBJ*, PREC>>& nearest) const;
+
+    // Find the objects within maxDistance of origin whose direction lies
+    // within halfAngle radians of the unit vector direction.
+    void findObjectsInCone(const PointType&                         origin,
+                           const PointType&                         direction,
+                           PREC                                     halfAngle,
+                           PREC                                     maxDistance,
+                           PREC                                     scale,
+                           std::vector<std::pair<const OBJ*, PREC>>& objects) const;
+
+    // Position used for spatial queries; specialized for each object type.
+    static PointType objectPosition(const OBJ&);
+
     int countChildren() const;
     int countObjects()  const;
 
@@ -359,6 +424,219 @@ inline StaticOctree<OBJ, PREC>::~StaticOctree()
 }
 
 
+template <class OBJ, class PREC>
+void StaticOctree<OBJ, PREC>::findNearestObjects(const PointType&                         position,
+                                                 unsigned int                             count,
+                                                 PREC                                     maxDistance,
+                                                 PREC                                     scale,
+                                                 std::vector<std::pair<const OBJ*, PREC>>& nearest) const
+{
+    nearest.clear();
+    if (count == 0)
+        return;
+
+    struct NodeEntry
+    {
+        PREC distance;
+        PREC scale;
+        const StaticOctree* node;
+    };
+    auto nodeFarther = [](const NodeEntry& a, const NodeEntry& b) { return a.distance > b.distance; };
+    auto objectCloser = [](const std::pair<const OBJ*, PREC>& a, const std::pair<const OBJ*, PREC>& b)
+    {
+        return a.second < b.second;
+    };
+
+    // Lower bound on the distance to any object in a node: the distance to
+    // the bounding sphere of the node's cube.
+    auto nodeDistance = [&position](const StaticOctree* node, PREC nodeScale)
+    {
+        return std::max((position - node->cellCenterPos).norm() - nodeScale * SQRT3, PREC(0));
+    };
+
+    std::priority_queue<NodeEntry, std::vector<NodeEntry>, decltype(nodeFarther)> nodes(nodeFarther);
+    nodes.push({ nodeDistance(this, scale), scale, this });
+
+    // nearest is kept as a max-heap on distance so that the current worst
+    // candidate is always at the front.
+    PREC limit = maxDistance;
+    while (!nodes.empty())
+    {
+        NodeEntry entry = nodes.top();
+        if (entry.distance > limit)
+            break;
+        nodes.pop();
+
+        const StaticOctree* node = entry.node;
+        for (unsigned int i = 0; i < node->nObjects; ++i)
+        {
+            const OBJ& obj = node->_firstObject[i];
+            PREC distance = (position - objectPosition(obj)).norm();
+            if (distance > limit || (nearest.size() == count && distance >= limit))
+                continue;
+
+            if (nearest.size() == count)
+            {
+                std::pop_heap(nearest.begin(), nearest.end(), objectCloser);
+                nearest.pop_back();
+            }
+            nearest.emplace_back(&obj, distance);
+            std::push_heap(nearest.begin(), nearest.end(), objectCloser);
+            if (nearest.size() == count)
+                limit = nearest.front().second;
+        }
+
+        if (node->_children != nullptr)
+        {
+            PREC childScale = entry.scale * (PREC) 0.5;
+            for (int i = 0; i < 8; ++i)
+            {
+                PREC childDistance = nodeDistance(node->_children[i], childScale);
+                if (childDistance <= limit)
+                    nodes.push({ childDistance, childScale, node->_children[i] });
+            }
+        }
+    }
+
+    std::sort_heap(nearest.begin(), nearest.end(), objectCloser);
+}
+
+
+template <class OBJ, class PREC>
+void StaticOctree<OBJ, PREC>::processObjectsAlongRay(OctreeRayProcessor<OBJ, PREC>& processor,
+                                                     const PointType&               origin,
+                                                     const PointType&               direction,
+                                                     float                          limitingFactor,
+                                                     PREC                           scale) const
+{
+    struct NodeEntry
+    {
+        PREC angle;     // lower bound on the angle between the ray and the node
+        PREC distance;  // distance along the ray at which the node is entered
+        PREC scale;
+        const StaticOctree* node;
+    };
+    auto nodeAfter = [](const NodeEntry& a, const NodeEntry& b)
+    {
+        return a.angle > b.angle || (a.angle == b.angle && a.distance > b.distance);
+    };
+
+    auto nodeEntry = [&origin, &direction](const StaticOctree* node, PREC nodeScale) -> NodeEntry
+    {
+        PointType offset = node->cellCenterPos - origin;
+
+        // Slab test of the ray against the node's cube
+        PREC tEntry = 0;
+        PREC tExit = std::numeric_limits<PREC>::max();
+        bool pierced = true;
+        for (int i = 0; i < 3 && pierced; ++i)
+        {
+            if (direction[i] == 0)
+            {
+                pierced = std::abs(offset[i]) <= nodeScale;
+                continue;
+            }
+
+            PREC t0 = (offset[i] - nodeScale) / direction[i];
+            PREC t1 = (offset[i] + nodeScale) / direction[i];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            tEntry = std::max(tEntry, t0);
+            tExit = std::min(tExit, t1);
+            pierced = tEntry <= tExit;
+        }
+        if (pierced)
+            return { PREC(0), tEntry, nodeScale, node };
+
+        // The ray misses the cube; bound the angle using the node's
+        // bounding sphere.
+        PREC centerDistance = offset.norm();
+        PREC nodeRadius = nodeScale * SQRT3;
+        PREC angle = 0;
+        if (centerDistance > nodeRadius)
+        {
+            PREC cosAngle = std::clamp(offset.dot(direction) / centerDistance, PREC(-1), PREC(1));
+            angle = std::max(std::acos(cosAngle) - std::asin(nodeRadius / centerDistance), PREC(0));
+        }
+        return { angle, std::max(centerDistance - nodeRadius, PREC(0)), nodeScale, node };
+    };
+
+    std::priority_queue<NodeEntry, std::vector<NodeEntry>, decltype(nodeAfter)> nodes(nodeAfter);
+    nodes.push(nodeEntry(this, scale));
+
+    while (!nodes.empty())
+    {
+        NodeEntry entry = nodes.top();
+        if (entry.angle > processor.maxAngle())
+            break;
+        nodes.pop();
+
+        const StaticOctree* node = entry.node;
+        PREC minDistance = (origin - node->cellCenterPos).norm() - entry.scale * SQRT3;
+        node->processNodeObjects(processor, origin, limitingFactor, minDistance);
+
+        // Skip the children if none of their objects can be bright enough
+        if (node->_children == nullptr ||
+            (minDistance > 0 && astro::absToAppMag((PREC) node->exclusionFactor, minDistance) > limitingFactor))
+        {
+            continue;
+        }
+
+        PREC childScale = entry.scale * (PREC) 0.5;
+        for (int i = 0; i < 8; ++i)
+        {
+            NodeEntry child = nodeEntry(node->_children[i], childScale);
+            if (child.angle <= processor.maxAngle())
+                nodes.push(child);
+        }
+    }
+}
+
+
+template <class OBJ, class PREC>
+void StaticOctree<OBJ, PREC>::findObjectsInCone(const PointType&                         origin,
+                                                const PointType&                         direction,
+                                                PREC                                     halfAngle,
+                                                PREC                                     maxDistance,
+                                                PREC                                     scale,
+                                                std::vector<std::pair<const OBJ*, PREC>>& objects) const
+{
+    // Reject the node if its bounding sphere lies entirely beyond
+    // maxDistance or entirely outside the cone.
+    PointType offset = cellCenterPos - origin;
+    PREC centerDistance = offset.norm();
+    PREC nodeRadius = scale * SQRT3;
+    if (centerDistance - nodeRadius > maxDistance)
+        return;
+
+    if (centerDistance > nodeRadius)
+    {
+        PREC cosAngle = std::clamp(offset.dot(direction) / centerDistance, PREC(-1), PREC(1));
+        if (std::acos(cosAngle) - std::asin(nodeRadius / centerDistance) > halfAngle)
+            return;
+    }
+
+    PREC cosHalfAngle = std::cos(halfAngle);
+    for (unsigned int i = 0; i < nObjects; ++i)
+    {
+        const OBJ& obj = _firstObject[i];
+        PointType v = objectPosition(obj) - origin;
+        PREC distance = v.norm();
+        if (distance <= maxDistance && v.dot(direction) >= cosHalfAngle * distance)
+            objects.emplace_back(&obj, distance);
+    }
+
+    if (_children != nullptr)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            _children[i]->findObjectsInCone(origin, direction, halfAngle, maxDistance,
+                                            scale * (PREC) 0.5, objects);
+        }
+    }
+}
+
+
 template <class OBJ, class PREC>
 inline int StaticOctree<OBJ, PREC>::countChildren() const
 {
@@ -0,0 +1,165 @@
+// parsedcatalog.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// A catalog file tokenized and parsed ahead of loading.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <cmath>
+#include <sstream>
+
+#include <celutil/logger.h>
+#include "parsedcatalog.h"
+#include "parser.h"
+#include "value.h"
+
+using celestia::util::GetLogger;
+using celestia::util::Level;
+using celestia::util::Logger;
+
+
+ParsedCatalog::ParsedCatalog(std::istream& in)
+{
+    std::ostringstream log;
+    Logger logger(Level::Warning, log, log);
+    Tokenizer tokenizer(&in, &logger);
+    Parser parser(&tokenizer);
+
+    for (;;)
+    {
+        Token token;
+        token.type = tokenizer.nextToken();
+        token.lineNumber = tokenizer.getLineNumber();
+        token.number = tokenizer.getNumberValue();
+        token.textOffset = text.size();
+        token.textLength = 0;
+        token.value = 0;
+        token.endLineNumber = token.lineNumber;
+
+        if (token.type == Tokenizer::TokenName || token.type == Tokenizer::TokenString)
+        {
+            std::string_view tokenText = tokenizer.getStringValue();
+            token.textLength = tokenText.size();
+            text.append(tokenText);
+        }
+        else if (token.type == Tokenizer::TokenBeginGroup)
+        {
+            tokenizer.pushBack();
+            Value* value = parser.readValue();
+            token.value = values.size();
+            token.endLineNumber = tokenizer.getLineNumber();
+            values.push_back(value);
+
+            // The loaders stop at a property group they can't read, so
+            // parsing can stop there as well.
+            if (value == nullptr)
+            {
+                tokens.push_back(token);
+                token.type = Tokenizer::TokenError;
+                token.lineNumber = token.endLineNumber;
+                token.number = std::nan("");
+            }
+        }
+
+        tokens.push_back(token);
+        if (token.type == Tokenizer::TokenEnd || token.type == Tokenizer::TokenError)
+            break;
+    }
+
+    messages = log.str();
+}
+
+
+ParsedCatalog::~ParsedCatalog()
+{
+    for (Value* value : values)
+        delete value;
+}
+
+
+Tokenizer::TokenType ParsedCatalog::nextToken()
+{
+    if (isPushedBack)
+    {
+        isPushedBack = false;
+        return getTokenType();
+    }
+
+    // Past the end keep returning the final TokenEnd or TokenError
+    if (isStart)
+        isStart = false;
+    else if (current + 1 < tokens.size())
+        ++current;
+
+    const Token& token = tokens[current];
+    lineNumber = token.lineNumber;
+    if (token.type == Tokenizer::TokenEnd || token.type == Tokenizer::TokenError)
+        logMessages();
+
+    return token.type;
+}
+
+
+Tokenizer::TokenType ParsedCatalog::getTokenType() const
+{
+    return isStart ? Tokenizer::TokenBegin : tokens[current].type;
+}
+
+
+void ParsedCatalog::pushBack()
+{
+    isPushedBack = true;
+}
+
+
+double ParsedCatalog::getNumberValue() const
+{
+    return getTokenType() == Tokenizer::TokenNumber ? tokens[current].number : std::nan("");
+}
+
+
+std::string_view ParsedCatalog::getStringValue() const
+{
+    if (isStart)
+        return {};
+
+    const Token& token = tokens[current];
+    return std::string_view(text).substr(token.textOffset, token.textLength);
+}
+
+
+int ParsedCatalog::getLineNumber() const
+{
+    return lineNumber;
+}
+
+
+Value* ParsedCatalog::readValue()
+{
+    if (nextToken() != Tokenizer::TokenBeginGroup)
+        return nullptr;
+
+    const Token& token = tokens[current];
+    lineNumber = token.endLineNumber;
+
+    Value* value = values[token.value];
+    values[token.value] = nullptr;
+    if (value == nullptr)
+        logMessages();
+
+    return value;
+}
+
+
+void ParsedCatalog::logMessages()
+{
+    if (messages.empty())
+        return;
+
+    GetLogger()->error("{}", messages);
+    messages.clear();
+}
@@ -0,0 +1,87 @@
+// parsedcatalog.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// A catalog file tokenized and parsed ahead of loading.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <celutil/tokenizer.h>
+
+class Value;
+
+
+/*! A ParsedCatalog holds a star, deep sky object or solar system catalog
+ *  file after it has been tokenized and its property groups parsed. This
+ *  is the expensive part of loading a catalog, and it doesn't depend on
+ *  any other catalog, so it can be done on a worker thread; the objects
+ *  are then created from the parsed catalogs in order.
+ *
+ *  Loaders read a ParsedCatalog as they would read a Tokenizer and a
+ *  Parser: nextToken() returns the tokens between the property groups, and
+ *  readValue() returns the property group that follows, already parsed.
+ *  Parsing stops at the first error, which the loader encounters at the
+ *  same place as when reading the file directly.
+ *
+ *  Nothing is logged while parsing. Messages from the tokenizer are kept
+ *  and written to the log when the loader reaches the end of the catalog,
+ *  or the place where parsing failed.
+ */
+class ParsedCatalog
+{
+ public:
+    explicit ParsedCatalog(std::istream&);
+    ~ParsedCatalog();
+    ParsedCatalog(const ParsedCatalog&) = delete;
+    ParsedCatalog& operator=(const ParsedCatalog&) = delete;
+
+    Tokenizer::TokenType nextToken();
+    Tokenizer::TokenType getTokenType() const;
+    void pushBack();
+    double getNumberValue() const;
+    std::string_view getStringValue() const;
+    int getLineNumber() const;
+
+    /*! Read the next token and return the property group it starts, or
+     *  nullptr if it doesn't start one or the group couldn't be parsed.
+     *  The caller takes ownership of the value.
+     */
+    Value* readValue();
+
+ private:
+    struct Token
+    {
+        Tokenizer::TokenType type;
+        int lineNumber;
+        double number;
+        std::size_t textOffset;
+        std::size_t textLength;
+        // For property groups, the index of the parsed value and the line
+        // on which the group ends
+        std::size_t value;
+        int endLineNumber;
+    };
+
+    void logMessages();
+
+    std::vector<Token> tokens;
+    std::string text;
+    std::vector<Value*> values;
+    std::string messages;
+
+    std::size_t current{ 0 };
+    bool isStart{ true };
+    bool isPushedBack{ false };
+    int lineNumber{ 1 };
+};
@@ -12,6 +12,7 @@
 #include <celengine/star.h>
 #include <celengine/univcoord.h>
 #include "pointstarvertexbuffer.h"
+#include "labelmanager.h"
 #include "render.h"
 #include "pointstarrenderer.h"
 
@@ -116,9 +117,13 @@ void PointStarRenderer::process(const Star& star, float distance, float appMag)
                     float distr = min(1.0f, 3.5f * (labelThresholdMag - appMag)/labelThresholdMag);
                     Color color = Color(Renderer::StarLabelColor, distr * Renderer::StarLabelColor.alpha());
                     renderer->addBackgroundAnnotation(nullptr,
-                                                      starDB->getStarName(star, true),
+                                                      renderer->getLabelManager().getStarName(star, *starDB),
                                                       color,
-                                                      relPos);
+                                                      relPos,
+                                                      Renderer::AlignLeft,
+                                                      Renderer::VerticalAlignBottom,
+                                                      0.0f,
+                                                      &star);
                 }
             }
         }
@@ -152,7 +157,7 @@ void PointStarRenderer::process(const Star& star, float distance, float appMag)
                 pos = pos * (1.0f - star.getRadius() * 1.01f / pos.norm());
 
                 renderer->addSortedAnnotation(nullptr,
-                                              starDB->getStarName(star, true),
+                                              renderer->getLabelManager().getStarName(star, *starDB),
                                               Renderer::StarLabelColor,
                                               pos);
             }
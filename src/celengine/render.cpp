@@ -32,7 +32,11 @@
 #include "renderinfo.h"
 #include "renderglsl.h"
 #include "axisarrow.h"
+#include "bodyindex.h"
+#include "flatframetree.h"
 #include "frametree.h"
+#include "labelmanager.h"
+#include "scenesnapshot.h"
 #include "timelinephase.h"
 #include "skygrid.h"
 #include "modelgeometry.h"
@@ -232,7 +236,7 @@ Renderer::Renderer() :
 #ifndef GL_ES
     renderMode(GL_FILL),
 #endif
-    labelMode(LocationLabels), //def. NoLabels
+    labelMode(LocationLabels | DeclutterLabels), //def. NoLabels
     renderFlags(DefaultRenderFlags),
     orbitMask(Body::Planet | Body::Moon | Body::Stellar),
     ambientLightLevel(0.1f),
@@ -266,6 +270,8 @@ Renderer::Renderer() :
     }
 
     shaderManager = new ShaderManager();
+    m_labelManager = std::make_unique<LabelManager>();
+    m_sceneSnapshot = std::make_unique<SceneSnapshot>();
     m_VertexObjects.fill(nullptr);
 }
 
@@ -817,7 +823,8 @@ void Renderer::addAnnotation(vector<Annotation>& annotations,
                              LabelAlignment halign,
                              LabelVerticalAlignment valign,
                              float size,
-                             bool special)
+                             bool special,
+                             const void* object)
 {
     GLint view[4] = { 0, 0, windowWidth, windowHeight };
     Vector3f win;
@@ -837,14 +844,17 @@ void Renderer::addAnnotation(vector<Annotation>& annotations,
         if (abs(y - win.y()) < 0.001) win.y() = y;
 
         Annotation a;
-        if (!special || markerRep == nullptr)
-             a.labelText = labelText;
+        if (object != nullptr)
+            a.sharedLabelText = &labelText;
+        else if (!special || markerRep == nullptr)
+            a.labelText = labelText;
         a.markerRep = markerRep;
         a.color = color;
         a.position = win;
         a.halign = halign;
         a.valign = valign;
         a.size = size;
+        a.object = object;
         annotations.push_back(a);
     }
 }
@@ -868,9 +878,10 @@ void Renderer::addBackgroundAnnotation(const celestia::MarkerRepresentation* mar
                                        const Vector3f& pos,
                                        LabelAlignment halign,
                                        LabelVerticalAlignment valign,
-                                       float size)
+                                       float size,
+                                       const void* object)
 {
-    addAnnotation(backgroundAnnotations, markerRep, labelText, color, pos, halign, valign, size);
+    addAnnotation(backgroundAnnotations, markerRep, labelText, color, pos, halign, valign, size, false, object);
 }
 
 
@@ -1473,8 +1484,17 @@ void Renderer::draw(const Observer& observer,
     double now = observer.getTime();
     realTime = observer.getRealTime();
 
+    if (m_sceneSnapshot->getTime() != now)
+        m_sceneSnapshot->reset(now);
+
     frameCount++;
+    // Settings changed since the last frame may affect the cached lists
+    if (settingsChanged)
+        m_nearSystemsCache.hasView = false;
     settingsChanged = false;
+    if (g_lodSphere != nullptr)
+        g_lodSphere->beginFrame();
+    m_labelManager->beginFrame(universe.getStarCatalog(), universe.getDSOCatalog());
 
     // Compute the size of a pixel
     setFieldOfView(radToDeg(observer.getFOV()));
@@ -1536,7 +1556,12 @@ void Renderer::draw(const Observer& observer,
     faintestPlanetMag = faintestMag;
     if ((renderFlags & (ShowSolarSystemObjects | ShowOrbits)) != 0)
     {
-        buildNearSystemsLists(universe, observer, xfrustum, now);
+        bool viewUnchanged = isNearSystemsViewUnchanged(observer, now);
+        if (!viewUnchanged || !restoreNearSystemsLists(universe))
+        {
+            buildNearSystemsLists(universe, observer, xfrustum, now);
+            storeNearSystemsLists(observer, now, viewUnchanged);
+        }
     }
 
     setupSecondaryLightSources(secondaryIlluminators, lightSourceList);
@@ -1612,6 +1637,8 @@ void Renderer::draw(const Observer& observer,
     renderBoundaries(universe, dist, asterismMVP);
 
     // Render star and deep sky object labels
+    if (auto font = getFont(FontNormal); font != nullptr && (labelMode & DeclutterLabels) != 0)
+        m_labelManager->declutter(backgroundAnnotations, *font, windowWidth, windowHeight);
     renderBackgroundAnnotations(FontNormal);
 
     // Render constellations labels
@@ -2923,8 +2950,8 @@ bool Renderer::testEclipse(const Body& receiver,
         // less than the distance between the sun and the receiver.  This
         // approximation works everywhere in the solar system, and is likely
         // valid for any orbitally stable pair of objects orbiting a star.
-        Vector3d posReceiver = receiver.getAstrocentricPosition(now);
-        Vector3d posCaster = caster.getAstrocentricPosition(now);
+        Vector3d posReceiver = m_sceneSnapshot->getAstrocentricPosition(receiver, now);
+        Vector3d posCaster = m_sceneSnapshot->getAstrocentricPosition(caster, now);
 
         //const Star* sun = receiver.getSystem()->getStar();
         //assert(sun != nullptr);
@@ -3001,7 +3028,7 @@ bool Renderer::testEclipse(const Body& receiver,
             {
                 // Possible intersection, but it depends on the orientation of the
                 // rings.
-                Quaterniond casterOrientation = caster.getOrientation(now);
+                Quaterniond casterOrientation = m_sceneSnapshot->getOrientation(caster, now);
                 Vector3d ringPlaneNormal = casterOrientation * Vector3d::UnitY();
                 Vector3d shadowDirection = lightToCasterDir.normalized();
                 Vector3d v = ringPlaneNormal.cross(shadowDirection);
@@ -3079,8 +3106,7 @@ void Renderer::renderPlanet(Body& body,
         rp.semiAxes = body.getSemiAxes() * (1.0f / rp.radius);
         rp.geometryScale = body.getGeometryScale();
 
-        Quaterniond q = body.getRotationModel(now)->spin(now) *
-                        body.getEclipticToEquatorial(now);
+        Quaterniond q = m_sceneSnapshot->getOrientation(body, now);
 
         rp.orientation = body.getGeometryOrientation() * q.cast<float>();
 
@@ -3814,7 +3840,8 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
                                 const Frustum& viewFrustum,
                                 const Vector3d& viewPlaneNormal,
                                 const Vector3d& frameCenter,
-                                const FrameTree* tree,
+                                const FlatFrameTree& flatTree,
+                                std::uint32_t parentNode,
                                 const Observer& observer,
                                 double now)
 {
@@ -3825,24 +3852,46 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
     double invCosViewAngle = 1.0 / cosViewConeAngle;
     double sinViewAngle = sqrt(1.0 - square(cosViewConeAngle));
 
-    unsigned int nChildren = tree != nullptr ? tree->childCount() : 0;
-    for (unsigned int i = 0; i < nChildren; i++)
+    // Large trees are culled against the view cone with a spatial index
+    // first; children outside the cone can't add anything to the render
+    // lists, and neither can their subtrees.
+    const FlatFrameTree::Node& parent = flatTree.getNode(parentNode);
+    const BodySpatialIndex* spatialIndex = parent.subtree != nullptr ? parent.subtree->getSpatialIndex(now) : nullptr;
+    std::vector<unsigned int> candidates;
+    if (spatialIndex != nullptr)
+    {
+        spatialIndex->findInCone(astrocentricObserverPos - frameCenter, viewPlaneNormal,
+                                 cosViewConeAngle, candidates);
+    }
+
+    unsigned int nChildren = spatialIndex != nullptr ? static_cast<unsigned int>(candidates.size())
+                                                     : parent.childCount;
+
+    // Evaluate the positions of all active children up front, so that
+    // those with Keplerian orbits are computed in batches.
+    std::vector<std::uint32_t> childNodes;
+    childNodes.reserve(nChildren);
+    for (unsigned int n = 0; n < nChildren; n++)
     {
-        auto phase = tree->getChild(i);
+        std::uint32_t childNode = parent.firstChild + (spatialIndex != nullptr ? candidates[n] : n);
 
         // No need to do anything if the phase isn't active now
-        if (!phase->includes(now))
-            continue;
+        if (flatTree.getNode(childNode).includes(now))
+            childNodes.push_back(childNode);
+    }
+    m_sceneSnapshot->computeNodePositions(flatTree, childNodes);
 
-        Body* body = phase->body();
+    for (std::uint32_t childNode : childNodes)
+    {
+        const FlatFrameTree::Node& node = flatTree.getNode(childNode);
+
+        Body* body = node.body;
 
         // pos_s: sun-relative position of object
         // pos_v: viewer-relative position of object
 
         // Get the position of the body relative to the sun.
-        Vector3d p = phase->orbit()->positionAtTime(now);
-        auto frame = phase->orbitFrame();
-        Vector3d pos_s = frameCenter + frame->getOrientation(now).conjugate() * p;
+        Vector3d pos_s = m_sceneSnapshot->getNodePosition(flatTree, childNode);
 
         // We now have the positions of the observer and the planet relative
         // to the sun.  From these, compute the position of the body
@@ -3856,7 +3905,7 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
         // Vector from object center to its projection on the view normal.
         Vector3d toViewNormal = pos_v - dist_vn * viewPlaneNormal;
 
-        float cullingRadius = body->getCullingRadius();
+        float cullingRadius = node.cullingRadius;
 
         // The result of the planetshine test can be reused for the view cone
         // test, but only when the object's light influence sphere is larger
@@ -3899,10 +3948,9 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
         bool insideViewCone = false;
         if (!viewConeTestFailed)
         {
-            float radius = body->getCullingRadius();
-            if (dist_vn > -radius)
+            if (dist_vn > -cullingRadius)
             {
-                double maxPerpDist = (radius + dist_vn * sinViewAngle) * invCosViewAngle;
+                double maxPerpDist = (cullingRadius + dist_vn * sinViewAngle) * invCosViewAngle;
                 double perpDistSq = toViewNormal.squaredNorm();
                 insideViewCone = perpDistSq < maxPerpDist * maxPerpDist;
             }
@@ -3914,7 +3962,7 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
             double dist_v = pos_v.norm();
 
             // Calculate the size of the planet/moon disc in pixels
-            float discSize = (body->getCullingRadius() / (float) dist_v) / pixelSize;
+            float discSize = (cullingRadius / (float) dist_v) / pixelSize;
 
             // Compute the apparent magnitude; instead of summing the reflected
             // light from all nearby stars, we just consider the one with the
@@ -3949,7 +3997,7 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
             }
         }
 
-        const FrameTree* subtree = body->getFrameTree();
+        const FrameTree* subtree = node.subtree;
         if (subtree != nullptr)
         {
             double dist_v = pos_v.norm();
@@ -4027,7 +4075,8 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
                                  viewFrustum,
                                  viewPlaneNormal,
                                  pos_s,
-                                 subtree,
+                                 flatTree,
+                                 childNode,
                                  observer,
                                  now);
             }
@@ -4039,28 +4088,30 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
 void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
                                const Quaterniond& observerOrientation,
                                const Frustum& viewFrustum,
-                               const FrameTree* tree,
+                               const Vector3d& frameCenter,
+                               const FlatFrameTree& flatTree,
+                               std::uint32_t parentNode,
                                double now)
 {
     Matrix3d viewMat = observerOrientation.toRotationMatrix();
     Vector3d viewMatZ = viewMat.row(2);
 
-    unsigned int nChildren = tree != nullptr ? tree->childCount() : 0;
-    for (unsigned int i = 0; i < nChildren; i++)
+    const FlatFrameTree::Node& parent = flatTree.getNode(parentNode);
+    for (std::uint32_t childNode = parent.firstChild; childNode < parent.firstChild + parent.childCount; childNode++)
     {
-        auto phase = tree->getChild(i);
+        const FlatFrameTree::Node& node = flatTree.getNode(childNode);
 
         // No need to do anything if the phase isn't active now
-        if (!phase->includes(now))
+        if (!node.includes(now))
             continue;
 
-        Body* body = phase->body();
+        Body* body = node.body;
 
         // pos_s: sun-relative position of object
         // pos_v: viewer-relative position of object
 
         // Get the position of the body relative to the sun.
-        Vector3d pos_s = body->getAstrocentricPosition(now);
+        Vector3d pos_s = m_sceneSnapshot->getNodePosition(flatTree, childNode);
 
         // We now have the positions of the observer and the planet relative
         // to the sun.  From these, compute the position of the body
@@ -4075,19 +4126,12 @@ void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
              orbitVis == Body::AlwaysVisible ||
              (orbitVis == Body::UseClassVisibility && (body->getOrbitClassification() & orbitMask) != 0)))
         {
-            Vector3d orbitOrigin = Vector3d::Zero();
-            Selection centerObject = phase->orbitFrame()->getCenter();
-            if (centerObject.body() != nullptr)
-            {
-                orbitOrigin = centerObject.body()->getAstrocentricPosition(now);
-            }
-
-            // Calculate the origin of the orbit relative to the observer
-            Vector3d relOrigin = orbitOrigin - astrocentricObserverPos;
+            // The orbit is centered on the parent in the frame tree
+            Vector3d relOrigin = frameCenter - astrocentricObserverPos;
 
             // Compute the size of the orbit in pixels
             double originDistance = pos_v.norm();
-            double boundingRadius = body->getOrbit(now)->getBoundingRadius();
+            double boundingRadius = node.orbit->getBoundingRadius();
             auto orbitRadiusInPixels = (float) (boundingRadius / (originDistance * pixelSize));
 
             if (orbitRadiusInPixels > minOrbitSize)
@@ -4104,7 +4148,7 @@ void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
             }
         }
 
-        const FrameTree* subtree = body->getFrameTree();
+        const FrameTree* subtree = node.subtree;
         if (subtree != nullptr)
         {
             // Only try to render orbits of child objects when:
@@ -4134,7 +4178,9 @@ void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
                     buildOrbitLists(astrocentricObserverPos,
                                     observerOrientation,
                                     viewFrustum,
-                                    subtree,
+                                    pos_s,
+                                    flatTree,
+                                    childNode,
                                     now);
                 }
             }
@@ -4224,12 +4270,11 @@ void Renderer::buildLabelLists(const Frustum& viewFrustum,
         {
             // In the typical case, we're rendering labels for many
             // objects that orbit the same primary. Avoid repeatedly
-            // calling getPosition() by caching the last primary
-            // position.
+            // computing the primary position by caching the last one.
             if (primary != lastPrimary)
             {
-                Vector3d p = phase->orbitFrame()->getOrientation(now).conjugate() *
-                             phase->orbit()->positionAtTime(now);
+                Vector3d p = m_sceneSnapshot->getAstrocentricPosition(*body, now) -
+                             m_sceneSnapshot->getAstrocentricPosition(*primary, now);
                 Vector3d v = ri.position.cast<double>() - p;
 
                 primarySphere = Sphered(v, primary->getRadius());
@@ -4386,17 +4431,33 @@ void Renderer::renderPointStars(const StarDatabase& starDB,
     m_starProcStats.height = 0;
     m_starProcStats.objects = 0;
 #endif
-    starDB.findVisibleStars(starRenderer,
-                            obsPos.cast<float>(),
-                            observer.getOrientationf(),
-                            degToRad(fov),
-                            getAspectRatio(),
-                            faintestMagNight,
+    // Skip the octree query if the observer hasn't moved since the last
+    // frame; the stars found by it are processed again either way.
+    VisibleObjectCache<Star, float>::Query query{ &starDB, starDB.size(),
+                                                  obsPos.cast<float>(),
+                                                  observer.getOrientationf(),
+                                                  degToRad(fov),
+                                                  getAspectRatio(),
+                                                  faintestMagNight };
+    if (m_visibleStars.matches(query))
+    {
+        m_visibleStars.replay(starRenderer);
+    }
+    else
+    {
+        m_visibleStars.record(query, starRenderer);
+        starDB.findVisibleStars(m_visibleStars,
+                                query.position,
+                                query.orientation,
+                                query.fovY,
+                                query.aspectRatio,
+                                query.limitingMag,
 #ifdef OCTREE_DEBUG
-                            &m_starProcStats);
+                                &m_starProcStats);
 #else
-                            nullptr);
+                                nullptr);
 #endif
+    }
 
     starRenderer.starVertexBuffer->render();
     starRenderer.glareVertexBuffer->render();
@@ -4461,17 +4522,31 @@ void Renderer::renderDeepSkyObjects(const Universe& universe,
     m_dsoProcStats.nodes = 0;
     m_dsoProcStats.height = 0;
 #endif
-    dsoDB->findVisibleDSOs(dsoRenderer,
-                           obsPos,
-                           observer.getOrientationf(),
-                           degToRad(fov),
-                           getAspectRatio(),
-                           2 * faintestMagNight,
+    VisibleObjectCache<DeepSkyObject*, double>::Query query{ dsoDB, dsoDB->size(),
+                                                             obsPos,
+                                                             observer.getOrientationf(),
+                                                             degToRad(fov),
+                                                             getAspectRatio(),
+                                                             2 * faintestMagNight };
+    if (m_visibleDSOs.matches(query))
+    {
+        m_visibleDSOs.replay(dsoRenderer);
+    }
+    else
+    {
+        m_visibleDSOs.record(query, dsoRenderer);
+        dsoDB->findVisibleDSOs(m_visibleDSOs,
+                               query.position,
+                               query.orientation,
+                               query.fovY,
+                               query.aspectRatio,
+                               query.limitingMag,
 #ifdef OCTREE_DEBUG
-                           &m_dsoProcStats);
+                               &m_dsoProcStats);
 #else
-                            nullptr);
+                               nullptr);
 #endif
+    }
 
     // clog << "DSOs processed: " << dsoRenderer.dsosProcessed << endl;
 
@@ -4677,10 +4752,7 @@ Renderer::renderAnnotationMarker(const Annotation &a,
             int labelOffset = (int)markerRep.size() / 2;
             float x = labelOffset + PixelOffset;
             float y = -labelOffset - font->getHeight() + PixelOffset;
-            font->bind();
-            font->setMVPMatrices(*m.projection, mv);
-            font->render(markerRep.label(), x, y);
-            font->flush();
+            font->render(markerRep.label(), (mv * Vector4f(x, y, 0.0f, 1.0f)).head<3>(), a.color);
         }
     }
 }
@@ -4693,21 +4765,17 @@ Renderer::renderAnnotationLabel(const Annotation &a,
                                 float depth,
                                 const Matrices &m)
 {
-    glVertexAttrib(CelestiaGLProgram::ColorAttributeIndex, a.color);
-
-    Matrix4f mv = vecgl::translate(*m.modelview,
-                                   (int)a.position.x() + hOffset + PixelOffset,
-                                   (int)a.position.y() + vOffset + PixelOffset,
-                                   depth);
-
     auto font = getFont(fs);
     if (!font)
         return;
 
-    font->bind();
-    font->setMVPMatrices(*m.projection, mv);
-    font->render(a.labelText, 0.0f, 0.0f);
-    font->flush();
+    // Labels are queued with their own color and position, and drawn
+    // together when the font is unbound.
+    Vector4f offset((int)a.position.x() + hOffset + PixelOffset,
+                    (int)a.position.y() + vOffset + PixelOffset,
+                    depth,
+                    1.0f);
+    font->render(a.getLabelText(), ((*m.modelview) * offset).head<3>(), a.color);
 }
 
 // stars and constellations. DSOs
@@ -4727,6 +4795,9 @@ void Renderer::renderAnnotations(const vector<Annotation>& annotations,
     Matrix4f mv = Matrix4f::Identity();
     Matrices m = { &m_orthoProjMatrix, &mv };
 
+    font->bind();
+    font->setMVPMatrices(m_orthoProjMatrix);
+
     for (int i = 0; i < (int) annotations.size(); i++)
     {
         if (annotations[i].markerRep != nullptr)
@@ -4734,21 +4805,23 @@ void Renderer::renderAnnotations(const vector<Annotation>& annotations,
             renderAnnotationMarker(annotations[i], fs, 0.0f, m);
         }
 
-        if (!annotations[i].labelText.empty())
+        if (!annotations[i].getLabelText().empty())
         {
-            int labelWidth = 0;
+            int labelWidth = annotations[i].labelWidth;
             int hOffset = 2;
             int vOffset = 0;
 
             switch (annotations[i].halign)
             {
             case AlignCenter:
-                labelWidth = (font->getWidth(annotations[i].labelText));
+                if (labelWidth < 0)
+                    labelWidth = font->getWidth(annotations[i].getLabelText());
                 hOffset = -labelWidth / 2;
                 break;
 
             case AlignRight:
-                labelWidth = (font->getWidth(annotations[i].labelText));
+                if (labelWidth < 0)
+                    labelWidth = font->getWidth(annotations[i].getLabelText());
                 hOffset = -(labelWidth + 2);
                 break;
 
@@ -4830,6 +4903,9 @@ Renderer::renderAnnotations(vector<Annotation>::iterator startIter,
     Matrix4f mv = Matrix4f::Identity();
     Matrices m = { &m_orthoProjMatrix, &mv };
 
+    font->bind();
+    font->setMVPMatrices(m_orthoProjMatrix);
+
     // Precompute values that will be used to generate the normalized device z value;
     // we're effectively just handling the projection instead of OpenGL. We use an orthographic
     // projection matrix in order to get the label text position exactly right but need to mimic
@@ -4856,7 +4932,7 @@ Renderer::renderAnnotations(vector<Annotation>::iterator startIter,
             renderAnnotationMarker(*iter, fs, ndc_z, m);
         }
 
-        if (!iter->labelText.empty())
+        if (!iter->getLabelText().empty())
         {
             if (iter->markerRep != nullptr)
                 labelHOffset += (int) iter->markerRep->size() / 2 + 3;
@@ -4865,8 +4941,8 @@ Renderer::renderAnnotations(vector<Annotation>::iterator startIter,
         }
     }
 
-    disableDepthTest();
     font->unbind();
+    disableDepthTest();
 
     return iter;
 }
@@ -5764,13 +5840,15 @@ Renderer::buildNearSystemsLists(const Universe &universe,
         Vector3d astrocentricObserverPos = astrocentricPosition(observerPos, *sun, now);
 
         // Build render lists for bodies and orbits paths
+        const FlatFrameTree& flatTree = solarSysTree->getFlattened();
+        m_sceneSnapshot->getNodePosition(flatTree, 0, sun);
         buildRenderLists(astrocentricObserverPos, xfrustum,
                          observerOrient.conjugate() * -Vector3d::UnitZ(),
-                         Vector3d::Zero(), solarSysTree, observer, now);
+                         Vector3d::Zero(), flatTree, 0, observer, now);
         if ((renderFlags & ShowOrbits) != 0)
         {
             buildOrbitLists(astrocentricObserverPos, observerOrient,
-                            xfrustum, solarSysTree, now);
+                            xfrustum, Vector3d::Zero(), flatTree, 0, now);
         }
     }
 
@@ -5778,6 +5856,92 @@ Renderer::buildNearSystemsLists(const Universe &universe,
         buildLabelLists(xfrustum, now);
 }
 
+// Check whether the solar system lists would be built for the same time
+// and view as in the previous frame.
+bool
+Renderer::isNearSystemsViewUnchanged(const Observer &observer, double now) const
+{
+    const NearSystemsCache& cache = m_nearSystemsCache;
+    return cache.hasView &&
+           cache.time == now &&
+           cache.observerPosition == observer.getPosition() &&
+           cache.observerOrientation.coeffs() == observer.getOrientation().coeffs() &&
+           cache.fov == fov &&
+           cache.faintestMag == faintestMag &&
+           cache.solarSystemMaxDistance == SolarSystemMaxDistance &&
+           cache.windowWidth == windowWidth &&
+           cache.windowHeight == windowHeight &&
+           cache.highlightObject == highlightObject &&
+           cache.displayedSurface == displayedSurface &&
+           cache.locationFilter == locationFilter;
+}
+
+
+// Copy the kept solar system lists, if there are any and none of the solar
+// systems have changed since they were built.
+bool
+Renderer::restoreNearSystemsLists(const Universe &universe)
+{
+    NearSystemsCache& cache = m_nearSystemsCache;
+    if (!cache.hasLists)
+        return false;
+
+    for (const auto sun : cache.nearStars)
+    {
+        const SolarSystem* solarSystem = universe.getSolarSystem(sun);
+        if (solarSystem != nullptr && solarSystem->getFrameTree()->updateRequired())
+        {
+            cache.hasLists = false;
+            return false;
+        }
+    }
+
+    renderList = cache.renderList;
+    secondaryIlluminators = cache.secondaryIlluminators;
+    depthSortedAnnotations = cache.depthSortedAnnotations;
+    orbitPathList = cache.orbitPathList;
+    nearStars = cache.nearStars;
+    lightSourceList = cache.lightSourceList;
+
+    return true;
+}
+
+
+// Record the view the solar system lists were just built for. The lists are
+// only kept once they've been built twice for the same view, so that frames
+// with a changing view don't pay for copying them.
+void
+Renderer::storeNearSystemsLists(const Observer &observer, double now, bool viewUnchanged)
+{
+    NearSystemsCache& cache = m_nearSystemsCache;
+    if (!viewUnchanged)
+    {
+        cache.hasView = true;
+        cache.hasLists = false;
+        cache.time = now;
+        cache.observerPosition = observer.getPosition();
+        cache.observerOrientation = observer.getOrientation();
+        cache.fov = fov;
+        cache.faintestMag = faintestMag;
+        cache.solarSystemMaxDistance = SolarSystemMaxDistance;
+        cache.windowWidth = windowWidth;
+        cache.windowHeight = windowHeight;
+        cache.highlightObject = highlightObject;
+        cache.displayedSurface = displayedSurface;
+        cache.locationFilter = locationFilter;
+        return;
+    }
+
+    cache.hasLists = true;
+    cache.renderList = renderList;
+    cache.secondaryIlluminators = secondaryIlluminators;
+    cache.depthSortedAnnotations = depthSortedAnnotations;
+    cache.orbitPathList = orbitPathList;
+    cache.nearStars = nearStars;
+    cache.lightSourceList = lightSourceList;
+}
+
+
 void
 Renderer::buildDepthPartitions()
 {
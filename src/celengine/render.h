@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
@@ -23,8 +24,12 @@
 #include <celengine/rendcontext.h>
 #include <celengine/renderlistentry.h>
 #include "vertexobject.h"
+#include "visibleobjectcache.h"
 
 class RendererWatcher;
+class FlatFrameTree;
+class LabelManager;
+class SceneSnapshot;
 class FrameTree;
 class ReferenceMark;
 class CurvePlot;
@@ -165,6 +170,7 @@ class Renderer
         DwarfPlanetLabels   = 0x1000,
         MinorMoonLabels     = 0x2000,
         GlobularLabels      = 0x4000,
+        DeclutterLabels     = 0x8000,
         BodyLabelMask       = (PlanetLabels | DwarfPlanetLabels | MoonLabels | MinorMoonLabels | AsteroidLabels | SpacecraftLabels | CometLabels),
     };
 
@@ -384,12 +390,30 @@ class Renderer
     struct Annotation
     {
         std::string labelText;
+        // Label text of a star or deep sky object, owned by the label
+        // manager; used instead of labelText when set
+        const std::string* sharedLabelText{ nullptr };
         const celestia::MarkerRepresentation* markerRep;
         Color color;
         Eigen::Vector3f position;
         LabelAlignment halign : 3;
         LabelVerticalAlignment valign : 3;
         float size;
+        // Star or deep sky object the label belongs to, if any
+        const void* object{ nullptr };
+        // Width of the label in pixels, or -1 if it hasn't been measured
+        int labelWidth{ -1 };
+
+        const std::string& getLabelText() const
+        {
+            return sharedLabelText != nullptr ? *sharedLabelText : labelText;
+        }
+
+        void hideLabel()
+        {
+            labelText.clear();
+            sharedLabelText = nullptr;
+        }
 
         bool operator<(const Annotation&) const;
     };
@@ -401,13 +425,17 @@ class Renderer
                                  LabelAlignment halign = AlignLeft,
                                  LabelVerticalAlignment valign = VerticalAlignBottom,
                                  float size = 0.0f);
+    // Labels of stars and deep sky objects are added with the object they
+    // belong to; their text must then come from the label manager, and is
+    // referenced rather than copied.
     void addBackgroundAnnotation(const celestia::MarkerRepresentation* markerRep,
                                  const std::string& labelText,
                                  Color color,
                                  const Eigen::Vector3f& position,
                                  LabelAlignment halign = AlignLeft,
                                  LabelVerticalAlignment valign = VerticalAlignBottom,
-                                 float size = 0.0f);
+                                 float size = 0.0f,
+                                 const void* object = nullptr);
     void addSortedAnnotation(const celestia::MarkerRepresentation* markerRep,
                              const std::string& labelText,
                              Color color,
@@ -454,6 +482,15 @@ class Renderer
     void setFont(FontStyle, const std::shared_ptr<TextureFont>&);
     std::shared_ptr<TextureFont> getFont(FontStyle) const;
 
+    LabelManager& getLabelManager() { return *m_labelManager; }
+
+    /*! The state of solar system bodies for the frame being drawn. It is
+     *  reset whenever a frame is drawn for a new time; callers drawing
+     *  several views of the same instant may reset it once per frame
+     *  themselves.
+     */
+    SceneSnapshot& getSceneSnapshot() { return *m_sceneSnapshot; }
+
     bool settingsHaveChanged() const;
     void markSettingsChanged();
 
@@ -564,18 +601,24 @@ class Renderer
                                const Observer &observer,
                                const celmath::Frustum &xfrustum,
                                double jd);
+    bool isNearSystemsViewUnchanged(const Observer &observer, double jd) const;
+    bool restoreNearSystemsLists(const Universe &universe);
+    void storeNearSystemsLists(const Observer &observer, double jd, bool viewUnchanged);
 
     void buildRenderLists(const Eigen::Vector3d& astrocentricObserverPos,
                           const celmath::Frustum& viewFrustum,
                           const Eigen::Vector3d& viewPlaneNormal,
                           const Eigen::Vector3d& frameCenter,
-                          const FrameTree* tree,
+                          const FlatFrameTree& flatTree,
+                          std::uint32_t parentNode,
                           const Observer& observer,
                           double now);
     void buildOrbitLists(const Eigen::Vector3d& astrocentricObserverPos,
                          const Eigen::Quaterniond& observerOrientation,
                          const celmath::Frustum& viewFrustum,
-                         const FrameTree* tree,
+                         const Eigen::Vector3d& frameCenter,
+                         const FlatFrameTree& flatTree,
+                         std::uint32_t parentNode,
                          double now);
     void buildLabelLists(const celmath::Frustum& viewFrustum,
                          double now);
@@ -686,7 +729,8 @@ class Renderer
                        LabelAlignment halign = AlignLeft,
                        LabelVerticalAlignment = VerticalAlignBottom,
                        float size = 0.0f,
-                       bool special = false);
+                       bool special = false,
+                       const void* object = nullptr);
     void renderAnnotationMarker(const Annotation &a,
                                 FontStyle fs,
                                 float depth,
@@ -791,6 +835,39 @@ class Renderer
 
     std::vector<LightSource> lightSourceList;
 
+    // The view the solar system lists of the previous frame were built for.
+    // Once the view has stayed the same for two frames, the lists are kept,
+    // and copied rather than rebuilt for as long as it doesn't change.
+    struct NearSystemsCache
+    {
+        bool hasView{ false };
+        bool hasLists{ false };
+        double time{ 0.0 };
+        UniversalCoord observerPosition;
+        Eigen::Quaterniond observerOrientation;
+        float fov{ 0.0f };
+        float faintestMag{ 0.0f };
+        float solarSystemMaxDistance{ 0.0f };
+        int windowWidth{ 0 };
+        int windowHeight{ 0 };
+        Selection highlightObject;
+        std::string displayedSurface;
+        uint64_t locationFilter{ 0 };
+
+        std::vector<RenderListEntry> renderList;
+        std::vector<SecondaryIlluminator> secondaryIlluminators;
+        std::vector<Annotation> depthSortedAnnotations;
+        std::vector<OrbitPathListEntry> orbitPathList;
+        std::vector<const Star*> nearStars;
+        std::vector<LightSource> lightSourceList;
+    };
+    NearSystemsCache m_nearSystemsCache;
+
+    // Results of the star and deep sky object octree queries of the
+    // previous frame
+    VisibleObjectCache<Star, float> m_visibleStars;
+    VisibleObjectCache<DeepSkyObject*, double> m_visibleDSOs;
+
     Eigen::Matrix4f m_modelMatrix;
     Eigen::Matrix4f m_projMatrix;
     Eigen::Matrix4f m_MVPMatrix;
@@ -842,6 +919,9 @@ class Renderer
     AsterismRenderer* m_asterismRenderer { nullptr };
     BoundariesRenderer* m_boundariesRenderer { nullptr };
 
+    std::unique_ptr<LabelManager> m_labelManager;
+    std::unique_ptr<SceneSnapshot> m_sceneSnapshot;
+
     // True if we're in between a begin/endObjectAnnotations
     bool objectAnnotationSetOpen;
 
@@ -0,0 +1,257 @@
+// scenesnapshot.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Positions and orientations of solar system bodies at one instant,
+// evaluated once and shared by everything that draws or queries a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+
+#include "body.h"
+#include "flatframetree.h"
+#include "frame.h"
+#include "scenesnapshot.h"
+#include "selection.h"
+#include "star.h"
+
+
+void
+SceneSnapshot::reset(double t)
+{
+    // Forget the trees that weren't used during the last snapshot; they may
+    // have been rebuilt or destroyed since.
+    trees.erase(std::remove_if(trees.begin(), trees.end(),
+                               [this](const TreeState& state) { return state.generation != generation; }),
+                trees.end());
+    lastTree = 0;
+
+    bodies.clear();
+    nodeBodies.clear();
+    time = t;
+    generation++;
+}
+
+
+std::uint32_t
+SceneSnapshot::getTreeIndex(const FlatFrameTree& tree, const Star* star)
+{
+    std::uint32_t index = lastTree;
+    if (index >= trees.size() || trees[index].id != tree.getId())
+    {
+        index = 0;
+        while (index < trees.size() && trees[index].id != tree.getId())
+            index++;
+        if (index == trees.size())
+            trees.emplace_back().id = tree.getId();
+        lastTree = index;
+    }
+
+    TreeState& state = trees[index];
+    if (state.generation != generation)
+    {
+        state.generation = generation;
+        state.positions.resize(tree.getNodeCount());
+        state.generations.assign(tree.getNodeCount(), 0);
+        state.star = nullptr;
+    }
+
+    if (star != nullptr && state.star == nullptr)
+    {
+        state.star = star;
+        state.starPosition = star->getPosition(time);
+    }
+
+    return index;
+}
+
+
+const Eigen::Vector3d&
+SceneSnapshot::setNodePosition(const FlatFrameTree& tree,
+                               std::uint32_t treeIndex,
+                               std::uint32_t node,
+                               const Eigen::Vector3d& orbitPosition)
+{
+    const FlatFrameTree::Node& n = tree.getNode(node);
+    Eigen::Vector3d position = getNodePosition(tree, treeIndex, n.parent) +
+                               n.orbitFrame->getOrientation(time).conjugate() * orbitPosition;
+
+    if (n.includes(time))
+        nodeBodies.push_back({ n.body, treeIndex, node });
+
+    TreeState& state = trees[treeIndex];
+    state.positions[node] = position;
+    state.generations[node] = generation;
+    return state.positions[node];
+}
+
+
+const Eigen::Vector3d&
+SceneSnapshot::getNodePosition(const FlatFrameTree& tree,
+                               std::uint32_t treeIndex,
+                               std::uint32_t node)
+{
+    TreeState& state = trees[treeIndex];
+    if (state.generations[node] == generation)
+        return state.positions[node];
+
+    const FlatFrameTree::Node& n = tree.getNode(node);
+    if (n.parent == FlatFrameTree::NoParent)
+    {
+        state.positions[node] = Eigen::Vector3d::Zero();
+        state.generations[node] = generation;
+        return state.positions[node];
+    }
+
+    return setNodePosition(tree, treeIndex, node, n.orbit->positionAtTime(time));
+}
+
+
+const Eigen::Vector3d&
+SceneSnapshot::getNodePosition(const FlatFrameTree& tree,
+                               std::uint32_t node,
+                               const Star* star)
+{
+    return getNodePosition(tree, getTreeIndex(tree, star), node);
+}
+
+
+void
+SceneSnapshot::computeNodePositions(const FlatFrameTree& tree,
+                                    celestia::util::array_view<std::uint32_t> nodes)
+{
+    std::uint32_t treeIndex = getTreeIndex(tree, nullptr);
+    TreeState& state = trees[treeIndex];
+
+    batchNodes.clear();
+    batchOrbits.clear();
+    for (std::uint32_t node : nodes)
+    {
+        const FlatFrameTree::Node& n = tree.getNode(node);
+        if (state.generations[node] != generation && n.ellipticalOrbit != nullptr)
+        {
+            batchNodes.push_back(node);
+            batchOrbits.push_back(n.ellipticalOrbit);
+        }
+    }
+
+    batchPositions.resize(batchOrbits.size());
+    if (incrementalOrbits)
+    {
+        if (state.keplerStates.size() != tree.getNodeCount())
+        {
+            state.keplerStates.assign(tree.getNodeCount(), {});
+            state.keplerOrbits.assign(tree.getNodeCount(), nullptr);
+        }
+
+        batchStates.resize(batchNodes.size());
+        for (std::size_t i = 0; i < batchNodes.size(); i++)
+        {
+            std::uint32_t node = batchNodes[i];
+            if (state.keplerOrbits[node] != batchOrbits[i])
+            {
+                state.keplerStates[node] = {};
+                state.keplerOrbits[node] = batchOrbits[i];
+            }
+            batchStates[i] = state.keplerStates[node];
+        }
+
+        EllipticalOrbit::positionsAtTime(batchOrbits, time, batchPositions, batchStates);
+        for (std::size_t i = 0; i < batchNodes.size(); i++)
+            state.keplerStates[batchNodes[i]] = batchStates[i];
+    }
+    else
+    {
+        EllipticalOrbit::positionsAtTime(batchOrbits, time, batchPositions);
+    }
+
+    for (std::size_t i = 0; i < batchNodes.size(); i++)
+        setNodePosition(tree, treeIndex, batchNodes[i], batchPositions[i]);
+
+    // Nodes with other kinds of orbits are evaluated one at a time
+    for (std::uint32_t node : nodes)
+        getNodePosition(tree, treeIndex, node);
+}
+
+
+SceneSnapshot::BodyState&
+SceneSnapshot::getBodyState(const Body& body)
+{
+    for (const NodeBody& nodeBody : nodeBodies)
+    {
+        BodyState& state = bodies[nodeBody.body];
+        state.astrocentricPosition = trees[nodeBody.tree].positions[nodeBody.node];
+        state.hasAstrocentricPosition = true;
+        state.tree = nodeBody.tree;
+    }
+    nodeBodies.clear();
+
+    return bodies[&body];
+}
+
+
+Eigen::Vector3d
+SceneSnapshot::getAstrocentricPosition(const Body& body, double t)
+{
+    if (t != time)
+        return body.getAstrocentricPosition(t);
+
+    BodyState& state = getBodyState(body);
+    if (!state.hasAstrocentricPosition)
+    {
+        state.astrocentricPosition = body.getAstrocentricPosition(t);
+        state.hasAstrocentricPosition = true;
+    }
+
+    return state.astrocentricPosition;
+}
+
+
+UniversalCoord
+SceneSnapshot::getPosition(const Body& body, double t)
+{
+    if (t != time)
+        return body.getPosition(t);
+
+    BodyState& state = getBodyState(body);
+    if (!state.hasPosition)
+    {
+        if (state.hasAstrocentricPosition && state.tree != NoTree && trees[state.tree].star != nullptr)
+            state.position = trees[state.tree].starPosition.offsetKm(state.astrocentricPosition);
+        else
+            state.position = body.getPosition(t);
+        state.hasPosition = true;
+    }
+
+    return state.position;
+}
+
+
+UniversalCoord
+SceneSnapshot::getPosition(const Selection& sel, double t)
+{
+    if (sel.getType() == Selection::Type_Body)
+        return getPosition(*sel.body(), t);
+    return sel.getPosition(t);
+}
+
+
+Eigen::Quaterniond
+SceneSnapshot::getOrientation(const Body& body, double t)
+{
+    if (t != time)
+        return body.getOrientation(t);
+
+    BodyState& state = getBodyState(body);
+    if (!state.hasOrientation)
+    {
+        state.orientation = body.getOrientation(t);
+        state.hasOrientation = true;
+    }
+
+    return state.orientation;
+}
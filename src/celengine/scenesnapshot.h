@@ -0,0 +1,154 @@
+// scenesnapshot.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Positions and orientations of solar system bodies at one instant,
+// evaluated once and shared by everything that draws or queries a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celengine/univcoord.h>
+#include <celephem/kepler.h>
+#include <celutil/array_view.h>
+
+class Body;
+class EllipticalOrbit;
+class FlatFrameTree;
+class Selection;
+class Star;
+
+
+/*! A SceneSnapshot records the state of solar system bodies at a single
+ *  time: astrocentric positions, universal positions and orientations.
+ *  Each value is evaluated on first use and then reused by every later
+ *  request until the snapshot is reset, so that the render list, orbit
+ *  and label passes of every view, eclipse tests, picking and the info
+ *  overlay share one ephemeris evaluation per body and frame.
+ *
+ *  Requests for any time other than the snapshot time are evaluated
+ *  directly and not recorded.
+ */
+class SceneSnapshot
+{
+ public:
+    //! Discard all recorded values and start a snapshot at time t
+    void reset(double t);
+
+    double getTime() const { return time; }
+
+    /*! Return the position, relative to the system's star, of a node of a
+     *  flattened frame tree. The node and its ancestors must be active at
+     *  the snapshot time. If star is not null, it is recorded as the center
+     *  of the tree so that universal positions can be derived from the
+     *  astrocentric ones.
+     */
+    const Eigen::Vector3d& getNodePosition(const FlatFrameTree& tree,
+                                           std::uint32_t node,
+                                           const Star* star = nullptr);
+
+    /*! Compute the positions of several nodes of a flattened frame tree
+     *  together. Nodes with Keplerian orbits have their positions evaluated
+     *  in batches, which is much faster than one at a time for the large
+     *  numbers of minor bodies in some systems. The same conditions apply
+     *  as for getNodePosition().
+     */
+    void computeNodePositions(const FlatFrameTree& tree,
+                              celestia::util::array_view<std::uint32_t> nodes);
+
+    /*! Enable or disable incremental evaluation of Keplerian orbits by
+     *  computeNodePositions(). When enabled, the solution of each orbit is
+     *  kept and advanced from one snapshot to the next instead of being
+     *  solved again, which is much cheaper at moderate time rates; see
+     *  celestia::ephem::AdvanceKeplerElliptical() for the error bounds.
+     */
+    void setIncrementalOrbits(bool enable) { incrementalOrbits = enable; }
+    bool getIncrementalOrbits() const { return incrementalOrbits; }
+
+    Eigen::Vector3d getAstrocentricPosition(const Body& body, double t);
+    UniversalCoord getPosition(const Body& body, double t);
+    UniversalCoord getPosition(const Selection& sel, double t);
+    Eigen::Quaterniond getOrientation(const Body& body, double t);
+
+ private:
+    static constexpr std::uint32_t NoTree = ~static_cast<std::uint32_t>(0);
+
+    struct TreeState
+    {
+        // Id of the FlatFrameTree, and the node positions indexed like its nodes
+        std::uint64_t id{ 0 };
+        std::vector<Eigen::Vector3d> positions;
+        std::vector<std::uint32_t> generations;
+        const Star* star{ nullptr };
+        UniversalCoord starPosition;
+        std::uint32_t generation{ 0 };
+
+        // Solutions for the nodes' Keplerian orbits, kept across snapshots
+        // for incremental evaluation, and the orbits they belong to
+        std::vector<celestia::ephem::KeplerState> keplerStates;
+        std::vector<const EllipticalOrbit*> keplerOrbits;
+    };
+
+    struct BodyState
+    {
+        Eigen::Vector3d astrocentricPosition;
+        UniversalCoord position;
+        Eigen::Quaterniond orientation;
+        // Tree whose star the astrocentric position is relative to
+        std::uint32_t tree{ NoTree };
+        bool hasAstrocentricPosition{ false };
+        bool hasPosition{ false };
+        bool hasOrientation{ false };
+    };
+
+    // A body whose position was computed as a node of a tree
+    struct NodeBody
+    {
+        const Body* body;
+        std::uint32_t tree;
+        std::uint32_t node;
+    };
+
+    std::uint32_t getTreeIndex(const FlatFrameTree& tree, const Star* star);
+    const Eigen::Vector3d& getNodePosition(const FlatFrameTree& tree,
+                                           std::uint32_t treeIndex,
+                                           std::uint32_t node);
+    const Eigen::Vector3d& setNodePosition(const FlatFrameTree& tree,
+                                           std::uint32_t treeIndex,
+                                           std::uint32_t node,
+                                           const Eigen::Vector3d& orbitPosition);
+    BodyState& getBodyState(const Body& body);
+
+    double time{ std::numeric_limits<double>::quiet_NaN() };
+    std::uint32_t generation{ 1 };
+    // Only a few trees are used in a frame, so they're searched linearly,
+    // starting with the last one used
+    std::vector<TreeState> trees;
+    std::uint32_t lastTree{ 0 };
+
+    // Body states are requested by Body rather than by node. The bodies of
+    // the nodes evaluated are only recorded in the map when the first such
+    // request is made, which keeps map lookups out of node evaluation.
+    std::unordered_map<const Body*, BodyState> bodies;
+    std::vector<NodeBody> nodeBodies;
+
+    // Scratch space for computeNodePositions()
+    std::vector<std::uint32_t> batchNodes;
+    std::vector<const EllipticalOrbit*> batchOrbits;
+    std::vector<Eigen::Vector3d> batchPositions;
+    std::vector<celestia::ephem::KeplerState> batchStates;
+
+    bool incrementalOrbits{ false };
+};
@@ -0,0 +1,329 @@
+// shadercache.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Disk cache of linked shader program binaries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
+#include <celutil/fnv.h>
+#include <celutil/logger.h>
+#include "glshader.h"
+#include "glsupport.h"
+#include "shadercache.h"
+#include "shadermanager.h"
+
+namespace celutil = celestia::util;
+using celestia::util::GetLogger;
+
+
+namespace
+{
+
+constexpr std::string_view BinaryHeader = "CELSHBIN";
+constexpr std::string_view VariantsHeader = "CELSHVAR";
+constexpr std::uint32_t BinaryVersion = 2;
+constexpr std::uint32_t VariantsVersion = 1;
+
+// Upper bound on the number of recorded shader variants
+constexpr std::uint32_t MaxVariants = 4096;
+
+// Upper bound on the size of a program binary, which is checked when it is
+// read so that a damaged file can't cause a huge allocation
+constexpr std::uint32_t MaxBinarySize = 1U << 26;
+
+// Binaries that haven't been used for this long are deleted by prune()
+constexpr auto MaxUnusedAge = std::chrono::hours(24 * 90);
+
+// Seeds for the hash used to name a cache file, and for the independent
+// hash stored inside it to guard against collisions
+constexpr std::uint64_t KeySeed = celutil::FNV1aOffsetBasis;
+constexpr std::uint64_t CheckSeed = UINT64_C(0x84222325cbf29ce4);
+
+const char*
+GetGLString(GLenum name)
+{
+    const auto* str = reinterpret_cast<const char*>(glGetString(name));
+    return str == nullptr ? "" : str;
+}
+
+bool
+ReadHeader(std::istream& in, std::string_view header, std::uint32_t expectedVersion)
+{
+    char buffer[8];
+    std::uint32_t version;
+    return header.size() == sizeof(buffer) &&
+           in.read(buffer, sizeof(buffer)).good() &&
+           std::string_view(buffer, sizeof(buffer)) == header &&
+           celutil::readLE<std::uint32_t>(in, version) &&
+           version == expectedVersion;
+}
+
+void
+WriteHeader(std::ostream& out, std::string_view header, std::uint32_t version)
+{
+    out.write(header.data(), header.size());
+    celutil::writeLE<std::uint32_t>(out, version);
+}
+
+// Read the part of a binary's header that doesn't depend on the sources
+bool
+ReadBinaryHeader(std::istream& in, std::uint64_t driverHash)
+{
+    std::uint64_t fileDriverHash;
+    return ReadHeader(in, BinaryHeader, BinaryVersion) &&
+           celutil::readLE<std::uint64_t>(in, fileDriverHash) &&
+           fileDriverHash == driverHash;
+}
+
+} // end unnamed namespace
+
+
+ShaderCache::ShaderCache(const fs::path& _directory, std::string _driver) :
+    directory(_directory),
+    driver(std::move(_driver))
+{
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec)
+        GetLogger()->warn("Could not create shader cache directory {}\n", directory);
+}
+
+
+bool
+ShaderCache::isSupported()
+{
+#ifdef GL_ES
+    return celestia::gl::OES_get_program_binary;
+#else
+    return celestia::gl::ARB_get_program_binary;
+#endif
+}
+
+
+std::string
+ShaderCache::getDriver()
+{
+    return fmt::format("{}|{}|{}|{}",
+                       GetGLString(GL_VENDOR),
+                       GetGLString(GL_RENDERER),
+                       GetGLString(GL_VERSION),
+                       GetGLString(GL_SHADING_LANGUAGE_VERSION));
+}
+
+
+fs::path
+ShaderCache::getPath(std::uint64_t key) const
+{
+    return directory / fmt::format("{:016x}.bin", key);
+}
+
+
+GLProgram*
+ShaderCache::load(const std::string& vsSource, const std::string& fsSource) const
+{
+    std::uint32_t format;
+    std::vector<char> binary;
+    if (!loadBinary(vsSource, fsSource, format, binary))
+        return nullptr;
+
+    GLProgram* prog = nullptr;
+    if (GLShaderLoader::CreateProgramFromBinary(static_cast<GLenum>(format), binary, &prog) != ShaderStatus_OK)
+        return nullptr;
+
+    return prog;
+}
+
+
+void
+ShaderCache::prepare(GLProgram& prog)
+{
+    prog.setBinaryRetrievable();
+}
+
+
+void
+ShaderCache::store(const GLProgram& prog, const std::string& vsSource, const std::string& fsSource) const
+{
+    GLenum format = 0;
+    std::vector<char> binary;
+    if (prog.getBinary(format, binary))
+        storeBinary(vsSource, fsSource, static_cast<std::uint32_t>(format), binary);
+}
+
+
+bool
+ShaderCache::loadBinary(const std::string& vsSource, const std::string& fsSource,
+                        std::uint32_t& format, std::vector<char>& binary) const
+{
+    std::uint64_t key = celutil::FNV1a64(fsSource, celutil::FNV1a64(vsSource, celutil::FNV1a64(driver, KeySeed)));
+    fs::path path = getPath(key);
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.good() || !ReadBinaryHeader(in, celutil::FNV1a64(driver)))
+        return false;
+
+    std::uint64_t vsLength, fsLength, check;
+    std::uint32_t length;
+    if (!celutil::readLE<std::uint64_t>(in, vsLength) || vsLength != vsSource.size() ||
+        !celutil::readLE<std::uint64_t>(in, fsLength) || fsLength != fsSource.size() ||
+        !celutil::readLE<std::uint64_t>(in, check) ||
+        check != celutil::FNV1a64(fsSource, celutil::FNV1a64(vsSource, celutil::FNV1a64(driver, CheckSeed))) ||
+        !celutil::readLE<std::uint32_t>(in, format) ||
+        !celutil::readLE<std::uint32_t>(in, length) || length > MaxBinarySize)
+    {
+        return false;
+    }
+
+    binary.resize(length);
+    if (!in.read(binary.data(), length).good())
+        return false;
+
+    // Mark the binary as used, so that prune() keeps it
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    return true;
+}
+
+
+void
+ShaderCache::storeBinary(const std::string& vsSource, const std::string& fsSource,
+                         std::uint32_t format, const std::vector<char>& binary) const
+{
+    if (binary.size() > MaxBinarySize)
+        return;
+
+    std::uint64_t key = celutil::FNV1a64(fsSource, celutil::FNV1a64(vsSource, celutil::FNV1a64(driver, KeySeed)));
+    std::ofstream out(getPath(key), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.good())
+        return;
+
+    WriteHeader(out, BinaryHeader, BinaryVersion);
+    celutil::writeLE<std::uint64_t>(out, celutil::FNV1a64(driver));
+    celutil::writeLE<std::uint64_t>(out, vsSource.size());
+    celutil::writeLE<std::uint64_t>(out, fsSource.size());
+    celutil::writeLE<std::uint64_t>(out, celutil::FNV1a64(fsSource, celutil::FNV1a64(vsSource, celutil::FNV1a64(driver, CheckSeed))));
+    celutil::writeLE<std::uint32_t>(out, format);
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(binary.size()));
+    out.write(binary.data(), binary.size());
+
+    if (!out.good())
+        GetLogger()->warn("Could not write shader cache file {}\n", getPath(key));
+}
+
+
+std::vector<ShaderProperties>
+ShaderCache::readVariants() const
+{
+    std::vector<ShaderProperties> variants;
+
+    std::ifstream in(directory / "variants.dat", std::ios::in | std::ios::binary);
+    std::uint32_t count;
+    if (!in.good() || !ReadHeader(in, VariantsHeader, VariantsVersion) ||
+        !celutil::readLE<std::uint32_t>(in, count) || count > MaxVariants)
+    {
+        return variants;
+    }
+
+    variants.reserve(count);
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::uint64_t texUsage;
+        std::uint16_t nLights, lightModel, effects;
+        std::uint32_t shadowCounts;
+        std::int32_t fishEyeOverride;
+        if (!celutil::readLE<std::uint64_t>(in, texUsage) ||
+            !celutil::readLE<std::uint16_t>(in, nLights) ||
+            !celutil::readLE<std::uint16_t>(in, lightModel) ||
+            !celutil::readLE<std::uint16_t>(in, effects) ||
+            !celutil::readLE<std::uint32_t>(in, shadowCounts) ||
+            !celutil::readLE<std::int32_t>(in, fishEyeOverride) ||
+            nLights > MaxShaderLights)
+        {
+            GetLogger()->warn("Shader variant list in {} is damaged\n", directory);
+            variants.clear();
+            break;
+        }
+
+        ShaderProperties props;
+        props.texUsage = static_cast<unsigned long>(texUsage);
+        props.nLights = nLights;
+        props.lightModel = lightModel;
+        props.effects = effects;
+        props.shadowCounts = shadowCounts;
+        props.fishEyeOverride = fishEyeOverride;
+        variants.push_back(props);
+    }
+
+    return variants;
+}
+
+
+void
+ShaderCache::writeVariants(const std::vector<ShaderProperties>& variants) const
+{
+    std::ofstream out(directory / "variants.dat", std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.good())
+        return;
+
+    auto count = static_cast<std::uint32_t>(std::min<std::size_t>(variants.size(), MaxVariants));
+    WriteHeader(out, VariantsHeader, VariantsVersion);
+    celutil::writeLE<std::uint32_t>(out, count);
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        const ShaderProperties& props = variants[i];
+        celutil::writeLE<std::uint64_t>(out, props.texUsage);
+        celutil::writeLE<std::uint16_t>(out, props.nLights);
+        celutil::writeLE<std::uint16_t>(out, props.lightModel);
+        celutil::writeLE<std::uint16_t>(out, props.effects);
+        celutil::writeLE<std::uint32_t>(out, props.shadowCounts);
+        celutil::writeLE<std::int32_t>(out, props.fishEyeOverride);
+    }
+}
+
+
+void
+ShaderCache::prune() const
+{
+    std::uint64_t driverHash = celutil::FNV1a64(driver);
+    auto now = fs::file_time_type::clock::now();
+
+    std::vector<fs::path> stale;
+    std::error_code ec;
+    for (fs::directory_iterator iter(directory, ec), end; !ec && iter != end; iter.increment(ec))
+    {
+        const fs::path& path = iter->path();
+        if (path.extension() != ".bin")
+            continue;
+
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        bool current = in.good() && ReadBinaryHeader(in, driverHash);
+        if (current)
+        {
+            std::error_code timeError;
+            auto modified = fs::last_write_time(path, timeError);
+            current = !timeError && now - modified < MaxUnusedAge;
+        }
+
+        if (!current)
+            stale.push_back(path);
+    }
+
+    for (const fs::path& path : stale)
+        fs::remove(path, ec);
+
+    if (!stale.empty())
+        GetLogger()->verbose("Removed {} stale shader binaries from {}\n", stale.size(), directory);
+}
@@ -0,0 +1,79 @@
+// shadercache.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Disk cache of linked shader program binaries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+
+class GLProgram;
+class ShaderProperties;
+
+
+/*! A ShaderCache keeps the binaries of linked shader programs on disk,
+ *  keyed by a hash of the GLSL source and of the driver that compiled them,
+ *  so that later sessions can skip compiling and linking. It also keeps the
+ *  list of shader property combinations used in earlier sessions, so that
+ *  their programs can be built ahead of time.
+ *
+ *  The cache requires program binary support from the driver; see
+ *  isSupported().
+ */
+class ShaderCache
+{
+ public:
+    ShaderCache(const fs::path& directory, std::string driver);
+
+    static bool isSupported();
+
+    //! Identify the current GL driver, which compiled the cached binaries
+    static std::string getDriver();
+
+    /*! Return a program created from the cached binary for a pair of
+     *  shader sources, or nullptr if there is none or the driver rejects it.
+     */
+    GLProgram* load(const std::string& vsSource, const std::string& fsSource) const;
+
+    //! Make a program's binary retrievable; call before linking it
+    static void prepare(GLProgram& prog);
+
+    //! Store the binary of a linked program
+    void store(const GLProgram& prog, const std::string& vsSource, const std::string& fsSource) const;
+
+    /*! Read the cached binary for a pair of shader sources, as returned by
+     *  glGetProgramBinary. Fails if the binary was stored for different
+     *  sources, by another driver or in another cache format.
+     */
+    bool loadBinary(const std::string& vsSource, const std::string& fsSource,
+                    std::uint32_t& format, std::vector<char>& binary) const;
+    void storeBinary(const std::string& vsSource, const std::string& fsSource,
+                     std::uint32_t format, const std::vector<char>& binary) const;
+
+    std::vector<ShaderProperties> readVariants() const;
+    void writeVariants(const std::vector<ShaderProperties>& variants) const;
+
+    /*! Delete binaries that can't be used any more: those written by
+     *  another driver or in another cache format, and those that haven't
+     *  been loaded or stored for a long time, typically because the
+     *  shader sources have changed.
+     */
+    void prune() const;
+
+ private:
+    fs::path getPath(std::uint64_t key) const;
+
+    fs::path directory;
+    std::string driver;
+};
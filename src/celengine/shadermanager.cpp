@@ -14,7 +14,9 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <set>
 #include <tuple>
+#include <vector>
 #include <fmt/format.h>
 #include <Eigen/Geometry>
 #include <celcompat/filesystem.h>
@@ -22,6 +24,7 @@
 #include <celutil/logger.h>
 #include "glsupport.h"
 #include "vecgl.h"
+#include "shadercache.h"
 #include "shadermanager.h"
 #include "shadowmap.h"
 
@@ -346,6 +349,22 @@ ShaderManager::ShaderManager()
 
 ShaderManager::~ShaderManager()
 {
+    if (cache != nullptr)
+    {
+        // Record the shader variants used in this session along with the
+        // ones used before
+        std::set<ShaderProperties> variants;
+        for (const auto& props : cache->readVariants())
+            variants.insert(props);
+
+        std::size_t recorded = variants.size();
+        for (const auto& shader : dynamicShaders)
+            variants.insert(shader.first);
+
+        if (variants.size() != recorded)
+            cache->writeVariants(std::vector<ShaderProperties>(variants.begin(), variants.end()));
+    }
+
     for(const auto& shader : dynamicShaders)
         delete shader.second;
 
@@ -1749,8 +1768,8 @@ float calculateShadow()
     return source;
 }
 
-GLVertexShader*
-ShaderManager::buildVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildVertexShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2098,14 +2117,12 @@ ShaderManager::buildVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
-ShaderManager::buildFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildFragmentShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     // Without GL_ARB_shader_texture_lod enabled one can use texture2DLod
@@ -2543,15 +2560,13 @@ ShaderManager::buildFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source;
 }
 
 
 #if 0
-GLVertexShader*
-ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildRingsVertexShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2601,14 +2616,12 @@ ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
-ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildRingsFragmentShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2687,15 +2700,13 @@ ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source;
 }
 #endif
 
 
-GLVertexShader*
-ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildRingsVertexShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2741,14 +2752,12 @@ ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
-ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildRingsFragmentShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2852,14 +2861,12 @@ ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source;
 }
 
 
-GLVertexShader*
-ShaderManager::buildAtmosphereVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildAtmosphereVertexShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2899,14 +2906,12 @@ ShaderManager::buildAtmosphereVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
-ShaderManager::buildAtmosphereFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildAtmosphereFragmentShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -2956,16 +2961,14 @@ ShaderManager::buildAtmosphereFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source;
 }
 
 
 // The emissive shader ignores all lighting and uses the diffuse color
 // as the final fragment color.
-GLVertexShader*
-ShaderManager::buildEmissiveVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildEmissiveVertexShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -3031,14 +3034,12 @@ ShaderManager::buildEmissiveVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
-ShaderManager::buildEmissiveFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildEmissiveFragmentShaderSource(const ShaderProperties& props)
 {
     string source(VersionHeader);
     source += CommonHeader;
@@ -3087,15 +3088,13 @@ ShaderManager::buildEmissiveFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source;
 }
 
 
 // Build the vertex shader used for rendering particle systems.
-GLVertexShader*
-ShaderManager::buildParticleVertexShader(const ShaderProperties& props)
+string
+ShaderManager::buildParticleVertexShaderSource(const ShaderProperties& props)
 {
     ostringstream source;
     source << VersionHeader;
@@ -3169,14 +3168,12 @@ ShaderManager::buildParticleVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source.str(), &vs);
-    return status == ShaderStatus_OK ? vs : nullptr;
+    return source.str();
 }
 
 
-GLFragmentShader*
-ShaderManager::buildParticleFragmentShader(const ShaderProperties& props)
+string
+ShaderManager::buildParticleFragmentShaderSource(const ShaderProperties& props)
 {
     ostringstream source;
 
@@ -3237,49 +3234,48 @@ ShaderManager::buildParticleFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source.str(), &fs);
-    return status == ShaderStatus_OK ? fs : nullptr;
+    return source.str();
 }
 
 CelestiaGLProgram*
 ShaderManager::buildProgram(const ShaderProperties& props)
 {
     GLProgram* prog = nullptr;
-    GLShaderStatus status;
+    GLShaderStatus status = ShaderStatus_OK;
 
-    GLVertexShader* vs = nullptr;
-    GLFragmentShader* fs = nullptr;
+    string vs;
+    string fs;
 
     if (props.lightModel == ShaderProperties::RingIllumModel)
     {
-        vs = buildRingsVertexShader(props);
-        fs = buildRingsFragmentShader(props);
+        vs = buildRingsVertexShaderSource(props);
+        fs = buildRingsFragmentShaderSource(props);
     }
     else if (props.lightModel == ShaderProperties::AtmosphereModel)
     {
-        vs = buildAtmosphereVertexShader(props);
-        fs = buildAtmosphereFragmentShader(props);
+        vs = buildAtmosphereVertexShaderSource(props);
+        fs = buildAtmosphereFragmentShaderSource(props);
     }
     else if (props.lightModel == ShaderProperties::EmissiveModel)
     {
-        vs = buildEmissiveVertexShader(props);
-        fs = buildEmissiveFragmentShader(props);
+        vs = buildEmissiveVertexShaderSource(props);
+        fs = buildEmissiveFragmentShaderSource(props);
     }
     else if (props.lightModel == ShaderProperties::ParticleModel)
     {
-        vs = buildParticleVertexShader(props);
-        fs = buildParticleFragmentShader(props);
+        vs = buildParticleVertexShaderSource(props);
+        fs = buildParticleFragmentShaderSource(props);
     }
     else
     {
-        vs = buildVertexShader(props);
-        fs = buildFragmentShader(props);
+        vs = buildVertexShaderSource(props);
+        fs = buildFragmentShaderSource(props);
     }
 
-    if (vs != nullptr && fs != nullptr)
+    prog = loadCachedProgram(vs, fs);
+    if (prog == nullptr)
     {
-        status = GLShaderLoader::CreateProgram(*vs, *fs, &prog);
+        status = GLShaderLoader::CreateProgram(vs, fs, &prog);
         if (status == ShaderStatus_OK)
         {
             glBindAttribLocation(prog->getID(),
@@ -3339,16 +3335,13 @@ ShaderManager::buildProgram(const ShaderProperties& props)
                                      "in_PointSize");
             }
 
+            if (cache != nullptr)
+                ShaderCache::prepare(*prog);
             status = prog->link();
+            if (status == ShaderStatus_OK)
+                storeCachedProgram(*prog, vs, fs);
         }
     }
-    else
-    {
-        status = ShaderStatus_CompileError;
-    }
-
-    delete vs;
-    delete fs;
 
     if (status != ShaderStatus_OK)
     {
@@ -3385,6 +3378,10 @@ ShaderManager::buildProgram(const std::string& vs, const std::string& fs)
     DumpVSSource(_vs);
     DumpFSSource(_fs);
 
+    prog = loadCachedProgram(_vs, _fs);
+    if (prog != nullptr)
+        return new CelestiaGLProgram(*prog);
+
     status = GLShaderLoader::CreateProgram(_vs, _fs, &prog);
     if (status == ShaderStatus_OK)
     {
@@ -3428,7 +3425,11 @@ ShaderManager::buildProgram(const std::string& vs, const std::string& fs)
                              CelestiaGLProgram::IntensityAttributeIndex,
                              "in_Intensity");
 
+        if (cache != nullptr)
+            ShaderCache::prepare(*prog);
         status = prog->link();
+        if (status == ShaderStatus_OK)
+            storeCachedProgram(*prog, _vs, _fs);
     }
 
     if (status != ShaderStatus_OK)
@@ -3460,6 +3461,42 @@ void ShaderManager::setFisheyeEnabled(bool enabled)
     fisheyeEnabled = enabled;
 }
 
+void ShaderManager::setCacheDirectory(const fs::path& dir)
+{
+    if (ShaderCache::isSupported())
+    {
+        cache = std::make_unique<ShaderCache>(dir, ShaderCache::getDriver());
+        cache->prune();
+    }
+    else
+        GetLogger()->info("Program binaries are not supported; shaders will not be cached\n");
+}
+
+// Build ahead of time the shaders that earlier sessions needed, so that
+// they don't have to be compiled in the middle of a frame. With cached
+// program binaries this is quick.
+void ShaderManager::warmUp()
+{
+    if (cache == nullptr)
+        return;
+
+    for (const auto& props : cache->readVariants())
+        getShader(props);
+}
+
+GLProgram*
+ShaderManager::loadCachedProgram(const std::string& vs, const std::string& fs) const
+{
+    return cache == nullptr ? nullptr : cache->load(vs, fs);
+}
+
+void
+ShaderManager::storeCachedProgram(const GLProgram& prog, const std::string& vs, const std::string& fs) const
+{
+    if (cache != nullptr)
+        cache->store(prog, vs, fs);
+}
+
 CelestiaGLProgram::CelestiaGLProgram(GLProgram& _program,
                                      const ShaderProperties& _props) :
     program(&_program),
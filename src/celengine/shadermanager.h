@@ -11,7 +11,10 @@
 #define _CELENGINE_SHADERMANAGER_H_
 
 #include <map>
+#include <memory>
 #include <iostream>
+#include <string>
+#include <celcompat/filesystem.h>
 #include <celengine/glshader.h>
 #include <celengine/lightenv.h>
 #include <celengine/atmosphere.h>
@@ -292,6 +295,8 @@ class CelestiaGLProgram
 };
 
 
+class ShaderCache;
+
 class ShaderManager
 {
  public:
@@ -304,28 +309,41 @@ class ShaderManager
 
     void setFisheyeEnabled(bool enabled);
 
+    /*! Keep linked program binaries in a directory, when the driver supports
+     *  it, and remember which shader variants were used. Programs are
+     *  still built from source whenever there's no usable binary.
+     */
+    void setCacheDirectory(const fs::path&);
+
+    //! Build the shader variants recorded in earlier sessions
+    void warmUp();
+
  private:
     CelestiaGLProgram* buildProgram(const ShaderProperties&);
     CelestiaGLProgram* buildProgram(const std::string&, const std::string&);
+    GLProgram* loadCachedProgram(const std::string&, const std::string&) const;
+    void storeCachedProgram(const GLProgram&, const std::string&, const std::string&) const;
 
-    GLVertexShader* buildVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildFragmentShader(const ShaderProperties&);
+    std::string buildVertexShaderSource(const ShaderProperties&);
+    std::string buildFragmentShaderSource(const ShaderProperties&);
 
-    GLVertexShader* buildRingsVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildRingsFragmentShader(const ShaderProperties&);
+    std::string buildRingsVertexShaderSource(const ShaderProperties&);
+    std::string buildRingsFragmentShaderSource(const ShaderProperties&);
 
-    GLVertexShader* buildAtmosphereVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildAtmosphereFragmentShader(const ShaderProperties&);
+    std::string buildAtmosphereVertexShaderSource(const ShaderProperties&);
+    std::string buildAtmosphereFragmentShaderSource(const ShaderProperties&);
 
-    GLVertexShader* buildEmissiveVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildEmissiveFragmentShader(const ShaderProperties&);
+    std::string buildEmissiveVertexShaderSource(const ShaderProperties&);
+    std::string buildEmissiveFragmentShaderSource(const ShaderProperties&);
 
-    GLVertexShader* buildParticleVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildParticleFragmentShader(const ShaderProperties&);
+    std::string buildParticleVertexShaderSource(const ShaderProperties&);
+    std::string buildParticleFragmentShaderSource(const ShaderProperties&);
 
     std::map<ShaderProperties, CelestiaGLProgram*> dynamicShaders;
     std::map<std::string, CelestiaGLProgram*> staticShaders;
 
+    std::unique_ptr<ShaderCache> cache;
+
     bool fisheyeEnabled { false };
 };
 
@@ -148,14 +148,18 @@ void Simulation::setTrackedObject(const Selection& sel)
 }
 
 
-Selection Simulation::pickObject(const Vector3f& pickRay, uint64_t renderFlags, float tolerance)
+Selection Simulation::pickObject(const Vector3f& pickRay,
+                                 uint64_t renderFlags,
+                                 float tolerance,
+                                 SceneSnapshot* snapshot)
 {
     return universe->pick(activeObserver->getPosition(),
                           activeObserver->getOrientationf().conjugate() * pickRay,
                           activeObserver->getTime(),
                           renderFlags,
                           faintestVisible,
-                          tolerance);
+                          tolerance,
+                          snapshot);
 }
 
 void Simulation::reverseObserverOrientation()
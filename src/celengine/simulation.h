@@ -42,7 +42,10 @@ class Simulation
     void draw(Renderer&);
     void render(Renderer&, Observer&);
 
-    Selection pickObject(const Eigen::Vector3f& pickRay, uint64_t renderFlags, float tolerance = 0.0f);
+    Selection pickObject(const Eigen::Vector3f& pickRay,
+                         uint64_t renderFlags,
+                         float tolerance = 0.0f,
+                         SceneSnapshot* snapshot = nullptr);
 
     Universe* getUniverse() const;
 
@@ -20,7 +20,8 @@
 #include <celutil/gettext.h>
 #include <celutil/tokenizer.h>
 #include "astro.h"
-#include "parser.h"
+#include "parsedcatalog.h"
+#include "value.h"
 #include "texmanager.h"
 #include "meshmanager.h"
 #include "universe.h"
@@ -78,7 +79,7 @@ enum BodyType
   The name and parent name are both mandatory.
 */
 
-static void sscError(const Tokenizer& tok,
+static void sscError(const ParsedCatalog& tok,
                      const string& msg)
 {
     GetLogger()->error(_("Error in .ssc file (line {}): {}\n"),
@@ -1107,73 +1108,79 @@ bool LoadSolarSystemObjects(istream& in,
                             Universe& universe,
                             const fs::path& directory)
 {
-    Tokenizer tokenizer(&in);
-    Parser parser(&tokenizer);
+    ParsedCatalog catalog(in);
+    return LoadSolarSystemObjects(catalog, universe, directory);
+}
+
 
+bool LoadSolarSystemObjects(ParsedCatalog& catalog,
+                            Universe& universe,
+                            const fs::path& directory)
+{
 #ifdef ENABLE_NLS
     string s = directory.string();
     const char* d = s.c_str();
     bindtextdomain(d, d); // domain name is the same as resource path
 #endif
 
-    while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+    while (catalog.nextToken() != Tokenizer::TokenEnd)
     {
         // Read the disposition; if none is specified, the default is Add.
         DataDisposition disposition = DataDisposition::Add;
-        if (tokenizer.getTokenType() == Tokenizer::TokenName)
+        if (catalog.getTokenType() == Tokenizer::TokenName)
         {
-            if (tokenizer.getStringValue() == "Add")
+            if (catalog.getStringValue() == "Add")
             {
                 disposition = DataDisposition::Add;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
-            else if (tokenizer.getStringValue() == "Replace")
+            else if (catalog.getStringValue() == "Replace")
             {
                 disposition = DataDisposition::Replace;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
-            else if (tokenizer.getStringValue() == "Modify")
+            else if (catalog.getStringValue() == "Modify")
             {
                 disposition = DataDisposition::Modify;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
         }
 
         // Read the item type; if none is specified the default is Body
         string itemType("Body");
-        if (tokenizer.getTokenType() == Tokenizer::TokenName)
+        if (catalog.getTokenType() == Tokenizer::TokenName)
         {
-            itemType = tokenizer.getStringValue();
-            tokenizer.nextToken();
+            itemType = catalog.getStringValue();
+            catalog.nextToken();
         }
 
-        if (tokenizer.getTokenType() != Tokenizer::TokenString)
+        if (catalog.getTokenType() != Tokenizer::TokenString)
         {
-            sscError(tokenizer, "object name expected");
+            sscError(catalog, "object name expected");
             return false;
         }
 
         // The name list is a string with zero more names. Multiple names are
         // delimited by colons.
-        string nameList(tokenizer.getStringValue());
+        string nameList(catalog.getStringValue());
 
-        if (tokenizer.nextToken() != Tokenizer::TokenString)
+        if (catalog.nextToken() != Tokenizer::TokenString)
         {
-            sscError(tokenizer, "bad parent object name");
+            sscError(catalog, "bad parent object name");
             return false;
         }
-        string parentName(tokenizer.getStringValue());
+        string parentName(catalog.getStringValue());
 
-        Value* objectDataValue = parser.readValue();
+        Value* objectDataValue = catalog.readValue();
         if (objectDataValue == nullptr)
         {
-            sscError(tokenizer, "bad object definition");
+            sscError(catalog, "bad object definition");
             return false;
         }
 
         if (objectDataValue->getType() != Value::HashType)
         {
-            sscError(tokenizer, "{ expected");
+            sscError(catalog, "{ expected");
             delete objectDataValue;
             return false;
         }
@@ -1244,7 +1251,7 @@ bool LoadSolarSystemObjects(istream& in,
             }
             else
             {
-                sscError(tokenizer, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
+                sscError(catalog, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
             }
 
             if (parentSystem != nullptr)
@@ -1254,7 +1261,7 @@ bool LoadSolarSystemObjects(istream& in,
                 {
                     if (disposition == DataDisposition::Add)
                     {
-                        sscError(tokenizer, fmt::sprintf(_("warning duplicate definition of %s %s\n"), parentName, primaryName));
+                        sscError(catalog, fmt::sprintf(_("warning duplicate definition of %s %s\n"), parentName, primaryName));
                     }
                     else if (disposition == DataDisposition::Replace)
                     {
@@ -1285,7 +1292,7 @@ bool LoadSolarSystemObjects(istream& in,
             if (parent.body() != nullptr)
                 parent.body()->addAlternateSurface(primaryName, surface);
             else
-                sscError(tokenizer, _("bad alternate surface"));
+                sscError(catalog, _("bad alternate surface"));
         }
         else if (itemType == "Location")
         {
@@ -1300,12 +1307,12 @@ bool LoadSolarSystemObjects(istream& in,
                 }
                 else
                 {
-                    sscError(tokenizer, _("bad location"));
+                    sscError(catalog, _("bad location"));
                 }
             }
             else
             {
-                sscError(tokenizer, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
+                sscError(catalog, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
             }
         }
         delete objectDataValue;
@@ -37,11 +37,15 @@ class SolarSystem
 
 typedef std::map<uint32_t, SolarSystem*> SolarSystemCatalog;
 
+class ParsedCatalog;
 class Universe;
 
 bool LoadSolarSystemObjects(std::istream& in,
                             Universe& universe,
                             const fs::path& dir = fs::path());
+bool LoadSolarSystemObjects(ParsedCatalog& catalog,
+                            Universe& universe,
+                            const fs::path& dir = fs::path());
 
 #endif // _SOLARSYS_H_
 
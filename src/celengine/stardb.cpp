@@ -20,8 +20,10 @@
 #include <celutil/gettext.h>
 #include <celutil/tokenizer.h>
 #include "stardb.h"
+#include "starnametable.h"
 #include "astro.h"
-#include "parser.h"
+#include "parsedcatalog.h"
+#include "value.h"
 #include "parseobject.h"
 #include "multitexture.h"
 #include "meshmanager.h"
@@ -335,19 +337,19 @@ vector<string> StarDatabase::getCompletion(const string& name, bool i18n) const
 }
 
 
-#if 0
-static void catalogNumberToString(AstroCatalog::IndexNumber catalogNumber, char* buf, unsigned int bufSize)
+// Return a view of a catalog number designation written to a buffer with
+// fmt::format_to_n; designations too long for the buffer are truncated.
+static string_view designationView(const StarDatabase::NameBuffer& buffer, const fmt::format_to_n_result<char*>& result)
 {
-    // TODO: implement using using fmt::write
+    return string_view(buffer.data(), min(static_cast<size_t>(result.size), buffer.size()));
 }
-#endif
 
 
-static string catalogNumberToString(AstroCatalog::IndexNumber catalogNumber)
+static string_view catalogNumberToString(AstroCatalog::IndexNumber catalogNumber, StarDatabase::NameBuffer& buffer)
 {
     if (catalogNumber <= StarDatabase::MAX_HIPPARCOS_NUMBER)
     {
-        return fmt::format("HIP {}", catalogNumber);
+        return designationView(buffer, fmt::format_to_n(buffer.data(), buffer.size(), "HIP {}", catalogNumber));
     }
     else
     {
@@ -356,7 +358,7 @@ static string catalogNumberToString(AstroCatalog::IndexNumber catalogNumber)
         AstroCatalog::IndexNumber tyc2 = catalogNumber / 10000;
         catalogNumber -= tyc2 * 10000;
         AstroCatalog::IndexNumber tyc1 = catalogNumber;
-        return fmt::format("TYC {}-{}-{}", tyc1, tyc2, tyc3);
+        return designationView(buffer, fmt::format_to_n(buffer.data(), buffer.size(), "TYC {}-{}-{}", tyc1, tyc2, tyc3));
     }
 }
 
@@ -368,29 +370,17 @@ static string catalogNumberToString(AstroCatalog::IndexNumber catalogNumber)
 //      the HD catalog number if it exists, otherwise
 //      the HIPPARCOS catalog number.
 //
-// CAREFUL:
-// If the star name is not present in the names database, a new
-// string is constructed to contain the catalog number--keep in
-// mind that calling this method could possibly incur the overhead
-// of a memory allocation (though no explcit deallocation is
-// required as it's all wrapped in the string class.)
-string StarDatabase::getStarName(const Star& star, bool i18n) const
+// The returned view refers either to the name table or, for stars
+// without a name, to nameBuffer; no memory is allocated.
+string_view StarDatabase::getStarName(const Star& star, NameBuffer& nameBuffer, bool i18n) const
 {
     AstroCatalog::IndexNumber catalogNumber = star.getIndex();
 
-    if (namesDB != nullptr)
+    if (const StarNameTable* table = getNameTable(); table != nullptr)
     {
-        StarNameDatabase::NumberIndex::const_iterator iter = namesDB->getFirstNameIter(catalogNumber);
-        if (iter != namesDB->getFinalNameIter() && iter->first == catalogNumber)
-        {
-            if (i18n)
-            {
-                const char * local = D_(iter->second.c_str());
-                if (iter->second != local)
-                    return local;
-            }
-            return iter->second;
-        }
+        string_view name = table->getFirstName(catalogNumber, i18n);
+        if (!name.empty())
+            return name;
     }
 
     /*
@@ -399,9 +389,17 @@ string StarDatabase::getStarName(const Star& star, bool i18n) const
       return fmt::format("HD {}", star.getIndex(Star::HDCatalog));
       else
     */
-    return catalogNumberToString(catalogNumber);
+    return catalogNumberToString(catalogNumber, nameBuffer);
+}
+
+
+string StarDatabase::getStarName(const Star& star, bool i18n) const
+{
+    NameBuffer buffer;
+    return string(getStarName(star, buffer, i18n));
 }
 
+
 // A less convenient version of getStarName that writes to a char
 // array instead of a string. The advantage is that no memory allocation
 // will every occur.
@@ -409,102 +407,75 @@ void StarDatabase::getStarName(const Star& star, char* nameBuffer, unsigned int
 {
     assert(bufferSize != 0);
 
-    AstroCatalog::IndexNumber catalogNumber = star.getIndex();
-
-    if (namesDB != nullptr)
-    {
-        StarNameDatabase::NumberIndex::const_iterator iter = namesDB->getFirstNameIter(catalogNumber);
-        if (iter != namesDB->getFinalNameIter() && iter->first == catalogNumber)
-        {
-            if (i18n)
-            {
-                const char * local = D_(iter->second.c_str());
-                if (iter->second != local)
-                {
-                    strncpy(nameBuffer, local, bufferSize);
-                    nameBuffer[bufferSize - 1] = '\0';
-                    return;
-                }
-            }
-
-            strncpy(nameBuffer, iter->second.c_str(), bufferSize);
-            nameBuffer[bufferSize - 1] = '\0';
-            return;
-        }
-    }
-
-    strncpy(nameBuffer, catalogNumberToString(catalogNumber).c_str(), bufferSize);
-    nameBuffer[bufferSize - 1] = '\0';
+    NameBuffer buffer;
+    string_view name = getStarName(star, buffer, i18n);
+    size_t length = min(name.size(), static_cast<size_t>(bufferSize - 1));
+    memcpy(nameBuffer, name.data(), length);
+    nameBuffer[length] = '\0';
 }
 
 
 string StarDatabase::getStarNameList(const Star& star, const unsigned int maxNames) const
 {
     string starNames;
+    getStarNameList(star, starNames, maxNames);
+    return starNames;
+}
+
+
+// Replace the contents of starNames with a list of the names of a star,
+// separated by slashes. Reusing the same string for every call avoids
+// allocating memory once its capacity is large enough.
+void StarDatabase::getStarNameList(const Star& star, string& starNames, const unsigned int maxNames) const
+{
+    starNames.clear();
     unsigned int catalogNumber = star.getIndex();
-    std::set<std::string> nameSet;
-    bool isNameSetEmpty = true;
+    unsigned int nameCount = 0;
 
-    auto append = [&] (const string &str)
+    const StarNameTable* table = getNameTable();
+    pair<uint32_t, uint32_t> tableNames{ 0, 0 };
+    if (table != nullptr)
+        tableNames = table->findNames(catalogNumber);
+
+    // Skip names already in the list; catalog designations differ from
+    // each other, so only the names from the table need to be checked.
+    auto append = [&] (string_view name, uint32_t tableEnd)
     {
-        auto inserted = nameSet.insert(str);
-        if (inserted.second)
+        for (uint32_t i = tableNames.first; i < tableEnd; i++)
         {
-            if (isNameSetEmpty)
-                isNameSetEmpty = false;
-            else
-                starNames += " / ";
-            starNames += str;
+            if (table->getName(i, true) == name)
+                return;
         }
-    };
 
-    if (namesDB != nullptr)
-    {
-        StarNameDatabase::NumberIndex::const_iterator iter = namesDB->getFirstNameIter(catalogNumber);
+        if (nameCount > 0)
+            starNames += " / ";
+        starNames += name;
+        ++nameCount;
+    };
 
-        while (iter != namesDB->getFinalNameIter() && iter->first == catalogNumber && nameSet.size() < maxNames)
-        {
-            append(D_(iter->second.c_str()));
-            ++iter;
-        }
-    }
+    uint32_t tableEnd = tableNames.first;
+    for (; tableEnd < tableNames.second && nameCount < maxNames; tableEnd++)
+        append(table->getName(tableEnd, true), tableEnd);
 
+    NameBuffer buffer;
     AstroCatalog::IndexNumber hip  = catalogNumber;
-    if (hip != AstroCatalog::InvalidIndex && hip != 0 && nameSet.size() < maxNames)
+    if (hip != AstroCatalog::InvalidIndex && hip != 0 && nameCount < maxNames)
     {
         if (hip <= Star::MaxTychoCatalogNumber)
-        {
-            if (hip >= 1000000)
-            {
-                AstroCatalog::IndexNumber h = hip;
-                AstroCatalog::IndexNumber tyc3   = h / 1000000000;
-                       h     -= tyc3 * 1000000000;
-                AstroCatalog::IndexNumber tyc2   = h / 10000;
-                       h     -= tyc2 * 10000;
-                AstroCatalog::IndexNumber tyc1   = h;
-
-                append(fmt::format("TYC {}-{}-{}", tyc1, tyc2, tyc3));
-            }
-            else
-            {
-                append(fmt::format("HIP {}", hip));
-            }
-        }
+            append(catalogNumberToString(hip, buffer), tableEnd);
     }
 
     AstroCatalog::IndexNumber hd   = crossIndex(StarDatabase::HenryDraper, hip);
-    if (nameSet.size() < maxNames && hd != AstroCatalog::InvalidIndex)
+    if (nameCount < maxNames && hd != AstroCatalog::InvalidIndex)
     {
-        append(fmt::format("HD {}", hd));
+        append(designationView(buffer, fmt::format_to_n(buffer.data(), buffer.size(), "HD {}", hd)), tableEnd);
     }
 
     AstroCatalog::IndexNumber sao   = crossIndex(StarDatabase::SAO, hip);
-    if (nameSet.size() < maxNames && sao != AstroCatalog::InvalidIndex)
+    if (nameCount < maxNames && sao != AstroCatalog::InvalidIndex)
     {
-        append(fmt::format("SAO {}", sao));
+        append(designationView(buffer, fmt::format_to_n(buffer.data(), buffer.size(), "SAO {}", sao)), tableEnd);
     }
-
-    return starNames;
 }
 
 
@@ -553,6 +524,48 @@ void StarDatabase::findCloseStars(StarHandler& starHandler,
 }
 
 
+void StarDatabase::findStarsAlongRay(StarRayHandler& starHandler,
+                                     const Vector3f& origin,
+                                     const Vector3f& direction,
+                                     float limitingMag) const
+{
+    octreeRoot->processObjectsAlongRay(starHandler,
+                                       origin,
+                                       direction.normalized(),
+                                       limitingMag,
+                                       STAR_OCTREE_ROOT_SIZE);
+}
+
+
+void StarDatabase::findNearestStars(vector<pair<const Star*, float>>& stars,
+                                    const Vector3f& position,
+                                    unsigned int count,
+                                    float maxDistance) const
+{
+    octreeRoot->findNearestObjects(position,
+                                   count,
+                                   maxDistance,
+                                   STAR_OCTREE_ROOT_SIZE,
+                                   stars);
+}
+
+
+void StarDatabase::findStarsInCone(vector<pair<const Star*, float>>& stars,
+                                   const Vector3f& origin,
+                                   const Vector3f& direction,
+                                   float halfAngle,
+                                   float maxDistance) const
+{
+    stars.clear();
+    octreeRoot->findObjectsInCone(origin,
+                                  direction.normalized(),
+                                  halfAngle,
+                                  maxDistance,
+                                  STAR_OCTREE_ROOT_SIZE,
+                                  stars);
+}
+
+
 StarNameDatabase* StarDatabase::getNameDatabase() const
 {
     return namesDB;
@@ -562,6 +575,18 @@ StarNameDatabase* StarDatabase::getNameDatabase() const
 void StarDatabase::setNameDatabase(StarNameDatabase* _namesDB)
 {
     namesDB    = _namesDB;
+    nameTable.reset();
+}
+
+
+const StarNameTable* StarDatabase::getNameTable() const
+{
+    if (namesDB == nullptr)
+        return nullptr;
+
+    if (nameTable == nullptr)
+        nameTable = make_unique<StarNameTable>(*namesDB);
+    return nameTable.get();
 }
 
 
@@ -761,7 +786,7 @@ void StarDatabase::finish()
 }
 
 
-static void stcError(const Tokenizer& tok,
+static void stcError(const ParsedCatalog& tok,
                      const string& msg)
 {
     GetLogger()->error(_("Error in .stc file (line {}): {}\n"), tok.getLineNumber(), msg);
@@ -1185,76 +1210,80 @@ bool StarDatabase::createStar(Star* star,
  */
 bool StarDatabase::load(istream& in, const fs::path& resourcePath)
 {
-    Tokenizer tokenizer(&in);
-    Parser parser(&tokenizer);
+    ParsedCatalog catalog(in);
+    return load(catalog, resourcePath);
+}
 
+
+bool StarDatabase::load(ParsedCatalog& catalog, const fs::path& resourcePath)
+{
 #ifdef ENABLE_NLS
     string s = resourcePath.string();
     const char *d = s.c_str();
     bindtextdomain(d, d); // domain name is the same as resource path
 #endif
 
-    while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+    while (catalog.nextToken() != Tokenizer::TokenEnd)
     {
         bool isStar = true;
 
         // Parse the disposition--either Add, Replace, or Modify. The disposition
         // may be omitted. The default value is Add.
         DataDisposition disposition = DataDisposition::Add;
-        if (tokenizer.getTokenType() == Tokenizer::TokenName)
+        if (catalog.getTokenType() == Tokenizer::TokenName)
         {
-            if (tokenizer.getStringValue() == "Modify")
+            if (catalog.getStringValue() == "Modify")
             {
                 disposition = DataDisposition::Modify;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
-            else if (tokenizer.getStringValue() == "Replace")
+            else if (catalog.getStringValue() == "Replace")
             {
                 disposition = DataDisposition::Replace;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
-            else if (tokenizer.getStringValue() == "Add")
+            else if (catalog.getStringValue() == "Add")
             {
                 disposition = DataDisposition::Add;
-                tokenizer.nextToken();
+                catalog.nextToken();
             }
         }
 
         // Parse the object type--either Star or Barycenter. The object type
         // may be omitted. The default is Star.
-        if (tokenizer.getTokenType() == Tokenizer::TokenName)
+        if (catalog.getTokenType() == Tokenizer::TokenName)
         {
-            if (tokenizer.getStringValue() == "Star")
+            if (catalog.getStringValue() == "Star")
             {
                 isStar = true;
             }
-            else if (tokenizer.getStringValue() == "Barycenter")
+            else if (catalog.getStringValue() == "Barycenter")
             {
                 isStar = false;
             }
             else
             {
-                stcError(tokenizer, "unrecognized object type");
+                stcError(catalog, "unrecognized object type");
                 return false;
             }
-            tokenizer.nextToken();
+            catalog.nextToken();
         }
 
         // Parse the catalog number; it may be omitted if a name is supplied.
         AstroCatalog::IndexNumber catalogNumber = AstroCatalog::InvalidIndex;
-        if (tokenizer.getTokenType() == Tokenizer::TokenNumber)
+        if (catalog.getTokenType() == Tokenizer::TokenNumber)
         {
-            catalogNumber = (AstroCatalog::IndexNumber) tokenizer.getNumberValue();
-            tokenizer.nextToken();
+            catalogNumber = (AstroCatalog::IndexNumber) catalog.getNumberValue();
+            catalog.nextToken();
         }
 
         string objName;
         string firstName;
-        if (tokenizer.getTokenType() == Tokenizer::TokenString)
+        if (catalog.getTokenType() == Tokenizer::TokenString)
         {
             // A star name (or names) is present
-            objName    = tokenizer.getStringValue();
-            tokenizer.nextToken();
+            objName    = catalog.getStringValue();
+            catalog.nextToken();
             if (!objName.empty())
             {
                 string::size_type next = objName.find(':', 0);
@@ -1263,9 +1292,9 @@ bool StarDatabase::load(istream& in, const fs::path& resourcePath)
         }
 
         // now goes the star definition
-        if (tokenizer.getTokenType() != Tokenizer::TokenBeginGroup)
+        if (catalog.getTokenType() != Tokenizer::TokenBeginGroup)
         {
-            GetLogger()->error("Unexpected token at line {}!\n", tokenizer.getLineNumber());
+            GetLogger()->error("Unexpected token at line {}!\n", catalog.getLineNumber());
             return false;
         }
 
@@ -1280,7 +1309,7 @@ bool StarDatabase::load(istream& in, const fs::path& resourcePath)
             {
                 if (!isStar && firstName.empty())
                 {
-                    GetLogger()->error("Bad barycenter: neither catalog number nor name set at line {}.\n", tokenizer.getLineNumber());
+                    GetLogger()->error("Bad barycenter: neither catalog number nor name set at line {}.\n", catalog.getLineNumber());
                     return false;
                 }
                 catalogNumber = nextAutoCatalogNumber--;
@@ -1327,18 +1356,18 @@ bool StarDatabase::load(istream& in, const fs::path& resourcePath)
 
         bool isNewStar = star == nullptr;
 
-        tokenizer.pushBack();
+        catalog.pushBack();
 
-        Value* starDataValue = parser.readValue();
+        Value* starDataValue = catalog.readValue();
         if (starDataValue == nullptr)
         {
-            GetLogger()->error("Error reading star at line {}.\n", tokenizer.getLineNumber());
+            GetLogger()->error("Error reading star at line {}.\n", catalog.getLineNumber());
             return false;
         }
 
         if (starDataValue->getType() != Value::HashType)
         {
-            GetLogger()->error("Bad star definition at line {}.\n", tokenizer.getLineNumber());
+            GetLogger()->error("Bad star definition at line {}.\n", catalog.getLineNumber());
             delete starDataValue;
             return false;
         }
@@ -1376,6 +1405,7 @@ bool StarDatabase::load(istream& in, const fs::path& resourcePath)
                 // List of namesDB will replace any that already exist for
                 // this star.
                 namesDB->erase(catalogNumber);
+                nameTable.reset();
 
                 // Iterate through the string for names delimited
                 // by ':', and insert them into the star database.
@@ -11,7 +11,10 @@
 #ifndef _CELENGINE_STARDB_H_
 #define _CELENGINE_STARDB_H_
 
+#include <array>
 #include <iostream>
+#include <memory>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <celutil/blockarray.h>
@@ -21,6 +24,9 @@
 #include <celengine/staroctree.h>
 #include <celengine/parseobject.h>
 
+class StarNameTable;
+class ParsedCatalog;
+
 
 static const unsigned int MAX_STAR_NAMES = 10;
 
@@ -53,14 +59,37 @@ class StarDatabase
                         const Eigen::Vector3f& obsPosition,
                         float radius) const;
 
+    void findStarsAlongRay(StarRayHandler& starHandler,
+                           const Eigen::Vector3f& origin,
+                           const Eigen::Vector3f& direction,
+                           float limitingMag) const;
+
+    void findNearestStars(std::vector<std::pair<const Star*, float>>& stars,
+                          const Eigen::Vector3f& position,
+                          unsigned int count,
+                          float maxDistance) const;
+
+    void findStarsInCone(std::vector<std::pair<const Star*, float>>& stars,
+                         const Eigen::Vector3f& origin,
+                         const Eigen::Vector3f& direction,
+                         float halfAngle,
+                         float maxDistance) const;
+
+    // Large enough for any catalog number designation, e.g. "TYC 1234-12345-1"
+    using NameBuffer = std::array<char, 32>;
+
     std::string getStarName    (const Star&, bool i18n = false) const;
     void getStarName(const Star& star, char* nameBuffer, unsigned int bufferSize, bool i18n = false) const;
+    std::string_view getStarName(const Star& star, NameBuffer& nameBuffer, bool i18n = false) const;
     std::string getStarNameList(const Star&, const unsigned int maxNames = MAX_STAR_NAMES) const;
+    void getStarNameList(const Star&, std::string& starNames, const unsigned int maxNames = MAX_STAR_NAMES) const;
 
     StarNameDatabase* getNameDatabase() const;
+    const StarNameTable* getNameTable() const;
     void setNameDatabase(StarNameDatabase*);
 
     bool load(std::istream&, const fs::path& resourcePath = fs::path());
+    bool load(ParsedCatalog&, const fs::path& resourcePath = fs::path());
     bool loadBinary(std::istream&);
 
     enum Catalog
@@ -110,6 +139,8 @@ private:
 
     Star*             stars{ nullptr };
     StarNameDatabase* namesDB{ nullptr };
+    // Built from namesDB on first use, and discarded whenever names are added
+    mutable std::unique_ptr<StarNameTable> nameTable;
     Star**            catalogNumberIndex{ nullptr };
     StarOctree*       octreeRoot{ nullptr };
     AstroCatalog::IndexNumber nextAutoCatalogNumber{ 0xfffffffe };
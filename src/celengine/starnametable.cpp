@@ -0,0 +1,85 @@
+// starnametable.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Compact, read only copy of the star names database for fast lookups.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <celutil/gettext.h>
+#include "name.h"
+#include "starnametable.h"
+
+
+StarNameTable::StarNameTable(const NameDatabase& namesDB)
+{
+    const NameDatabase::NumberIndex& numberIndex = namesDB.getNumberIndex();
+    names.reserve(numberIndex.size());
+
+    // Designations such as constellation abbreviations recur often, and
+    // most names have no translation, so store each distinct string once.
+    // The keys refer to strings owned by the name database and the message
+    // catalog, which outlive the construction of the table.
+    std::unordered_map<std::string_view, std::uint32_t> interned;
+    auto intern = [&](std::string_view str)
+    {
+        auto [iter, inserted] = interned.try_emplace(str, static_cast<std::uint32_t>(strings.size()));
+        if (inserted)
+            strings.append(str);
+        return iter->second;
+    };
+
+    for (const auto& [catalogNumber, name] : numberIndex)
+    {
+        if (entries.empty() || entries.back().catalogNumber != catalogNumber)
+            entries.push_back({ catalogNumber, static_cast<std::uint32_t>(names.size()) });
+
+        std::string_view localized = D_(name.c_str());
+        names.push_back({ intern(name), static_cast<std::uint32_t>(name.size()),
+                          intern(localized), static_cast<std::uint32_t>(localized.size()) });
+    }
+
+    entries.shrink_to_fit();
+    strings.shrink_to_fit();
+}
+
+
+std::pair<std::uint32_t, std::uint32_t>
+StarNameTable::findNames(AstroCatalog::IndexNumber catalogNumber) const
+{
+    auto iter = std::lower_bound(entries.begin(), entries.end(), catalogNumber,
+                                 [](const Entry& entry, AstroCatalog::IndexNumber n)
+                                 {
+                                     return entry.catalogNumber < n;
+                                 });
+    if (iter == entries.end() || iter->catalogNumber != catalogNumber)
+        return { 0, 0 };
+
+    auto next = iter + 1;
+    std::uint32_t last = next == entries.end() ? static_cast<std::uint32_t>(names.size()) : next->firstName;
+    return { iter->firstName, last };
+}
+
+
+std::string_view
+StarNameTable::getName(std::uint32_t index, bool i18n) const
+{
+    const Name& name = names[index];
+    if (i18n)
+        return std::string_view(strings).substr(name.localizedOffset, name.localizedLength);
+    return std::string_view(strings).substr(name.offset, name.length);
+}
+
+
+std::string_view
+StarNameTable::getFirstName(AstroCatalog::IndexNumber catalogNumber, bool i18n) const
+{
+    auto [first, last] = findNames(catalogNumber);
+    return first == last ? std::string_view() : getName(first, i18n);
+}
@@ -0,0 +1,74 @@
+// starnametable.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Compact, read only copy of the star names database for fast lookups.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <celengine/astroobj.h>
+
+class NameDatabase;
+
+
+/*! A StarNameTable holds all of the names in a name database, along with
+ *  their localized variants, as offsets into a single buffer of interned
+ *  UTF-8 strings. Lookups return views into that buffer and never
+ *  allocate. The names of each catalog number keep the order of the name
+ *  database, so the first one is the proper name of the star.
+ *
+ *  The table is a snapshot: it must be rebuilt after the name database
+ *  changes.
+ */
+class StarNameTable
+{
+ public:
+    explicit StarNameTable(const NameDatabase& namesDB);
+
+    /*! Return the half open range of name indices that belong to a
+     *  catalog number; the range is empty if the star has no names.
+     */
+    std::pair<std::uint32_t, std::uint32_t> findNames(AstroCatalog::IndexNumber catalogNumber) const;
+
+    /*! Return a name by index, localized if i18n is set and a translation
+     *  exists.
+     */
+    std::string_view getName(std::uint32_t index, bool i18n) const;
+
+    //! Return the first name of a catalog number, or an empty view
+    std::string_view getFirstName(AstroCatalog::IndexNumber catalogNumber, bool i18n) const;
+
+    std::size_t getNameCount() const { return names.size(); }
+    std::size_t getStringBytes() const { return strings.size(); }
+
+ private:
+    struct Entry
+    {
+        AstroCatalog::IndexNumber catalogNumber;
+        std::uint32_t firstName;
+    };
+
+    struct Name
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::uint32_t localizedOffset;
+        std::uint32_t localizedLength;
+    };
+
+    // Sorted by catalog number
+    std::vector<Entry> entries;
+    std::vector<Name> names;
+    std::string strings;
+};
@@ -84,6 +84,30 @@ template<> DynamicStarOctree::ExclusionFactorDecayFunction*
 
 
 // total specialization of the StaticOctree template process*() methods for stars:
+template<>
+void StarOctree::processNodeObjects(StarHandler&    processor,
+                                    const Vector3f& obsPosition,
+                                    float           limitingFactor,
+                                    float           minDistance) const
+{
+    float dimmest = minDistance > 0 ? astro::appToAbsMag(limitingFactor, minDistance) : 1000;
+
+    for (unsigned int i=0; i<nObjects; ++i)
+    {
+        const Star& obj = _firstObject[i];
+
+        if (obj.getAbsoluteMagnitude() < dimmest)
+        {
+            float distance    = (obsPosition - obj.getPosition()).norm();
+            float appMag      = obj.getApparentMagnitude(distance);
+
+            if (appMag < limitingFactor || (distance < MAX_STAR_ORBIT_RADIUS && obj.getOrbit()))
+                processor.process(obj, distance, appMag);
+        }
+    }
+}
+
+
 template<>
 void StarOctree::processVisibleObjects(StarHandler&    processor,
                                        const Vector3f& obsPosition,
@@ -117,25 +141,11 @@ void StarOctree::processVisibleObjects(StarHandler&    processor,
     float minDistance = (obsPosition - cellCenterPos).norm() - scale * StarOctree::SQRT3;
 
     // Process the objects in this node
-    float dimmest     = minDistance > 0 ? astro::appToAbsMag(limitingFactor, minDistance) : 1000;
-
-    for (unsigned int i=0; i<nObjects; ++i)
-    {
 #ifdef OCTREE_DEBUG
-        if (stats != nullptr)
-            stats->objects++;
+    if (stats != nullptr)
+        stats->objects += nObjects;
 #endif
-        const Star& obj = _firstObject[i];
-
-        if (obj.getAbsoluteMagnitude() < dimmest)
-        {
-            float distance    = (obsPosition - obj.getPosition()).norm();
-            float appMag      = obj.getApparentMagnitude(distance);
-
-            if (appMag < limitingFactor || (distance < MAX_STAR_ORBIT_RADIUS && obj.getOrbit()))
-                processor.process(obj, distance, appMag);
-        }
-    }
+    processNodeObjects(processor, obsPosition, limitingFactor, minDistance);
 
     // See if any of the objects in child nodes are potentially included
     // that we need to recurse deeper.
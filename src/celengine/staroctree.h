@@ -20,5 +20,12 @@
 typedef DynamicOctree  <Star, float> DynamicStarOctree;
 typedef StaticOctree   <Star, float> StarOctree;
 typedef OctreeProcessor<Star, float> StarHandler;
+typedef OctreeRayProcessor<Star, float> StarRayHandler;
+
+template<>
+inline StarOctree::PointType StarOctree::objectPosition(const Star& star)
+{
+    return star.getPosition();
+}
 
 #endif  // _CELENGINE_STAROCTREE_H_
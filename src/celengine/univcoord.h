@@ -49,7 +49,7 @@ class UniversalCoord
     /** Compute a universal coordinate that is the sum of this coordinate and
       * an offset in kilometers.
       */
-    UniversalCoord offsetKm(const Eigen::Vector3d& v)
+    UniversalCoord offsetKm(const Eigen::Vector3d& v) const
     {
         Eigen::Vector3d vUly = v * astro::kilometersToMicroLightYears(1.0);
         return *this + UniversalCoord(vUly);
@@ -62,7 +62,7 @@ class UniversalCoord
       * necessary to use it in new code, where the use of the rather the rather
       * obscure unit micro-light year isn't necessary.
       */
-    UniversalCoord offsetUly(const Eigen::Vector3d& vUly)
+    UniversalCoord offsetUly(const Eigen::Vector3d& vUly) const
     {
         return *this + UniversalCoord(vUly);
     }
@@ -178,3 +178,13 @@ inline UniversalCoord operator-(const UniversalCoord& uc0, const UniversalCoord&
 {
     return UniversalCoord(uc0.x - uc1.x, uc0.y - uc1.y, uc0.z - uc1.z);
 }
+
+inline bool operator==(const UniversalCoord& uc0, const UniversalCoord& uc1)
+{
+    return uc0.x == uc1.x && uc0.y == uc1.y && uc0.z == uc1.z;
+}
+
+inline bool operator!=(const UniversalCoord& uc0, const UniversalCoord& uc1)
+{
+    return !(uc0 == uc1);
+}
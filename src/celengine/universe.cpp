@@ -17,7 +17,10 @@
 #include "meshmanager.h"
 #include "universe.h"
 #include "timelinephase.h"
+#include "bodyindex.h"
+#include "flatframetree.h"
 #include "frametree.h"
+#include "scenesnapshot.h"
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
 #include <celmath/intersect.h>
@@ -285,6 +288,23 @@ void NearStarFinder::process(const Star& star, float distance, float /*unused*/)
 }
 
 
+class NearDSOFinder : public DSOHandler
+{
+public:
+    NearDSOFinder(vector<const DeepSkyObject*>& _nearDSOs) : nearDSOs(_nearDSOs) {}
+    ~NearDSOFinder() = default;
+    void process(DeepSkyObject* const & dso, double /*unused*/, float /*unused*/)
+    {
+        // processCloseObjects has already checked the distance to the
+        // center of the DSO.
+        nearDSOs.push_back(dso);
+    }
+
+private:
+    vector<const DeepSkyObject*>& nearDSOs;
+};
+
+
 
 struct PlanetPickInfo
 {
@@ -295,9 +315,17 @@ struct PlanetPickInfo
     Eigen::ParametrizedLine<double, 3> pickRay;
     double jd;
     float atanTolerance;
+    SceneSnapshot* snapshot;
 };
 
 
+static Vector3d pickPosition(const Body& body, double tdb, SceneSnapshot* snapshot)
+{
+    return snapshot != nullptr ? snapshot->getAstrocentricPosition(body, tdb)
+                               : body.getAstrocentricPosition(tdb);
+}
+
+
 static bool ApproxPlanetPickTraversal(Body* body, void* info)
 {
     auto* pickInfo = (PlanetPickInfo*) info;
@@ -306,7 +334,7 @@ static bool ApproxPlanetPickTraversal(Body* body, void* info)
     if (!body->isVisible() || !body->extant(pickInfo->jd) || !body->isClickable())
         return true;
 
-    Vector3d bpos = body->getAstrocentricPosition(pickInfo->jd);
+    Vector3d bpos = pickPosition(*body, pickInfo->jd, pickInfo->snapshot);
     Vector3d bodyDir = bpos - pickInfo->pickRay.origin();
     double distance = bodyDir.norm();
 
@@ -339,7 +367,7 @@ static bool ApproxPlanetPickTraversal(Body* body, void* info)
 static bool ExactPlanetPickTraversal(Body* body, void* info)
 {
     auto* pickInfo = reinterpret_cast<PlanetPickInfo*>(info);
-    Vector3d bpos = body->getAstrocentricPosition(pickInfo->jd);
+    Vector3d bpos = pickPosition(*body, pickInfo->jd, pickInfo->snapshot);
     float radius = body->getRadius();
     double distance = -1.0;
 
@@ -412,36 +440,44 @@ static bool ExactPlanetPickTraversal(Body* body, void* info)
     return true;
 }
 
-// Recursively traverse a frame tree; call the specified callback function for each
-// body in the tree. The callback function returns a boolean indicating whether
-// traversal should continue.
-//
-// TODO: This function works, but could use some cleanup:
-//   * Make it a member of the frame tree class
-//   * Combine info and func into a traversal callback class
-static bool traverseFrameTree(FrameTree* frameTree,
-                              double tdb,
-                              PlanetarySystem::TraversalFunc func,
-                              void* info)
+// Recursively collect the bodies of a frame tree that a pick cone could
+// select, in depth-first order: each body is followed by its subtree. Large
+// trees are culled with their spatial index; a child outside the cone is
+// skipped along with its subtree, which lies within the child's bounding
+// sphere.
+static void collectPickCandidates(const FlatFrameTree& flatTree,
+                                  std::uint32_t parentNode,
+                                  const Eigen::ParametrizedLine<double, 3>& pickRay,
+                                  double cosHalfAngle,
+                                  double tdb,
+                                  SceneSnapshot* snapshot,
+                                  vector<Body*>& bodies)
 {
-    for (unsigned int i = 0; i < frameTree->childCount(); i++)
+    const FlatFrameTree::Node& parent = flatTree.getNode(parentNode);
+    const BodySpatialIndex* spatialIndex = parent.subtree->getSpatialIndex(tdb);
+    vector<unsigned int> candidates;
+    if (spatialIndex != nullptr)
     {
-        auto phase = frameTree->getChild(i);
-        if (phase->includes(tdb))
-        {
-            Body* body = phase->body();
-            if (!func(body, info))
-                return false;
-
-            if (body->getFrameTree() != nullptr)
-            {
-                if (!traverseFrameTree(body->getFrameTree(), tdb, func, info))
-                    return false;
-            }
-        }
+        // Index positions are relative to the body at the center of the tree
+        Vector3d apex = pickRay.origin();
+        if (parent.body != nullptr)
+            apex -= pickPosition(*parent.body, tdb, snapshot);
+        spatialIndex->findInCone(apex, pickRay.direction(), cosHalfAngle, candidates);
     }
 
-    return true;
+    unsigned int nChildren = spatialIndex != nullptr ? static_cast<unsigned int>(candidates.size())
+                                                     : parent.childCount;
+    for (unsigned int n = 0; n < nChildren; n++)
+    {
+        std::uint32_t childNode = parent.firstChild + (spatialIndex != nullptr ? candidates[n] : n);
+        const FlatFrameTree::Node& node = flatTree.getNode(childNode);
+        if (!node.includes(tdb))
+            continue;
+
+        bodies.push_back(node.body);
+        if (node.subtree != nullptr)
+            collectPickCandidates(flatTree, childNode, pickRay, cosHalfAngle, tdb, snapshot, bodies);
+    }
 }
 
 
@@ -450,7 +486,8 @@ Selection Universe::pickPlanet(SolarSystem& solarSystem,
                                const Vector3f& direction,
                                double when,
                                float /*faintestMag*/,
-                               float tolerance)
+                               float tolerance,
+                               SceneSnapshot* snapshot)
 {
     double sinTol2 = std::max(sin(tolerance / 2.0), ANGULAR_RES);
     PlanetPickInfo pickInfo;
@@ -468,10 +505,28 @@ Selection Universe::pickPlanet(SolarSystem& solarSystem,
     pickInfo.closestBody = nullptr;
     pickInfo.jd = when;
     pickInfo.atanTolerance = (float) atan(tolerance);
+    pickInfo.snapshot = snapshot;
+
+    // The flattened tree and spatial indexes rely on up to date bounding
+    // spheres, which the renderer normally takes care of.
+    FrameTree* frameTree = solarSystem.getFrameTree();
+    if (frameTree->updateRequired())
+    {
+        frameTree->recomputeBoundingSphere();
+        frameTree->markUpdated();
+    }
+
+    // Neither pick test can select a body farther from the pick ray than the
+    // tolerance angle, so only the bodies within that cone need to be
+    // considered.
+    double cosTolerance = 1.0 - 2.0 * sinTol2 * sinTol2;
+    vector<Body*> candidates;
+    collectPickCandidates(frameTree->getFlattened(), 0, pickInfo.pickRay, cosTolerance, when, snapshot, candidates);
 
     // First see if there's a planet|moon that the pick ray intersects.
     // Select the closest planet|moon intersected.
-    traverseFrameTree(solarSystem.getFrameTree(), when, ExactPlanetPickTraversal, (void*) &pickInfo);
+    for (Body* body : candidates)
+        ExactPlanetPickTraversal(body, &pickInfo);
 
     if (pickInfo.closestBody != nullptr)
     {
@@ -480,7 +535,8 @@ Selection Universe::pickPlanet(SolarSystem& solarSystem,
 
         // Check if there is a satellite in front of the primary body that is
         // sufficiently close to the pickRay
-        traverseFrameTree(solarSystem.getFrameTree(), when, ApproxPlanetPickTraversal, (void*) &pickInfo);
+        for (Body* body : candidates)
+            ApproxPlanetPickTraversal(body, &pickInfo);
 
         if (pickInfo.closestBody == closestBody)
             return  Selection(closestBody);
@@ -502,7 +558,8 @@ Selection Universe::pickPlanet(SolarSystem& solarSystem,
     // clicks on a pixel where the planet's disc has been rendered--in order
     // to make distant planets visible on the screen at all, their apparent
     // size has to be greater than their actual disc size.
-    traverseFrameTree(solarSystem.getFrameTree(), when, ApproxPlanetPickTraversal, (void*) &pickInfo);
+    for (Body* body : candidates)
+        ApproxPlanetPickTraversal(body, &pickInfo);
 
     if (pickInfo.sinAngle2Closest <= sinTol2)
         return Selection(pickInfo.closestBody);
@@ -511,14 +568,15 @@ Selection Universe::pickPlanet(SolarSystem& solarSystem,
 }
 
 
-// StarPicker is a callback class for StarDatabase::findVisibleStars
-class StarPicker : public StarHandler
+// StarPicker is a callback class for StarDatabase::findStarsAlongRay
+class StarPicker : public StarRayHandler
 {
 public:
     StarPicker(const Vector3f&, const Vector3f&, double, float);
     ~StarPicker() = default;
 
     void process(const Star& /*star*/, float /*unused*/, float /*unused*/);
+    float maxAngle() const { return (float) (2.0 * asin(sinAngle2Closest)); }
 
 public:
     const Star* pickedStar;
@@ -683,18 +741,10 @@ Selection Universe::pickStar(const UniversalCoord& origin,
     if (closePicker.closestStar != nullptr)
         return Selection(const_cast<Star*>(closePicker.closestStar));
 
-    // Find visible stars expects an orientation, but we just have a direction
-    // vector.  Convert the direction vector into an orientation by computing
-    // the rotation required to map -Z to the direction.
-    Quaternionf rotation;
-    rotation.setFromTwoVectors(-Vector3f::UnitZ(), direction);
-
+    // Walk the octree along the pick ray, nearest nodes in angle first;
+    // the search narrows as the picker finds stars closer to the ray.
     StarPicker picker(o, direction, when, tolerance);
-    starCatalog->findVisibleStars(picker,
-                                  o,
-                                  rotation.conjugate(),
-                                  tolerance, 1.0f,
-                                  faintestMag);
+    starCatalog->findStarsAlongRay(picker, o, direction, faintestMag);
     if (picker.pickedStar != nullptr)
         return Selection(const_cast<Star*>(picker.pickedStar));
     else
@@ -702,13 +752,14 @@ Selection Universe::pickStar(const UniversalCoord& origin,
 }
 
 
-class DSOPicker : public DSOHandler
+class DSOPicker : public DSORayHandler
 {
 public:
     DSOPicker(const Vector3d& pickOrigin, const Vector3d& pickDir, uint64_t renderFlags, float angle);
     ~DSOPicker() = default;
 
     void process(DeepSkyObject* const &, double, float);
+    double maxAngle() const { return 2.0 * asin(sinAngle2Closest); }
 
 public:
     Vector3d pickOrigin;
@@ -838,16 +889,8 @@ Selection Universe::pickDeepSkyObject(const UniversalCoord& origin,
         return Selection(const_cast<DeepSkyObject*>(closePicker.closestDSO));
     }
 
-    Quaternionf rotation;
-    rotation.setFromTwoVectors(-Vector3f::UnitZ(), direction);
-
     DSOPicker picker(orig, dir, renderFlags, tolerance);
-    dsoCatalog->findVisibleDSOs(picker,
-                                orig,
-                                rotation.conjugate(),
-                                tolerance,
-                                1.0f,
-                                faintestMag);
+    dsoCatalog->findDSOsAlongRay(picker, orig, dir, faintestMag);
     if (picker.pickedDSO != nullptr)
         return Selection(const_cast<DeepSkyObject*>(picker.pickedDSO));
     else
@@ -860,7 +903,8 @@ Selection Universe::pick(const UniversalCoord& origin,
                          double when,
                          uint64_t renderFlags,
                          float  faintestMag,
-                         float  tolerance)
+                         float  tolerance,
+                         SceneSnapshot* snapshot)
 {
     Selection sel;
 
@@ -877,7 +921,8 @@ Selection Universe::pick(const UniversalCoord& origin,
                                 origin, direction,
                                 when,
                                 faintestMag,
-                                tolerance);
+                                tolerance,
+                                snapshot);
                 if (!sel.empty())
                     break;
             }
@@ -1232,3 +1277,79 @@ Universe::getNearStars(const UniversalCoord& position,
     NearStarFinder finder(maxDistance, nearStars);
     starCatalog->findCloseStars(finder, pos, maxDistance);
 }
+
+
+// Find up to count stars within maxDistance light years of position, sorted
+// from nearest to farthest.
+void
+Universe::getNearestStars(const UniversalCoord& position,
+                          unsigned int count,
+                          float maxDistance,
+                          vector<const Star*>& stars) const
+{
+    vector<pair<const Star*, float>> nearest;
+    starCatalog->findNearestStars(nearest, position.toLy().cast<float>(), count, maxDistance);
+    for (const auto& [star, distance] : nearest)
+        stars.push_back(star);
+}
+
+
+// Find the stars within maxDistance light years of origin whose direction
+// lies within halfAngle radians of direction, sorted from nearest to farthest.
+void
+Universe::getStarsInCone(const UniversalCoord& origin,
+                         const Vector3d& direction,
+                         double halfAngle,
+                         float maxDistance,
+                         vector<const Star*>& stars) const
+{
+    vector<pair<const Star*, float>> found;
+    starCatalog->findStarsInCone(found,
+                                 origin.toLy().cast<float>(),
+                                 direction.cast<float>(),
+                                 static_cast<float>(halfAngle),
+                                 maxDistance);
+    sort(found.begin(), found.end(),
+         [](const auto& a, const auto& b) { return a.second < b.second; });
+    for (const auto& [star, distance] : found)
+        stars.push_back(star);
+}
+
+
+void
+Universe::getNearDSOs(const UniversalCoord& position,
+                      double maxDistance,
+                      vector<const DeepSkyObject*>& dsos) const
+{
+    NearDSOFinder finder(dsos);
+    dsoCatalog->findCloseDSOs(finder, position.toLy(), static_cast<float>(maxDistance));
+}
+
+
+void
+Universe::getNearestDSOs(const UniversalCoord& position,
+                         unsigned int count,
+                         double maxDistance,
+                         vector<const DeepSkyObject*>& dsos) const
+{
+    vector<pair<DeepSkyObject*, double>> nearest;
+    dsoCatalog->findNearestDSOs(nearest, position.toLy(), count, maxDistance);
+    for (const auto& [dso, distance] : nearest)
+        dsos.push_back(dso);
+}
+
+
+void
+Universe::getDSOsInCone(const UniversalCoord& origin,
+                        const Vector3d& direction,
+                        double halfAngle,
+                        double maxDistance,
+                        vector<const DeepSkyObject*>& dsos) const
+{
+    vector<pair<DeepSkyObject*, double>> found;
+    dsoCatalog->findDSOsInCone(found, origin.toLy(), direction, halfAngle, maxDistance);
+    sort(found.begin(), found.end(),
+         [](const auto& a, const auto& b) { return a.second < b.second; });
+    for (const auto& [dso, distance] : found)
+        dsos.push_back(dso);
+}
@@ -23,6 +23,7 @@
 
 
 class ConstellationBoundaries;
+class SceneSnapshot;
 
 class Universe
 {
@@ -50,7 +51,8 @@ class Universe
                    double when,
                    uint64_t renderFlags,
                    float faintestMag,
-                   float tolerance = 0.0f);
+                   float tolerance = 0.0f,
+                   SceneSnapshot* snapshot = nullptr);
 
 
     Selection find(const std::string& s,
@@ -88,6 +90,28 @@ class Universe
     void getNearStars(const UniversalCoord& position,
                       float maxDistance,
                       std::vector<const Star*>& stars) const;
+    void getNearestStars(const UniversalCoord& position,
+                         unsigned int count,
+                         float maxDistance,
+                         std::vector<const Star*>& stars) const;
+    void getStarsInCone(const UniversalCoord& origin,
+                        const Eigen::Vector3d& direction,
+                        double halfAngle,
+                        float maxDistance,
+                        std::vector<const Star*>& stars) const;
+
+    void getNearDSOs(const UniversalCoord& position,
+                     double maxDistance,
+                     std::vector<const DeepSkyObject*>& dsos) const;
+    void getNearestDSOs(const UniversalCoord& position,
+                        unsigned int count,
+                        double maxDistance,
+                        std::vector<const DeepSkyObject*>& dsos) const;
+    void getDSOsInCone(const UniversalCoord& origin,
+                       const Eigen::Vector3d& direction,
+                       double halfAngle,
+                       double maxDistance,
+                       std::vector<const DeepSkyObject*>& dsos) const;
 
     void markObject(const Selection&,
                     const celestia::MarkerRepresentation& rep,
@@ -105,7 +129,8 @@ class Universe
                          const Eigen::Vector3f& direction,
                          double when,
                          float faintestMag,
-                         float tolerance);
+                         float tolerance,
+                         SceneSnapshot* snapshot);
 
     Selection pickStar(const UniversalCoord& origin,
                        const Eigen::Vector3f& direction,
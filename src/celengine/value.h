@@ -88,6 +88,11 @@ class Value
         assert(type == StringType);
         return *data.s;
     }
+    std::string_view getStringView() const
+    {
+        assert(type == StringType);
+        return *data.s;
+    }
     Array* getArray() const
     {
         assert(type == ArrayType);
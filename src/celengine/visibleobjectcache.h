@@ -0,0 +1,133 @@
+// visibleobjectcache.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Results of an octree visibility query, kept so that they can be replayed
+// while the view doesn't change.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "octree.h"
+
+
+/*! A VisibleObjectCache sits between an octree visibility query and the
+ *  processor that renders its results. While recording, it passes every
+ *  object on to the processor and keeps a list of them. If a later query
+ *  has exactly the same parameters, the list can be replayed instead of
+ *  traversing the octree again.
+ *
+ *  The processor runs on every object for every frame either way, so only
+ *  the query itself is skipped: anything that the processor checks, such
+ *  as object visibility or the time, may change freely. The catalog is
+ *  identified by its address and object count; it must be invalidated
+ *  explicitly if objects are replaced without changing the count.
+ */
+template<class OBJ, class PREC> class VisibleObjectCache : public OctreeProcessor<OBJ, PREC>
+{
+ public:
+    using Position = Eigen::Matrix<PREC, 3, 1>;
+
+    struct Query
+    {
+        const void* catalog;
+        std::uint32_t objectCount;
+        Position position;
+        Eigen::Quaternionf orientation;
+        float fovY;
+        float aspectRatio;
+        float limitingMag;
+
+        bool operator==(const Query& other) const
+        {
+            return catalog == other.catalog &&
+                   objectCount == other.objectCount &&
+                   position == other.position &&
+                   orientation.coeffs() == other.orientation.coeffs() &&
+                   fovY == other.fovY &&
+                   aspectRatio == other.aspectRatio &&
+                   limitingMag == other.limitingMag;
+        }
+    };
+
+    //! Return true if the recorded list is the result of query
+    bool matches(const Query& query) const
+    {
+        return valid && query == recordedQuery;
+    }
+
+    /*! Start recording the results of query, forwarding each object to
+     *  processor. The cache must then be passed to the octree query in
+     *  place of the processor.
+     */
+    void record(const Query& query, OctreeProcessor<OBJ, PREC>& processor)
+    {
+        entries.clear();
+        recordedQuery = query;
+        target = &processor;
+        valid = true;
+    }
+
+    //! Pass the recorded objects to processor in their original order
+    void replay(OctreeProcessor<OBJ, PREC>& processor) const
+    {
+        for (const auto& entry : entries)
+            processor.process(load(entry.object), entry.distance, entry.appMag);
+    }
+
+    void invalidate()
+    {
+        valid = false;
+        entries.clear();
+    }
+
+    void process(const OBJ& obj, PREC distance, float appMag) override
+    {
+        entries.push_back({ store(obj), distance, appMag });
+        target->process(obj, distance, appMag);
+    }
+
+ private:
+    // Objects that are themselves pointers are kept by value, since the
+    // octree may pass them in temporaries; others are kept by address.
+    using StoredObject = std::conditional_t<std::is_pointer_v<OBJ>, OBJ, const OBJ*>;
+
+    static StoredObject store(const OBJ& obj)
+    {
+        if constexpr (std::is_pointer_v<OBJ>)
+            return obj;
+        else
+            return &obj;
+    }
+
+    static const OBJ& load(const StoredObject& object)
+    {
+        if constexpr (std::is_pointer_v<OBJ>)
+            return object;
+        else
+            return *object;
+    }
+
+    struct Entry
+    {
+        StoredObject object;
+        PREC distance;
+        float appMag;
+    };
+
+    std::vector<Entry> entries;
+    Query recordedQuery{};
+    OctreeProcessor<OBJ, PREC>* target{ nullptr };
+    bool valid{ false };
+};
@@ -16,8 +16,11 @@
 #include <celmath/geomutil.h>
 #include <celutil/logger.h>
 #include <cassert>
-#include <vector>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
 
 using namespace Eigen;
 using namespace std;
@@ -351,35 +354,77 @@ void computePlanetCoords(int p, double map, double da, double dhl, double dl,
     distance *= KM_PER_AU;
 }
 
-void ComputeGalileanElements(double t,
-                             double& l1, double& l2, double& l3, double& l4,
-                             double& p1, double& p2, double& p3, double& p4,
-                             double& w1, double& w2, double& w3, double& w4,
-                             double& gamma, double& phi, double& psi,
-                             double& G, double& Gp)
+// The satellite theories below evaluate a set of fundamental arguments
+// common to all the satellites of a planet, and then a series of periodic
+// terms specific to each satellite. A SatelliteTheory computes the common
+// arguments once for a given time and shares them between the orbits of all
+// the satellites, so that a planetary system evaluates them once per frame
+// rather than once per satellite.
+template<typename T> class SatelliteTheory
 {
-    // Parameter t is Julian days, epoch 1950.0.
-    l1 = 1.8513962 + 3.551552269981*t;
-    l2 = 3.0670952 + 1.769322724929*t;
-    l3 = 2.1041485 + 0.87820795239*t;
-    l4 = 1.473836 + 0.37648621522*t;
-
-    p1 = 1.69451 + 2.8167146e-3*t;
-    p2 = 2.702927 + 8.248962e-4*t;
-    p3 = 3.28443 + 1.24396e-4*t;
-    p4 = 5.851859 + 3.21e-5*t;
-
-    w1 = 5.451267 - 2.3176901e-3*t;
-    w2 = 1.753028 - 5.695121e-4*t;
-    w3 = 2.080331 - 1.25263e-4*t;
-    w4 = 5.630757 - 3.07063e-5*t;
-
-    gamma = 5.7653e-3*sin(2.85674 + 1.8347e-5*t) + 6.002e-4*sin(0.60189 - 2.82274e-4*t);
-    phi = 3.485014 + 3.033241e-3*t;
-    psi = 5.524285 - 3.63e-8*t;
-    G = 0.527745 + 1.45023893e-3*t + gamma;
-    Gp = 0.5581306 + 5.83982523e-4*t;
-}
+ public:
+    const T& elementsAt(double t)
+    {
+        if (t != lastTime)
+        {
+            T::compute(t, elements);
+            lastTime = t;
+        }
+        return elements;
+    }
+
+    static std::shared_ptr<SatelliteTheory> get()
+    {
+        static std::weak_ptr<SatelliteTheory> instance;
+        auto theory = instance.lock();
+        if (theory == nullptr)
+        {
+            theory = std::make_shared<SatelliteTheory>();
+            instance = theory;
+        }
+        return theory;
+    }
+
+ private:
+    double lastTime{ std::numeric_limits<double>::quiet_NaN() };
+    T elements{};
+};
+
+
+struct GalileanElements
+{
+    double l1, l2, l3, l4;
+    double p1, p2, p3, p4;
+    double w1, w2, w3, w4;
+    double gamma, phi, psi, G, Gp;
+
+    static void compute(double t, GalileanElements& e)
+    {
+        // Parameter t is Julian days, epoch 1950.0.
+        e.l1 = 1.8513962 + 3.551552269981*t;
+        e.l2 = 3.0670952 + 1.769322724929*t;
+        e.l3 = 2.1041485 + 0.87820795239*t;
+        e.l4 = 1.473836 + 0.37648621522*t;
+
+        e.p1 = 1.69451 + 2.8167146e-3*t;
+        e.p2 = 2.702927 + 8.248962e-4*t;
+        e.p3 = 3.28443 + 1.24396e-4*t;
+        e.p4 = 5.851859 + 3.21e-5*t;
+
+        e.w1 = 5.451267 - 2.3176901e-3*t;
+        e.w2 = 1.753028 - 5.695121e-4*t;
+        e.w3 = 2.080331 - 1.25263e-4*t;
+        e.w4 = 5.630757 - 3.07063e-5*t;
+
+        e.gamma = 5.7653e-3*sin(2.85674 + 1.8347e-5*t) + 6.002e-4*sin(0.60189 - 2.82274e-4*t);
+        e.phi = 3.485014 + 3.033241e-3*t;
+        e.psi = 5.524285 - 3.63e-8*t;
+        e.G = 0.527745 + 1.45023893e-3*t + e.gamma;
+        e.Gp = 0.5581306 + 5.83982523e-4*t;
+    }
+};
+
+using GalileanTheory = SatelliteTheory<GalileanElements>;
 
 
 
@@ -1549,27 +1594,27 @@ static const double JupAscendingNode = degToRad(22.203);
 class IoOrbit : public CachingOrbit
 {
  public:
+    explicit IoOrbit(std::shared_ptr<GalileanTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~IoOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
     //Computation will yield latitude(L), longitude(B) and distance(R) relative to Jupiter
     double t;
-    double l1, l2, l3, l4;
-    double p1, p2, p3, p4;
-    double w1, w2, w3, w4;
-    double gamma, phi, psi, G, Gp;
     double sigma, L, B, R;
     double T, P;
 
     // Epoch for Galilean satellites is 1976.0 Aug 10
     t = jd - 2443000.5;
 
-    ComputeGalileanElements(t,
-                            l1, l2, l3, l4,
-                            p1, p2, p3, p4,
-                            w1, w2, w3, w4,
-                            gamma, phi, psi, G, Gp);
+    const auto& [l1, l2, l3, l4,
+                 p1, p2, p3, p4,
+                 w1, w2, w3, w4,
+                 gamma, phi, psi, G, Gp] = theory->elementsAt(t);
 
     // Calculate periodic terms for longitude
     sigma = 0.47259*sin(2*(l1 - l2)) - 0.03478*sin(p3 - p4)
@@ -1625,32 +1670,35 @@ class IoOrbit : public CachingOrbit
     {
         return 423329 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<GalileanTheory> theory;
 };
 
 class EuropaOrbit : public CachingOrbit
 {
  public:
+    explicit EuropaOrbit(std::shared_ptr<GalileanTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~EuropaOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
     // Computation will yield latitude(L), longitude(B) and distance(R) relative to Jupiter
     double t;
-    double l1, l2, l3, l4;
-    double p1, p2, p3, p4;
-    double w1, w2, w3, w4;
-    double gamma, phi, psi, G, Gp;
     double sigma, L, B, R;
     double T, P;
 
     // Epoch for Galilean satellites is 1976 Aug 10
     t = jd - 2443000.5;
 
-    ComputeGalileanElements(t,
-                            l1, l2, l3, l4,
-                            p1, p2, p3, p4,
-                            w1, w2, w3, w4,
-                            gamma, phi, psi, G, Gp);
+    const auto& [l1, l2, l3, l4,
+                 p1, p2, p3, p4,
+                 w1, w2, w3, w4,
+                 gamma, phi, psi, G, Gp] = theory->elementsAt(t);
 
     // Calculate periodic terms for longitude
     sigma = 1.06476*sin(2*(l2 - l3)) + 0.04256*sin(l1 - 2*l2 + p3)
@@ -1717,32 +1765,35 @@ class EuropaOrbit : public CachingOrbit
     {
         return 678000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<GalileanTheory> theory;
 };
 
 class GanymedeOrbit : public CachingOrbit
 {
  public:
+    explicit GanymedeOrbit(std::shared_ptr<GalileanTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~GanymedeOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
     //Computation will yield latitude(L), longitude(B) and distance(R) relative to Jupiter
     double t;
-    double l1, l2, l3, l4;
-    double p1, p2, p3, p4;
-    double w1, w2, w3, w4;
-    double gamma, phi, psi, G, Gp;
     double sigma, L, B, R;
     double T, P;
 
     //Epoch for Galilean satellites is 1976 Aug 10
     t = jd - 2443000.5;
 
-    ComputeGalileanElements(t,
-                            l1, l2, l3, l4,
-                            p1, p2, p3, p4,
-                            w1, w2, w3, w4,
-                            gamma, phi, psi, G, Gp);
+    const auto& [l1, l2, l3, l4,
+                 p1, p2, p3, p4,
+                 w1, w2, w3, w4,
+                 gamma, phi, psi, G, Gp] = theory->elementsAt(t);
 
     //Calculate periodic terms for longitude
     sigma = 0.1649*sin(l3 - p3) + 0.09081*sin(l3 - p4)
@@ -1812,32 +1863,35 @@ class GanymedeOrbit : public CachingOrbit
     {
         return 1070000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<GalileanTheory> theory;
 };
 
 class CallistoOrbit : public CachingOrbit
 {
  public:
+    explicit CallistoOrbit(std::shared_ptr<GalileanTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~CallistoOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
     //Computation will yield latitude(L), longitude(B) and distance(R) relative to Jupiter
     double t;
-    double l1, l2, l3, l4;
-    double p1, p2, p3, p4;
-    double w1, w2, w3, w4;
-    double gamma, phi, psi, G, Gp;
     double sigma, L, B, R;
     double T, P;
 
     //Epoch for Galilean satellites is 1976 Aug 10
     t = jd - 2443000.5;
 
-    ComputeGalileanElements(t,
-                            l1, l2, l3, l4,
-                            p1, p2, p3, p4,
-                            w1, w2, w3, w4,
-                            gamma, phi, psi, G, Gp);
+    const auto& [l1, l2, l3, l4,
+                 p1, p2, p3, p4,
+                 w1, w2, w3, w4,
+                 gamma, phi, psi, G, Gp] = theory->elementsAt(t);
 
     //Calculate periodic terms for longitude
     sigma =
@@ -1952,6 +2006,9 @@ class CallistoOrbit : public CachingOrbit
     {
         return 1890000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<GalileanTheory> theory;
 };
 
 
@@ -1964,37 +2021,38 @@ static const double SatTilt = 28.0817;
 // Titan, Hyperion, and Iapetus are from Jean Meeus's Astronomical Algorithms,
 // and were originally derived by Gerard Dourneau.
 
-void ComputeSaturnianElements(double t,
-                              double& t1, double& t2, double& t3,
-                              double& t4, double& t5, double& t6,
-                              double& t7, double& t8, double& t9,
-                              double& t10, double& t11,
-                              double& W0, double& W1, double& W2,
-                              double& W3, double& W4, double& W5,
-                              double& W6, double& W7, double& W8)
+struct SaturnianElements
 {
-    t1 = t - 2411093.0;
-    t2 = t1 / 365.25;
-    t3 = (t - 2433282.423) / 365.25 + 1950.0;
-    t4 = t - 2411368.0;
-    t5 = t4 / 365.25;
-    t6 = t - 2415020.0;
-    t7 = t6 / 36525;
-    t8 = t6 / 365.25;
-    t9 = (t - 2442000.5) / 365.25;
-    t10 = t - 2409786.0;
-    t11 = t10 / 36525;
-
-    W0 = 5.095 * (t3 - 1866.39);
-    W1 = 74.4 + 32.39 * t2;
-    W2 = 134.3 + 92.62 * t2;
-    W3 = 42.0 - 0.5118 * t5;
-    W4 = 276.59 + 0.5118 * t5;
-    W5 = 267.2635 + 1222.1136 * t7;
-    W6 = 175.4762 + 1221.5515 * t7;
-    W7 = 2.4891 + 0.002435 * t7;
-    W8 = 113.35 - 0.2597 * t7;
-}
+    double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+    double W0, W1, W2, W3, W4, W5, W6, W7, W8;
+
+    static void compute(double t, SaturnianElements& e)
+    {
+        e.t1 = t - 2411093.0;
+        e.t2 = e.t1 / 365.25;
+        e.t3 = (t - 2433282.423) / 365.25 + 1950.0;
+        e.t4 = t - 2411368.0;
+        e.t5 = e.t4 / 365.25;
+        e.t6 = t - 2415020.0;
+        e.t7 = e.t6 / 36525;
+        e.t8 = e.t6 / 365.25;
+        e.t9 = (t - 2442000.5) / 365.25;
+        e.t10 = t - 2409786.0;
+        e.t11 = e.t10 / 36525;
+
+        e.W0 = 5.095 * (e.t3 - 1866.39);
+        e.W1 = 74.4 + 32.39 * e.t2;
+        e.W2 = 134.3 + 92.62 * e.t2;
+        e.W3 = 42.0 - 0.5118 * e.t5;
+        e.W4 = 276.59 + 0.5118 * e.t5;
+        e.W5 = 267.2635 + 1222.1136 * e.t7;
+        e.W6 = 175.4762 + 1221.5515 * e.t7;
+        e.W7 = 2.4891 + 0.002435 * e.t7;
+        e.W8 = 113.35 - 0.2597 * e.t7;
+    }
+};
+
+using SaturnianTheory = SatelliteTheory<SaturnianElements>;
 
 
 static Vector3d SaturnMoonPosition(double lam, double gam, double Om, double r)
@@ -2052,18 +2110,19 @@ static void OuterSaturnMoonParams(double a, double e, double i,
 class MimasOrbit : public CachingOrbit
 {
  public:
+    explicit MimasOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~MimasOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
 
         double L = 127.64 + 381.994497 * t1 - 43.57 * sinD(W0) -
             0.720 * sinD( 3 * W0) - 0.02144 * sinD(5 * W0);
@@ -2088,24 +2147,28 @@ class MimasOrbit : public CachingOrbit
     {
         return 189000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class EnceladusOrbit : public CachingOrbit
 {
  public:
+    explicit EnceladusOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~EnceladusOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
 
         double L = 200.317 + 262.7319002 * t1 + 0.25667 * sinD(W1) +
             0.20883 * sinD(W2);
@@ -2129,24 +2192,28 @@ class EnceladusOrbit : public CachingOrbit
     {
         return 239000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class TethysOrbit : public CachingOrbit
 {
  public:
+    explicit TethysOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~TethysOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
 
         double lam = 285.306 + 190.69791226 * t1 + 2.063 * sinD(W0) +
             0.03409 * sinD(3 * W0) + 0.001015 * sinD(5 * W0);
@@ -2166,24 +2233,28 @@ class TethysOrbit : public CachingOrbit
     {
         return 295000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class DioneOrbit : public CachingOrbit
 {
  public:
+    explicit DioneOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~DioneOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
 
         double L = 254.712 + 131.53493193 * t1 - 0.0215 * sinD(W1) -
             0.01733 * sinD(W2);
@@ -2208,24 +2279,28 @@ class DioneOrbit : public CachingOrbit
     {
         return 378000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class RheaOrbit : public CachingOrbit
 {
  public:
+    explicit RheaOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~RheaOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
         /*double e1 = 0.05589 - 0.000346 * t7;  Unused*/
 
         double p_ = 342.7 + 10.057 * t2;
@@ -2257,24 +2332,28 @@ class RheaOrbit : public CachingOrbit
     {
         return 528000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class TitanOrbit : public CachingOrbit
 {
  public:
+    explicit TitanOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~TitanOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
         double e1 = 0.05589 - 0.000346 * t7;
 
         double L = 261.1582 + 22.57697855 * t4 + 0.074025 * sinD(W3);
@@ -2325,24 +2404,28 @@ class TitanOrbit : public CachingOrbit
     {
         return 1260000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class HyperionOrbit : public CachingOrbit
 {
  public:
+    explicit HyperionOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~HyperionOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
         double eta = 92.39 + 0.5621071 * t6;
         double zeta = 148.19 - 19.18 * t8;
         double theta = 184.8 - 35.41 * t9;
@@ -2408,24 +2491,28 @@ class HyperionOrbit : public CachingOrbit
     {
         return 1640000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
 class IapetusOrbit : public CachingOrbit
 {
  public:
+    explicit IapetusOrbit(std::shared_ptr<SaturnianTheory> _theory) :
+        theory(std::move(_theory))
+    {
+    }
+
     ~IapetusOrbit() override = default;
 
     Vector3d computePosition(double jd) const override
     {
         // Computation will yield latitude(L), longitude(B) and distance(R)
         // relative to Saturn.
-        double t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
-        double W0, W1, W2, W3, W4, W5, W6, W7, W8;
-
-        ComputeSaturnianElements(jd,
-                                 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
-                                 W0, W1, W2, W3, W4, W5, W6, W7, W8);
+        const auto& [t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11,
+                     W0, W1, W2, W3, W4, W5, W6, W7, W8] = theory->elementsAt(jd);
         double L = 261.1582 + 22.57697855 * t4;
         double om_ = 91.796 + 0.562 * t7;
         double psi = 4.367 - 0.195 * t7;
@@ -2500,6 +2587,9 @@ class IapetusOrbit : public CachingOrbit
     {
         return 3660000 * BoundingRadiusSlack;
     };
+
+ private:
+    std::shared_ptr<SaturnianTheory> theory;
 };
 
 
@@ -3264,29 +3354,29 @@ Orbit* GetCustomOrbit(const string& name)
     if (name == "deimos")
         return new DeimosOrbit();
     if (name == "io")
-        return new IoOrbit();
+        return new IoOrbit(GalileanTheory::get());
     if (name == "europa")
-        return new EuropaOrbit();
+        return new EuropaOrbit(GalileanTheory::get());
     if (name == "ganymede")
-        return new GanymedeOrbit();
+        return new GanymedeOrbit(GalileanTheory::get());
     if (name == "callisto")
-        return new CallistoOrbit();
+        return new CallistoOrbit(GalileanTheory::get());
     if (name == "mimas")
-        return new MimasOrbit();
+        return new MimasOrbit(SaturnianTheory::get());
     if (name == "enceladus")
-        return new EnceladusOrbit();
+        return new EnceladusOrbit(SaturnianTheory::get());
     if (name == "tethys")
-        return new TethysOrbit();
+        return new TethysOrbit(SaturnianTheory::get());
     if (name == "dione")
-        return new DioneOrbit();
+        return new DioneOrbit(SaturnianTheory::get());
     if (name == "rhea")
-        return new RheaOrbit();
+        return new RheaOrbit(SaturnianTheory::get());
     if (name == "titan")
-        return new TitanOrbit();
+        return new TitanOrbit(SaturnianTheory::get());
     if (name == "hyperion")
-        return new HyperionOrbit();
+        return new HyperionOrbit(SaturnianTheory::get());
     if (name == "iapetus")
-        return new IapetusOrbit();
+        return new IapetusOrbit(SaturnianTheory::get());
     if (name == "phoebe")
         return new PhoebeOrbit();
     if (name == "miranda")
@@ -0,0 +1,290 @@
+// kepler.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Solvers for Kepler's equation that handle many orbits at once.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <cmath>
+
+#include <celcompat/numbers.h>
+#include "kepler.h"
+
+namespace celestia::ephem
+{
+
+namespace
+{
+
+// With the starting values below, Danby's fourth order iteration
+// converges to within rounding error in two steps for all eccentricities;
+// the hyperbolic solver takes one more as a margin.
+constexpr int EllipticalIterations = 2;
+constexpr int HyperbolicIterations = 3;
+
+// Limits of incremental steps in AdvanceKeplerElliptical(): the change
+// in eccentric anomaly for which the rotation series below are accurate,
+// the error bound of the Newton correction, and the number of steps after
+// which orbits are solved exactly again
+constexpr double MaxIncrementalStep = 1.0e-2;
+constexpr double MaxIncrementalError = 1.0e-15;
+constexpr std::uint32_t RefreshSteps = 256;
+
+// Eccentricity above which elliptical orbits start from the cubic
+// approximation near pericenter
+constexpr double HighEccentricity = 0.8;
+
+// pi/2 split into three parts, the first two with enough trailing zero
+// bits that their products with the small integers used here are exact
+constexpr double PiOver2A = 1.57079632673412561417e+00;
+constexpr double PiOver2B = 6.07710050630396597660e-11;
+constexpr double PiOver2C = 2.02226624879595063154e-21;
+constexpr double TwoOverPi = 0.63661977236758134308;
+
+
+// Round to the nearest integer, for |x| < 2^51. Unlike std::nearbyint,
+// this can be vectorized. Reassociation would fold it to x, so this file is
+// always compiled without fast math; see CMakeLists.txt.
+inline double
+roundNearest(double x)
+{
+    constexpr double shift = 6755399441055744.0; // 1.5 * 2^52
+    return (x + shift) - shift;
+}
+
+
+// Reduce an angle to [-pi, pi]
+inline double
+reduceAngle(double x)
+{
+    double k = 4.0 * roundNearest(x * (0.25 * TwoOverPi));
+    return ((x - k * PiOver2A) - k * PiOver2B) - k * PiOver2C;
+}
+
+
+// Sine and cosine with only arithmetic and selects, so that loops using
+// them can be vectorized; the math library functions are opaque calls.
+// Accurate to an ulp or so for |x| below about 1e5.
+inline void
+sinCos(double x, double& s, double& c)
+{
+    // Reduce to r in [-pi/4, pi/4] and quadrant q
+    double k = roundNearest(x * TwoOverPi);
+    double r = ((x - k * PiOver2A) - k * PiOver2B) - k * PiOver2C;
+    double q = k - 4.0 * roundNearest(k * 0.25 - 0.375);
+
+    // Taylor series, truncated where the terms drop below rounding error
+    double r2 = r * r;
+    double sr = r + r * r2 * (-1.0 / 6.0 + r2 * (1.0 / 120.0 + r2 * (-1.0 / 5040.0 +
+                r2 * (1.0 / 362880.0 + r2 * (-1.0 / 39916800.0 + r2 * (1.0 / 6227020800.0 +
+                r2 * (-1.0 / 1307674368000.0 + r2 * (1.0 / 355687428096000.0))))))));
+    double cr = 1.0 + r2 * (-0.5 + r2 * (1.0 / 24.0 + r2 * (-1.0 / 720.0 +
+                r2 * (1.0 / 40320.0 + r2 * (-1.0 / 3628800.0 + r2 * (1.0 / 479001600.0 +
+                r2 * (-1.0 / 87178291200.0 + r2 * (1.0 / 20922789888000.0))))))));
+
+    bool odd = (q == 1.0) | (q == 3.0);
+    double sq = odd ? cr : sr;
+    double cq = odd ? sr : cr;
+    s = q >= 2.0 ? -sq : sq;
+    c = (q == 1.0) | (q == 2.0) ? -cq : cq;
+}
+
+
+// Rotate the angle with sine s and cosine c by a small angle d, using
+// series for sin d and cos d that are exact to rounding for
+// |d| <= MaxIncrementalStep
+inline void
+rotateSmall(double& s, double& c, double d)
+{
+    double d2 = d * d;
+    double sd = d * (1.0 + d2 * (-1.0 / 6.0 + d2 * (1.0 / 120.0)));
+    double cd = 1.0 + d2 * (-0.5 + d2 * (1.0 / 24.0 + d2 * (-1.0 / 720.0)));
+    double sr = s * cd + c * sd;
+    c = c * cd - s * sd;
+    s = sr;
+}
+
+
+// Near pericenter, Kepler's equation is approximately the cubic
+// (1 - e) E + e E^3 / 6 = M, or (e - 1) H + e H^3 / 6 = M for hyperbolic
+// orbits. This is the real root of the cubic with the given linear
+// coefficient, which is a good starting value for nearly parabolic orbits.
+inline double
+cubicStart(double linear, double e, double M)
+{
+    double p = 2.0 * linear / e;
+    double q = 3.0 * std::abs(M) / e;
+    double w = std::cbrt(q + std::sqrt(q * q + p * p * p));
+    return w > 0.0 ? std::copysign(w - p / w, M) : 0.0;
+}
+
+
+// One step of Danby's iteration for a function f with derivatives f1, f2
+// and f3
+inline double
+danbyStep(double f, double f1, double f2, double f3)
+{
+    double d1 = -f / f1;
+    double d2 = -f / (f1 + 0.5 * d1 * f2);
+    return -f / (f1 + 0.5 * d2 * f2 + d2 * d2 * f3 * (1.0 / 6.0));
+}
+
+} // end unnamed namespace
+
+
+void
+SolveKeplerElliptical(const double* eccentricity,
+                      const double* meanAnomaly,
+                      double* eccentricAnomaly,
+                      std::size_t count)
+{
+    // Start from one Newton step from E = M
+    for (std::size_t i = 0; i < count; i++)
+    {
+        double e = eccentricity[i];
+        double M = reduceAngle(meanAnomaly[i]);
+        double s, c;
+        sinCos(M, s, c);
+        eccentricAnomaly[i] = M + e * s / (1.0 - e * c);
+    }
+
+    // High eccentricities start from the cubic near pericenter, or else
+    // from Danby's starting value. These are few, so they aren't worth
+    // keeping out of the math library.
+    for (std::size_t i = 0; i < count; i++)
+    {
+        double e = eccentricity[i];
+        if (e < HighEccentricity)
+            continue;
+
+        double M = reduceAngle(meanAnomaly[i]);
+        double E = cubicStart(1.0 - e, e, M);
+        if (std::abs(E) >= 1.0)
+            E = M + 0.85 * e * static_cast<double>((M > 0.0) - (M < 0.0));
+        eccentricAnomaly[i] = E;
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        double e = eccentricity[i];
+        double M = reduceAngle(meanAnomaly[i]);
+        double E = eccentricAnomaly[i];
+        for (int j = 0; j < EllipticalIterations; j++)
+        {
+            double s, c;
+            sinCos(E, s, c);
+            E += danbyStep(E - e * s - M, 1.0 - e * c, e * s, e * c);
+        }
+
+        eccentricAnomaly[i] = E;
+    }
+}
+
+
+void
+AdvanceKeplerElliptical(const double* eccentricity,
+                        const double* meanAnomaly,
+                        KeplerState* states,
+                        std::size_t count)
+{
+    constexpr std::size_t BlockSize = 256;
+    double e[BlockSize];
+    double M[BlockSize];
+    double E[BlockSize];
+    std::size_t index[BlockSize];
+
+    for (std::size_t first = 0; first < count; first += BlockSize)
+    {
+        std::size_t blockCount = std::min(count - first, BlockSize);
+        std::size_t exactCount = 0;
+
+        for (std::size_t i = first; i < first + blockCount; i++)
+        {
+            KeplerState& state = states[i];
+            double ecc = eccentricity[i];
+
+            // Predict the change in E from the derivative dE/dM, and
+            // bound the error left after a Newton correction, which is
+            // about k^3 d^4 for a prediction error of k d^2.
+            double f1 = 1.0 - ecc * state.cosE;
+            double d = (meanAnomaly[i] - state.meanAnomaly) / f1;
+            double k = ecc / (2.0 * f1);
+            double d2 = d * d;
+            if (state.steps >= RefreshSteps || !(std::abs(d) <= MaxIncrementalStep) ||
+                !(k * k * k * d2 * d2 <= MaxIncrementalError))
+            {
+                e[exactCount] = ecc;
+                M[exactCount] = meanAnomaly[i];
+                index[exactCount] = i;
+                exactCount++;
+                continue;
+            }
+
+            double s = state.sinE;
+            double c = state.cosE;
+            rotateSmall(s, c, d);
+            double Ep = state.eccentricAnomaly + d;
+
+            double correction = -reduceAngle(Ep - ecc * s - meanAnomaly[i]) / (1.0 - ecc * c);
+            rotateSmall(s, c, correction);
+
+            state.meanAnomaly = meanAnomaly[i];
+            state.eccentricAnomaly = Ep + correction;
+            state.sinE = s;
+            state.cosE = c;
+            state.steps++;
+        }
+
+        SolveKeplerElliptical(e, M, E, exactCount);
+        for (std::size_t j = 0; j < exactCount; j++)
+        {
+            KeplerState& state = states[index[j]];
+            state.meanAnomaly = M[j];
+            state.eccentricAnomaly = E[j];
+            sinCos(E[j], state.sinE, state.cosE);
+
+            // Refreshes continue on the same schedule. Otherwise, orbits
+            // solved together would all be refreshed on the same later
+            // call, so they start at different points of the schedule.
+            if (state.steps == RefreshSteps)
+                state.steps = 0;
+            else
+                state.steps = static_cast<std::uint32_t>(index[j] % RefreshSteps);
+        }
+    }
+}
+
+
+void
+SolveKeplerHyperbolic(const double* eccentricity,
+                      const double* meanAnomaly,
+                      double* hyperbolicAnomaly,
+                      std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++)
+    {
+        double e = eccentricity[i];
+        double M = meanAnomaly[i];
+
+        // The cubic near pericenter, and the asymptotic solution further out
+        double Hc = cubicStart(e - 1.0, e, M);
+        double Ha = std::copysign(std::log(2.0 * std::abs(M) / e + 1.85), M);
+        double H = std::abs(Hc) < 1.0 ? Hc : Ha;
+
+        for (int j = 0; j < HyperbolicIterations; j++)
+        {
+            double s = e * std::sinh(H);
+            double c = e * std::cosh(H);
+            H += danbyStep(s - H - M, c - 1.0, s, c);
+        }
+
+        hyperbolicAnomaly[i] = H;
+    }
+}
+
+} // end namespace celestia::ephem
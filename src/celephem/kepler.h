@@ -0,0 +1,73 @@
+// kepler.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Solvers for Kepler's equation that handle many orbits at once.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace celestia::ephem
+{
+
+/*! Solve Kepler's equation M = E - e sin E for the eccentric anomalies of
+ *  count elliptical orbits, 0 <= e < 1. The results are in [-pi, pi].
+ *
+ *  Every orbit gets the same fixed number of iterations, computed without
+ *  branches or math library calls, so that the compiler can evaluate
+ *  several orbits with each vector instruction.
+ */
+void SolveKeplerElliptical(const double* eccentricity,
+                           const double* meanAnomaly,
+                           double* eccentricAnomaly,
+                           std::size_t count);
+
+/*! The solution of Kepler's equation for an elliptical orbit at one time,
+ *  kept by AdvanceKeplerElliptical() to advance it to the next. A default
+ *  constructed state is solved from scratch on first use.
+ */
+struct KeplerState
+{
+    double meanAnomaly{ 0.0 };
+    double eccentricAnomaly{ 0.0 };
+    double sinE{ 0.0 };
+    double cosE{ 1.0 };
+    // Number of incremental steps since the last exact solution, or
+    // ~0 if there is none
+    std::uint32_t steps{ ~UINT32_C(0) };
+};
+
+/*! Advance the solutions of Kepler's equation for count elliptical orbits
+ *  to new mean anomalies.
+ *
+ *  Where the mean anomaly changed little since the previous call, as it
+ *  does between frames at moderate time rates, the previous solution is
+ *  rotated forward and corrected with one Newton step, with no
+ *  trigonometric functions. The size of the step is limited so that the
+ *  error of the correction stays below 1e-15 radians; larger changes,
+ *  such as time jumps, are solved exactly. To bound the accumulation of
+ *  rounding error, each orbit is also solved exactly after a fixed
+ *  number of incremental steps, at a different step for each orbit.
+ */
+void AdvanceKeplerElliptical(const double* eccentricity,
+                             const double* meanAnomaly,
+                             KeplerState* states,
+                             std::size_t count);
+
+/*! Solve Kepler's equation M = e sinh H - H for the hyperbolic anomalies of
+ *  count hyperbolic orbits, e > 1. These are rare enough that the solver
+ *  isn't vectorized.
+ */
+void SolveKeplerHyperbolic(const double* eccentricity,
+                           const double* meanAnomaly,
+                           double* hyperbolicAnomaly,
+                           std::size_t count);
+
+} // end namespace celestia::ephem
@@ -9,10 +9,10 @@
 // of the License, or (at your option) any later version.
 
 #include "orbit.h"
+#include "kepler.h"
 #include <celcompat/numbers.h>
 #include <celengine/body.h>
 #include <celmath/mathlib.h>
-#include <celmath/solve.h>
 #include <celmath/geomutil.h>
 #include <functional>
 #include <algorithm>
@@ -22,8 +22,13 @@
 using namespace Eigen;
 using namespace std;
 using namespace celmath;
+namespace ephem = celestia::ephem;
 
 
+// Number of Kepler equation solutions computed together by the batch
+// position functions
+static constexpr std::size_t KeplerBatchSize = 256;
+
 // Orbital velocity is computed by differentiation for orbits that don't
 // override velocityAtTime().
 static const double ORBITAL_VELOCITY_DIFF_DELTA = 1.0 / 1440.0;
@@ -198,79 +203,12 @@ EllipticalOrbit::EllipticalOrbit(double _pericenterDistance,
 }
 
 
-// Standard iteration for solving Kepler's Equation
-struct SolveKeplerFunc1
-{
-    double ecc;
-    double M;
-
-    SolveKeplerFunc1(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-    double operator()(double x) const
-    {
-        return M + ecc * sin(x);
-    }
-};
-
-
-// Faster converging iteration for Kepler's Equation; more efficient
-// than above for orbits with eccentricities greater than 0.3.  This
-// is from Jean Meeus's _Astronomical Algorithms_ (2nd ed), p. 199
-struct SolveKeplerFunc2
-{
-    double ecc;
-    double M;
-
-    SolveKeplerFunc2(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-    double operator()(double x) const
-    {
-        return x + (M + ecc * sin(x) - x) / (1 - ecc * cos(x));
-    }
-};
-
-
-struct SolveKeplerLaguerreConway
+void Orbit::positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const
 {
-    double ecc;
-    double M;
-
-    SolveKeplerLaguerreConway(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-    double operator()(double x) const
-    {
-        double s = ecc * sin(x);
-        double c = ecc * cos(x);
-        double f = x - s - M;
-        double f1 = 1 - c;
-        double f2 = s;
-        x += -5 * f / (f1 + sign(f1) * sqrt(abs(16 * f1 * f1 - 20 * f * f2)));
-
-        return x;
-    }
-};
-
-struct SolveKeplerLaguerreConwayHyp
-{
-    double ecc;
-    double M;
-
-    SolveKeplerLaguerreConwayHyp(double _ecc, double _M) : ecc(_ecc), M(_M) {};
-
-    double operator()(double x) const
-    {
-        double s = ecc * sinh(x);
-        double c = ecc * cosh(x);
-        double f = s - x - M;
-        double f1 = c - 1;
-        double f2 = s;
-        x += -5 * f / (f1 + sign(f1) * sqrt(abs(16 * f1 * f1 - 20 * f * f2)));
-
-        return x;
-    }
-};
-
-typedef pair<double, double> Solution;
+    assert(positions.size() == times.size());
+    for (std::size_t i = 0; i < times.size(); i++)
+        positions[i] = positionAtTime(times[i]);
+}
 
 
 Vector3d Orbit::velocityAtTime(double tdb) const
@@ -283,49 +221,14 @@ Vector3d Orbit::velocityAtTime(double tdb) const
 
 double EllipticalOrbit::eccentricAnomaly(double M) const
 {
-    if (eccentricity == 0.0)
-    {
-        // Circular orbit
-        return M;
-    }
-    if (eccentricity < 0.2)
-    {
-        // Low eccentricity, so use the standard iteration technique
-        Solution sol = solve_iteration_fixed(SolveKeplerFunc1(eccentricity, M), M, 5);
-        return sol.first;
-    }
-    else if (eccentricity < 0.9)
-    {
-        // Higher eccentricity elliptical orbit; use a more complex but
-        // much faster converging iteration.
-        Solution sol = solve_iteration_fixed(SolveKeplerFunc2(eccentricity, M), M, 6);
-        // Debugging
-        // GetLogger()->debug("ecc: {}, error: {} mas\n",
-        //        eccentricity, radToDeg(sol.second) * 3600000);
-        return sol.first;
-    }
-    else if (eccentricity < 1.0)
-    {
-        // Extremely stable Laguerre-Conway method for solving Kepler's
-        // equation.  Only use this for high-eccentricity orbits, as it
-        // requires more calcuation.
-        double E = M + 0.85 * eccentricity * sign(sin(M));
-        Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConway(eccentricity, M), E, 8);
-        return sol.first;
-    }
-    else if (eccentricity == 1.0)
-    {
-        // Nearly parabolic orbit; very common for comets
-        // TODO: handle this
-        return M;
-    }
-    else
-    {
-        // Laguerre-Conway method for hyperbolic (ecc > 1) orbits.
-        double E = log(2 * M / eccentricity + 1.85);
-        Solution sol = solve_iteration_fixed(SolveKeplerLaguerreConwayHyp(eccentricity, M), E, 30);
-        return sol.first;
-    }
+    double E = M;
+    if (eccentricity < 1.0)
+        ephem::SolveKeplerElliptical(&eccentricity, &M, &E, 1);
+    else if (eccentricity > 1.0)
+        ephem::SolveKeplerHyperbolic(&eccentricity, &M, &E, 1);
+
+    // TODO: handle nearly parabolic orbits, which are very common for comets
+    return E;
 }
 
 
@@ -337,9 +240,7 @@ Vector3d EllipticalOrbit::positionAtE(double E) const
 
     if (eccentricity < 1.0)
     {
-        double a = pericenterDistance / (1.0 - eccentricity);
-        x = a * (cos(E) - eccentricity);
-        y = a * sqrt(1 - square(eccentricity)) * sin(E);
+        return positionAtE(sin(E), cos(E));
     }
     else if (eccentricity > 1.0)
     {
@@ -361,6 +262,21 @@ Vector3d EllipticalOrbit::positionAtE(double E) const
 }
 
 
+// Compute the position on an elliptical orbit from the sine and cosine of
+// the eccentric anomaly.
+Vector3d EllipticalOrbit::positionAtE(double sinE, double cosE) const
+{
+    double a = pericenterDistance / (1.0 - eccentricity);
+    double x = a * (cosE - eccentricity);
+    double y = a * sqrt(1 - square(eccentricity)) * sinE;
+
+    Vector3d p = orbitPlaneRotation * Vector3d(x, y, 0);
+
+    // Convert to Celestia's internal coordinate system
+    return Vector3d(p.x(), p.z(), -p.y());
+}
+
+
 // Compute the velocity at the specified eccentric
 // anomaly E.
 Vector3d EllipticalOrbit::velocityAtE(double E) const
@@ -412,6 +328,135 @@ Vector3d EllipticalOrbit::positionAtTime(double t) const
 }
 
 
+// Batch version of positionAtTime(); the quantities that don't depend on
+// time are computed once for all times.
+void EllipticalOrbit::positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const
+{
+    assert(positions.size() == times.size());
+    if (eccentricity == 1.0)
+    {
+        // TODO: Handle parabolic orbits
+        std::fill(positions.begin(), positions.end(), Vector3d::Zero());
+        return;
+    }
+
+    double meanMotion = 2.0 * celestia::numbers::pi / period;
+    double a = pericenterDistance / (1.0 - eccentricity);
+    double b = a * sqrt(abs(1 - square(eccentricity)));
+
+    // Axes of the orbital plane, converted to Celestia's internal
+    // coordinate system
+    Vector3d xAxis(orbitPlaneRotation(0, 0), orbitPlaneRotation(2, 0), -orbitPlaneRotation(1, 0));
+    Vector3d yAxis(orbitPlaneRotation(0, 1), orbitPlaneRotation(2, 1), -orbitPlaneRotation(1, 1));
+
+    double e[KeplerBatchSize];
+    double M[KeplerBatchSize];
+    double E[KeplerBatchSize];
+    std::fill_n(e, KeplerBatchSize, eccentricity);
+    for (std::size_t first = 0; first < times.size(); first += KeplerBatchSize)
+    {
+        std::size_t count = std::min(times.size() - first, KeplerBatchSize);
+        for (std::size_t i = 0; i < count; i++)
+            M[i] = meanAnomalyAtEpoch + (times[first + i] - epoch) * meanMotion;
+
+        if (eccentricity < 1.0)
+        {
+            ephem::SolveKeplerElliptical(e, M, E, count);
+            for (std::size_t i = 0; i < count; i++)
+                positions[first + i] = xAxis * (a * (cos(E[i]) - eccentricity)) + yAxis * (b * sin(E[i]));
+        }
+        else
+        {
+            ephem::SolveKeplerHyperbolic(e, M, E, count);
+            for (std::size_t i = 0; i < count; i++)
+                positions[first + i] = xAxis * (-a * (eccentricity - cosh(E[i]))) + yAxis * (-b * sinh(E[i]));
+        }
+    }
+}
+
+
+/*! Compute the positions of many orbits at time t, solving Kepler's
+ *  equation for batches of orbits at once.
+ *
+ *  positions receives the position of each orbit. If states is not empty,
+ *  it holds a propagation state for each orbit, which must be used only
+ *  with that orbit. Elliptical orbits are then advanced from the time of
+ *  their previous evaluation where that is cheaper than solving Kepler's
+ *  equation; see AdvanceKeplerElliptical().
+ */
+void EllipticalOrbit::positionsAtTime(celestia::util::array_view<const EllipticalOrbit*> orbits,
+                                      double t,
+                                      celestia::util::array_span<Vector3d> positions,
+                                      celestia::util::array_span<ephem::KeplerState> states)
+{
+    assert(positions.size() == orbits.size());
+    assert(states.empty() || states.size() == orbits.size());
+
+    // Elliptical and hyperbolic orbits are gathered into separate batches;
+    // index holds the position of each batch entry in orbits.
+    struct Batch
+    {
+        double e[KeplerBatchSize];
+        double M[KeplerBatchSize];
+        double E[KeplerBatchSize];
+        ephem::KeplerState state[KeplerBatchSize];
+        std::size_t index[KeplerBatchSize];
+        std::size_t count{ 0 };
+    };
+
+    Batch elliptical;
+    Batch hyperbolic;
+
+    auto flush = [&](Batch& batch, bool isElliptical)
+    {
+        if (isElliptical && !states.empty())
+        {
+            for (std::size_t i = 0; i < batch.count; i++)
+                batch.state[i] = states[batch.index[i]];
+            ephem::AdvanceKeplerElliptical(batch.e, batch.M, batch.state, batch.count);
+            for (std::size_t i = 0; i < batch.count; i++)
+            {
+                const ephem::KeplerState& state = batch.state[i];
+                states[batch.index[i]] = state;
+                positions[batch.index[i]] = orbits[batch.index[i]]->positionAtE(state.sinE, state.cosE);
+            }
+        }
+        else
+        {
+            if (isElliptical)
+                ephem::SolveKeplerElliptical(batch.e, batch.M, batch.E, batch.count);
+            else
+                ephem::SolveKeplerHyperbolic(batch.e, batch.M, batch.E, batch.count);
+            for (std::size_t i = 0; i < batch.count; i++)
+                positions[batch.index[i]] = orbits[batch.index[i]]->positionAtE(batch.E[i]);
+        }
+        batch.count = 0;
+    };
+
+    for (std::size_t i = 0; i < orbits.size(); i++)
+    {
+        const EllipticalOrbit& orbit = *orbits[i];
+        double M = orbit.meanAnomalyAtEpoch + (t - orbit.epoch) * (2.0 * celestia::numbers::pi / orbit.period);
+        if (orbit.eccentricity == 1.0)
+        {
+            positions[i] = orbit.positionAtE(M);
+            continue;
+        }
+
+        bool isElliptical = orbit.eccentricity < 1.0;
+        Batch& batch = isElliptical ? elliptical : hyperbolic;
+        batch.e[batch.count] = orbit.eccentricity;
+        batch.M[batch.count] = M;
+        batch.index[batch.count] = i;
+        if (++batch.count == KeplerBatchSize)
+            flush(batch, isElliptical);
+    }
+
+    flush(elliptical, true);
+    flush(hyperbolic, false);
+}
+
+
 Vector3d EllipticalOrbit::velocityAtTime(double t) const
 {
     t = t - epoch;
@@ -436,6 +481,17 @@ double EllipticalOrbit::getBoundingRadius() const
 }
 
 
+double EllipticalOrbit::getMaximumSpeed() const
+{
+    if (eccentricity >= 1.0)
+        return std::numeric_limits<double>::infinity();
+
+    // Speed at pericenter, from the vis-viva equation
+    double semiMajorAxis = pericenterDistance / (1.0 - eccentricity);
+    return 2.0 * celestia::numbers::pi * semiMajorAxis / period * std::sqrt((1.0 + eccentricity) / (1.0 - eccentricity));
+}
+
+
 Vector3d CachingOrbit::positionAtTime(double jd) const
 {
     if (jd != lastTime)
@@ -474,6 +530,14 @@ Vector3d CachingOrbit::velocityAtTime(double jd) const
 }
 
 
+void CachingOrbit::positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const
+{
+    assert(positions.size() == times.size());
+    for (std::size_t i = 0; i < times.size(); i++)
+        positions[i] = computePosition(times[i]);
+}
+
+
 /*! Calculate the velocity at the specified time (units are
  *  kilometers / Julian day.) The default implementation just
  *  differentiates the position.
@@ -596,6 +660,37 @@ Vector3d MixedOrbit::positionAtTime(double jd) const
 }
 
 
+const Orbit* MixedOrbit::orbitAtTime(double jd) const
+{
+    if (jd < begin)
+        return beforeApprox;
+    else if (jd < end)
+        return primary;
+    else
+        return afterApprox;
+}
+
+
+void MixedOrbit::positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const
+{
+    assert(positions.size() == times.size());
+
+    // Pass each run of times covered by the same orbit on to it together
+    std::size_t first = 0;
+    while (first < times.size())
+    {
+        const Orbit* orbit = orbitAtTime(times[first]);
+        std::size_t last = first + 1;
+        while (last < times.size() && orbitAtTime(times[last]) == orbit)
+            last++;
+
+        orbit->positionsAtTimes(celestia::util::array_view<double>(times.data() + first, last - first),
+                                positions.subspan(first, last - first));
+        first = last;
+    }
+}
+
+
 Vector3d MixedOrbit::velocityAtTime(double jd) const
 {
     if (jd < begin)
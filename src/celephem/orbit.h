@@ -10,11 +10,21 @@
 #ifndef _CELENGINE_ORBIT_H_
 #define _CELENGINE_ORBIT_H_
 
+#include <limits>
+
 #include <Eigen/Core>
 
+#include <celutil/array_span.h>
+#include <celutil/array_view.h>
+
 
 class OrbitSampleProc;
 
+namespace celestia::ephem
+{
+struct KeplerState;
+}
+
 class Orbit
 {
  public:
@@ -25,6 +35,15 @@ class Orbit
      */
     virtual Eigen::Vector3d positionAtTime(double jd) const = 0;
 
+    /*! Compute the positions at each of a list of times (TDB), storing
+     * them in positions, which must have the same size as times.
+     * The results are the same as those of positionAtTime(), but orbits
+     * may override this to share work between times. Evaluation is fastest
+     * when the times are in increasing order.
+     */
+    virtual void positionsAtTimes(celestia::util::array_view<double> times,
+                                  celestia::util::array_span<Eigen::Vector3d> positions) const;
+
     /*! Return the orbital velocity in the orbit's reference frame at the
      * specified time (TDB). Units are kilometers per day. If the method
      * is not overridden, the velocity will be computed by differentiation
@@ -35,6 +54,11 @@ class Orbit
     virtual double getPeriod() const = 0;
     virtual double getBoundingRadius() const = 0;
 
+    /*! Return an upper bound on the speed in the orbit's reference frame,
+     * in kilometers per day, or infinity if none is known.
+     */
+    virtual double getMaximumSpeed() const { return std::numeric_limits<double>::infinity(); };
+
     virtual void sample(double startTime, double endTime, OrbitSampleProc& proc) const;
 
     virtual bool isPeriodic() const { return true; };
@@ -65,13 +89,21 @@ class EllipticalOrbit : public Orbit
 
     // Compute the orbit for a specified Julian date
     virtual Eigen::Vector3d positionAtTime(double) const;
+    void positionsAtTimes(celestia::util::array_view<double>, celestia::util::array_span<Eigen::Vector3d>) const override;
     virtual Eigen::Vector3d velocityAtTime(double) const;
     double getPeriod() const;
+
+    static void positionsAtTime(celestia::util::array_view<const EllipticalOrbit*> orbits,
+                                double t,
+                                celestia::util::array_span<Eigen::Vector3d> positions,
+                                celestia::util::array_span<celestia::ephem::KeplerState> states = {});
     double getBoundingRadius() const;
+    double getMaximumSpeed() const override;
 
  private:
     double eccentricAnomaly(double) const;
     Eigen::Vector3d positionAtE(double) const;
+    Eigen::Vector3d positionAtE(double sinE, double cosE) const;
     Eigen::Vector3d velocityAtE(double) const;
 
     double pericenterDistance;
@@ -120,6 +152,10 @@ class CachingOrbit : public Orbit
     Eigen::Vector3d positionAtTime(double jd) const;
     Eigen::Vector3d velocityAtTime(double jd) const;
 
+    // Evaluates computePosition() without disturbing the cached position
+    void positionsAtTimes(celestia::util::array_view<double> times,
+                          celestia::util::array_span<Eigen::Vector3d> positions) const override;
+
  private:
     mutable Eigen::Vector3d lastPosition;
     mutable Eigen::Vector3d lastVelocity;
@@ -142,12 +178,15 @@ class MixedOrbit : public Orbit
     virtual ~MixedOrbit();
 
     virtual Eigen::Vector3d positionAtTime(double jd) const;
+    void positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Eigen::Vector3d> positions) const override;
     virtual Eigen::Vector3d velocityAtTime(double jd) const;
     virtual double getPeriod() const;
     virtual double getBoundingRadius() const;
     virtual void sample(double startTime, double endTime, OrbitSampleProc& proc) const;
 
  private:
+    const Orbit* orbitAtTime(double jd) const;
+
     Orbit* primary;
     EllipticalOrbit* afterApprox;
     EllipticalOrbit* beforeApprox;
@@ -196,6 +235,7 @@ class FixedOrbit : public Orbit
     virtual double getPeriod() const;
     virtual bool isPeriodic() const;
     virtual double getBoundingRadius() const;
+    double getMaximumSpeed() const override { return 0.0; };
     virtual void sample(double, double, OrbitSampleProc&) const;
 
  private:
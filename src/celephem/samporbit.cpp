@@ -18,6 +18,7 @@
 #include <celutil/bytes.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <cassert>
 #include <cmath>
 #include <string>
 #include <algorithm>
@@ -79,6 +80,7 @@ public:
     double getBoundingRadius() const override;
     Vector3d computePosition(double jd) const override;
     Vector3d computeVelocity(double jd) const override;
+    void positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const override;
 
     bool isPeriodic() const override;
     void getValidRange(double& begin, double& end) const override;
@@ -86,6 +88,9 @@ public:
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
 
 private:
+    int findSample(double jd) const;
+    Vector3d interpolatePosition(int n, double jd) const;
+
     vector<Sample<T> > samples;
     double boundingRadius;
     double period;
@@ -163,125 +168,161 @@ static Vector3d cubicInterpolateVelocity(const Vector3d& p0, const Vector3d& v0,
 }
 
 
-template <typename T> Vector3d SampledOrbit<T>::computePosition(double jd) const
+template <typename T> int SampledOrbit<T>::findSample(double jd) const
+{
+    Sample<T> samp;
+    samp.t = jd;
+    auto iter = lower_bound(samples.begin(), samples.end(), samp);
+    return (int) (iter - samples.begin());
+}
+
+
+// Interpolate the position at time jd, where n is the index of the first
+// sample not earlier than jd. There must be at least two samples.
+template <typename T> Vector3d SampledOrbit<T>::interpolatePosition(int n, double jd) const
 {
     Vector3d pos;
-    if (samples.size() == 0)
-    {
-        pos = Vector3d::Zero();
-    }
-    else if (samples.size() == 1)
+    if (n == 0)
     {
-        pos = Vector3d(samples[0].x, samples[0].y, samples[0].z);
+        pos = Vector3d(samples[n].x, samples[n].y, samples[n].z);
     }
-    else
+    else if (n < (int) samples.size())
     {
-        Sample<T> samp;
-        samp.t = jd;
-        int n = lastSample;
-
-        if (n < 1 || n >= (int) samples.size() || jd < samples[n - 1].t || jd > samples[n].t)
+        if (interpolation == TrajectoryInterpolationLinear)
         {
-            typename vector<Sample<T> >::const_iterator iter = lower_bound(samples.begin(),
-                                                                           samples.end(),
-                                                                           samp);
-            if (iter == samples.end())
-                n = samples.size();
-            else
-                n = iter - samples.begin();
+            Sample<T> s0 = samples[n - 1];
+            Sample<T> s1 = samples[n];
 
-            lastSample = n;
+            double t = (jd - s0.t) / (s1.t - s0.t);
+            pos = Vector3d(lerp(t, (double) s0.x, (double) s1.x),
+                           lerp(t, (double) s0.y, (double) s1.y),
+                           lerp(t, (double) s0.z, (double) s1.z));
         }
-
-        if (n == 0)
+        else if (interpolation == TrajectoryInterpolationCubic)
         {
-            pos = Vector3d(samples[n].x, samples[n].y, samples[n].z);
-        }
-        else if (n < (int) samples.size())
-        {
-            if (interpolation == TrajectoryInterpolationLinear)
+            Sample<T> s0, s1, s2, s3;
+            if (n > 1)
+                s0 = samples[n - 2];
+            else
+                s0 = samples[n - 1];
+            s1 = samples[n - 1];
+            s2 = samples[n];
+            if (n < (int) samples.size() - 1)
+                s3 = samples[n + 1];
+            else
+                s3 = samples[n];
+
+            double h = s2.t - s1.t;
+            double ih = 1.0 / h;
+            double t = (jd - s1.t) * ih;
+            Vector3d p0(s1.x, s1.y, s1.z);
+            Vector3d p1(s2.x, s2.y, s2.z);
+
+            Vector3d v10((double) s1.x - (double) s0.x,
+                         (double) s1.y - (double) s0.y,
+                         (double) s1.z - (double) s0.z);
+            Vector3d v21((double) s2.x - (double) s1.x,
+                         (double) s2.y - (double) s1.y,
+                         (double) s2.z - (double) s1.z);
+            Vector3d v32((double) s3.x - (double) s2.x,
+                         (double) s3.y - (double) s2.y,
+                         (double) s3.z - (double) s2.z);
+
+            // Estimate velocities by averaging the differences at adjacent spans
+            // (except at the end spans, where we just use a single velocity.)
+            Vector3d v0;
+            if (n > 1)
             {
-                Sample<T> s0 = samples[n - 1];
-                Sample<T> s1 = samples[n];
-
-                double t = (jd - s0.t) / (s1.t - s0.t);
-                pos = Vector3d(lerp(t, (double) s0.x, (double) s1.x),
-                               lerp(t, (double) s0.y, (double) s1.y),
-                               lerp(t, (double) s0.z, (double) s1.z));
+                v0 = v10 * (0.5 / (s1.t - s0.t)) + v21 * (0.5 * ih);
+                v0 *= h;
             }
-            else if (interpolation == TrajectoryInterpolationCubic)
+            else
             {
-                Sample<T> s0, s1, s2, s3;
-                if (n > 1)
-                    s0 = samples[n - 2];
-                else
-                    s0 = samples[n - 1];
-                s1 = samples[n - 1];
-                s2 = samples[n];
-                if (n < (int) samples.size() - 1)
-                    s3 = samples[n + 1];
-                else
-                    s3 = samples[n];
-
-                double h = s2.t - s1.t;
-                double ih = 1.0 / h;
-                double t = (jd - s1.t) * ih;
-                Vector3d p0(s1.x, s1.y, s1.z);
-                Vector3d p1(s2.x, s2.y, s2.z);
-
-                Vector3d v10((double) s1.x - (double) s0.x,
-                             (double) s1.y - (double) s0.y,
-                             (double) s1.z - (double) s0.z);
-                Vector3d v21((double) s2.x - (double) s1.x,
-                             (double) s2.y - (double) s1.y,
-                             (double) s2.z - (double) s1.z);
-                Vector3d v32((double) s3.x - (double) s2.x,
-                             (double) s3.y - (double) s2.y,
-                             (double) s3.z - (double) s2.z);
-
-                // Estimate velocities by averaging the differences at adjacent spans
-                // (except at the end spans, where we just use a single velocity.)
-                Vector3d v0;
-                if (n > 1)
-                {
-                    v0 = v10 * (0.5 / (s1.t - s0.t)) + v21 * (0.5 * ih);
-                    v0 *= h;
-                }
-                else
-                {
-                    v0 = v21;
-                }
-
-                Vector3d v1;
-                if (n < (int) samples.size() - 1)
-                {
-                    v1 = v21 * (0.5 * ih) + v32 * (0.5 / (s3.t - s2.t));
-                    v1 *= h;
-                }
-                else
-                {
-                    v1 = v21;
-                }
+                v0 = v21;
+            }
 
-                pos = cubicInterpolate(p0, v0, p1, v1, t);
+            Vector3d v1;
+            if (n < (int) samples.size() - 1)
+            {
+                v1 = v21 * (0.5 * ih) + v32 * (0.5 / (s3.t - s2.t));
+                v1 *= h;
             }
             else
             {
-                // Unknown interpolation type
-                pos = Vector3d::Zero();
+                v1 = v21;
             }
+
+            pos = cubicInterpolate(p0, v0, p1, v1, t);
         }
         else
         {
-            pos = Vector3d(samples[n - 1].x, samples[n - 1].y, samples[n - 1].z);
+            // Unknown interpolation type
+            pos = Vector3d::Zero();
         }
     }
+    else
+    {
+        pos = Vector3d(samples[n - 1].x, samples[n - 1].y, samples[n - 1].z);
+    }
 
     // Add correction for Celestia's coordinate system
     return Vector3d(pos.x(), pos.z(), -pos.y());
 }
 
 
+template <typename T> Vector3d SampledOrbit<T>::computePosition(double jd) const
+{
+    if (samples.size() == 0)
+        return Vector3d::Zero();
+
+    if (samples.size() == 1)
+        return Vector3d(samples[0].x, samples[0].z, -samples[0].y);
+
+    int n = lastSample;
+    if (n < 1 || n >= (int) samples.size() || jd < samples[n - 1].t || jd > samples[n].t)
+    {
+        n = findSample(jd);
+        lastSample = n;
+    }
+
+    return interpolatePosition(n, jd);
+}
+
+
+// For times in increasing order, the sample following each time is found
+// by advancing from the one found for the previous time.
+template <typename T> void SampledOrbit<T>::positionsAtTimes(celestia::util::array_view<double> times,
+                                                             celestia::util::array_span<Vector3d> positions) const
+{
+    assert(positions.size() == times.size());
+    if (samples.size() < 2)
+    {
+        for (std::size_t i = 0; i < times.size(); i++)
+            positions[i] = computePosition(times[i]);
+        return;
+    }
+
+    int n = -1;
+    double lastTime = 0.0;
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        double jd = times[i];
+        if (n < 0 || jd < lastTime)
+        {
+            n = findSample(jd);
+        }
+        else
+        {
+            while (n < (int) samples.size() && samples[n].t < jd)
+                n++;
+        }
+
+        lastTime = jd;
+        positions[i] = interpolatePosition(n, jd);
+    }
+}
+
+
 template <typename T> Vector3d SampledOrbit<T>::computeVelocity(double jd) const
 {
     Vector3d vel;
@@ -444,6 +485,7 @@ public:
     double getBoundingRadius() const override;
     Vector3d computePosition(double jd) const override;
     Vector3d computeVelocity(double jd) const override;
+    void positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const override;
 
     bool isPeriodic() const override;
     void getValidRange(double& begin, double& end) const override;
@@ -451,6 +493,9 @@ public:
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
 
 private:
+    int findSample(double jd) const;
+    Vector3d interpolatePosition(int n, double jd) const;
+
     vector<SampleXYZV<T> > samples;
     double boundingRadius;
     double period;
@@ -515,79 +560,116 @@ template <typename T> double SampledOrbitXYZV<T>::getBoundingRadius() const
 }
 
 
-template <typename T> Vector3d SampledOrbitXYZV<T>::computePosition(double jd) const
+template <typename T> int SampledOrbitXYZV<T>::findSample(double jd) const
+{
+    SampleXYZV<T> samp;
+    samp.t = jd;
+    auto iter = lower_bound(samples.begin(), samples.end(), samp);
+    return (int) (iter - samples.begin());
+}
+
+
+// Interpolate the position at time jd, where n is the index of the first
+// sample not earlier than jd. There must be at least two samples.
+template <typename T> Vector3d SampledOrbitXYZV<T>::interpolatePosition(int n, double jd) const
 {
     Vector3d pos;
-    if (samples.size() == 0)
+    if (n == 0)
     {
-        pos = Vector3d::Zero();
+        pos = Vector3d(samples[n].position.x(), samples[n].position.y(), samples[n].position.z());
     }
-    else if (samples.size() == 1)
+    else if (n < (int) samples.size())
     {
-        pos = Vector3d(samples[0].position.x(), samples[1].position.y(), samples[2].position.z());
-    }
-    else
-    {
-        SampleXYZV<T> samp;
-        samp.t = jd;
-        int n = lastSample;
+        SampleXYZV<T> s0 = samples[n - 1];
+        SampleXYZV<T> s1 = samples[n];
 
-        if (n < 1 || n >= (int) samples.size() || jd < samples[n - 1].t || jd > samples[n].t)
+        if (interpolation == TrajectoryInterpolationLinear)
         {
-            typename vector<SampleXYZV<T> >::const_iterator iter = lower_bound(samples.begin(),
-                                                                               samples.end(),
-                                                                               samp);
-            if (iter == samples.end())
-                n = samples.size();
-            else
-                n = iter - samples.begin();
+            double t = (jd - s0.t) / (s1.t - s0.t);
 
-            lastSample = n;
+            Vector3d p0(s0.position.x(), s0.position.y(), s0.position.z());
+            Vector3d p1(s1.position.x(), s1.position.y(), s1.position.z());
+            pos = p0 + t * (p1 - p0);
         }
-
-        if (n == 0)
+        else if (interpolation == TrajectoryInterpolationCubic)
         {
-            pos = Vector3d(samples[n].position.x(), samples[n].position.y(), samples[n].position.z());
+            double h = s1.t - s0.t;
+            double ih = 1.0 / h;
+            double t = (jd - s0.t) * ih;
+
+            Vector3d p0(s0.position.x(), s0.position.y(), s0.position.z());
+            Vector3d v0(s0.velocity.x(), s0.velocity.y(), s0.velocity.z());
+            Vector3d p1(s1.position.x(), s1.position.y(), s1.position.z());
+            Vector3d v1(s1.velocity.x(), s1.velocity.y(), s1.velocity.z());
+            pos = cubicInterpolate(p0, v0 * h, p1, v1 * h, t);
         }
-        else if (n < (int) samples.size())
+        else
         {
-            SampleXYZV<T> s0 = samples[n - 1];
-            SampleXYZV<T> s1 = samples[n];
+            // Unknown interpolation type
+            pos = Vector3d::Zero();
+        }
+    }
+    else
+    {
+        pos = Vector3d(samples[n - 1].position.x(), samples[n - 1].position.y(), samples[n - 1].position.z());
+    }
 
-            if (interpolation == TrajectoryInterpolationLinear)
-            {
-                double t = (jd - s0.t) / (s1.t - s0.t);
+    // Add correction for Celestia's coordinate system
+    return Vector3d(pos.x(), pos.z(), -pos.y());
+}
 
-                Vector3d p0(s0.position.x(), s0.position.y(), s0.position.z());
-                Vector3d p1(s1.position.x(), s1.position.y(), s1.position.z());
-                pos = p0 + t * (p1 - p0);
-            }
-            else if (interpolation == TrajectoryInterpolationCubic)
-            {
-                double h = s1.t - s0.t;
-                double ih = 1.0 / h;
-                double t = (jd - s0.t) * ih;
 
-                Vector3d p0(s0.position.x(), s0.position.y(), s0.position.z());
-                Vector3d v0(s0.velocity.x(), s0.velocity.y(), s0.velocity.z());
-                Vector3d p1(s1.position.x(), s1.position.y(), s1.position.z());
-                Vector3d v1(s1.velocity.x(), s1.velocity.y(), s1.velocity.z());
-                pos = cubicInterpolate(p0, v0 * h, p1, v1 * h, t);
-            }
-            else
-            {
-                // Unknown interpolation type
-                pos = Vector3d::Zero();
-            }
+template <typename T> Vector3d SampledOrbitXYZV<T>::computePosition(double jd) const
+{
+    if (samples.size() == 0)
+        return Vector3d::Zero();
+
+    if (samples.size() == 1)
+    {
+        const auto& p = samples[0].position;
+        return Vector3d(p.x(), p.z(), -p.y());
+    }
+
+    int n = lastSample;
+    if (n < 1 || n >= (int) samples.size() || jd < samples[n - 1].t || jd > samples[n].t)
+    {
+        n = findSample(jd);
+        lastSample = n;
+    }
+
+    return interpolatePosition(n, jd);
+}
+
+
+template <typename T> void SampledOrbitXYZV<T>::positionsAtTimes(celestia::util::array_view<double> times,
+                                                                 celestia::util::array_span<Vector3d> positions) const
+{
+    assert(positions.size() == times.size());
+    if (samples.size() < 2)
+    {
+        for (std::size_t i = 0; i < times.size(); i++)
+            positions[i] = computePosition(times[i]);
+        return;
+    }
+
+    int n = -1;
+    double lastTime = 0.0;
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        double jd = times[i];
+        if (n < 0 || jd < lastTime)
+        {
+            n = findSample(jd);
         }
         else
         {
-            pos = Vector3d(samples[n - 1].position.x(), samples[n - 1].position.y(), samples[n - 1].position.z());
+            while (n < (int) samples.size() && samples[n].t < jd)
+                n++;
         }
-    }
 
-    // Add correction for Celestia's coordinate system
-    return Vector3d(pos.x(), pos.z(), -pos.y());
+        lastTime = jd;
+        positions[i] = interpolatePosition(n, jd);
+    }
 }
 
 
@@ -12,9 +12,14 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <vector>
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
+#include <celutil/array_span.h>
+#include <celutil/array_view.h>
 #include <celengine/astro.h>
 #include "vsop87.h"
 
@@ -11012,6 +11017,142 @@ static double SumSeries(const VSOPSeries& series, double t)
     return x;
 }
 
+// Largest number of times evaluated together by SumSeries(); the error of
+// the angle addition recurrence grows with the number of steps.
+constexpr int MaxSeriesTimes = 64;
+
+// Times further than this from an even spacing (in Julian millenia) aren't
+// evaluated together.
+constexpr double MaxSpacingError = 1.0e-13;
+
+
+// Return the number of times starting at t, up to MaxSeriesTimes, that
+// are evenly spaced.
+static int EvenlySpacedCount(const double* t, size_t count)
+{
+    int n = (int) min(count, (size_t) MaxSeriesTimes);
+    if (n <= 2)
+        return n;
+
+    double dt = t[1] - t[0];
+    for (int k = 2; k < n; k++)
+    {
+        if (abs(t[k] - (t[0] + k * dt)) > MaxSpacingError)
+            return k;
+    }
+
+    return n;
+}
+
+
+// Add a series evaluated at n evenly spaced times to sums. Instead of
+// evaluating a cosine for every term and time, each term is stepped from
+// one time to the next with the angle addition formulas; the small
+// deviations of the times from an even spacing are corrected to first
+// order.
+static void SumSeries(const VSOPSeries& series, const double* t, int n, double* sums)
+{
+    double dt = n > 1 ? (t[n - 1] - t[0]) / (n - 1) : 0.0;
+    double spacingError[MaxSeriesTimes];
+    for (int k = 0; k < n; k++)
+        spacingError[k] = t[k] - (t[0] + k * dt);
+
+    const VSOPTerm* term = &series.terms[0];
+    for (int i = 0; i < series.nTerms; i++, term++)
+    {
+        double c = cos(term->B + term->C * t[0]);
+        double s = sin(term->B + term->C * t[0]);
+        double cStep = cos(term->C * dt);
+        double sStep = sin(term->C * dt);
+        for (int k = 0; k < n; k++)
+        {
+            sums[k] += term->A * (c - s * term->C * spacingError[k]);
+            double next = c * cStep - s * sStep;
+            s = s * cStep + c * sStep;
+            c = next;
+        }
+    }
+}
+
+
+// Evaluate a polynomial in t with series as coefficients at n evenly
+// spaced times.
+static void SumPolynomial(const VSOPSeries* series, int nSeries, const double* t, int n, double* sums)
+{
+    double terms[MaxSeriesTimes];
+    double T[MaxSeriesTimes];
+    fill_n(sums, n, 0.0);
+    fill_n(T, n, 1.0);
+    for (int i = 0; i < nSeries; i++)
+    {
+        fill_n(terms, n, 0.0);
+        SumSeries(series[i], t, n, terms);
+        for (int k = 0; k < n; k++)
+        {
+            sums[k] += terms[k] * T[k];
+            T[k] *= t[k];
+        }
+    }
+}
+
+
+// Evaluate positions at many times, passing the time arguments of each run
+// of evenly spaced times to evaluate.
+template<typename F> static void
+EvaluateInRuns(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions, F evaluate)
+{
+    assert(positions.size() == times.size());
+    double t[MaxSeriesTimes];
+    size_t first = 0;
+    while (first < times.size())
+    {
+        // t is Julian millenia since J2000.0
+        size_t count = min(times.size() - first, (size_t) MaxSeriesTimes);
+        for (size_t k = 0; k < count; k++)
+            t[k] = (times[first + k] - 2451545.0) / 365250.0;
+
+        int n = EvenlySpacedCount(t, count);
+        evaluate(t, n, positions.data() + first);
+        first += n;
+    }
+}
+
+
+/*! Sample an orbit at evenly spaced times over [ startTime, endTime ].
+ *  Velocities are found by differentiation as in
+ *  CachingOrbit::computeVelocity(), but with all positions evaluated in
+ *  two batches.
+ *
+ *  Only the VSOP87 orbits are sampled evenly. Elliptical orbits keep the
+ *  adaptive sampling of Orbit::sample(), where each step depends on the
+ *  positions found for the last one, and sampled trajectories pass their
+ *  own samples on without evaluating any positions.
+ */
+static void SampleEvenly(const Orbit& orbit, double startTime, double endTime, double step, OrbitSampleProc& proc)
+{
+    // The same times as for adaptive sampling with a fixed step
+    vector<double> times{ startTime };
+    for (double t = startTime; t < endTime;)
+    {
+        t += min(step, endTime - t);
+        times.push_back(t);
+    }
+
+    constexpr double dt = 1.0 / 1440.0;
+    vector<double> laterTimes(times.size());
+    for (size_t i = 0; i < times.size(); i++)
+        laterTimes[i] = times[i] + dt;
+
+    vector<Vector3d> positions(times.size());
+    vector<Vector3d> laterPositions(times.size());
+    orbit.positionsAtTimes(times, positions);
+    orbit.positionsAtTimes(laterTimes, laterPositions);
+
+    for (size_t i = 0; i < times.size(); i++)
+        proc.sample(times[i], positions[i], (laterPositions[i] - positions[i]) * (1.0 / dt));
+}
+
+
 class VSOP87Orbit : public CachingOrbit
 {
  private:
@@ -11097,25 +11238,37 @@ class VSOP87Orbit : public CachingOrbit
                         -sin(l) * sin(b) * r);
     }
 
+    void positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const override
+    {
+        EvaluateInRuns(times, positions, [this](const double* t, int n, Vector3d* p)
+        {
+            double l[MaxSeriesTimes];
+            double b[MaxSeriesTimes];
+            double r[MaxSeriesTimes];
+            SumPolynomial(vsL, nL, t, n, l);
+            SumPolynomial(vsB, nB, t, n, b);
+            SumPolynomial(vsR, nR, t, n, r);
+
+            for (int k = 0; k < n; k++)
+            {
+                double rk = r[k] * KM_PER_AU;
+                double bk = b[k] - celestia::numbers::pi / 2;
+                double lk = l[k] + celestia::numbers::pi;
+                p[k] = Vector3d(cos(lk) * sin(bk) * rk,
+                                cos(bk) * rk,
+                                -sin(lk) * sin(bk) * rk);
+            }
+        });
+    }
+
 
     /** Custom implementation of sample() for VSOP87 orbits. The default
       * implementation runs too slowly and produces too many samples.
       */
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override
     {
-        double span = getPeriod();
-
-        AdaptiveSamplingParameters samplingParams{};
-        samplingParams.tolerance = 1.0; // kilometers
-
-        // startStep, minStep, and maxStep are all set to identical values,
-        // so the adaptive sampling function actuall behaves like uniform
-        // sampling.
-        samplingParams.startStep = span / 150.0;
-        samplingParams.minStep   = samplingParams.startStep;
-        samplingParams.maxStep   = samplingParams.startStep;
-
-        adaptiveSample(startTime, endTime, proc, samplingParams);
+        // Uniform sampling, which lets all positions be evaluated in batches
+        SampleEvenly(*this, startTime, endTime, getPeriod() / 150.0, proc);
     }
 
 };
@@ -11203,6 +11356,22 @@ class VSOP87OrbitRect : public CachingOrbit
         // Corrections for internal coordinate system
         return Vector3d(v.x(), v.z(), -v.y());
     }
+
+    void positionsAtTimes(celestia::util::array_view<double> times, celestia::util::array_span<Vector3d> positions) const override
+    {
+        EvaluateInRuns(times, positions, [this](const double* t, int n, Vector3d* p)
+        {
+            double x[MaxSeriesTimes];
+            double y[MaxSeriesTimes];
+            double z[MaxSeriesTimes];
+            SumPolynomial(vsX, nX, t, n, x);
+            SumPolynomial(vsY, nY, t, n, y);
+            SumPolynomial(vsZ, nZ, t, n, z);
+
+            for (int k = 0; k < n; k++)
+                p[k] = Vector3d(x[k], z[k], -y[k]) * KM_PER_AU;
+        });
+    }
 };
 
 
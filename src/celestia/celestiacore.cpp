@@ -30,6 +30,7 @@
 #include <celephem/spiceinterface.h>
 #endif
 #include <celengine/axisarrow.h>
+#include <celengine/parsedcatalog.h>
 #include <celengine/planetgrid.h>
 #include <celengine/visibleregion.h>
 #include <celengine/framebuffer.h>
@@ -40,6 +41,7 @@
 #include <celutil/formatnum.h>
 #include <celutil/fsutils.h>
 #include <celutil/logger.h>
+#include <celutil/parallel.h>
 #include <celutil/gettext.h>
 #include <celutil/utf8.h>
 #include <celcompat/filesystem.h>
@@ -56,6 +58,8 @@
 #include <set>
 #include <celengine/rectangle.h>
 #include <celengine/mapmanager.h>
+#include <celengine/scenesnapshot.h>
+#include <celengine/shadermanager.h>
 #include <fmt/ostream.h>
 #ifdef USE_MINIAUDIO
 #include "miniaudiosession.h"
@@ -407,6 +411,12 @@ void CelestiaCore::cancelScript()
 }
 
 
+bool CelestiaCore::isScriptRunning() const
+{
+    return m_script != nullptr;
+}
+
+
 void CelestiaCore::runScript(const fs::path& filename, bool i18n)
 {
     cancelScript();
@@ -550,7 +560,7 @@ void CelestiaCore::mouseButtonUp(float x, float y, int button)
             Vector3f pickRay = renderer->getProjectionMode() == Renderer::ProjectionMode::FisheyeMode ? sim->getActiveObserver()->getPickRayFisheye(pickX, pickY) : sim->getActiveObserver()->getPickRay(pickX, pickY);
 
             Selection oldSel = sim->getSelection();
-            Selection newSel = sim->pickObject(pickRay, renderer->getRenderFlags(), pickTolerance);
+            Selection newSel = sim->pickObject(pickRay, renderer->getRenderFlags(), pickTolerance, &renderer->getSceneSnapshot());
             addToHistory();
             sim->setSelection(newSel);
             if (!oldSel.empty() && oldSel == newSel)
@@ -569,7 +579,7 @@ void CelestiaCore::mouseButtonUp(float x, float y, int button)
 
             Vector3f pickRay = renderer->getProjectionMode() == Renderer::ProjectionMode::FisheyeMode ? sim->getActiveObserver()->getPickRayFisheye(pickX, pickY) : sim->getActiveObserver()->getPickRay(pickX, pickY);
 
-            Selection sel = sim->pickObject(pickRay, renderer->getRenderFlags(), pickTolerance);
+            Selection sel = sim->pickObject(pickRay, renderer->getRenderFlags(), pickTolerance, &renderer->getSceneSnapshot());
             if (!sel.empty())
             {
                 if (contextMenuHandler != nullptr)
@@ -1962,6 +1972,14 @@ void CelestiaCore::tick()
         dt = sysTime - lastTime;
     }
 
+    tick(dt);
+}
+
+
+// Advance the application by a fixed time step dt in seconds, independent
+// of the system clock. Used by frontends rendering at a fixed frame rate.
+void CelestiaCore::tick(double dt)
+{
     // Pause script execution
     if (scriptState == ScriptPaused)
         dt = 0.0;
@@ -2144,6 +2162,10 @@ void CelestiaCore::draw()
         return;
     viewChanged = false;
 
+    // All views show the same instant, so they, the overlay and picking
+    // until the next frame share one snapshot of the solar system state.
+    renderer->getSceneSnapshot().reset(sim->getTime());
+
     // Render each view
     for (const auto view : views)
         draw(view);
@@ -3172,7 +3194,8 @@ void CelestiaCore::renderOverlay()
         {
             if (lightTravelFlag)
             {
-                Vector3d v = sim->getSelection().getPosition(sim->getTime()).offsetFromKm(sim->getObserver().getPosition());
+                Vector3d v = renderer->getSceneSnapshot().getPosition(sim->getSelection(), sim->getTime())
+                                                         .offsetFromKm(sim->getObserver().getPosition());
                 // light travel time in days
                 lt = v.norm() / (86400.0_c);
             }
@@ -3356,7 +3379,8 @@ void CelestiaCore::renderOverlay()
         overlay->moveBy(safeAreaInsets.left, height - safeAreaInsets.top - titleFont->getHeight());
 
         overlay->beginText();
-        Vector3d v = sel.getPosition(sim->getTime()).offsetFromKm(sim->getObserver().getPosition());
+        Vector3d v = renderer->getSceneSnapshot().getPosition(sel, sim->getTime())
+                                                 .offsetFromKm(sim->getObserver().getPosition());
 
         switch (sel.getType())
         {
@@ -3365,7 +3389,7 @@ void CelestiaCore::renderOverlay()
                 if (sel != lastSelection)
                 {
                     lastSelection = sel;
-                    selectionNames = sim->getUniverse()->getStarCatalog()->getStarNameList(*sel.star());
+                    sim->getUniverse()->getStarCatalog()->getStarNameList(*sel.star(), selectionNames);
                 }
 
                 overlay->setFont(titleFont);
@@ -3668,27 +3692,28 @@ class SolarSystemLoader
     {
     }
 
-    void process(const fs::path& filepath)
+    bool accept(const fs::path& filepath) const
     {
         if (DetermineFileType(filepath) != Content_CelestiaCatalog)
-            return;
+            return false;
 
         if (find(begin(skip), end(skip), filepath) != end(skip))
         {
             GetLogger()->info(_("Skipping solar system catalog: {}\n"), filepath);
-            return;
+            return false;
         }
+        return true;
+    }
+
+    void load(const fs::path& filepath, ParsedCatalog& catalog)
+    {
         GetLogger()->info(_("Loading solar system catalog: {}\n"), filepath);
         if (notifier != nullptr)
             notifier->update(filepath.filename().string());
 
-        ifstream solarSysFile(filepath, ios::in);
-        if (solarSysFile.good())
-        {
-            LoadSolarSystemObjects(solarSysFile,
-                                   *universe,
-                                   filepath.parent_path());
-        }
+        LoadSolarSystemObjects(catalog,
+                               *universe,
+                               filepath.parent_path());
     }
 };
 
@@ -3714,26 +3739,27 @@ template <class OBJDB> class CatalogLoader
     {
     }
 
-    void process(const fs::path& filepath)
+    bool accept(const fs::path& filepath) const
     {
         if (DetermineFileType(filepath) != contentType)
-            return;
+            return false;
 
         if (find(begin(skip), end(skip), filepath) != end(skip))
         {
             GetLogger()->info(_("Skipping {} catalog: {}\n"), typeDesc, filepath);
-            return;
+            return false;
         }
+        return true;
+    }
+
+    void load(const fs::path& filepath, ParsedCatalog& catalog)
+    {
         GetLogger()->info(_("Loading {} catalog: {}\n"), typeDesc, filepath);
         if (notifier != nullptr)
             notifier->update(filepath.filename().string());
 
-        ifstream catalogFile(filepath, ios::in);
-        if (catalogFile.good())
-        {
-            if (!objDB->load(catalogFile, filepath.parent_path()))
-                GetLogger()->error(_("Error reading {} catalog file: {}\n"), typeDesc, filepath);
-        }
+        if (!objDB->load(catalog, filepath.parent_path()))
+            GetLogger()->error(_("Error reading {} catalog file: {}\n"), typeDesc, filepath);
     }
 };
 
@@ -3741,6 +3767,88 @@ using StarLoader = CatalogLoader<StarDatabase>;
 using DeepSkyLoader = CatalogLoader<DSODatabase>;
 
 
+// Number of files parsed per worker thread before their results are handed
+// to the loader; bounds the memory used by parsed catalogs.
+constexpr std::size_t CatalogFilesPerThread = 4;
+
+/*! Load all catalog files accepted by the loader from the extras
+ *  directories, in sorted order within each directory. Files are read and
+ *  parsed concurrently, but the objects they define are always created one
+ *  file at a time in that order, so Modify and Replace dispositions behave
+ *  exactly as if the files were read sequentially.
+ */
+template <class LOADER>
+void loadExtrasCatalogs(LOADER& loader,
+                        const vector<fs::path>& extrasDirs,
+                        unsigned int threads)
+{
+    vector<fs::path> files;
+    for (const auto& dir : extrasDirs)
+    {
+        if (!is_valid_directory(dir))
+            continue;
+
+        vector<fs::path> entries;
+        std::error_code ec;
+        auto iter = fs::recursive_directory_iterator(dir, ec);
+        for (; iter != end(iter); iter.increment(ec))
+        {
+            if (ec)
+                continue;
+            if (!fs::is_directory(iter->path(), ec))
+                entries.push_back(iter->path());
+        }
+        std::sort(begin(entries), end(entries));
+        for (const auto& fn : entries)
+        {
+            if (loader.accept(fn))
+                files.push_back(fn);
+        }
+    }
+
+    unsigned int workers = GetWorkerCount(threads);
+    if (workers == 1)
+    {
+        for (const auto& fn : files)
+        {
+            ifstream catalogFile(fn, ios::in);
+            if (!catalogFile.good())
+                continue;
+            ParsedCatalog catalog(catalogFile);
+            loader.load(fn, catalog);
+        }
+        return;
+    }
+
+    std::size_t batchSize = workers * CatalogFilesPerThread;
+    vector<unique_ptr<ParsedCatalog>> catalogs;
+    for (std::size_t first = 0; first < files.size(); first += batchSize)
+    {
+        std::size_t count = std::min(batchSize, files.size() - first);
+        catalogs.clear();
+        catalogs.resize(count);
+        ParallelFor(count, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                ifstream catalogFile(files[first + i], ios::in);
+                if (!catalogFile.good())
+                    continue;
+                catalogs[i] = make_unique<ParsedCatalog>(catalogFile);
+            }
+        }, workers);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (catalogs[i] == nullptr)
+                continue;
+            loader.load(files[first + i], *catalogs[i]);
+            catalogs[i].reset();
+        }
+    }
+}
+
+
 bool CelestiaCore::initSimulation(const fs::path& configFileName,
                                   const vector<fs::path>& extrasDirs,
                                   ProgressNotifier* progressNotifier)
@@ -3852,30 +3960,11 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
 
     // Next, read all the deep sky files in the extras directories
     {
-        vector<fs::path> entries;
         DeepSkyLoader loader(dsoDB, "deep sky object",
                              Content_CelestiaDeepSkyCatalog,
                              progressNotifier,
                              config->skipExtras);
-        for (const auto& dir : config->extrasDirs)
-        {
-            if (!is_valid_directory(dir))
-                continue;
-
-            entries.clear();
-            std::error_code ec;
-            auto iter = fs::recursive_directory_iterator(dir, ec);
-            for (; iter != end(iter); iter.increment(ec))
-            {
-                if (ec)
-                    continue;
-                if (!fs::is_directory(iter->path(), ec))
-                    entries.push_back(iter->path());
-            }
-            std::sort(begin(entries), end(entries));
-            for (const auto& fn : entries)
-                loader.process(fn);
-        }
+        loadExtrasCatalogs(loader, config->extrasDirs, config->catalogLoaderThreads);
     }
     dsoDB->finish();
     universe->setDSOCatalog(dsoDB);
@@ -3906,27 +3995,8 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
 
     // Next, read all the solar system files in the extras directories
     {
-        vector<fs::path> entries;
         SolarSystemLoader loader(universe, progressNotifier, config->skipExtras);
-        for (const auto& dir : config->extrasDirs)
-        {
-            if (!is_valid_directory(dir))
-                continue;
-
-            entries.clear();
-            std::error_code ec;
-            auto iter = fs::recursive_directory_iterator(dir, ec);
-            for (; iter != end(iter); iter.increment(ec))
-            {
-                if (ec)
-                    continue;
-                if (!fs::is_directory(iter->path(), ec))
-                    entries.push_back(iter->path());
-            }
-            sort(begin(entries), end(entries));
-            for(const auto& fn : entries)
-                loader.process(fn);
-        }
+        loadExtrasCatalogs(loader, config->extrasDirs, config->catalogLoaderThreads);
     }
 
     // Load asterisms:
@@ -4089,12 +4159,22 @@ bool CelestiaCore::initRenderer()
         return false;
     }
 
+    renderer->getSceneSnapshot().setIncrementalOrbits(config->incrementalOrbits);
+
     if ((renderer->getRenderFlags() & Renderer::ShowAutoMag) != 0)
     {
         renderer->setFaintestAM45deg(renderer->getFaintestAM45deg());
         setFaintestAutoMag();
     }
 
+    if (!config->cacheDirectory.empty())
+    {
+        SetGlyphCacheDirectory(config->cacheDirectory / "glyphs");
+        renderer->getShaderManager().setCacheDirectory(config->cacheDirectory / "shaders");
+        renderer->getShaderManager().warmUp();
+        m_legacyPlugin->setCacheDirectory(config->cacheDirectory / "scripts");
+    }
+
     if (config->mainFont.empty())
         font = LoadTextureFont(renderer, "fonts/DejaVuSans.ttf,12");
     else
@@ -4213,31 +4293,12 @@ bool CelestiaCore::readStars(const CelestiaConfig& cfg,
 
     // Now, read supplemental star files from the extras directories
     {
-        vector<fs::path> entries;
         StarLoader loader(starDB,
                           "star",
                           Content_CelestiaStarCatalog,
                           progressNotifier,
                           config->skipExtras);
-        for (const auto& dir : config->extrasDirs)
-        {
-            if (!is_valid_directory(dir))
-                continue;
-
-            entries.clear();
-            std::error_code ec;
-            auto iter = fs::recursive_directory_iterator(dir, ec);
-            for (; iter != end(iter); iter.increment(ec))
-            {
-                if (ec)
-                    continue;
-                if (!fs::is_directory(iter->path(), ec))
-                    entries.push_back(iter->path());
-            }
-            std::sort(begin(entries), end(entries));
-            for (const auto& fn : entries)
-                loader.process(fn);
-        }
+        loadExtrasCatalogs(loader, config->extrasDirs, config->catalogLoaderThreads);
     }
 
     starDB->finish();
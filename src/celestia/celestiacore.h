@@ -243,6 +243,7 @@ class CelestiaCore // : public Watchable<CelestiaCore>
     void draw();
     void draw(View*);
     void tick();
+    void tick(double dt);
 
     Simulation* getSimulation() const;
     Renderer* getRenderer() const;
@@ -284,6 +285,7 @@ class CelestiaCore // : public Watchable<CelestiaCore>
     void runScript(const fs::path& filename, bool i18n = true);
     void cancelScript();
     void resumeScript();
+    bool isScriptRunning() const;
 
     int getHudDetail();
     void setHudDetail(int);
@@ -73,6 +73,8 @@ CelestiaConfig* ReadCelestiaConfig(const fs::path& filename, CelestiaConfig *con
 #ifdef CELX
     config->configParams = configParams;
     configParams->getPath("LuaHook", config->luaHook);
+    config->scriptFrameBudget = 0.0;
+    configParams->getNumber("ScriptFrameBudget", config->scriptFrameBudget);
 #endif
 
     config->faintestVisible = 6.0f;
@@ -119,6 +121,7 @@ CelestiaConfig* ReadCelestiaConfig(const fs::path& filename, CelestiaConfig *con
     config->reverseMouseWheel = false;
     configParams->getBoolean("ReverseMouseWheel", config->reverseMouseWheel);
     configParams->getPath("ScriptScreenshotDirectory", config->scriptScreenshotDirectory);
+    configParams->getPath("CacheDirectory", config->cacheDirectory);
     config->scriptSystemAccessPolicy = "ask";
     configParams->getString("ScriptSystemAccessPolicy", config->scriptSystemAccessPolicy);
 
@@ -132,9 +135,13 @@ CelestiaConfig* ReadCelestiaConfig(const fs::path& filename, CelestiaConfig *con
     config->orbitPathSamplePoints = getUint(configParams, "OrbitPathSamplePoints", 100);
     config->shadowTextureSize = getUint(configParams, "ShadowTextureSize", 256);
     config->eclipseTextureSize = getUint(configParams, "EclipseTextureSize", 128);
+    config->incrementalOrbits = false;
+    configParams->getBoolean("IncrementalOrbits", config->incrementalOrbits);
 
     config->consoleLogRows = getUint(configParams, "LogSize", 200);
 
+    config->catalogLoaderThreads = getUint(configParams, "CatalogLoaderThreads", 0);
+
     Value* solarSystemsVal = configParams->getValue("SolarSystemCatalogs");
     if (solarSystemsVal != nullptr)
     {
@@ -48,9 +48,12 @@ public:
     double orbitPeriodsShown;
     double linearFadeFraction;
     fs::path scriptScreenshotDirectory;
+    fs::path cacheDirectory;
     std::string scriptSystemAccessPolicy;
 #ifdef CELX
     fs::path luaHook;
+    // Time in microseconds that scripts may run per frame, 0 for no limit
+    double scriptFrameBudget;
     Hash* configParams;
 #endif
 
@@ -64,11 +67,15 @@ public:
     unsigned int shadowTextureSize;
     unsigned int eclipseTextureSize;
     unsigned int orbitPathSamplePoints;
+    bool incrementalOrbits;
 
     unsigned int aaSamples;
 
     unsigned int consoleLogRows;
 
+    // Threads used to read extras catalogs, 0 for one per hardware thread
+    unsigned int catalogLoaderThreads;
+
     Hash* params;
 
     float getFloatValue(const std::string& name);
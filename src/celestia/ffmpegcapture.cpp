@@ -7,21 +7,52 @@ extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavutil/timestamp.h>
+#include <libavutil/imgutils.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/opt.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
 }
 
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <fmt/format.h>
 
+#include <celengine/glsupport.h>
 #include <celengine/pixelformat.h>
 #include <celengine/render.h>
+#include <celutil/logger.h>
 
 using namespace std;
 using namespace celestia;
+using celestia::util::GetLogger;
+
+namespace
+{
+// Number of pixel pack buffers cycled through for asynchronous readback;
+// a frame is copied out of its buffer this many frames after it was
+// rendered, by which time the transfer has normally completed.
+constexpr unsigned int ReadbackBufferCount = 3;
+
+// Maximum number of frames waiting for the encoder thread. When the queue
+// is full the render thread waits rather than dropping frames, because
+// the simulation time step is locked to the movie frame rate.
+constexpr std::size_t MaxQueuedFrames = 8;
+
+struct CapturedFrame
+{
+    std::vector<std::uint8_t> pixels;
+    int64_t pts;
+};
+} // end unnamed namespace
 
 // a wrapper around a single output AVStream
 class FFMPEGCapturePrivate
@@ -33,7 +64,7 @@ class FFMPEGCapturePrivate
     bool addStream(int w, int h, float fps);
     bool openVideo();
     bool start();
-    bool writeVideoFrame(bool = false);
+    bool captureFrame();
     void finish();
     void setVideoCodec(int);
 
@@ -41,9 +72,21 @@ class FFMPEGCapturePrivate
 
     int writePacket();
 
+    // render thread side of the pipeline
+    void initReadback();
+    void releaseReadback();
+    bool readbackOldest();
+    std::vector<std::uint8_t> acquireBuffer();
+    bool queueFrame(std::vector<std::uint8_t>&&, int64_t);
+
+    // encoder thread side of the pipeline
+    void encoderLoop();
+    bool encodeFrame(const std::uint8_t*, int64_t);
+    bool sendFrame(AVFrame*);
+    void stopEncoder();
+
     AVStream        *st       { nullptr };
     AVFrame         *frame    { nullptr };
-    AVFrame         *tmpfr    { nullptr };
     AVCodecContext  *enc      { nullptr };
     AVFormatContext *oc       { nullptr };
     const AVCodec   *vc       { nullptr };
@@ -66,6 +109,31 @@ class FFMPEGCapturePrivate
     fs::path        filename;
     std::string     vc_options;
 
+    // size in bytes of a row of captured pixels, padded to the default
+    // GL_PACK_ALIGNMENT of 4
+    int             stride    { 0       };
+
+    std::array<GLuint, ReadbackBufferCount>  pbos{};
+    std::array<int64_t, ReadbackBufferCount> pboPts{};
+    unsigned int    pboHead   { 0       };
+    unsigned int    pboPending{ 0       };
+    bool            usePBO    { false   };
+
+    std::thread                 encoder;
+    std::mutex                  queueMutex;
+    std::condition_variable     frameQueued;
+    std::condition_variable     frameDequeued;
+    std::deque<CapturedFrame>   queue;
+    std::vector<std::vector<std::uint8_t>> freeBuffers;
+    bool            finishing     { false };
+    bool            encoderFailed { false };
+
+    // statistics, guarded by queueMutex
+    int64_t         framesEncoded { 0 };
+    int64_t         framesDropped { 0 };
+    int64_t         producerWaits { 0 };
+    std::size_t     maxQueued     { 0 };
+
  public:
 #if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 10, 100)) // ffmpeg < 4.0
     static bool     registered;
@@ -319,6 +387,10 @@ bool FFMPEGCapturePrivate::start()
         return false;
     }
 
+    initReadback();
+    finishing = false;
+    encoder = std::thread(&FFMPEGCapturePrivate::encoderLoop, this);
+
     return true;
 }
 
@@ -377,82 +449,270 @@ bool FFMPEGCapturePrivate::openVideo()
             cout << "Failed to allocate SWS context\n";
             return false;
         }
+    }
+
+    stride = ((hasAlpha ? 4 : 3) * enc->width + 3) & ~3;
+
+    // copy the stream parameters to the muxer
+    if (avcodec_parameters_from_context(st->codecpar, enc) < 0)
+    {
+        cout << "Failed to copy the stream parameters to the muxer\n";
+        return false;
+    }
+
+    return true;
+}
+
+void FFMPEGCapturePrivate::initReadback()
+{
+#ifdef GL_ES
+    // Pixel pack buffers require OpenGL ES 3.0
+    usePBO = false;
+#else
+    glGenBuffers(ReadbackBufferCount, pbos.data());
+    for (GLuint pbo : pbos)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, stride * enc->height, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    usePBO = glGetError() == GL_NO_ERROR;
+    if (!usePBO)
+    {
+        cout << "Pixel pack buffers are unavailable, falling back to synchronous readback\n";
+        releaseReadback();
+    }
+#endif
+    pboHead = 0;
+    pboPending = 0;
+}
+
+void FFMPEGCapturePrivate::releaseReadback()
+{
+#ifndef GL_ES
+    if (pbos[0] != 0)
+        glDeleteBuffers(ReadbackBufferCount, pbos.data());
+#endif
+    pbos.fill(0);
+    usePBO = false;
+}
 
-        // allocate and init a temporary frame
-        if((tmpfr = av_frame_alloc()) == nullptr)
+std::vector<std::uint8_t> FFMPEGCapturePrivate::acquireBuffer()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (freeBuffers.empty())
+        return std::vector<std::uint8_t>(static_cast<std::size_t>(stride) * enc->height);
+
+    std::vector<std::uint8_t> buffer = std::move(freeBuffers.back());
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+// hand a captured frame over to the encoder thread, waiting for space in
+// the queue if the encoder is falling behind
+bool FFMPEGCapturePrivate::queueFrame(std::vector<std::uint8_t>&& pixels, int64_t pts)
+{
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (queue.size() >= MaxQueuedFrames && !encoderFailed)
         {
-            cout << "Failed to allocate temp frame\n";
-            return false;
+            ++producerWaits;
+            frameDequeued.wait(lock, [this] { return queue.size() < MaxQueuedFrames || encoderFailed; });
         }
 
-        tmpfr->format = format;
-        tmpfr->width  = enc->width;
-        tmpfr->height = enc->height;
-
-        // allocate the buffers for the frame data
-        if (av_frame_get_buffer(tmpfr, 32) < 0)
+        if (encoderFailed)
         {
-            cout << "Failed to allocate temp frame buffer\n";
+            ++framesDropped;
             return false;
         }
+
+        queue.push_back({ std::move(pixels), pts });
+        maxQueued = std::max(maxQueued, queue.size());
     }
 
-    // copy the stream parameters to the muxer
-    if (avcodec_parameters_from_context(st->codecpar, enc) < 0)
+    frameQueued.notify_one();
+    return true;
+}
+
+// copy the oldest pending pixel pack buffer into a frame and queue it
+bool FFMPEGCapturePrivate::readbackOldest()
+{
+#ifdef GL_ES
+    return false;
+#else
+    unsigned int index = (pboHead + ReadbackBufferCount - pboPending) % ReadbackBufferCount;
+    --pboPending;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[index]);
+    const auto *src = static_cast<const std::uint8_t*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (src == nullptr)
     {
-        cout << "Failed to copy the stream parameters to the muxer\n";
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        cout << "Failed to map the pixel pack buffer\n";
+        std::lock_guard<std::mutex> lock(queueMutex);
+        ++framesDropped;
         return false;
     }
 
-    return true;
+    std::vector<std::uint8_t> pixels = acquireBuffer();
+    if (gl::MESA_pack_invert)
+    {
+        std::memcpy(pixels.data(), src, pixels.size());
+    }
+    else
+    {
+        // glReadPixels returns the rows bottom-up
+        for (int row = 0; row < enc->height; row++)
+            std::memcpy(&pixels[row * stride], src + (enc->height - 1 - row) * stride, stride);
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return queueFrame(std::move(pixels), pboPts[index]);
+#endif
 }
 
-static void captureImage(AVFrame *pict, int width, int height, const Renderer *r)
+bool FFMPEGCapturePrivate::captureFrame()
 {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (encoderFailed)
+            return false;
+    }
+
     int x, y, w, h;
-    r->getViewport(&x, &y, &w, &h);
+    renderer->getViewport(&x, &y, &w, &h);
+    x += (w - enc->width) / 2;
+    y += (h - enc->height) / 2;
 
-    x += (w - width) / 2;
-    y += (h - height) / 2;
-    r->captureFrame(x, y, width, height,
-                    r->getPreferredCaptureFormat(),
-                    pict->data[0]);
+    int64_t pts = nextPts++;
+
+    if (!usePBO)
+    {
+        std::vector<std::uint8_t> pixels = acquireBuffer();
+        if (!renderer->captureFrame(x, y, enc->width, enc->height,
+                                    renderer->getPreferredCaptureFormat(),
+                                    pixels.data()))
+        {
+            cout << "Failed to capture the frame\n";
+            std::lock_guard<std::mutex> lock(queueMutex);
+            freeBuffers.push_back(std::move(pixels));
+            ++framesDropped;
+            return false;
+        }
+        return queueFrame(std::move(pixels), pts);
+    }
+
+#ifndef GL_ES
+    // Start the transfer of this frame and retire the oldest one
+    bool ok = true;
+    if (pboPending == ReadbackBufferCount)
+        ok = readbackOldest();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[pboHead]);
+    glReadPixels(x, y, enc->width, enc->height,
+                 hasAlpha ? GL_RGBA : GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pboPts[pboHead] = pts;
+    pboHead = (pboHead + 1) % ReadbackBufferCount;
+    ++pboPending;
+
+    return ok;
+#else
+    return false;
+#endif
 }
 
-// encode one video frame and send it to the muxer
-// return 1 when encoding is finished, 0 otherwise
-bool FFMPEGCapturePrivate::writeVideoFrame(bool finalize)
+void FFMPEGCapturePrivate::encoderLoop()
 {
-    AVFrame *frame = finalize ? nullptr : this->frame;
-    const int bytesPerPixel = hasAlpha ? 4 : 3;
-
-    // check if we want to generate more frames
-    if (!finalize)
+    for (;;)
     {
-        // when we pass a frame to the encoder, it may keep a reference to it
-        // internally; make sure we do not overwrite it here
-        if (av_frame_make_writable(frame) < 0)
+        CapturedFrame captured;
         {
-            cout << "Failed to make the frame writable\n";
-            return false;
+            std::unique_lock<std::mutex> lock(queueMutex);
+            frameQueued.wait(lock, [this] { return !queue.empty() || finishing; });
+            if (queue.empty())
+                break;
+
+            captured = std::move(queue.front());
+            queue.pop_front();
         }
+        frameDequeued.notify_one();
+
+        bool ok = encodeFrame(captured.pixels.data(), captured.pts);
 
-        if (enc->pix_fmt != format)
         {
-            captureImage(tmpfr, enc->width, enc->height, renderer);
-            // we need to compute the correct line width of our source data
-            const int linesize = bytesPerPixel * enc->width;
-            sws_scale(swsc, tmpfr->data, &linesize, 0, enc->height,
-                      frame->data, frame->linesize);
+            std::lock_guard<std::mutex> lock(queueMutex);
+            freeBuffers.push_back(std::move(captured.pixels));
+            if (ok)
+            {
+                ++framesEncoded;
+            }
+            else
+            {
+                // drop everything still queued and stop accepting frames
+                framesDropped += 1 + static_cast<int64_t>(queue.size());
+                queue.clear();
+                encoderFailed = true;
+            }
         }
-        else
+
+        if (!ok)
         {
-            captureImage(frame, enc->width, enc->height, renderer);
+            frameDequeued.notify_all();
+            break;
         }
+    }
+}
+
+void FFMPEGCapturePrivate::stopEncoder()
+{
+    if (!encoder.joinable())
+        return;
 
-        frame->pts = nextPts++;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        finishing = true;
     }
+    frameQueued.notify_one();
+    encoder.join();
+}
 
+// convert one captured frame to the codec pixel format and encode it
+bool FFMPEGCapturePrivate::encodeFrame(const std::uint8_t *pixels, int64_t pts)
+{
+    // when we pass a frame to the encoder, it may keep a reference to it
+    // internally; make sure we do not overwrite it here
+    if (av_frame_make_writable(frame) < 0)
+    {
+        cout << "Failed to make the frame writable\n";
+        return false;
+    }
+
+    if (enc->pix_fmt != format)
+    {
+        const std::uint8_t *const src[] = { pixels };
+        const int srcStride[] = { stride };
+        sws_scale(swsc, src, srcStride, 0, enc->height,
+                  frame->data, frame->linesize);
+    }
+    else
+    {
+        av_image_copy_plane(frame->data[0], frame->linesize[0],
+                            pixels, stride,
+                            (hasAlpha ? 4 : 3) * enc->width, enc->height);
+    }
+
+    frame->pts = pts;
+    return sendFrame(frame);
+}
+
+// send one video frame (or nullptr to flush) to the encoder and pass the
+// resulting packets to the muxer
+bool FFMPEGCapturePrivate::sendFrame(AVFrame *frame)
+{
 #if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 133, 100))
     av_init_packet(pkt);
 #endif
@@ -489,7 +749,13 @@ bool FFMPEGCapturePrivate::writeVideoFrame(bool finalize)
 
 void FFMPEGCapturePrivate::finish()
 {
-    writeVideoFrame(true);
+    // retire the frames still in flight on the GPU
+    while (pboPending > 0)
+        readbackOldest();
+    releaseReadback();
+
+    stopEncoder();
+    sendFrame(nullptr);
 
     // Write the trailer, if any. The trailer must be written before you
     // close the CodecContexts open when you wrote the header; otherwise
@@ -499,14 +765,19 @@ void FFMPEGCapturePrivate::finish()
 
     if (!(oc->oformat->flags & AVFMT_NOFILE))
         avio_closep(&oc->pb);
+
+    GetLogger()->info("Captured {} frames: {} encoded, {} dropped, "
+                      "up to {} queued, render thread waited {} times\n",
+                      nextPts, framesEncoded, framesDropped, maxQueued, producerWaits);
 }
 
 FFMPEGCapturePrivate::~FFMPEGCapturePrivate()
 {
+    stopEncoder();
+    releaseReadback();
+    sws_freeContext(swsc);
     avcodec_free_context(&enc);
     av_frame_free(&frame);
-    if (tmpfr != nullptr)
-        av_frame_free(&tmpfr);
     avformat_free_context(oc);
     av_packet_free(&pkt);
 }
@@ -574,7 +845,7 @@ bool FFMPEGCapture::end()
 
 bool FFMPEGCapture::captureFrame()
 {
-    return d->capturing && d->writeVideoFrame();
+    return d->capturing && d->captureFrame();
 }
 
 void FFMPEGCapture::setVideoCodec(AVCodecID vc_id)
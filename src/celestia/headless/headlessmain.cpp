@@ -0,0 +1,565 @@
+// headlessmain.cpp
+//
+// Copyright (C) 2023-present, the Celestia Development Team
+//
+// Offscreen front-end for Celestia. Renders into an EGL pbuffer without a
+// window system, runs a script at a fixed simulated frame rate and writes
+// every frame to disk or to standard output.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <array>
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <fmt/format.h>
+
+#include <celcompat/filesystem.h>
+#include <celengine/glsupport.h>
+#include <celengine/image.h>
+#include <celengine/render.h>
+#include <celimage/imageformats.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+#include <celutil/tzutil.h>
+#include <celestia/celestiacore.h>
+
+using celestia::util::GetLogger;
+using celestia::util::Level;
+
+namespace celestia
+{
+namespace
+{
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+enum class OutputFormat
+{
+    PNG,
+    JPEG,
+    Raw,
+};
+
+struct Options
+{
+    fs::path configFile;
+    fs::path dataDir;
+    std::vector<fs::path> extrasDirs;
+    fs::path script;
+    std::string url;
+    fs::path output{ "frames" };
+    OutputFormat format{ OutputFormat::PNG };
+    double fps{ 30.0 };
+    int frames{ 0 };
+    int width{ 1280 };
+    int height{ 720 };
+    bool timing{ true };
+    Level verbosity{ Level::Info };
+};
+
+
+class HeadlessAlerter : public CelestiaCore::Alerter
+{
+ public:
+    void fatalError(const std::string& msg) override
+    {
+        fmt::print(stderr, "{}\n", msg);
+    }
+};
+
+
+// An EGL context rendering into a pbuffer of fixed size. The Mesa
+// surfaceless platform is preferred so that no X11 or Wayland server is
+// needed; this works with software rendering (llvmpipe) as well.
+class HeadlessContext
+{
+ public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    bool init(int width, int height);
+
+ private:
+    EGLDisplay display{ EGL_NO_DISPLAY };
+    EGLSurface surface{ EGL_NO_SURFACE };
+    EGLContext context{ EGL_NO_CONTEXT };
+};
+
+
+HeadlessContext::~HeadlessContext()
+{
+    if (display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context != EGL_NO_CONTEXT)
+        eglDestroyContext(display, context);
+    if (surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, surface);
+    eglTerminate(display);
+}
+
+
+bool
+HeadlessContext::init(int width, int height)
+{
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions != nullptr && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr)
+    {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY)
+    {
+        GetLogger()->error("Unable to get an EGL display\n");
+        return false;
+    }
+
+    EGLint major;
+    EGLint minor;
+    if (eglInitialize(display, &major, &minor) != EGL_TRUE)
+    {
+        GetLogger()->error("Unable to initialize EGL\n");
+        display = EGL_NO_DISPLAY;
+        return false;
+    }
+    GetLogger()->verbose("EGL version {}.{}\n", major, minor);
+
+#ifdef GL_ES
+    EGLenum api = EGL_OPENGL_ES_API;
+    EGLint renderableType = EGL_OPENGL_ES2_BIT;
+#else
+    EGLenum api = EGL_OPENGL_API;
+    EGLint renderableType = EGL_OPENGL_BIT;
+#endif
+    if (eglBindAPI(api) != EGL_TRUE)
+    {
+        GetLogger()->error("Unable to bind the OpenGL API\n");
+        return false;
+    }
+
+    const EGLint configAttribs[] =
+    {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, renderableType,
+        EGL_RED_SIZE,        8,
+        EGL_GREEN_SIZE,      8,
+        EGL_BLUE_SIZE,       8,
+        EGL_DEPTH_SIZE,      24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint nConfigs = 0;
+    if (eglChooseConfig(display, configAttribs, &config, 1, &nConfigs) != EGL_TRUE || nConfigs == 0)
+    {
+        GetLogger()->error("No suitable EGL configuration found\n");
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] =
+    {
+        EGL_WIDTH,  width,
+        EGL_HEIGHT, height,
+        EGL_NONE
+    };
+    surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE)
+    {
+        GetLogger()->error("Unable to create a {}x{} EGL pbuffer\n", width, height);
+        return false;
+    }
+
+#ifdef GL_ES
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+#else
+    const EGLint contextAttribs[] = { EGL_NONE };
+#endif
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        GetLogger()->error("Unable to create an EGL context\n");
+        return false;
+    }
+
+    if (eglMakeCurrent(display, surface, surface, context) != EGL_TRUE)
+    {
+        GetLogger()->error("Unable to make the EGL context current\n");
+        return false;
+    }
+
+    return true;
+}
+
+
+// Write a captured frame. Raw frames are streamed to stdout without row
+// padding, so that they can be piped straight into an encoder, e.g.
+// ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r FPS -i - out.mp4
+bool
+WriteFrame(const Options& options, int frame, Image& image)
+{
+    switch (options.format)
+    {
+    case OutputFormat::Raw:
+        {
+            auto rowBytes = static_cast<std::size_t>(image.getWidth() * image.getComponents());
+            for (int row = 0; row < image.getHeight(); row++)
+            {
+                if (std::fwrite(image.getPixels() + row * image.getPitch(), 1, rowBytes, stdout) != rowBytes)
+                    return false;
+            }
+            return std::fflush(stdout) == 0;
+        }
+    case OutputFormat::JPEG:
+        return SaveJPEGImage(options.output / fmt::format("frame{:06d}.jpg", frame), image);
+    case OutputFormat::PNG:
+        return SavePNGImage(options.output / fmt::format("frame{:06d}.png", frame), image);
+    default:
+        return false;
+    }
+}
+
+
+void
+PrintUsage(const char* name)
+{
+    fmt::print(stderr,
+               "Usage: {} [options]\n"
+               "  -s, --script FILE     run the cel or celx script FILE\n"
+               "  -u, --url URL         start from the cel:// URL\n"
+               "  -n, --frames N        render N frames (default: until the script ends)\n"
+               "  -r, --fps RATE        simulated frames per second (default: 30)\n"
+               "  -g, --size WxH        frame size (default: 1280x720)\n"
+               "  -o, --output DIR      directory for the frames, or - for raw frames\n"
+               "                        on stdout (default: frames)\n"
+               "  -f, --format FORMAT   png, jpeg or raw (default: png)\n"
+               "  -c, --conf FILE       configuration file\n"
+               "  -d, --dir DIR         data directory\n"
+               "  -e, --extrasdir DIR   additional extras directory\n"
+               "  -q, --quiet           don't print per-frame timing\n"
+               "  -v, --verbose         verbose logging\n"
+               "  -h, --help            show this help\n",
+               name);
+}
+
+
+bool
+ParseOptions(int argc, char* argv[], Options& options)
+{
+    static const struct option longOptions[] =
+    {
+        { "script",    required_argument, nullptr, 's' },
+        { "url",       required_argument, nullptr, 'u' },
+        { "frames",    required_argument, nullptr, 'n' },
+        { "fps",       required_argument, nullptr, 'r' },
+        { "size",      required_argument, nullptr, 'g' },
+        { "output",    required_argument, nullptr, 'o' },
+        { "format",    required_argument, nullptr, 'f' },
+        { "conf",      required_argument, nullptr, 'c' },
+        { "dir",       required_argument, nullptr, 'd' },
+        { "extrasdir", required_argument, nullptr, 'e' },
+        { "quiet",     no_argument,       nullptr, 'q' },
+        { "verbose",   no_argument,       nullptr, 'v' },
+        { "help",      no_argument,       nullptr, 'h' },
+        { nullptr,     0,                 nullptr, 0   },
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "s:u:n:r:g:o:f:c:d:e:qvh", longOptions, nullptr)) != -1)
+    {
+        switch (c)
+        {
+        case 's':
+            options.script = optarg;
+            break;
+        case 'u':
+            options.url = optarg;
+            break;
+        case 'n':
+            options.frames = std::atoi(optarg);
+            break;
+        case 'r':
+            options.fps = std::atof(optarg);
+            break;
+        case 'g':
+            if (std::sscanf(optarg, "%dx%d", &options.width, &options.height) != 2)
+            {
+                fmt::print(stderr, "Invalid frame size '{}'\n", optarg);
+                return false;
+            }
+            break;
+        case 'o':
+            options.output = optarg;
+            break;
+        case 'f':
+            if (std::string_view(optarg) == "png")
+                options.format = OutputFormat::PNG;
+            else if (std::string_view(optarg) == "jpeg" || std::string_view(optarg) == "jpg")
+                options.format = OutputFormat::JPEG;
+            else if (std::string_view(optarg) == "raw")
+                options.format = OutputFormat::Raw;
+            else
+            {
+                fmt::print(stderr, "Unknown output format '{}'\n", optarg);
+                return false;
+            }
+            break;
+        case 'c':
+            options.configFile = optarg;
+            break;
+        case 'd':
+            options.dataDir = optarg;
+            break;
+        case 'e':
+            options.extrasDirs.emplace_back(optarg);
+            break;
+        case 'q':
+            options.timing = false;
+            break;
+        case 'v':
+            options.verbosity = Level::Verbose;
+            break;
+        case 'h':
+        default:
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (options.output == "-")
+        options.format = OutputFormat::Raw;
+
+    if (options.fps <= 0.0 || options.width <= 0 || options.height <= 0 || options.frames < 0)
+    {
+        fmt::print(stderr, "Frame rate, frame size and frame count must be positive\n");
+        return false;
+    }
+
+    if (options.script.empty() && options.frames == 0)
+    {
+        fmt::print(stderr, "Either a script or a frame count is required\n");
+        return false;
+    }
+
+    if (options.format == OutputFormat::Raw && options.output != "-")
+    {
+        fmt::print(stderr, "Raw frames can only be written to stdout\n");
+        return false;
+    }
+
+    return true;
+}
+
+
+double
+Milliseconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+
+int
+Run(const Options& options)
+{
+    using clock = std::chrono::steady_clock;
+
+    if (options.format != OutputFormat::Raw)
+    {
+        std::error_code ec;
+        fs::create_directories(options.output, ec);
+        if (ec)
+        {
+            GetLogger()->error("Unable to create output directory {}: {}\n", options.output, ec.message());
+            return 1;
+        }
+    }
+
+    // Paths given on the command line are relative to the working directory
+    // we were started in, not to the data directory.
+    std::error_code ec;
+    Options resolved = options;
+    if (!resolved.script.empty())
+        resolved.script = fs::absolute(resolved.script, ec);
+    if (resolved.format != OutputFormat::Raw)
+        resolved.output = fs::absolute(resolved.output, ec);
+    if (!resolved.configFile.empty())
+        resolved.configFile = fs::absolute(resolved.configFile, ec);
+    for (auto& dir : resolved.extrasDirs)
+        dir = fs::absolute(dir, ec);
+
+    fs::path dataDir = options.dataDir.empty() ? fs::path(CONFIG_DATA_DIR) : options.dataDir;
+    if (chdir(dataDir.c_str()) == -1)
+    {
+        GetLogger()->error("Cannot chdir to '{}', probably due to improper installation\n", dataDir);
+        return 1;
+    }
+
+    HeadlessContext context;
+    if (!context.init(resolved.width, resolved.height))
+        return 1;
+
+    auto appCore = std::make_unique<CelestiaCore>();
+    GetLogger()->setLevel(resolved.verbosity);
+    HeadlessAlerter alerter;
+    appCore->setAlerter(&alerter);
+
+    if (!appCore->initSimulation(resolved.configFile, resolved.extrasDirs))
+    {
+        GetLogger()->error("Error initializing simulation.\n");
+        return 1;
+    }
+
+    if (!gl::init(appCore->getConfig()->ignoreGLExtensions))
+    {
+        GetLogger()->error(_("Celestia was unable to initialize OpenGL.\n"));
+        return 1;
+    }
+#ifndef GL_ES
+    if (!gl::checkVersion(gl::GL_2_1))
+    {
+        GetLogger()->error(_("Celestia was unable to initialize OpenGL 2.1.\n"));
+        return 1;
+    }
+#endif
+
+    if (!appCore->initRenderer())
+    {
+        GetLogger()->error("Failed to initialize renderer.\n");
+        return 1;
+    }
+
+    Renderer* renderer = appCore->getRenderer();
+    renderer->setSolarSystemMaxDistance(appCore->getConfig()->SolarSystemMaxDistance);
+    renderer->setShadowMapSize(appCore->getConfig()->ShadowMapSize);
+
+    if (!resolved.url.empty())
+        appCore->setStartURL(resolved.url);
+    appCore->start();
+
+    std::string tzName;
+    int dstBias;
+    if (GetTZInfo(tzName, dstBias))
+    {
+        appCore->setTimeZoneName(tzName);
+        appCore->setTimeZoneBias(dstBias);
+    }
+
+    appCore->resize(resolved.width, resolved.height);
+
+    if (!resolved.script.empty())
+    {
+        appCore->runScript(resolved.script);
+        if (!appCore->isScriptRunning())
+        {
+            GetLogger()->error("Unable to run script {}\n", resolved.script);
+            return 1;
+        }
+    }
+
+    std::array<int, 4> viewport;
+    PixelFormat format;
+    appCore->getCaptureInfo(viewport, format);
+    Image image(format, viewport[2], viewport[3]);
+
+    double dt = 1.0 / resolved.fps;
+    clock::duration totalTick{ 0 };
+    clock::duration totalDraw{ 0 };
+    clock::duration totalCapture{ 0 };
+    clock::duration totalWrite{ 0 };
+    auto startTime = clock::now();
+
+    int frame = 0;
+    for (; resolved.frames == 0 || frame < resolved.frames; frame++)
+    {
+        // Without a frame count, stop once the script has finished.
+        if (resolved.frames == 0 && !appCore->isScriptRunning())
+            break;
+
+        auto t0 = clock::now();
+        appCore->tick(dt);
+        auto t1 = clock::now();
+
+        appCore->setViewChanged();
+        appCore->draw();
+        glFinish();
+        auto t2 = clock::now();
+
+        if (!appCore->captureImage(image.getPixels(), viewport, format))
+            return 1;
+        auto t3 = clock::now();
+
+        if (!WriteFrame(resolved, frame, image))
+        {
+            GetLogger()->error("Unable to write frame {}\n", frame);
+            return 1;
+        }
+        auto t4 = clock::now();
+
+        totalTick += t1 - t0;
+        totalDraw += t2 - t1;
+        totalCapture += t3 - t2;
+        totalWrite += t4 - t3;
+
+        if (resolved.timing)
+        {
+            fmt::print(stderr, "frame {:6d}: tick {:8.2f} ms, draw {:8.2f} ms, capture {:8.2f} ms, write {:8.2f} ms, total {:8.2f} ms\n",
+                       frame, Milliseconds(t1 - t0), Milliseconds(t2 - t1),
+                       Milliseconds(t3 - t2), Milliseconds(t4 - t3), Milliseconds(t4 - t0));
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(clock::now() - startTime).count();
+    if (frame > 0)
+    {
+        fmt::print(stderr, "{} frames in {:.2f} s ({:.2f} frames/s); mean tick {:.2f} ms, draw {:.2f} ms, capture {:.2f} ms, write {:.2f} ms\n",
+                   frame, elapsed, frame / elapsed,
+                   Milliseconds(totalTick) / frame, Milliseconds(totalDraw) / frame,
+                   Milliseconds(totalCapture) / frame, Milliseconds(totalWrite) / frame);
+    }
+
+    return 0;
+}
+
+} // end unnamed namespace
+} // end namespace celestia
+
+
+int
+main(int argc, char* argv[])
+{
+    std::setlocale(LC_ALL, "");
+    std::setlocale(LC_NUMERIC, "C");
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    bind_textdomain_codeset(PACKAGE, "UTF-8");
+    textdomain(PACKAGE);
+
+    celestia::Options options;
+    if (!celestia::ParseOptions(argc, argv, options))
+        return 1;
+
+    return celestia::Run(options);
+}
@@ -13,10 +13,12 @@
 #include <fstream>
 #include <algorithm>
 #include <memory>
+#include <vector>
 #include <celengine/glsupport.h>
 #include <celengine/image.h>
 #include <celutil/logger.h>
 #include <celutil/bytes.h>
+#include <celutil/parallel.h>
 #include "dds_decompress.h"
 
 using namespace celestia;
@@ -86,50 +88,59 @@ constexpr uint32_t FourCC(const char* s)
             (uint32_t) s[0]);
 }
 
-// decompress a DXTc texture to a RGBA texture, taken from https://github.com/ptitSeb/gl4es
-uint32_t* decompressDXTc(uint32_t width, uint32_t height, GLenum format, bool transparent0, ifstream &in)
+using DecompressBlockRowFunc = void (*)(const uint8_t*, uint32_t, bool, uint32_t*, uint32_t);
+
+// Below this many block rows the texture is decoded on the calling thread
+constexpr std::size_t MinBlockRowsPerThread = 64;
+
+// decompress a DXTc texture to a RGBA texture, block decoders are taken from https://github.com/ptitSeb/gl4es
+// The returned image is padded to a multiple of 4 pixels in both dimensions.
+std::unique_ptr<uint32_t[]> decompressDXTc(uint32_t width, uint32_t height, GLenum format, bool transparent0, ifstream &in)
 {
-    // TODO: check with the size of the input data stream if the stream is in fact decompressed
-    // alloc memory
-    auto *pixels = new uint32_t[((width + 3) & ~3) * ((height + 3) & ~3)];
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
 
-    int blocksize = 0;
-#define DDS_MAX_BLOCK_SIZE      16
+    std::size_t blocksize = 0;
+    DecompressBlockRowFunc decompressRow = nullptr;
     switch (format)
     {
     case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
         blocksize = 8;
+        decompressRow = DecompressBlockRowDXT1;
         break;
     case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        blocksize = 16;
+        decompressRow = DecompressBlockRowDXT3;
+        break;
     case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
         blocksize = 16;
+        decompressRow = DecompressBlockRowDXT5;
         break;
+    default:
+        return nullptr;
     }
-    uint8_t block[DDS_MAX_BLOCK_SIZE]; // enough to hold DXT1/3/5 blocks
-    for (uint32_t y = 0; y < height; y += 4)
+
+    // Read all blocks of the top level image at once rather than one block
+    // at a time.
+    std::size_t rowSize = blocksWide * blocksize;
+    std::vector<uint8_t> blocks(rowSize * blocksHigh);
+    in.read(reinterpret_cast<char*>(blocks.data()), blocks.size());
+    if (static_cast<std::size_t>(in.gcount()) != blocks.size())
+        return nullptr;
+
+    uint32_t stride = blocksWide * 4;
+    std::unique_ptr<uint32_t[]> pixels = std::make_unique<uint32_t[]>(static_cast<std::size_t>(stride) * blocksHigh * 4);
+
+    // Block rows are independent, so decode them in parallel
+    util::ParallelFor(blocksHigh, [&](std::size_t begin, std::size_t end)
     {
-        for (uint32_t x = 0; x < width; x += 4)
+        for (std::size_t by = begin; by < end; ++by)
         {
-            if (!in.good())
-            {
-                delete[] pixels;
-                return nullptr;
-            }
-            in.read((char*)block, blocksize);
-            switch(format)
-            {
-            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
-                DecompressBlockDXT1(x, y, width, block, transparent0, pixels);
-                break;
-            case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
-                DecompressBlockDXT3(x, y, width, block, transparent0, pixels);
-                break;
-            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-                DecompressBlockDXT5(x, y, width, block, transparent0, pixels);
-                break;
-            }
+            decompressRow(blocks.data() + by * rowSize, blocksWide, transparent0,
+                          pixels.get() + by * 4 * stride, stride);
         }
-    }
+    }, 0, MinBlockRowsPerThread);
+
     return pixels;
 }
 
@@ -246,25 +257,14 @@ Image* LoadDDSImage(const fs::path& filename)
         if (!gl::EXT_texture_compression_s3tc)
         {
             // DXTc texture not supported, decompress DXTc to RGB/RGBA
-            uint32_t *pixels = nullptr;
             bool transparent0 = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
-            if ((ddsd.width & 3) != 0 || (ddsd.height & 3) != 0)
-            {
-                uint32_t nw = max(ddsd.width, 4u);
-                uint32_t nh = max(ddsd.height, 4u);
-                auto *tmp = decompressDXTc(nw, nh, format, transparent0, in);
-                if (tmp != nullptr)
-                {
-                    pixels = new uint32_t[ddsd.width * ddsd.height];
-                    // crop
-                    for (uint32_t y = 0; y < ddsd.height; y++)
-                        memcpy((char *)pixels + y * ddsd.width * 4, (char *)tmp + y * nw * 4, ddsd.width * 4);
-                    delete[] tmp;
-                }
-            }
-            else
+            auto pixels = decompressDXTc(ddsd.width, ddsd.height, format, transparent0, in);
+            uint32_t paddedWidth = (ddsd.width + 3) & ~3u;
+            if (pixels != nullptr && paddedWidth != ddsd.width)
             {
-                pixels = decompressDXTc(ddsd.width, ddsd.height, format, transparent0, in);
+                // crop
+                for (uint32_t y = 1; y < ddsd.height; y++)
+                    memmove(pixels.get() + y * ddsd.width, pixels.get() + y * paddedWidth, ddsd.width * 4);
             }
 
             if (pixels == nullptr)
@@ -278,7 +278,7 @@ Image* LoadDDSImage(const fs::path& filename)
                 // Remove the alpha channel for DXT1 since DXT1 textures
                 // are deemed not to contain alpha values in Celestia
                 // https://github.com/CelestiaProject/Celestia/pull/1086
-                char *ptr = reinterpret_cast<char*>(pixels);
+                char *ptr = reinterpret_cast<char*>(pixels.get());
                 uint32_t numberOfPixels = ddsd.width * ddsd.height;
                 for (uint32_t index = 0; index < numberOfPixels; ++index)
                 {
@@ -287,8 +287,7 @@ Image* LoadDDSImage(const fs::path& filename)
             }
 
             Image *img = new Image(transparent0 ? PixelFormat::RGB : PixelFormat::RGBA, ddsd.width, ddsd.height);
-            memcpy(img->getPixels(), pixels, (transparent0 ? 3 : 4) * ddsd.width * ddsd.height);
-            delete[] pixels;
+            memcpy(img->getPixels(), pixels.get(), (transparent0 ? 3 : 4) * ddsd.width * ddsd.height);
             return img;
         }
     }
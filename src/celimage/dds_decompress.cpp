@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <iterator>
 #include <stddef.h>
 #include <stdint.h>
+#include "dds_decompress.h"
 
 /*
 DXT1/DXT3/DXT5 texture decompression
@@ -367,3 +370,181 @@ void DecompressBlockDXT3(uint32_t x,
     DecompressBlockDXT1Internal(blockStorage, image + x + (y * width), width,
                                 transparent0, alphaValues);
 }
+
+/*
+Row decoders
+
+The functions below decode a whole row of 4x4 blocks at once. Instead of
+evaluating the palette formula for every pixel they build the four colour
+(and, for DXT5, eight alpha) palette entries once per block and then resolve
+each pixel with a table lookup, which keeps the inner loop free of branches
+and lets the compiler vectorize it. The output is bit-identical to the
+per-block functions above.
+*/
+namespace
+{
+
+inline uint16_t ReadLE16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t ReadLE32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Expand a RGB565 color to 8 bits per channel, using the same rounding as
+// DecompressBlockDXT1Internal.
+inline void Expand565(uint16_t color, uint32_t& r, uint32_t& g, uint32_t& b)
+{
+    uint32_t temp = (color >> 11) * 255 + 16;
+    r = (temp / 32 + temp) / 32;
+    temp = ((color & 0x07E0) >> 5) * 255 + 32;
+    g = (temp / 64 + temp) / 64;
+    temp = (color & 0x001F) * 255 + 16;
+    b = (temp / 32 + temp) / 32;
+}
+
+// Build the RGB part of the four entry color palette of a block; alpha is
+// left at zero so that it can be or'ed in per pixel.
+inline void BuildColorPalette(const uint8_t* block, bool fourColor, uint32_t palette[4])
+{
+    uint16_t color0 = ReadLE16(block);
+    uint16_t color1 = ReadLE16(block + 2);
+
+    uint32_t r0, g0, b0, r1, g1, b1;
+    Expand565(color0, r0, g0, b0);
+    Expand565(color1, r1, g1, b1);
+
+    palette[0] = PackRGBA(r0, g0, b0, 0);
+    palette[1] = PackRGBA(r1, g1, b1, 0);
+    if (fourColor || color0 > color1)
+    {
+        palette[2] = PackRGBA((2 * r0 + r1) / 3, (2 * g0 + g1) / 3, (2 * b0 + b1) / 3, 0);
+        palette[3] = PackRGBA((r0 + 2 * r1) / 3, (g0 + 2 * g1) / 3, (b0 + 2 * b1) / 3, 0);
+    }
+    else
+    {
+        palette[2] = PackRGBA((r0 + r1) / 2, (g0 + g1) / 2, (b0 + b1) / 2, 0);
+        palette[3] = 0;
+    }
+}
+
+// Write the 16 pixels of a color block given per pixel alpha values.
+inline void ResolveColorBlock(const uint8_t* colorBlock,
+                              const uint32_t palette[4],
+                              const uint32_t alpha[16],
+                              bool transparent0,
+                              uint32_t* output,
+                              uint32_t outputStride)
+{
+    constexpr uint32_t opaqueBlack = PackRGBA(0, 0, 0, 0xff);
+    uint32_t code = ReadLE32(colorBlock + 4);
+    uint32_t keepMask = transparent0 ? opaqueBlack : 0;
+
+    for (int j = 0; j < 4; ++j)
+    {
+        uint32_t* row = output + j * outputStride;
+        for (int i = 0; i < 4; ++i)
+        {
+            int n = 4 * j + i;
+            uint32_t color = palette[(code >> (2 * n)) & 0x03] | alpha[n];
+            // Zero the pixel when transparent0 is set and it is opaque black
+            row[i] = color & (0u - (uint32_t)(color != keepMask));
+        }
+    }
+}
+
+} // anonymous namespace
+
+/*
+void DecompressBlockRowDXT1(): Decompresses a row of DXT1 blocks and stores the resulting four rows of pixels in 'image'.
+
+const uint8_t *blocks:          pointer to the first block of the row.
+uint32_t blockCount:            number of blocks in the row.
+uint32_t *image:                pointer to the first pixel of the top row of output.
+uint32_t stride:                distance in pixels between output rows, at least 4 * blockCount.
+*/
+void DecompressBlockRowDXT1(const uint8_t* blocks,
+                            uint32_t blockCount,
+                            bool transparent0,
+                            uint32_t* image,
+                            uint32_t stride)
+{
+    uint32_t alpha[16];
+    std::fill(std::begin(alpha), std::end(alpha), PackRGBA(0, 0, 0, 0xff));
+
+    for (uint32_t n = 0; n < blockCount; ++n, blocks += 8)
+    {
+        uint32_t palette[4];
+        BuildColorPalette(blocks, false, palette);
+        ResolveColorBlock(blocks, palette, alpha, transparent0, image + 4 * n, stride);
+    }
+}
+
+/*
+void DecompressBlockRowDXT3(): Decompresses a row of DXT3 blocks; see DecompressBlockRowDXT1().
+*/
+void DecompressBlockRowDXT3(const uint8_t* blocks,
+                            uint32_t blockCount,
+                            bool transparent0,
+                            uint32_t* image,
+                            uint32_t stride)
+{
+    for (uint32_t n = 0; n < blockCount; ++n, blocks += 16)
+    {
+        uint32_t alpha[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t nibble = (blocks[i / 2] >> (4 * (i & 1))) & 0xF;
+            alpha[i] = PackRGBA(0, 0, 0, nibble * 17);
+        }
+
+        uint32_t palette[4];
+        BuildColorPalette(blocks + 8, false, palette);
+        ResolveColorBlock(blocks + 8, palette, alpha, transparent0, image + 4 * n, stride);
+    }
+}
+
+/*
+void DecompressBlockRowDXT5(): Decompresses a row of DXT5 blocks; see DecompressBlockRowDXT1().
+*/
+void DecompressBlockRowDXT5(const uint8_t* blocks,
+                            uint32_t blockCount,
+                            bool /*transparent0*/,
+                            uint32_t* image,
+                            uint32_t stride)
+{
+    for (uint32_t n = 0; n < blockCount; ++n, blocks += 16)
+    {
+        uint32_t alpha0 = blocks[0];
+        uint32_t alpha1 = blocks[1];
+
+        uint32_t alphaPalette[8];
+        alphaPalette[0] = alpha0;
+        alphaPalette[1] = alpha1;
+        if (alpha0 > alpha1)
+        {
+            for (uint32_t code = 2; code < 8; ++code)
+                alphaPalette[code] = ((8 - code) * alpha0 + (code - 1) * alpha1) / 7;
+        }
+        else
+        {
+            for (uint32_t code = 2; code < 6; ++code)
+                alphaPalette[code] = ((6 - code) * alpha0 + (code - 1) * alpha1) / 5;
+            alphaPalette[6] = 0;
+            alphaPalette[7] = 255;
+        }
+
+        uint64_t alphaCode = (uint64_t)ReadLE16(blocks + 2) | ((uint64_t)ReadLE32(blocks + 4) << 16);
+        uint32_t alpha[16];
+        for (int i = 0; i < 16; ++i)
+            alpha[i] = alphaPalette[(alphaCode >> (3 * i)) & 0x07] << 24;
+
+        uint32_t palette[4];
+        BuildColorPalette(blocks + 8, true, palette);
+        // DXT5 never marks opaque black as transparent
+        ResolveColorBlock(blocks + 8, palette, alpha, false, image + 4 * n, stride);
+    }
+}
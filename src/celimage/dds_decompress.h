@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 void DecompressBlockDXT1(uint32_t x, uint32_t y, uint32_t width,
     const uint8_t* blockStorage,
     bool transparent0,
@@ -14,3 +16,17 @@ void DecompressBlockDXT5(uint32_t x, uint32_t y, uint32_t width,
     const uint8_t* blockStorage,
     bool transparent0,
     uint32_t* image);
+
+// Decompress a row of blockCount consecutive blocks into four rows of
+// pixels starting at image, with rows stride pixels apart.
+void DecompressBlockRowDXT1(const uint8_t* blocks, uint32_t blockCount,
+    bool transparent0,
+    uint32_t* image, uint32_t stride);
+
+void DecompressBlockRowDXT3(const uint8_t* blocks, uint32_t blockCount,
+    bool transparent0,
+    uint32_t* image, uint32_t stride);
+
+void DecompressBlockRowDXT5(const uint8_t* blocks, uint32_t blockCount,
+    bool transparent0,
+    uint32_t* image, uint32_t stride);
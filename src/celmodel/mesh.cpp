@@ -21,6 +21,7 @@
 #endif
 
 #include "mesh.h"
+#include "meshbvh.h"
 
 using celestia::util::GetLogger;
 
@@ -51,6 +52,44 @@ isOpaqueMaterial(const Material &material)
              material.blend != BlendMode::AdditiveBlend;
 }
 
+
+// Call func(triangle) for each triangle of the triangle list, strip and fan
+// groups, in group order.
+template<typename F>
+void forEachTriangle(const std::vector<PrimitiveGroup>& groups, F func)
+{
+    for (std::uint32_t groupIndex = 0; groupIndex < groups.size(); groupIndex++)
+    {
+        const PrimitiveGroup& group = groups[groupIndex];
+        auto nIndices = static_cast<std::uint32_t>(group.indices.size());
+        if (nIndices < 3)
+            continue;
+
+        const auto& indices = group.indices;
+        switch (group.prim)
+        {
+        case PrimitiveGroupType::TriList:
+            if (nIndices % 3 != 0)
+                break;
+            for (std::uint32_t i = 0; i < nIndices / 3; i++)
+                func(MeshTriangle{ { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] }, groupIndex, i });
+            break;
+        case PrimitiveGroupType::TriStrip:
+            // TODO: alternate orientation of triangles in a strip
+            for (std::uint32_t i = 0; i < nIndices - 2; i++)
+                func(MeshTriangle{ { indices[i], indices[i + 1], indices[i + 2] }, groupIndex, i });
+            break;
+        case PrimitiveGroupType::TriFan:
+            for (std::uint32_t i = 0; i < nIndices - 2; i++)
+                func(MeshTriangle{ { indices[0], indices[i + 1], indices[i + 2] }, groupIndex, i });
+            break;
+        default:
+            // Only triangle groups can be picked
+            break;
+        }
+    }
+}
+
 } // end unnamed namespace
 
 
@@ -190,6 +229,7 @@ Mesh::clone() const
 void
 Mesh::setVertices(unsigned int _nVertices, std::vector<VWord>&& vertexData)
 {
+    pickBVH.reset();
     nVertices = _nVertices;
     vertices = std::move(vertexData);
 }
@@ -202,6 +242,7 @@ Mesh::setVertexDescription(VertexDescription&& desc)
         return false;
 
     vertexDesc = std::move(desc);
+    pickBVH.reset();
     return true;
 }
 
@@ -225,6 +266,7 @@ Mesh::getGroup(unsigned int index) const
 PrimitiveGroup*
 Mesh::getGroup(unsigned int index)
 {
+    pickBVH.reset();
     if (index >= groups.size())
         return nullptr;
 
@@ -235,6 +277,7 @@ Mesh::getGroup(unsigned int index)
 unsigned int
 Mesh::addGroup(PrimitiveGroup&& group)
 {
+    pickBVH.reset();
     groups.push_back(std::move(group));
     return groups.size();
 }
@@ -353,6 +396,7 @@ Mesh::getGroupCount() const
 void
 Mesh::clearGroups()
 {
+    pickBVH.reset();
     groups.clear();
 }
 
@@ -374,6 +418,7 @@ Mesh::setName(std::string&& _name)
 void
 Mesh::remapIndices(const std::vector<Index32>& indexMap)
 {
+    pickBVH.reset();
     for (auto& group : groups)
     {
         for (auto& index : group.indices)
@@ -395,6 +440,7 @@ Mesh::remapMaterials(const std::vector<unsigned int>& materialMap)
 void
 Mesh::aggregateByMaterial()
 {
+    pickBVH.reset();
     std::sort(groups.begin(), groups.end(),
               [](const PrimitiveGroup& g0, const PrimitiveGroup& g1)
               {
@@ -462,6 +508,7 @@ Mesh::mergePrimitiveGroups()
 void
 Mesh::optimize()
 {
+    pickBVH.reset();
 #ifdef HAVE_MESHOPTIMIZER
     if (groups.size() > 1)
         return;
@@ -476,136 +523,77 @@ Mesh::optimize()
 
 bool
 Mesh::pick(const Eigen::Vector3d& rayOrigin, const Eigen::Vector3d& rayDirection, PickResult* result) const
+{
+    // Pick will automatically fail without vertex positions--no reasonable
+    // mesh should lack these.
+    if (vertexDesc.getAttribute(VertexAttributeSemantic::Position).semantic != VertexAttributeSemantic::Position ||
+        vertexDesc.getAttribute(VertexAttributeSemantic::Position).format != VertexAttributeFormat::Float3)
+    {
+        return false;
+    }
+
+    VertexPositions positions{ vertices.data(),
+                               vertexDesc.strideBytes / static_cast<unsigned int>(sizeof(VWord)),
+                               vertexDesc.getAttribute(VertexAttributeSemantic::Position).offsetWords };
+
+    if (pickBVH == nullptr)
+    {
+        std::vector<MeshTriangle> triangles;
+        triangles.reserve(getPrimitiveCount());
+        forEachTriangle(groups, [&triangles](const MeshTriangle& triangle) { triangles.push_back(triangle); });
+        pickBVH = std::make_shared<const MeshBVH>(std::move(triangles), positions);
+    }
+
+    double closest = 1.0e30;
+    MeshTriangle hit;
+    if (!pickBVH->pick(rayOrigin, rayDirection, positions, closest, hit))
+        return false;
+
+    if (result)
+    {
+        result->group = &groups[hit.group];
+        result->primitiveIndex = hit.primitive;
+        result->distance = closest;
+    }
+
+    return true;
+}
+
+
+bool
+Mesh::pickExhaustive(const Eigen::Vector3d& rayOrigin, const Eigen::Vector3d& rayDirection, PickResult* result) const
 {
     double maxDistance = 1.0e30;
     double closest = maxDistance;
 
-    // Pick will automatically fail without vertex positions--no reasonable
-    // mesh should lack these.
     if (vertexDesc.getAttribute(VertexAttributeSemantic::Position).semantic != VertexAttributeSemantic::Position ||
         vertexDesc.getAttribute(VertexAttributeSemantic::Position).format != VertexAttributeFormat::Float3)
     {
         return false;
     }
 
-    unsigned int stride = vertexDesc.strideBytes / sizeof(VWord);
-    unsigned int posOffset = vertexDesc.getAttribute(VertexAttributeSemantic::Position).offsetWords;
-    const VWord* vdata = vertices.data();
+    VertexPositions positions{ vertices.data(),
+                               vertexDesc.strideBytes / static_cast<unsigned int>(sizeof(VWord)),
+                               vertexDesc.getAttribute(VertexAttributeSemantic::Position).offsetWords };
 
-    // Iterate over all primitive groups in the mesh
-    for (const auto& group : groups)
+    forEachTriangle(groups, [&](const MeshTriangle& triangle)
     {
-        PrimitiveGroupType primType = group.prim;
-        Index32 nIndices = group.indices.size();
-
-        // Only attempt to compute the intersection of the ray with triangle
-        // groups.
-        if ((primType == PrimitiveGroupType::TriList
-             || primType == PrimitiveGroupType::TriStrip
-             || primType == PrimitiveGroupType::TriFan) &&
-            (nIndices >= 3) &&
-            !(primType == PrimitiveGroupType::TriList && nIndices % 3 != 0))
+        double t;
+        if (IntersectTriangle(positions[triangle.indices[0]],
+                              positions[triangle.indices[1]],
+                              positions[triangle.indices[2]],
+                              rayOrigin, rayDirection, closest, t) &&
+            t < closest)
         {
-            unsigned int primitiveIndex = 0;
-            Index32 index = 0;
-            Index32 i0 = group.indices[0];
-            Index32 i1 = group.indices[1];
-            Index32 i2 = group.indices[2];
-
-            // Iterate over the triangles in the primitive group
-            do
+            closest = t;
+            if (result)
             {
-                // Get the triangle vertices v0, v1, and v2
-                float fv[3];
-                std::memcpy(fv, vdata + i0 * stride + posOffset, sizeof(float) * 3);
-                Eigen::Vector3d v0 = Eigen::Map<Eigen::Vector3f>(fv).cast<double>();
-                std::memcpy(fv, vdata + i1 * stride + posOffset, sizeof(float) * 3);
-                Eigen::Vector3d v1 = Eigen::Map<Eigen::Vector3f>(fv).cast<double>();
-                std::memcpy(fv, vdata + i2 * stride + posOffset, sizeof(float) * 3);
-                Eigen::Vector3d v2 = Eigen::Map<Eigen::Vector3f>(fv).cast<double>();
-
-                // Compute the edge vectors e0 and e1, and the normal n
-                Eigen::Vector3d e0 = v1 - v0;
-                Eigen::Vector3d e1 = v2 - v0;
-                Eigen::Vector3d n = e0.cross(e1);
-
-                // c is the cosine of the angle between the ray and triangle normal
-                double c = n.dot(rayDirection);
-
-                // If the ray is parallel to the triangle, it either misses the
-                // triangle completely, or is contained in the triangle's plane.
-                // If it's contained in the plane, we'll still call it a miss.
-                if (c != 0.0)
-                {
-                    double t = (n.dot(v0 - rayOrigin)) / c;
-                    if (t < closest && t > 0.0)
-                    {
-                        double m00 = e0.dot(e0);
-                        double m01 = e0.dot(e1);
-                        double m10 = e1.dot(e0);
-                        double m11 = e1.dot(e1);
-                        double det = m00 * m11 - m01 * m10;
-                        if (det != 0.0)
-                        {
-                            Eigen::Vector3d p = rayOrigin + rayDirection * t;
-                            Eigen::Vector3d q = p - v0;
-                            double q0 = e0.dot(q);
-                            double q1 = e1.dot(q);
-                            double d = 1.0 / det;
-                            double s0 = (m11 * q0 - m01 * q1) * d;
-                            double s1 = (m00 * q1 - m10 * q0) * d;
-                            if (s0 >= 0.0 && s1 >= 0.0 && s0 + s1 <= 1.0)
-                            {
-                                closest = t;
-                                if (result)
-                                {
-                                    result->group = &group;
-                                    result->primitiveIndex = primitiveIndex;
-                                    result->distance = closest;
-                                }
-                            }
-                        }
-                    }
-                }
-
-                // Get the indices for the next triangle
-                if (primType == PrimitiveGroupType::TriList)
-                {
-                    index += 3;
-                    if (index < nIndices)
-                    {
-                        i0 = group.indices[index + 0];
-                        i1 = group.indices[index + 1];
-                        i2 = group.indices[index + 2];
-                    }
-                }
-                else if (primType == PrimitiveGroupType::TriStrip)
-                {
-                    index += 1;
-                    if (index < nIndices)
-                    {
-                        i0 = i1;
-                        i1 = i2;
-                        i2 = group.indices[index];
-                        // TODO: alternate orientation of triangles in a strip
-                    }
-                }
-                else // primType == TriFan
-                {
-                    index += 1;
-                    if (index < nIndices)
-                    {
-                        index += 1;
-                        i1 = i2;
-                        i2 = group.indices[index];
-                    }
-                }
-
-                primitiveIndex++;
-
-            } while (index < nIndices);
+                result->group = &groups[triangle.group];
+                result->primitiveIndex = triangle.primitive;
+                result->distance = closest;
+            }
         }
-    }
+    });
 
     return closest != maxDistance;
 }
@@ -677,6 +665,8 @@ Mesh::transform(const Eigen::Vector3f& translation, float scale)
     if (vertexDesc.getAttribute(VertexAttributeSemantic::Position).format != VertexAttributeFormat::Float3)
         return;
 
+    pickBVH.reset();
+
     VWord* vdata = vertices.data() + vertexDesc.getAttribute(VertexAttributeSemantic::Position).offsetWords;
     unsigned int i;
 
@@ -744,6 +734,7 @@ Mesh::getPrimitiveCount() const
 void
 Mesh::merge(const Mesh &other)
 {
+    pickBVH.reset();
     auto &ti = groups.front().indices;
     const auto &oi = other.groups.front().indices;
 
@@ -13,6 +13,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -155,6 +156,9 @@ bool operator==(const VertexDescription& a, const VertexDescription& b);
 bool operator<(const VertexDescription& a, const VertexDescription& b);
 
 
+class MeshBVH;
+
+
 struct PrimitiveGroup
 {
     PrimitiveGroup() = default;
@@ -245,6 +249,12 @@ class Mesh
     PrimitiveGroup createLinePrimitiveGroup(bool lineStrip, const std::vector<Index32>& indices);
     void mergePrimitiveGroups();
 
+    /*! Reference implementation of pick() that tests every triangle rather
+     *  than using the bounding volume hierarchy. Only used by the tests.
+     */
+    bool pickExhaustive(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, PickResult* result) const;
+    friend struct MeshPickTest;
+
     VertexDescription vertexDesc{ };
 
     unsigned int nVertices{ 0 };
@@ -253,6 +263,10 @@ class Mesh
     std::vector<PrimitiveGroup> groups;
 
     std::string name;
+
+    // Built on the first pick and discarded whenever the geometry or the
+    // group list changes.
+    mutable std::shared_ptr<const MeshBVH> pickBVH{ };
 };
 
 } // namespace cmod
@@ -0,0 +1,267 @@
+// meshbvh.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Bounding volume hierarchy over the triangles of a mesh, used to
+// accelerate ray picking.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <utility>
+
+#include "meshbvh.h"
+
+
+namespace cmod
+{
+namespace
+{
+
+// Maximum number of triangles stored in a leaf node
+constexpr std::uint32_t MaxLeafTriangles = 4;
+
+// Deep enough for any tree built by median splits of 2^32 triangles
+constexpr std::size_t MaxTraversalDepth = 64;
+
+
+// Compute the distance at which the ray enters box, clipped to
+// [0, maxDistance]. invDirection components may be infinite; a NaN slab
+// bound (ray lying in a slab plane) is ignored, which errs on the side of
+// reporting an intersection.
+bool
+IntersectBox(const Eigen::AlignedBox<float, 3>& box,
+             const Eigen::Vector3d& rayOrigin,
+             const Eigen::Vector3d& invDirection,
+             double maxDistance,
+             double& tEntry)
+{
+    double t0 = 0.0;
+    double t1 = maxDistance;
+    for (int i = 0; i < 3; i++)
+    {
+        double lo = (static_cast<double>(box.min()[i]) - rayOrigin[i]) * invDirection[i];
+        double hi = (static_cast<double>(box.max()[i]) - rayOrigin[i]) * invDirection[i];
+        if (lo > hi)
+            std::swap(lo, hi);
+        if (lo > t0)
+            t0 = lo;
+        if (hi < t1)
+            t1 = hi;
+        if (t0 > t1)
+            return false;
+    }
+
+    tEntry = t0;
+    return true;
+}
+
+} // end unnamed namespace
+
+
+bool
+IntersectTriangle(const Eigen::Vector3d& v0,
+                  const Eigen::Vector3d& v1,
+                  const Eigen::Vector3d& v2,
+                  const Eigen::Vector3d& rayOrigin,
+                  const Eigen::Vector3d& rayDirection,
+                  double maxDistance,
+                  double& t)
+{
+    // Compute the edge vectors e0 and e1, and the normal n
+    Eigen::Vector3d e0 = v1 - v0;
+    Eigen::Vector3d e1 = v2 - v0;
+    Eigen::Vector3d n = e0.cross(e1);
+
+    // c is the cosine of the angle between the ray and triangle normal
+    double c = n.dot(rayDirection);
+
+    // If the ray is parallel to the triangle, it either misses the
+    // triangle completely, or is contained in the triangle's plane.
+    // If it's contained in the plane, we'll still call it a miss.
+    if (c == 0.0)
+        return false;
+
+    double tPlane = (n.dot(v0 - rayOrigin)) / c;
+    if (tPlane > maxDistance || tPlane <= 0.0)
+        return false;
+
+    double m00 = e0.dot(e0);
+    double m01 = e0.dot(e1);
+    double m10 = e1.dot(e0);
+    double m11 = e1.dot(e1);
+    double det = m00 * m11 - m01 * m10;
+    if (det == 0.0)
+        return false;
+
+    Eigen::Vector3d p = rayOrigin + rayDirection * tPlane;
+    Eigen::Vector3d q = p - v0;
+    double q0 = e0.dot(q);
+    double q1 = e1.dot(q);
+    double d = 1.0 / det;
+    double s0 = (m11 * q0 - m01 * q1) * d;
+    double s1 = (m00 * q1 - m10 * q0) * d;
+    if (s0 < 0.0 || s1 < 0.0 || s0 + s1 > 1.0)
+        return false;
+
+    t = tPlane;
+    return true;
+}
+
+
+MeshBVH::MeshBVH(std::vector<MeshTriangle>&& _triangles, const VertexPositions& positions)
+{
+    auto count = static_cast<std::uint32_t>(_triangles.size());
+    if (count == 0)
+        return;
+
+    std::vector<Eigen::AlignedBox<float, 3>> triangleBounds;
+    std::vector<Eigen::Vector3f> centroids;
+    triangleBounds.reserve(count);
+    centroids.reserve(count);
+    for (const auto& triangle : _triangles)
+    {
+        Eigen::AlignedBox<float, 3> bounds;
+        for (Index32 index : triangle.indices)
+            bounds.extend(positions[index].cast<float>());
+        triangleBounds.push_back(bounds);
+        centroids.push_back(bounds.center());
+    }
+
+    std::vector<std::uint32_t> order(count);
+    for (std::uint32_t i = 0; i < count; i++)
+        order[i] = i;
+
+    nodes.reserve(2 * (count / MaxLeafTriangles + 1));
+    build(0, count, order, triangleBounds, centroids);
+
+    triangles.reserve(count);
+    for (std::uint32_t i : order)
+        triangles.push_back(_triangles[i]);
+}
+
+
+void
+MeshBVH::build(std::uint32_t first,
+               std::uint32_t count,
+               std::vector<std::uint32_t>& order,
+               const std::vector<Eigen::AlignedBox<float, 3>>& triangleBounds,
+               const std::vector<Eigen::Vector3f>& centroids)
+{
+    Eigen::AlignedBox<float, 3> bounds;
+    Eigen::AlignedBox<float, 3> centroidBounds;
+    for (std::uint32_t i = first; i < first + count; i++)
+    {
+        bounds.extend(triangleBounds[order[i]]);
+        centroidBounds.extend(centroids[order[i]]);
+    }
+
+    // Pad the box slightly so that rounding in the box test can't reject a
+    // ray that the triangle test accepts, e.g. one grazing a flat box.
+    float pad = 1.0e-5f * std::max(bounds.min().cwiseAbs().maxCoeff(), bounds.max().cwiseAbs().maxCoeff());
+    bounds.min().array() -= pad;
+    bounds.max().array() += pad;
+
+    auto nodeIndex = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back({ bounds, first, count });
+
+    Eigen::Index axis;
+    float extent = centroidBounds.sizes().maxCoeff(&axis);
+    if (count <= MaxLeafTriangles || extent <= 0.0f)
+        return;
+
+    // Split at the median centroid along the longest axis
+    std::uint32_t half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&centroids, axis](std::uint32_t a, std::uint32_t b)
+                     {
+                         return centroids[a][axis] < centroids[b][axis];
+                     });
+
+    build(first, half, order, triangleBounds, centroids);
+    auto rightIndex = static_cast<std::uint32_t>(nodes.size());
+    build(first + half, count - half, order, triangleBounds, centroids);
+
+    nodes[nodeIndex].first = rightIndex;
+    nodes[nodeIndex].count = 0;
+}
+
+
+bool
+MeshBVH::pick(const Eigen::Vector3d& rayOrigin,
+              const Eigen::Vector3d& rayDirection,
+              const VertexPositions& positions,
+              double& closest,
+              MeshTriangle& hit) const
+{
+    if (nodes.empty())
+        return false;
+
+    Eigen::Vector3d invDirection = rayDirection.cwiseInverse();
+    bool found = false;
+
+    std::array<std::uint32_t, MaxTraversalDepth> stack;
+    std::size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const Node& node = nodes[stack[--stackSize]];
+
+        // Nodes entered exactly at the closest distance may still hold a
+        // tie that the exhaustive search would have preferred.
+        double tEntry;
+        if (!IntersectBox(node.bounds, rayOrigin, invDirection, closest, tEntry))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                const MeshTriangle& triangle = triangles[i];
+                double t;
+                if (IntersectTriangle(positions[triangle.indices[0]],
+                                      positions[triangle.indices[1]],
+                                      positions[triangle.indices[2]],
+                                      rayOrigin, rayDirection, closest, t) &&
+                    (t < closest || (found && triangle.precedes(hit))))
+                {
+                    closest = t;
+                    hit = triangle;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so that closest shrinks early
+        auto left = static_cast<std::uint32_t>(&node - nodes.data()) + 1;
+        std::uint32_t right = node.first;
+        double tLeft;
+        double tRight;
+        bool hitLeft = IntersectBox(nodes[left].bounds, rayOrigin, invDirection, closest, tLeft);
+        bool hitRight = IntersectBox(nodes[right].bounds, rayOrigin, invDirection, closest, tRight);
+        if (hitLeft && hitRight)
+        {
+            if (tLeft <= tRight)
+                std::swap(left, right);
+            stack[stackSize++] = left;
+            stack[stackSize++] = right;
+        }
+        else if (hitLeft)
+        {
+            stack[stackSize++] = left;
+        }
+        else if (hitRight)
+        {
+            stack[stackSize++] = right;
+        }
+    }
+
+    return found;
+}
+
+} // namespace cmod
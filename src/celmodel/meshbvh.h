@@ -0,0 +1,112 @@
+// meshbvh.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Bounding volume hierarchy over the triangles of a mesh, used to
+// accelerate ray picking.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "mesh.h"
+
+
+namespace cmod
+{
+
+// Read access to the Float3 positions in interleaved vertex data.
+struct VertexPositions
+{
+    const VWord* data;
+    unsigned int stride;
+    unsigned int offset;
+
+    Eigen::Vector3d operator[](Index32 index) const
+    {
+        float fv[3];
+        std::memcpy(fv, data + index * stride + offset, sizeof(float) * 3);
+        return Eigen::Map<Eigen::Vector3f>(fv).cast<double>();
+    }
+};
+
+
+// A triangle of a mesh, identified by its primitive group and its index
+// within that group.
+struct MeshTriangle
+{
+    std::array<Index32, 3> indices;
+    std::uint32_t group;
+    std::uint32_t primitive;
+
+    // Order in which the exhaustive pick visits triangles; used to break
+    // ties between hits at the same distance.
+    bool precedes(const MeshTriangle& other) const
+    {
+        return group < other.group || (group == other.group && primitive < other.primitive);
+    }
+};
+
+
+// Compute the intersection of a ray with the triangle v0 v1 v2. Returns true
+// and sets t if the ray hits the triangle at a distance 0 < t <= maxDistance.
+bool IntersectTriangle(const Eigen::Vector3d& v0,
+                       const Eigen::Vector3d& v1,
+                       const Eigen::Vector3d& v2,
+                       const Eigen::Vector3d& rayOrigin,
+                       const Eigen::Vector3d& rayDirection,
+                       double maxDistance,
+                       double& t);
+
+
+class MeshBVH
+{
+ public:
+    MeshBVH(std::vector<MeshTriangle>&& triangles, const VertexPositions& positions);
+
+    /*! Find the closest triangle hit by the ray, nearer than closest. On a
+     *  hit, closest is updated and the triangle is stored in hit. Ties are
+     *  resolved the same way as testing every triangle in order would.
+     */
+    bool pick(const Eigen::Vector3d& rayOrigin,
+              const Eigen::Vector3d& rayDirection,
+              const VertexPositions& positions,
+              double& closest,
+              MeshTriangle& hit) const;
+
+    std::size_t getTriangleCount() const { return triangles.size(); }
+    std::size_t getNodeCount() const { return nodes.size(); }
+
+ private:
+    // Interior nodes have count == 0; their left child immediately follows
+    // them and first is the index of the right child. Leaf nodes reference
+    // count triangles starting at first.
+    struct Node
+    {
+        Eigen::AlignedBox<float, 3> bounds;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    void build(std::uint32_t first,
+               std::uint32_t count,
+               std::vector<std::uint32_t>& order,
+               const std::vector<Eigen::AlignedBox<float, 3>>& triangleBounds,
+               const std::vector<Eigen::Vector3f>& centroids);
+
+    std::vector<Node> nodes;
+    std::vector<MeshTriangle> triangles;
+};
+
+} // namespace cmod
@@ -62,6 +62,7 @@ void initLabelFlagMap(FlagMap &LabelFlagMap)
     LabelFlagMap["nebulae"sv]              = Renderer::NebulaLabels;
     LabelFlagMap["openclusters"sv]         = Renderer::OpenClusterLabels;
     LabelFlagMap["i18nconstellations"sv]   = Renderer::I18nConstellationLabels;
+    LabelFlagMap["declutter"sv]            = Renderer::DeclutterLabels;
 }
 
 void initBodyTypeMap(FlagMap &BodyTypeMap)
@@ -49,6 +49,13 @@ CommandParser::CommandParser(Tokenizer& tok, const shared_ptr<ScriptMaps> &sm) :
     parser = new Parser(tokenizer);
 }
 
+CommandParser::CommandParser(const shared_ptr<ScriptMaps> &sm) :
+    parser(nullptr),
+    tokenizer(nullptr),
+    scriptMaps(sm)
+{
+}
+
 CommandParser::~CommandParser()
 {
     delete parser;
@@ -58,30 +65,28 @@ CommandParser::~CommandParser()
 
 CommandSequence* CommandParser::parse()
 {
-    CommandSequence* seq = new CommandSequence();
+    ParsedScript script;
+    if (!read(script))
+        return nullptr;
 
+    return create(script);
+}
+
+
+bool CommandParser::read(ParsedScript& script)
+{
     if (tokenizer->nextToken() != Tokenizer::TokenBeginGroup)
     {
         error("'{' expected at start of script.");
-        delete seq;
-        return nullptr;
+        return false;
     }
 
     Tokenizer::TokenType ttype = tokenizer->nextToken();
     while (ttype != Tokenizer::TokenEnd && ttype != Tokenizer::TokenEndGroup)
     {
         tokenizer->pushBack();
-        Command* cmd = parseCommand();
-        if (cmd == nullptr)
-        {
-            for_each(seq->begin(), seq->end(), [](Command* cmd) { delete cmd; });
-            delete seq;
-            return nullptr;
-        }
-        else
-        {
-            seq->push_back(cmd);
-        }
+        if (!readCommand(script))
+            return false;
 
         ttype = tokenizer->nextToken();
     }
@@ -89,9 +94,29 @@ CommandSequence* CommandParser::parse()
     if (ttype != Tokenizer::TokenEndGroup)
     {
         error("Missing '}' at end of script.");
-        for_each(seq->begin(), seq->end(), [](Command* cmd) { delete cmd; });
-        delete seq;
-        return nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+
+CommandSequence* CommandParser::create(const ParsedScript& script)
+{
+    CommandSequence* seq = new CommandSequence();
+    seq->reserve(script.size());
+
+    for (const auto& parsedCommand : script)
+    {
+        Command* cmd = createCommand(parsedCommand.name, parsedCommand.parameters);
+        if (cmd == nullptr)
+        {
+            for_each(seq->begin(), seq->end(), [](Command* cmd) { delete cmd; });
+            delete seq;
+            return nullptr;
+        }
+
+        seq->push_back(cmd);
     }
 
     return seq;
@@ -136,12 +161,12 @@ static ObserverFrame::CoordinateSystem parseCoordinateSystem(const string& name)
 }
 
 
-Command* CommandParser::parseCommand()
+bool CommandParser::readCommand(ParsedScript& script)
 {
     if (tokenizer->nextToken() != Tokenizer::TokenName)
     {
         error("Invalid command name");
-        return nullptr;
+        return false;
     }
 
     string commandName(tokenizer->getStringValue());
@@ -150,10 +175,20 @@ Command* CommandParser::parseCommand()
     if (paramListValue == nullptr || paramListValue->getType() != Value::HashType)
     {
         error("Bad parameter list");
-        return nullptr;
+        delete paramListValue;
+        return false;
     }
 
-    Hash* paramList = paramListValue->getHash();
+    script.push_back({ std::move(commandName), std::move(*paramListValue->getHash()) });
+    delete paramListValue;
+
+    return true;
+}
+
+
+Command* CommandParser::createCommand(const string& commandName, const Hash& parameters)
+{
+    const Hash* paramList = &parameters;
     Command* cmd = nullptr;
 
     if (commandName == "wait")
@@ -874,8 +909,6 @@ Command* CommandParser::parseCommand()
         cmd = nullptr;
     }
 
-    delete paramListValue;
-
     return cmd;
 }
 
@@ -13,7 +13,10 @@
 #define _CMDPARSER_H_
 
 #include <iosfwd>
+#include <string>
 #include <string_view>
+#include <vector>
+#include <celengine/hash.h>
 #include <celscript/common/scriptmaps.h>
 #include <celutil/array_view.h>
 #include "command.h" // CommandSequence
@@ -23,18 +26,39 @@ class Parser;
 class Tokenizer;
 
 
+// A command read from a script, with its parameter list, before the command
+// itself has been created
+struct ParsedCommand
+{
+    std::string name;
+    Hash parameters;
+};
+
+using ParsedScript = std::vector<ParsedCommand>;
+
+
 class CommandParser
 {
  public:
     CommandParser(std::istream&, const std::shared_ptr<celestia::scripts::ScriptMaps> &sm);
     CommandParser(Tokenizer&, const std::shared_ptr<celestia::scripts::ScriptMaps> &sm);
+    // A parser without input, which can only create() commands
+    explicit CommandParser(const std::shared_ptr<celestia::scripts::ScriptMaps> &sm);
     ~CommandParser();
 
     CommandSequence* parse();
+
+    // Read the commands of a script and check its syntax, without creating
+    // them. create() then turns the parsed commands into a CommandSequence;
+    // the two steps together are equivalent to parse().
+    bool read(ParsedScript&);
+    CommandSequence* create(const ParsedScript&);
+
     celestia::util::array_view<std::string> getErrors() const;
 
  private:
-    Command* parseCommand();
+    bool readCommand(ParsedScript&);
+    Command* createCommand(const std::string&, const Hash&);
     void error(std::string);
 
     Parser* parser;
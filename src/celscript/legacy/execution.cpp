@@ -12,7 +12,7 @@
 using namespace std;
 
 
-Execution::Execution(CommandSequence& cmd, ExecutionEnvironment& _env) :
+Execution::Execution(const CommandSequence& cmd, ExecutionEnvironment& _env) :
     currentCommand(cmd.begin()),
     finalCommand(cmd.end()),
     env(_env),
@@ -56,7 +56,7 @@ bool Execution::tick(double dt)
 }
 
 
-void Execution::reset(CommandSequence& cmd)
+void Execution::reset(const CommandSequence& cmd)
 {
     currentCommand = cmd.begin();
     finalCommand = cmd.end();
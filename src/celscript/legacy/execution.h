@@ -17,10 +17,10 @@
 class Execution
 {
  public:
-    Execution(CommandSequence&, ExecutionEnvironment&);
+    Execution(const CommandSequence&, ExecutionEnvironment&);
 
     bool tick(double);
-    void reset(CommandSequence&);
+    void reset(const CommandSequence&);
 
  private:
     CommandSequence::const_iterator currentCommand;
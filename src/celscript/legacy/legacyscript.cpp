@@ -7,13 +7,11 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
-#include <fstream>
 #include <string>
 #include <celcompat/filesystem.h>
 #include <celestia/celestiacore.h>
 #include <celutil/gettext.h>
 #include "legacyscript.h"
-#include "cmdparser.h"
 #include "execution.h"
 
 using namespace std;
@@ -55,26 +53,15 @@ public:
     }
 };
 
-LegacyScript::LegacyScript(CelestiaCore *core) :
+LegacyScript::LegacyScript(CelestiaCore *core, shared_ptr<const CompiledScript> script) :
     m_appCore(core),
-    m_execEnv(new CoreExecutionEnvironment(*core))
+    m_script(std::move(script)),
+    m_execEnv(new CoreExecutionEnvironment(*core)),
+    m_runningScript(new Execution(m_script->getCommands(), *m_execEnv))
 {
 }
 
-bool LegacyScript::load(ifstream &scriptfile, const fs::path &/*path*/, string &errorMsg)
-{
-    CommandParser parser(scriptfile, m_appCore->scriptMaps());
-    CommandSequence* script = parser.parse();
-    if (script == nullptr)
-    {
-        auto errors = parser.getErrors();
-        if (!errors.empty())
-            errorMsg = errors[0];
-        return false;
-    }
-    m_runningScript = unique_ptr<Execution>(new Execution(*script, *m_execEnv));
-    return true;
-}
+LegacyScript::~LegacyScript() = default;
 
 bool LegacyScript::tick(double dt)
 {
@@ -86,25 +73,25 @@ bool LegacyScriptPlugin::isOurFile(const fs::path &p) const
     return p.extension() == ".cel";
 }
 
-unique_ptr<IScript> LegacyScriptPlugin::loadScript(const fs::path &path)
+void LegacyScriptPlugin::setCacheDirectory(const fs::path &dir)
 {
-    ifstream scriptfile(path);
-    if (!scriptfile.good())
-    {
-        appCore()->fatalError(_("Error opening script file."));
-        return nullptr;
-    }
+    m_cache.setDirectory(dir);
+    m_cache.prune();
+}
 
-    auto script = unique_ptr<LegacyScript>(new LegacyScript(appCore()));
+unique_ptr<IScript> LegacyScriptPlugin::loadScript(const fs::path &path)
+{
     string errorMsg;
-    if (!script->load(scriptfile, path, errorMsg))
+    auto compiledScript = m_cache.load(path, appCore()->scriptMaps(), errorMsg);
+    if (compiledScript == nullptr)
     {
         if (errorMsg.empty())
             errorMsg = _("Unknown error loading script");
         appCore()->fatalError(errorMsg);
         return nullptr;
     }
-    return script;
+
+    return unique_ptr<LegacyScript>(new LegacyScript(appCore(), std::move(compiledScript)));
 }
 
 }
@@ -10,7 +10,7 @@
 #pragma once
 
 #include <celscript/common/script.h>
-#include <iosfwd>
+#include "scriptcache.h"
 
 class Execution;
 class ExecutionEnvironment;
@@ -22,17 +22,16 @@ namespace celestia::scripts
 class LegacyScript : public IScript
 {
  public:
-    LegacyScript(CelestiaCore*);
-    ~LegacyScript() override = default;
-
-    bool load(std::ifstream&, const fs::path&, std::string&);
+    LegacyScript(CelestiaCore*, std::shared_ptr<const CompiledScript>);
+    ~LegacyScript() override;
 
     bool tick(double) override;
 
  private:
     CelestiaCore *m_appCore;
-    std::unique_ptr<Execution> m_runningScript;
+    std::shared_ptr<const CompiledScript> m_script;
     std::unique_ptr<ExecutionEnvironment> m_execEnv;
+    std::unique_ptr<Execution> m_runningScript;
 
     friend class LegacyScriptPlugin;
 };
@@ -50,6 +49,12 @@ class LegacyScriptPlugin : public IScriptPlugin
 
     bool isOurFile(const fs::path&) const override;
     std::unique_ptr<IScript> loadScript(const fs::path&) override;
+
+    //! Store parsed scripts in dir, so that later sessions can reuse them
+    void setCacheDirectory(const fs::path& dir);
+
+ private:
+    ScriptCache m_cache;
 };
 
 } // end namespace celestia::scripts
@@ -0,0 +1,480 @@
+// scriptcache.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Cache of parsed Celestia command scripts.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <celengine/value.h>
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
+#include <celutil/fnv.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+#include "cmdparser.h"
+#include "command.h"
+#include "scriptcache.h"
+
+namespace celutil = celestia::util;
+using celestia::util::GetLogger;
+
+
+namespace celestia::scripts
+{
+
+namespace
+{
+
+constexpr std::string_view CacheHeader = "CELSCRPT";
+constexpr std::uint32_t CacheVersion = 1;
+
+// Bounds on the contents of a cache file, which are checked when it is read
+// so that a damaged file can't cause huge allocations
+constexpr std::uint32_t MaxCommands = 1U << 20;
+constexpr std::uint32_t MaxEntries = 1U << 16;
+constexpr std::uint32_t MaxStringLength = 1U << 20;
+constexpr int MaxDepth = 16;
+
+// Cache files that haven't been used for this long are deleted by prune()
+constexpr auto MaxUnusedAge = std::chrono::hours(24 * 90);
+
+// Seeds for the hash used to name a cache file, and for the independent
+// hash stored inside it to guard against collisions
+constexpr std::uint64_t KeySeed = celutil::FNV1aOffsetBasis;
+constexpr std::uint64_t CheckSeed = UINT64_C(0x84222325cbf29ce4);
+
+// Read the part of a cache file's header that doesn't depend on the source
+bool
+ReadHeader(std::istream& in)
+{
+    char header[8];
+    std::uint32_t version;
+    return in.read(header, sizeof(header)).good() &&
+           std::string_view(header, sizeof(header)) == CacheHeader &&
+           celutil::readLE<std::uint32_t>(in, version) && version == CacheVersion;
+}
+
+bool
+ReadString(std::istream& in, std::string& s)
+{
+    std::uint32_t length;
+    if (!celutil::readLE<std::uint32_t>(in, length) || length > MaxStringLength)
+        return false;
+
+    s.resize(length);
+    return in.read(s.data(), length).good();
+}
+
+void
+WriteString(std::ostream& out, std::string_view s)
+{
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(s.size()));
+    out.write(s.data(), s.size());
+}
+
+bool ReadHash(std::istream& in, Hash& hash, int depth);
+
+Value*
+ReadValue(std::istream& in, int depth)
+{
+    std::uint8_t type;
+    if (depth > MaxDepth || !celutil::readLE<std::uint8_t>(in, type))
+        return nullptr;
+
+    switch (type)
+    {
+    case Value::NullType:
+        return new Value();
+
+    case Value::NumberType:
+        if (double d; celutil::readLE<double>(in, d))
+            return new Value(d);
+        return nullptr;
+
+    case Value::StringType:
+        if (std::string s; ReadString(in, s))
+            return new Value(s);
+        return nullptr;
+
+    case Value::BooleanType:
+        if (std::uint8_t b; celutil::readLE<std::uint8_t>(in, b))
+            return new Value(b != 0);
+        return nullptr;
+
+    case Value::ArrayType:
+        {
+            std::uint32_t count;
+            if (!celutil::readLE<std::uint32_t>(in, count) || count > MaxEntries)
+                return nullptr;
+
+            auto* value = new Value(new Array());
+            Array* array = value->getArray();
+            array->reserve(count);
+            for (std::uint32_t i = 0; i < count; i++)
+            {
+                Value* element = ReadValue(in, depth + 1);
+                if (element == nullptr)
+                {
+                    delete value;
+                    return nullptr;
+                }
+                array->push_back(element);
+            }
+            return value;
+        }
+
+    case Value::HashType:
+        {
+            auto* value = new Value(new Hash());
+            if (!ReadHash(in, *value->getHash(), depth + 1))
+            {
+                delete value;
+                return nullptr;
+            }
+            return value;
+        }
+
+    default:
+        return nullptr;
+    }
+}
+
+bool
+ReadHash(std::istream& in, Hash& hash, int depth)
+{
+    std::uint32_t count;
+    if (depth > MaxDepth || !celutil::readLE<std::uint32_t>(in, count) || count > MaxEntries)
+        return false;
+
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::string key;
+        if (!ReadString(in, key))
+            return false;
+
+        Value* value = ReadValue(in, depth + 1);
+        if (value == nullptr)
+            return false;
+
+        hash.addValue(std::move(key), *value);
+    }
+
+    return true;
+}
+
+void WriteHash(std::ostream& out, const Hash& hash);
+
+void
+WriteValue(std::ostream& out, const Value& value)
+{
+    celutil::writeLE<std::uint8_t>(out, static_cast<std::uint8_t>(value.getType()));
+    switch (value.getType())
+    {
+    case Value::NumberType:
+        celutil::writeLE<double>(out, value.getNumber());
+        break;
+    case Value::StringType:
+        WriteString(out, value.getStringView());
+        break;
+    case Value::BooleanType:
+        celutil::writeLE<std::uint8_t>(out, value.getBoolean() ? 1 : 0);
+        break;
+    case Value::ArrayType:
+        celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(value.getArray()->size()));
+        for (const Value* element : *value.getArray())
+            WriteValue(out, *element);
+        break;
+    case Value::HashType:
+        WriteHash(out, *value.getHash());
+        break;
+    default:
+        break;
+    }
+}
+
+void
+WriteHash(std::ostream& out, const Hash& hash)
+{
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(std::distance(hash.begin(), hash.end())));
+    for (const auto& [key, value] : hash)
+    {
+        WriteString(out, key);
+        WriteValue(out, *value);
+    }
+}
+
+// Check that a parsed script fits within the bounds that are checked when
+// it is read back
+bool IsStorable(const Hash& hash, int depth);
+
+bool
+IsStorable(const Value& value, int depth)
+{
+    if (depth > MaxDepth)
+        return false;
+
+    switch (value.getType())
+    {
+    case Value::StringType:
+        return value.getStringView().size() <= MaxStringLength;
+    case Value::ArrayType:
+        return value.getArray()->size() <= MaxEntries &&
+               std::all_of(value.getArray()->begin(), value.getArray()->end(),
+                           [depth](const Value* element) { return IsStorable(*element, depth + 1); });
+    case Value::HashType:
+        return IsStorable(*value.getHash(), depth + 1);
+    default:
+        return true;
+    }
+}
+
+bool
+IsStorable(const Hash& hash, int depth)
+{
+    return depth <= MaxDepth &&
+           static_cast<std::size_t>(std::distance(hash.begin(), hash.end())) <= MaxEntries &&
+           std::all_of(hash.begin(), hash.end(),
+                       [depth](const auto& entry)
+                       {
+                           return entry.first.size() <= MaxStringLength && IsStorable(*entry.second, depth + 1);
+                       });
+}
+
+bool
+IsStorable(const ParsedScript& script)
+{
+    return script.size() <= MaxCommands &&
+           std::all_of(script.begin(), script.end(),
+                       [](const ParsedCommand& command)
+                       {
+                           return command.name.size() <= MaxStringLength && IsStorable(command.parameters, 0);
+                       });
+}
+
+fs::path
+CachePath(const fs::path& directory, std::string_view source)
+{
+    return directory / fmt::format("{:016x}.cmd", celutil::FNV1a64(source, KeySeed));
+}
+
+} // end unnamed namespace
+
+
+bool
+ReadParsedScript(std::istream& in, std::string_view source, ParsedScript& script)
+{
+    std::uint64_t sourceSize, check;
+    std::uint32_t count;
+    if (!ReadHeader(in) ||
+        !celutil::readLE<std::uint64_t>(in, sourceSize) || sourceSize != source.size() ||
+        !celutil::readLE<std::uint64_t>(in, check) || check != celutil::FNV1a64(source, CheckSeed) ||
+        !celutil::readLE<std::uint32_t>(in, count) || count > MaxCommands)
+    {
+        return false;
+    }
+
+    ParsedScript result;
+    result.reserve(count);
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        ParsedCommand command;
+        if (!ReadString(in, command.name) || !ReadHash(in, command.parameters, 0))
+            return false;
+        result.push_back(std::move(command));
+    }
+
+    script = std::move(result);
+    return true;
+}
+
+
+bool
+WriteParsedScript(std::ostream& out, std::string_view source, const ParsedScript& script)
+{
+    if (!IsStorable(script))
+        return false;
+
+    out.write(CacheHeader.data(), CacheHeader.size());
+    celutil::writeLE<std::uint32_t>(out, CacheVersion);
+    celutil::writeLE<std::uint64_t>(out, source.size());
+    celutil::writeLE<std::uint64_t>(out, celutil::FNV1a64(source, CheckSeed));
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(script.size()));
+    for (const auto& command : script)
+    {
+        WriteString(out, command.name);
+        WriteHash(out, command.parameters);
+    }
+
+    return out.good();
+}
+
+
+
+CompiledScript::CompiledScript(CommandSequence* _commands) :
+    commands(_commands)
+{
+}
+
+
+CompiledScript::~CompiledScript()
+{
+    for (Command* command : *commands)
+        delete command;
+    delete commands;
+}
+
+
+void
+ScriptCache::setDirectory(const fs::path& _directory)
+{
+    directory = _directory;
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec)
+        GetLogger()->warn("Could not create script cache directory {}\n", directory);
+}
+
+
+void
+ScriptCache::prune() const
+{
+    if (directory.empty())
+        return;
+
+    auto now = fs::file_time_type::clock::now();
+
+    std::vector<fs::path> stale;
+    std::error_code ec;
+    for (fs::directory_iterator iter(directory, ec), end; !ec && iter != end; iter.increment(ec))
+    {
+        const fs::path& path = iter->path();
+        if (path.extension() != ".cmd")
+            continue;
+
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        bool current = in.good() && ReadHeader(in);
+        if (current)
+        {
+            std::error_code timeError;
+            auto modified = fs::last_write_time(path, timeError);
+            current = !timeError && now - modified < MaxUnusedAge;
+        }
+
+        if (!current)
+            stale.push_back(path);
+    }
+
+    for (const fs::path& path : stale)
+        fs::remove(path, ec);
+
+    if (!stale.empty())
+        GetLogger()->verbose("Removed {} stale script cache files from {}\n", stale.size(), directory);
+}
+
+
+std::shared_ptr<const CompiledScript>
+ScriptCache::load(const fs::path& path,
+                  const std::shared_ptr<ScriptMaps>& scriptMaps,
+                  std::string& errorMsg)
+{
+    // Scripts whose modification time or size can't be determined are
+    // loaded every time
+    std::error_code modifiedError;
+    std::error_code sizeError;
+    fs::file_time_type modified = fs::last_write_time(path, modifiedError);
+    std::uintmax_t size = fs::file_size(path, sizeError);
+    bool cacheable = !modifiedError && !sizeError;
+
+    std::string key = path.string();
+    if (cacheable)
+    {
+        auto it = scripts.find(key);
+        if (it != scripts.end() && it->second.modified == modified && it->second.size == size)
+            return it->second.script;
+    }
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.good())
+    {
+        errorMsg = _("Error opening script file.");
+        return nullptr;
+    }
+
+    std::string source(std::istreambuf_iterator<char>(in), {});
+
+    ParsedScript parsed;
+    bool stored = false;
+    if (!directory.empty())
+    {
+        fs::path cachePath = CachePath(directory, source);
+        std::ifstream cacheFile(cachePath, std::ios::in | std::ios::binary);
+        stored = cacheFile.good() && ReadParsedScript(cacheFile, source, parsed);
+
+        // Mark the cache file as used, so that prune() keeps it
+        if (stored)
+        {
+            std::error_code ec;
+            fs::last_write_time(cachePath, fs::file_time_type::clock::now(), ec);
+        }
+    }
+
+    if (!stored)
+    {
+        std::istringstream sourceStream(source);
+        CommandParser parser(sourceStream, scriptMaps);
+        if (!parser.read(parsed))
+        {
+            auto errors = parser.getErrors();
+            if (!errors.empty())
+                errorMsg = errors[0];
+            return nullptr;
+        }
+    }
+
+    CommandParser parser(scriptMaps);
+    CommandSequence* commands = parser.create(parsed);
+    if (commands == nullptr)
+    {
+        auto errors = parser.getErrors();
+        if (!errors.empty())
+            errorMsg = errors[0];
+        return nullptr;
+    }
+
+    // Written to memory first, so that no file is left for scripts that
+    // can't be stored
+    std::ostringstream data;
+    if (!stored && !directory.empty() && WriteParsedScript(data, source, parsed))
+    {
+        fs::path cachePath = CachePath(directory, source);
+        std::ofstream cacheFile(cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+        std::string contents = data.str();
+        if (!cacheFile.write(contents.data(), contents.size()).good())
+            GetLogger()->warn("Could not write script cache file {}\n", cachePath);
+    }
+
+    auto script = std::make_shared<const CompiledScript>(commands);
+    if (cacheable)
+        scripts[key] = { modified, size, script };
+
+    return script;
+}
+
+
+} // end namespace celestia::scripts
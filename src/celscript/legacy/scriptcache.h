@@ -0,0 +1,98 @@
+// scriptcache.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Cache of parsed Celestia command scripts.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+#include <celscript/common/scriptmaps.h>
+#include "cmdparser.h"
+
+class Command;
+
+
+namespace celestia::scripts
+{
+
+//! A command sequence created from a script, which owns its commands
+class CompiledScript
+{
+ public:
+    explicit CompiledScript(std::vector<Command*>* commands);
+    ~CompiledScript();
+    CompiledScript(const CompiledScript&) = delete;
+    CompiledScript& operator=(const CompiledScript&) = delete;
+
+    const std::vector<Command*>& getCommands() const { return *commands; }
+
+ private:
+    std::vector<Command*>* commands;
+};
+
+
+/*! Read or write the parsed commands of a script in the format of the
+ *  script cache. The cached commands are only read if they were written
+ *  for the same source. Scripts whose parameters exceed the bounds checked
+ *  when reading aren't written.
+ */
+bool ReadParsedScript(std::istream& in, std::string_view source, ParsedScript& script);
+bool WriteParsedScript(std::ostream& out, std::string_view source, const ParsedScript& script);
+
+
+/*! A ScriptCache keeps the scripts it loads, so that a script which is run
+ *  again doesn't have to be read and parsed again. Commands don't change
+ *  when they are executed, so every run of a script shares the commands
+ *  created for the first one. A script is loaded again if its file's size
+ *  or modification time changes.
+ *
+ *  If a cache directory is set, the parsed commands of every script are
+ *  also stored on disk, keyed by a hash of the script source, and later
+ *  sessions create the commands from them without tokenizing the script.
+ *  Only scripts whose commands were all created successfully are stored.
+ */
+class ScriptCache
+{
+ public:
+    void setDirectory(const fs::path&);
+
+    /*! Delete cache files that can't be used any more: those written in
+     *  another cache format, and those that haven't been read or written
+     *  for a long time, typically because the script has changed.
+     */
+    void prune() const;
+
+    /*! Return the commands of the script in the file at path, or nullptr
+     *  and an error message if the file can't be read or parsed.
+     */
+    std::shared_ptr<const CompiledScript> load(const fs::path& path,
+                                               const std::shared_ptr<ScriptMaps>& scriptMaps,
+                                               std::string& errorMsg);
+
+ private:
+    struct Entry
+    {
+        fs::file_time_type modified;
+        std::uintmax_t size;
+        std::shared_ptr<const CompiledScript> script;
+    };
+
+    std::unordered_map<std::string, Entry> scripts;
+    fs::path directory;
+};
+
+} // end namespace celestia::scripts
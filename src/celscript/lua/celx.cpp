@@ -11,6 +11,7 @@
 // of the License, or (at your option) any later version.
 
 #include <config.h>
+#include <algorithm>
 #include <cassert>
 #include <ctime>
 #include <map>
@@ -69,6 +70,12 @@ const char* CelxLua::ClassNames[] =
 // returning control to celestia
 static const double MaxTimeslice = 5.0;
 
+// Lua code may only be suspended from the instruction count hook where the
+// hook can check that this is safe, which requires lua_isyieldable()
+#if LUA_VERSION_NUM >= 503
+#define CELX_YIELDABLE_HOOKS
+#endif
+
 // names of callback-functions in Lua:
 const char* KbdCallback = "celestia_keyboard_callback";
 const char* CleanupCallback = "celestia_cleanup_callback";
@@ -235,7 +242,8 @@ double LuaState::getTime() const
 
 
 // Check if the running script has exceeded its allowed timeslice
-// and terminate it if it has:
+// and terminate it if it has, or suspend it until the next frame if it
+// has used up its frame budget:
 static void checkTimeslice(lua_State* l, lua_Debug* /*ar*/)
 {
     lua_pushstring(l, "celestia-luastate");
@@ -252,6 +260,7 @@ static void checkTimeslice(lua_State* l, lua_Debug* /*ar*/)
         lua_error(l);
         return;
     }
+    lua_pop(l, 1);
 
     if (luastate->timesliceExpired())
     {
@@ -260,6 +269,14 @@ static void checkTimeslice(lua_State* l, lua_Debug* /*ar*/)
         lua_pushstring(l, errormsg);
         lua_error(l);
     }
+
+#ifdef CELX_YIELDABLE_HOOKS
+    // Code run with lua_pcall can't yield. Coroutines created by the script
+    // inherit this hook and are yieldable too, but suspending one would
+    // return control to the script instead of to celestia.
+    if (lua_isyieldable(l) && luastate->yieldForFrameBudget(l))
+        lua_yield(l, 0);
+#endif
 }
 
 
@@ -333,6 +350,80 @@ string LuaState::getErrorMessage()
 }
 
 
+void LuaState::setFrameBudget(double budget)
+{
+    frameBudget = budget;
+}
+
+
+double LuaState::getFrameBudget() const
+{
+    return frameBudget;
+}
+
+
+bool LuaState::isFrameBudgetSupported()
+{
+#ifdef CELX_YIELDABLE_HOOKS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+// Return true if the code running in thread l has used up its frame budget,
+// recording that it's about to be suspended. Only the script coroutine and
+// the tick hook coroutine are suspended by the budget.
+bool LuaState::yieldForFrameBudget(const lua_State* l)
+{
+    if ((l != costate && l != hookThread) || getTime() <= runEndTime)
+        return false;
+
+    yieldedForBudget = true;
+    return true;
+}
+
+
+const LuaState::ExecutionStats& LuaState::getExecutionStats() const
+{
+    return stats;
+}
+
+
+void LuaState::logExecutionStats(const char* name) const
+{
+    if (stats.runs == 0)
+        return;
+
+    GetLogger()->info(_("{}: {} runs, {} deferred to a later frame, {:.1f} ms total, {:.0f} us longest\n"),
+                      name, stats.runs, stats.deferred,
+                      stats.totalTime * 1.0e3, stats.maxTime * 1.0e6);
+}
+
+
+// Start timing a run of Lua code and set the time at which it's suspended
+void LuaState::beginRun()
+{
+    runStartTime = getTime();
+    runEndTime = frameBudget > 0.0 ? runStartTime + frameBudget : std::numeric_limits<double>::infinity();
+    yieldedForBudget = false;
+}
+
+
+void LuaState::endRun()
+{
+    double elapsed = getTime() - runStartTime;
+    stats.runs++;
+    if (yieldedForBudget)
+        stats.deferred++;
+    stats.totalTime += elapsed;
+    stats.maxTime = std::max(stats.maxTime, elapsed);
+    stats.lastTime = elapsed;
+    runEndTime = std::numeric_limits<double>::infinity();
+}
+
+
 bool LuaState::timesliceExpired()
 {
     if (timeout < getTime())
@@ -346,7 +437,10 @@ bool LuaState::timesliceExpired()
 }
 
 
-static int resumeLuaThread(lua_State *L, lua_State *co, int narg)
+// If budgetYield is set when the thread returns, it was suspended by the
+// frame budget rather than by the script. It has no results then, and the
+// values on its stack belong to the suspended function.
+static int resumeLuaThread(lua_State *L, lua_State *co, int narg, const bool& budgetYield)
 {
     int status;
 
@@ -361,6 +455,9 @@ static int resumeLuaThread(lua_State *L, lua_State *co, int narg)
 #else
     status = lua_resume(co, narg);
 #endif
+    if (status == LUA_YIELD && budgetYield)
+        return 0;
+
     if (status == 0 || status == LUA_YIELD)
     {
         int nres = lua_gettop(co);
@@ -616,7 +713,10 @@ bool LuaState::handleTickEvent(double dt)
         lua_settable(costate, -3);
 
         timeout = getTime() + 1.0;
-        if (lua_pcall(costate, 1, 1, 0) != 0)
+        beginRun();
+        int status = lua_pcall(costate, 1, 1, 0);
+        endRun();
+        if (status != 0)
         {
             GetLogger()->error("Error while executing tick callback: {}\n",
                                lua_tostring(costate, -1));
@@ -684,7 +784,9 @@ int LuaState::resume()
         return 0;
 
     timeout = getTime() + MaxTimeslice;
-    int nArgs = resumeLuaThread(state, co, 0);
+    beginRun();
+    int nArgs = resumeLuaThread(state, co, 0, yieldedForBudget);
+    endRun();
     if (nArgs < 0)
     {
         alive = false;
@@ -1354,6 +1456,11 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
     if (!eventHandlerEnabled)
         return false;
 
+    // A call that was suspended is completed even if the budget has been
+    // removed since
+    if ((frameBudget > 0.0 || hookPending) && isFrameBudgetSupported())
+        return resumeLuaHook(obj, method, dt);
+
     lua_pushlightuserdata(costate, obj);
     lua_gettable(costate, LUA_REGISTRYINDEX);
     if (!lua_istable(costate, -1))
@@ -1372,7 +1479,10 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
         lua_pushnumber(costate, dt);
 
         timeout = getTime() + 1.0;
-        if (lua_pcall(costate, 2, 1, 0) != 0)
+        beginRun();
+        int status = lua_pcall(costate, 2, 1, 0);
+        endRun();
+        if (status != 0)
         {
             GetLogger()->error("Error while executing Lua Hook: {}\n",
                                lua_tostring(costate, -1));
@@ -1392,6 +1502,89 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
 }
 
 
+// Call a hook method with a time argument in a coroutine, so that it can be
+// suspended by the frame budget. A suspended call is continued by the next
+// calls until it completes, and the calls that continue it are dropped.
+bool LuaState::resumeLuaHook(void* obj, const char* method, double dt)
+{
+#ifdef CELX_YIELDABLE_HOOKS
+    int nArgs = 0;
+    if (!hookPending)
+    {
+        lua_pushlightuserdata(costate, obj);
+        lua_gettable(costate, LUA_REGISTRYINDEX);
+        if (!lua_istable(costate, -1))
+        {
+            lua_pop(costate, 1);
+            return false;
+        }
+
+        lua_pushstring(costate, method);
+        lua_gettable(costate, -2);
+        if (!lua_isfunction(costate, -1))
+        {
+            lua_pop(costate, 2);
+            return false;
+        }
+
+        if (hookThread == nullptr)
+        {
+            hookThread = lua_newthread(costate);
+            hookThreadRef = luaL_ref(costate, LUA_REGISTRYINDEX);
+            lua_sethook(hookThread, checkTimeslice, LUA_MASKCOUNT, 1000);
+        }
+
+        lua_insert(costate, -2);             // move the Lua object above the method
+        lua_xmove(costate, hookThread, 2);
+        lua_pushnumber(hookThread, dt);
+        nArgs = 2;
+    }
+
+    timeout = getTime() + 1.0;
+    beginRun();
+#if LUA_VERSION_NUM >= 504
+    int nResults;
+    int status = lua_resume(hookThread, costate, nArgs, &nResults);
+#else
+    int status = lua_resume(hookThread, costate, nArgs);
+    int nResults = lua_gettop(hookThread);
+#endif
+    endRun();
+
+    bool handled = false;
+    if (status == LUA_YIELD)
+    {
+        // Values yielded by the method itself are dropped; after a yield
+        // for the frame budget the stack belongs to the suspended method
+        if (!yieldedForBudget)
+            lua_settop(hookThread, 0);
+        hookPending = true;
+    }
+    else if (status == 0)
+    {
+        handled = nResults > 0 && lua_toboolean(hookThread, -nResults) == 1;
+        lua_settop(hookThread, 0);
+        hookPending = false;
+    }
+    else
+    {
+        GetLogger()->error("Error while executing Lua Hook: {}\n",
+                           lua_tostring(hookThread, -1));
+
+        // A thread can't be resumed after an error; use a new one
+        luaL_unref(costate, LUA_REGISTRYINDEX, hookThreadRef);
+        hookThread = nullptr;
+        hookThreadRef = LUA_NOREF;
+        hookPending = false;
+    }
+
+    return handled;
+#else
+    return false;
+#endif
+}
+
+
 /**** Implementation of Celx LuaState wrapper ****/
 
 bool CelxLua::isValid(int i) const
@@ -11,7 +11,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <vector>
 #include <lua.hpp>
@@ -33,6 +35,18 @@ class View;
 class LuaState
 {
 public:
+    // Time spent running the Lua code of a state: the script coroutine,
+    // and the tick event handler or tick hook. Times are in seconds.
+    struct ExecutionStats
+    {
+        std::uint64_t runs{ 0 };
+        // Runs that were suspended by the frame budget
+        std::uint64_t deferred{ 0 };
+        double totalTime{ 0.0 };
+        double maxTime{ 0.0 };
+        double lastTime{ 0.0 };
+    };
+
     LuaState();
     ~LuaState();
 
@@ -52,6 +66,16 @@ public:
     bool timesliceExpired();
     void requestIO();
 
+    // Limit the time in seconds that the script coroutine and the tick hook
+    // may run per frame; when it's used up they are suspended and continue
+    // on the next frame. Zero removes the limit. Suspending Lua code from a
+    // hook requires Lua 5.3 or later; see isFrameBudgetSupported().
+    void setFrameBudget(double);
+    double getFrameBudget() const;
+    static bool isFrameBudgetSupported();
+    bool yieldForFrameBudget(const lua_State*);
+    const ExecutionStats& getExecutionStats() const;
+
     bool charEntered(const char*);
     double getTime() const;
     int screenshotCount;
@@ -72,6 +96,7 @@ public:
     bool callLuaHook(void* obj, const char* method, float x, float y);
     bool callLuaHook(void* obj, const char* method, float x, float y, int b);
     bool callLuaHook(void* obj, const char* method, double dt);
+    void logExecutionStats(const char* name) const;
 
     enum IOMode {
         NoIO = 1,
@@ -81,6 +106,10 @@ public:
     };
 
 private:
+    void beginRun();
+    void endRun();
+    bool resumeLuaHook(void* obj, const char* method, double dt);
+
     lua_State* state;
     lua_State* costate{ nullptr }; // coroutine stack
     bool alive{ false };
@@ -88,6 +117,18 @@ private:
     double scriptAwakenTime{ 0.0 };
     IOMode ioMode{ NoIO };
     bool eventHandlerEnabled{ false };
+
+    double frameBudget{ 0.0 };
+    double runStartTime{ 0.0 };
+    double runEndTime{ std::numeric_limits<double>::infinity() };
+    bool yieldedForBudget{ false };
+    ExecutionStats stats;
+
+    // Coroutine for tick hook calls, and whether one was suspended by the
+    // frame budget and must be continued
+    lua_State* hookThread{ nullptr };
+    int hookThreadRef{ LUA_NOREF };
+    bool hookPending{ false };
 };
 
 View* getViewByObserver(CelestiaCore*, Observer*);
@@ -9,6 +9,9 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <optional>
 #include <fmt/format.h>
 #include "celx.h"
@@ -1077,6 +1080,144 @@ static int celestia_find(lua_State* l)
     return 1;
 }
 
+static std::size_t celx_arraylength(lua_State* l, int index)
+{
+#if LUA_VERSION_NUM >= 502
+    return lua_rawlen(l, index);
+#else
+    return lua_objlen(l, index);
+#endif
+}
+
+// Bulk position query: celestia:getpositions(objects, times [, center [, velocities]])
+// Returns a table with a flat array 'positions' holding x, y, z in km for
+// each (object, time) pair, times varying fastest, i.e. the coordinates of
+// objects[i] at times[j] start at index ((i - 1) * #times + (j - 1)) * 3 + 1.
+// Positions are relative to the center object, or to the universal origin if
+// no center is given. If velocities is true, a 'velocities' array in km/s
+// with the same layout is returned as well.
+static int celestia_getpositions(lua_State* l)
+{
+    Celx_CheckArgs(l, 3, 5, "Two to four arguments expected for celestia:getpositions()");
+    this_celestia(l);
+
+    if (!lua_istable(l, 2))
+    {
+        Celx_DoError(l, "First argument to celestia:getpositions() must be a table of objects");
+        return 0;
+    }
+    if (!lua_istable(l, 3))
+    {
+        Celx_DoError(l, "Second argument to celestia:getpositions() must be a table of times");
+        return 0;
+    }
+
+    Selection center;
+    if (!lua_isnoneornil(l, 4))
+    {
+        Selection* sel = to_object(l, 4);
+        if (sel == nullptr)
+        {
+            Celx_DoError(l, "Third argument to celestia:getpositions() must be an object");
+            return 0;
+        }
+        center = *sel;
+    }
+    bool withVelocities = lua_toboolean(l, 5) != 0;
+
+    // The result arrays hold three numbers per object and time, and Lua
+    // array indices are ints.
+    std::size_t nObjects = celx_arraylength(l, 2);
+    std::size_t nTimes = celx_arraylength(l, 3);
+    constexpr auto maxCount = static_cast<std::size_t>(std::numeric_limits<int>::max());
+    if (nObjects > 0 && nTimes > maxCount / 3 / nObjects)
+    {
+        Celx_DoError(l, "Too many positions requested from celestia:getpositions()");
+        return 0;
+    }
+
+    std::vector<Selection> objects;
+    objects.reserve(nObjects);
+    for (std::size_t i = 1; i <= nObjects; i++)
+    {
+        lua_rawgeti(l, 2, static_cast<int>(i));
+        Selection* sel = to_object(l, -1);
+        lua_pop(l, 1);
+        if (sel == nullptr)
+        {
+            Celx_DoError(l, "Table of objects passed to celestia:getpositions() contains a non-object");
+            return 0;
+        }
+        objects.push_back(*sel);
+    }
+
+    std::vector<double> times;
+    times.reserve(nTimes);
+    for (std::size_t i = 1; i <= nTimes; i++)
+    {
+        lua_rawgeti(l, 3, static_cast<int>(i));
+        if (!lua_isnumber(l, -1))
+        {
+            lua_pop(l, 1);
+            Celx_DoError(l, "Table of times passed to celestia:getpositions() contains a non-number");
+            return 0;
+        }
+        times.push_back(lua_tonumber(l, -1));
+        lua_pop(l, 1);
+    }
+
+    // Evaluate the center once per time rather than once per object.
+    std::vector<UniversalCoord> centerPositions(nTimes, UniversalCoord::Zero());
+    std::vector<Vector3d> centerVelocities(nTimes, Vector3d::Zero());
+    if (!center.empty())
+    {
+        for (std::size_t j = 0; j < nTimes; j++)
+        {
+            centerPositions[j] = center.getPosition(times[j]);
+            if (withVelocities)
+                centerVelocities[j] = center.getVelocity(times[j]);
+        }
+    }
+
+    // Orbit evaluation is not thread safe (cached and scripted orbits), so
+    // the results are computed serially; the saving comes from staying in
+    // C++ and filling preallocated arrays.
+    int count = static_cast<int>(nObjects * nTimes * 3);
+    lua_createtable(l, 0, 2);
+    lua_createtable(l, count, 0);
+    if (withVelocities)
+        lua_createtable(l, count, 0);
+    int positionsIndex = withVelocities ? -2 : -1;
+
+    int index = 1;
+    for (const Selection& sel : objects)
+    {
+        for (std::size_t j = 0; j < nTimes; j++)
+        {
+            Vector3d pos = sel.getPosition(times[j]).offsetFromKm(centerPositions[j]);
+            Vector3d vel = withVelocities
+                ? Vector3d((sel.getVelocity(times[j]) - centerVelocities[j]) / SECONDS_PER_DAY)
+                : Vector3d::Zero();
+            for (int k = 0; k < 3; k++, index++)
+            {
+                lua_pushnumber(l, pos[k]);
+                lua_rawseti(l, positionsIndex - 1, index);
+                if (withVelocities)
+                {
+                    lua_pushnumber(l, vel[k]);
+                    lua_rawseti(l, -2, index);
+                }
+            }
+        }
+    }
+
+    if (withVelocities)
+        lua_setfield(l, -3, "velocities");
+    lua_setfield(l, -2, "positions");
+
+    return 1;
+}
+
 static int celestia_select(lua_State* l)
 {
     Celx_CheckArgs(l, 2, 2, "One argument expected for celestia:select()");
@@ -1426,6 +1567,142 @@ static int celestia_stars(lua_State* l)
 }
 
 
+template<typename T>
+static void pushObjectList(lua_State* l, const vector<const T*>& objects)
+{
+    lua_createtable(l, static_cast<int>(objects.size()), 0);
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        object_new(l, Selection(const_cast<T*>(objects[i])));
+        lua_rawseti(l, -2, i + 1);
+    }
+}
+
+
+// Shared implementation of celestia:getnearstars() and celestia:getneardsos():
+// (position, maxdistance [, count]). Without a count all objects within
+// maxdistance light years are returned; with a count, the count nearest ones
+// sorted by distance.
+static int celestia_getnearobjects(lua_State* l, bool dsos, const char* name)
+{
+    Celx_CheckArgs(l, 3, 4, fmt::format("Two or three arguments expected for celestia:{}()", name).c_str());
+    CelestiaCore* appCore = this_celestia(l);
+    Universe* u = appCore->getSimulation()->getUniverse();
+
+    UniversalCoord* position = to_position(l, 2);
+    if (position == nullptr)
+    {
+        Celx_DoError(l, fmt::format("First argument to celestia:{}() must be a position", name).c_str());
+        return 0;
+    }
+    double maxDistance = Celx_SafeGetNumber(l, 3, AllErrors,
+                                            fmt::format("Second argument to celestia:{}() must be a number", name).c_str());
+    bool nearest = !lua_isnoneornil(l, 4);
+    double count = nearest ? Celx_SafeGetNumber(l, 4, AllErrors,
+                                                fmt::format("Third argument to celestia:{}() must be a number", name).c_str())
+                           : 0.0;
+    if (!std::isfinite(count))
+    {
+        Celx_DoError(l, fmt::format("Third argument to celestia:{}() must be a finite number", name).c_str());
+        return 0;
+    }
+
+    // Counts beyond the range of the search are the same as no limit
+    constexpr auto maxCount = static_cast<double>(std::numeric_limits<unsigned int>::max());
+    auto nearestCount = static_cast<unsigned int>(std::clamp(count, 0.0, maxCount));
+
+    if (dsos)
+    {
+        vector<const DeepSkyObject*> found;
+        if (nearest)
+            u->getNearestDSOs(*position, nearestCount, maxDistance, found);
+        else
+            u->getNearDSOs(*position, maxDistance, found);
+        pushObjectList(l, found);
+    }
+    else
+    {
+        vector<const Star*> found;
+        if (nearest)
+            u->getNearestStars(*position, nearestCount, static_cast<float>(maxDistance), found);
+        else
+            u->getNearStars(*position, static_cast<float>(maxDistance), found);
+        pushObjectList(l, found);
+    }
+
+    return 1;
+}
+
+
+static int celestia_getnearstars(lua_State* l)
+{
+    return celestia_getnearobjects(l, false, "getnearstars");
+}
+
+
+static int celestia_getneardsos(lua_State* l)
+{
+    return celestia_getnearobjects(l, true, "getneardsos");
+}
+
+
+// Shared implementation of celestia:getstarsincone() and celestia:getdsosincone():
+// (position, direction, halfangle [, maxdistance]). Returns the objects
+// within halfangle radians of the direction vector as seen from position,
+// sorted by distance.
+static int celestia_getobjectsincone(lua_State* l, bool dsos, const char* name)
+{
+    Celx_CheckArgs(l, 4, 5, fmt::format("Three or four arguments expected for celestia:{}()", name).c_str());
+    CelestiaCore* appCore = this_celestia(l);
+    Universe* u = appCore->getSimulation()->getUniverse();
+
+    UniversalCoord* origin = to_position(l, 2);
+    if (origin == nullptr)
+    {
+        Celx_DoError(l, fmt::format("First argument to celestia:{}() must be a position", name).c_str());
+        return 0;
+    }
+    Vector3d* direction = to_vector(l, 3);
+    if (direction == nullptr || direction->isZero())
+    {
+        Celx_DoError(l, fmt::format("Second argument to celestia:{}() must be a nonzero vector", name).c_str());
+        return 0;
+    }
+    double halfAngle = Celx_SafeGetNumber(l, 4, AllErrors,
+                                          fmt::format("Third argument to celestia:{}() must be a number", name).c_str());
+    double maxDistance = Celx_SafeGetNumber(l, 5, WrongType,
+                                            fmt::format("Fourth argument to celestia:{}() must be a number", name).c_str(),
+                                            dsos ? DSO_OCTREE_ROOT_SIZE : 1.0e9);
+
+    if (dsos)
+    {
+        vector<const DeepSkyObject*> found;
+        u->getDSOsInCone(*origin, *direction, halfAngle, maxDistance, found);
+        pushObjectList(l, found);
+    }
+    else
+    {
+        vector<const Star*> found;
+        u->getStarsInCone(*origin, *direction, halfAngle, static_cast<float>(maxDistance), found);
+        pushObjectList(l, found);
+    }
+
+    return 1;
+}
+
+
+static int celestia_getstarsincone(lua_State* l)
+{
+    return celestia_getobjectsincone(l, false, "getstarsincone");
+}
+
+
+static int celestia_getdsosincone(lua_State* l)
+{
+    return celestia_getobjectsincone(l, true, "getdsosincone");
+}
+
+
 static int celestia_getdsocount(lua_State* l)
 {
     Celx_CheckArgs(l, 1, 1, "No arguments expected to function celestia:getdsocount");
@@ -2557,6 +2834,7 @@ void CreateCelestiaMetaTable(lua_State* l)
     Celx_RegisterMethod(l, "getobservers", celestia_getobservers);
     Celx_RegisterMethod(l, "getselection", celestia_getselection);
     Celx_RegisterMethod(l, "find", celestia_find);
+    Celx_RegisterMethod(l, "getpositions", celestia_getpositions);
     Celx_RegisterMethod(l, "select", celestia_select);
     Celx_RegisterMethod(l, "mark", celestia_mark);
     Celx_RegisterMethod(l, "unmark", celestia_unmark);
@@ -2608,6 +2886,10 @@ void CreateCelestiaMetaTable(lua_State* l)
     Celx_RegisterMethod(l, "geteventhandler", celestia_geteventhandler);
     Celx_RegisterMethod(l, "stars", celestia_stars);
     Celx_RegisterMethod(l, "dsos", celestia_dsos);
+    Celx_RegisterMethod(l, "getnearstars", celestia_getnearstars);
+    Celx_RegisterMethod(l, "getneardsos", celestia_getneardsos);
+    Celx_RegisterMethod(l, "getstarsincone", celestia_getstarsincone);
+    Celx_RegisterMethod(l, "getdsosincone", celestia_getdsosincone);
     Celx_RegisterMethod(l, "windowbordersvisible", celestia_windowbordersvisible);
     Celx_RegisterMethod(l, "setwindowbordersvisible", celestia_setwindowbordersvisible);
     Celx_RegisterMethod(l, "seturl", celestia_seturl);
@@ -2741,6 +3023,51 @@ static int celestia_settimeslice(lua_State* l)
     return 0;
 }
 
+static int celestia_setframebudget(lua_State* l)
+{
+    Celx_CheckArgs(l, 2, 2, "One argument required for celestia:setframebudget");
+
+    double budget = Celx_SafeGetNumber(l, 2, AllErrors, "Argument to celestia:setframebudget must be a number");
+    if (budget < 0.0)
+    {
+        Celx_DoError(l, "Argument to celestia:setframebudget must not be negative");
+        return 0;
+    }
+
+    // The budget is given in microseconds
+    LuaState* luastate = getLuaStateObject(l);
+    luastate->setFrameBudget(budget * 1.0e-6);
+
+    return 0;
+}
+
+static int celestia_getframebudget(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 1, "No arguments expected for celestia:getframebudget");
+
+    LuaState* luastate = getLuaStateObject(l);
+    lua_pushnumber(l, luastate->getFrameBudget() * 1.0e6);
+
+    return 1;
+}
+
+static int celestia_getscriptstats(lua_State* l)
+{
+    CelxLua celx(l);
+    celx.checkArgs(1, 1, "No arguments expected for celestia:getscriptstats");
+
+    // Times are reported in microseconds, like the frame budget
+    const LuaState::ExecutionStats& stats = getLuaStateObject(l)->getExecutionStats();
+    lua_newtable(l);
+    celx.setTable("runs", static_cast<lua_Number>(stats.runs));
+    celx.setTable("deferred", static_cast<lua_Number>(stats.deferred));
+    celx.setTable("totaltime", stats.totalTime * 1.0e6);
+    celx.setTable("maxtime", stats.maxTime * 1.0e6);
+    celx.setTable("lasttime", stats.lastTime * 1.0e6);
+
+    return 1;
+}
+
 static int celestia_setluahook(lua_State* l)
 {
     Celx_CheckArgs(l, 2, 2, "One argument required for celestia:setluahook");
@@ -2875,6 +3202,9 @@ void ExtendCelestiaMetaTable(lua_State* l)
         cout << "Metatable for " << CelxLua::ClassNames[Celx_Celestia] << " not found!\n";
     celx.registerMethod("log", celestia_log);
     celx.registerMethod("settimeslice", celestia_settimeslice);
+    celx.registerMethod("setframebudget", celestia_setframebudget);
+    celx.registerMethod("getframebudget", celestia_getframebudget);
+    celx.registerMethod("getscriptstats", celestia_getscriptstats);
     celx.registerMethod("setluahook", celestia_setluahook);
     celx.registerMethod("getparamstring", celestia_getparamstring);
     celx.registerMethod("getfont", celestia_getfont);
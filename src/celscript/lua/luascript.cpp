@@ -39,10 +39,12 @@ LuaScript::LuaScript(CelestiaCore *appcore) :
 LuaScript::~LuaScript()
 {
     m_celxScript->cleanup();
+    m_celxScript->logExecutionStats(m_path.filename().string().c_str());
 }
 
 bool LuaScript::load(ifstream &scriptfile, const fs::path &path, string &errorMsg)
 {
+    m_path = path;
     if (m_celxScript->loadScript(scriptfile, path) != 0)
     {
         errorMsg = m_celxScript->getErrorMessage();
@@ -92,6 +94,7 @@ unique_ptr<IScript> LuaScriptPlugin::loadScript(const fs::path &path)
     }
 
     auto script = unique_ptr<LuaScript>(new LuaScript(appCore()));
+    script->m_celxScript->setFrameBudget(appCore()->getConfig()->scriptFrameBudget * 1.0e-6);
     string errMsg;
     if (!script->load(scriptfile, path, errMsg))
     {
@@ -205,6 +208,10 @@ bool CreateLuaEnvironment(CelestiaCore *appCore, const CelestiaConfig *config, P
     luaHook->allowSystemAccess();
     luaHook->setLuaPath(LuaPath);
 
+    if (config->scriptFrameBudget > 0.0 && !LuaState::isFrameBudgetSupported())
+        GetLogger()->warn(_("ScriptFrameBudget requires Lua 5.3 or later and will be ignored\n"));
+    luaHook->setFrameBudget(config->scriptFrameBudget * 1.0e-6);
+
     int status = 0;
     // Execute the Lua hook initialization script
     if (!config->luaHook.empty())
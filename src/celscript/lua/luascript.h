@@ -37,6 +37,7 @@ class LuaScript : public IScript
  private:
     CelestiaCore *m_appCore;
     std::unique_ptr<LuaState> m_celxScript;
+    fs::path m_path;
 
     friend class LuaScriptPlugin;
 };
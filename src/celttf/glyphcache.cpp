@@ -0,0 +1,118 @@
+// glyphcache.cpp
+//
+// Copyright (C) 2023-present, Celestia Development Team
+//
+// On-disk cache of rasterized glyph bitmaps.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
+#include <celutil/fnv.h>
+#include "glyphcache.h"
+
+namespace celutil = celestia::util;
+
+namespace
+{
+
+constexpr std::string_view GlyphCacheHeader = "CELGLYPHS";
+constexpr std::uint32_t GlyphCacheVersion = 1;
+
+} // namespace
+
+fs::path
+GetGlyphCacheFileName(std::string_view key)
+{
+    return fmt::format("{:016x}.glyphs", celutil::FNV1a64(key));
+}
+
+GlyphCacheStatus
+ReadGlyphCache(std::istream &in,
+               std::string_view key,
+               unsigned int maxGlyphSize,
+               GlyphBitmaps &bitmaps)
+{
+    char header[GlyphCacheHeader.size()];
+    std::uint32_t version;
+    std::uint32_t keyLength;
+    if (!in.read(header, sizeof(header)).good() ||
+        std::string_view(header, sizeof(header)) != GlyphCacheHeader ||
+        !celutil::readLE<std::uint32_t>(in, version) || version != GlyphCacheVersion ||
+        !celutil::readLE<std::uint32_t>(in, keyLength) || keyLength != key.size())
+    {
+        return GlyphCacheStatus::Outdated;
+    }
+
+    std::string fileKey(keyLength, '\0');
+    if (!in.read(fileKey.data(), keyLength).good() || fileKey != key)
+        return GlyphCacheStatus::Outdated;
+
+    std::uint32_t count;
+    if (!celutil::readLE<std::uint32_t>(in, count))
+        return GlyphCacheStatus::Damaged;
+
+    GlyphBitmaps result;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        std::uint32_t ch, bw, bh;
+        std::int32_t ax, ay, bl, bt;
+        if (!celutil::readLE<std::uint32_t>(in, ch) ||
+            !celutil::readLE<std::int32_t>(in, ax) ||
+            !celutil::readLE<std::int32_t>(in, ay) ||
+            !celutil::readLE<std::uint32_t>(in, bw) ||
+            !celutil::readLE<std::uint32_t>(in, bh) ||
+            !celutil::readLE<std::int32_t>(in, bl) ||
+            !celutil::readLE<std::int32_t>(in, bt) ||
+            bw > maxGlyphSize || bh > maxGlyphSize)
+        {
+            return GlyphCacheStatus::Damaged;
+        }
+
+        GlyphBitmap bitmap;
+        bitmap.glyph = { static_cast<wchar_t>(ch), ax, ay, bw, bh, bl, bt, 0.0f, 0.0f, -1 };
+        bitmap.pixels.resize(static_cast<std::size_t>(bw) * bh);
+        if (!in.read(reinterpret_cast<char *>(bitmap.pixels.data()), bitmap.pixels.size()).good())
+            return GlyphCacheStatus::Damaged;
+
+        result[bitmap.glyph.ch] = std::move(bitmap);
+    }
+
+    bitmaps = std::move(result);
+    return GlyphCacheStatus::Loaded;
+}
+
+bool
+WriteGlyphCache(std::ostream &out,
+                std::string_view key,
+                const GlyphBitmaps &bitmaps)
+{
+    out.write(GlyphCacheHeader.data(), GlyphCacheHeader.size());
+    celutil::writeLE<std::uint32_t>(out, GlyphCacheVersion);
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(key.size()));
+    out.write(key.data(), key.size());
+    celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(bitmaps.size()));
+    for (const auto &[ch, bitmap] : bitmaps)
+    {
+        const Glyph &g = bitmap.glyph;
+        celutil::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(ch));
+        celutil::writeLE<std::int32_t>(out, g.ax);
+        celutil::writeLE<std::int32_t>(out, g.ay);
+        celutil::writeLE<std::uint32_t>(out, g.bw);
+        celutil::writeLE<std::uint32_t>(out, g.bh);
+        celutil::writeLE<std::int32_t>(out, g.bl);
+        celutil::writeLE<std::int32_t>(out, g.bt);
+        out.write(reinterpret_cast<const char *>(bitmap.pixels.data()), bitmap.pixels.size());
+    }
+
+    return out.good();
+}
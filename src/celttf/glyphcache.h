@@ -0,0 +1,76 @@
+// glyphcache.h
+//
+// Copyright (C) 2023-present, Celestia Development Team
+//
+// On-disk cache of rasterized glyph bitmaps.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+
+struct Glyph
+{
+    wchar_t ch;
+
+    int ax; // advance.x
+    int ay; // advance.y
+
+    unsigned int bw; // bitmap.width;
+    unsigned int bh; // bitmap.height;
+
+    int bl; // bitmap_left;
+    int bt; // bitmap_top;
+
+    float tx; // x offset of glyph in texture coordinates
+    float ty; // y offset of glyph in texture coordinates
+
+    int page; // atlas page holding the glyph bitmap, -1 if none
+};
+
+// Rasterized glyph, kept so that it can be written to the glyph cache
+struct GlyphBitmap
+{
+    Glyph glyph;
+    std::vector<std::uint8_t> pixels;
+};
+
+using GlyphBitmaps = std::unordered_map<wchar_t, GlyphBitmap>;
+
+enum class GlyphCacheStatus
+{
+    Loaded,
+    Outdated,   // written for another font, size or FreeType version
+    Damaged,
+};
+
+/*! The glyph cache holds the bitmaps of every glyph rendered with a font
+ *  at a given size and resolution, so that they don't need to be
+ *  rasterized again the next time the font is loaded. The key identifies
+ *  everything that affects rasterization; it's stored in the file and
+ *  must match when reading it.
+ */
+fs::path GetGlyphCacheFileName(std::string_view key);
+
+/*! Read a glyph cache into bitmaps. Glyphs wider or taller than
+ *  maxGlyphSize are treated as damage. bitmaps is only modified when the
+ *  cache is loaded.
+ */
+GlyphCacheStatus ReadGlyphCache(std::istream& in,
+                                std::string_view key,
+                                unsigned int maxGlyphSize,
+                                GlyphBitmaps& bitmaps);
+
+bool WriteGlyphCache(std::ostream& out,
+                     std::string_view key,
+                     const GlyphBitmaps& bitmaps);
@@ -9,44 +9,28 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <celcompat/charconv.h>
 #include <celengine/glsupport.h>
 #include <celengine/render.h>
 #include <celutil/logger.h>
 #include <celutil/utf8.h>
+#include <fmt/format.h>
+#include <fstream>
 #include <ft2build.h>
 #include <map>
 #include <system_error>
+#include <unordered_map>
 #include <vector>
 #include FT_FREETYPE_H
+#include "glyphcache.h"
 #include "truetypefont.h"
 
 #define DUMP_TEXTURE 0
 
-#if DUMP_TEXTURE
-#include <fstream>
-#endif
-
 using celestia::compat::from_chars;
 using celestia::util::GetLogger;
 
-struct Glyph
-{
-    wchar_t ch;
-
-    int ax; // advance.x
-    int ay; // advance.y
-
-    unsigned int bw; // bitmap.width;
-    unsigned int bh; // bitmap.height;
-
-    int bl; // bitmap_left;
-    int bt; // bitmap_top;
-
-    float tx; // x offset of glyph in texture coordinates
-    float ty; // y offset of glyph in texture coordinates
-};
-
 struct UnicodeBlock
 {
     wchar_t first, last;
@@ -56,61 +40,86 @@ struct TextureFontPrivate
 {
     struct FontVertex
     {
-        FontVertex(float _x, float _y, float _u, float _v) : x(_x), y(_y), u(_u), v(_v)
+        FontVertex(float _x, float _y, float _z, float _u, float _v, Color _color) :
+            x(_x), y(_y), z(_z), u(_u), v(_v), color(_color)
         {
         }
-        float x, y;
+        float x, y, z;
         float u, v;
+        Color color;
+    };
+
+    // Glyphs are packed into fixed size texture pages, row by row; a page
+    // is never repacked, so adding a glyph doesn't move the others and
+    // text queued for drawing stays valid.
+    struct AtlasPage
+    {
+        GLuint texName{ 0 };
+        int    shelfX{ 0 };
+        int    shelfY{ 0 };
+        int    shelfHeight{ 0 };
+
+        std::vector<FontVertex> vertices; // queued quads using this page
     };
 
     TextureFontPrivate(const Renderer *renderer);
     ~TextureFontPrivate();
     TextureFontPrivate() = delete;
-    TextureFontPrivate(const TextureFontPrivate &) = default;
-    TextureFontPrivate(TextureFontPrivate &&) = default;
-    TextureFontPrivate &operator=(const TextureFontPrivate &) = default;
-    TextureFontPrivate &operator=(TextureFontPrivate &&) = default;
+    TextureFontPrivate(const TextureFontPrivate &) = delete;
+    TextureFontPrivate(TextureFontPrivate &&) = delete;
+    TextureFontPrivate &operator=(const TextureFontPrivate &) = delete;
+    TextureFontPrivate &operator=(TextureFontPrivate &&) = delete;
 
-    float render(std::string_view s, float x, float y);
+    float render(std::string_view s, float x, float y, float z, bool vertexColors, Color color);
     float render(wchar_t ch, float xoffset, float yoffset);
 
     bool               buildAtlas();
-    void               computeTextureSize();
-    bool               loadGlyphInfo(wchar_t /*ch*/, Glyph & /*c*/) const;
-    void               initCommonGlyphs();
-    int                getCommonGlyphsCount();
+    const GlyphBitmap *rasterize(wchar_t /*ch*/);
+    bool               loadGlyph(wchar_t /*ch*/, Glyph & /*c*/);
+    bool               addToAtlas(Glyph & /*c*/, const std::uint8_t * /*pixels*/);
+    bool               addPage();
     Glyph &            getGlyph(wchar_t /*ch*/);
     Glyph &            getGlyph(wchar_t /*ch*/, wchar_t /*fallback*/);
     [[nodiscard]] int  toPos(wchar_t /*ch*/) const;
-    void               optimize();
+    void               addQuad(const Glyph & /*g*/, float x1, float y1, float z, Color color);
+    void               setVertexColors(bool /*vertexColors*/);
     CelestiaGLProgram *getProgram();
     void               flush();
 
+    void               readGlyphCache();
+    void               writeGlyphCache() const;
+
     const Renderer    *m_renderer;
     CelestiaGLProgram *m_prog{ nullptr };
 
-    FT_Face m_face; // font face
+    FT_Face m_face{ nullptr }; // font face
 
     int m_maxAscent{ 0 };
     int m_maxDescent{ 0 };
     int m_maxWidth{ 0 };
 
-    int m_texWidth{ 0 };
-    int m_texHeight{ 0 };
+    int m_pageSize{ 0 }; // width and height of each atlas page
 
-    GLuint             m_texName{ 0 };   // texture object
-    std::vector<Glyph> m_glyphs;         // character information
-    GLint              m_maxTextureSize; // max supported texture size
+    std::vector<AtlasPage> m_pages;
+    std::vector<Glyph>     m_glyphs;      // common glyphs, indexed by toPos()
+    std::unordered_map<wchar_t, Glyph> m_otherGlyphs;
+    GLint                  m_maxTextureSize; // max supported texture size
 
     std::array<UnicodeBlock, 2> m_unicodeBlocks;
-    int                         m_commonGlyphsCount{ 0 };
-
-    int m_inserted{ 0 };
 
-    Eigen::Matrix4f         m_projection;
-    Eigen::Matrix4f         m_modelView;
-    bool                    m_shaderInUse{ false };
-    std::vector<FontVertex> m_fontVertices;
+    // Bitmaps of all rasterized glyphs, by character; only kept when they
+    // will be written to the glyph cache
+    GlyphBitmaps m_bitmaps;
+    GlyphBitmap  m_scratchBitmap;
+    fs::path    m_cachePath;
+    std::string m_cacheKey;
+    bool        m_cacheDirty{ false };
+
+    Eigen::Matrix4f m_projection;
+    Eigen::Matrix4f m_modelView;
+    bool            m_shaderInUse{ false };
+    bool            m_vertexColors{ false }; // queued text has per vertex colors
+    std::vector<unsigned short> m_indexes;
 };
 
 namespace
@@ -122,7 +131,12 @@ pt_to_px(float pt, int dpi = 96)
     return dpi == 0 ? pt : pt / 72.0f * static_cast<float>(dpi);
 }
 
-Glyph g_badGlyph = { 0, 0, 0, 0, 0, 0, 0, 0.0f, 0.0f };
+Glyph g_badGlyph = { 0, 0, 0, 0, 0, 0, 0, 0.0f, 0.0f, -1 };
+
+// Number of quads that can be drawn at once with 16-bit indices
+constexpr std::size_t MaxQuadsPerDraw = 65536 / 4;
+
+fs::path g_glyphCacheDirectory;
 
 } // namespace
 
@@ -141,107 +155,85 @@ TextureFontPrivate::TextureFontPrivate(const Renderer *renderer) : m_renderer(re
 
 TextureFontPrivate::~TextureFontPrivate()
 {
+    if (m_cacheDirty) writeGlyphCache();
+
     if (m_face != nullptr) FT_Done_Face(m_face);
-    if (m_texName != 0) glDeleteTextures(1, &m_texName);
+    for (const auto &page : m_pages)
+        glDeleteTextures(1, &page.texName);
 }
 
-bool
-TextureFontPrivate::loadGlyphInfo(wchar_t ch, Glyph &c) const
+/*
+ * Return the bitmap of a glyph, from the glyph cache if it's there and
+ * rendered with FreeType otherwise. Without a glyph cache, the bitmap is
+ * only valid until the next call.
+ */
+const GlyphBitmap *
+TextureFontPrivate::rasterize(wchar_t ch)
 {
+    if (auto it = m_bitmaps.find(ch); it != m_bitmaps.end())
+        return &it->second;
+
     FT_GlyphSlot g = m_face->glyph;
     if (FT_Load_Char(m_face, ch, FT_LOAD_RENDER) != 0)
-    {
-        c.ch = 0;
-        return false;
-    }
-
-    c.ch = ch;
-    c.ax = g->advance.x >> 6;
-    c.ay = g->advance.y >> 6;
-    c.bw = g->bitmap.width;
-    c.bh = g->bitmap.rows;
-    c.bl = g->bitmap_left;
-    c.bt = g->bitmap_top;
-    return true;
-}
-
-void
-TextureFontPrivate::initCommonGlyphs()
-{
-    if (!m_glyphs.empty()) return;
+        return nullptr;
 
-    m_glyphs.reserve(256);
+    GlyphBitmap &bitmap = m_cachePath.empty() ? m_scratchBitmap : m_bitmaps[ch];
+    bitmap.glyph = { ch, static_cast<int>(g->advance.x >> 6), static_cast<int>(g->advance.y >> 6),
+                     g->bitmap.width, g->bitmap.rows, g->bitmap_left, g->bitmap_top, 0.0f, 0.0f, -1 };
 
-    for (auto const &block : m_unicodeBlocks)
+    // Copy the bitmap rows without the padding FreeType may add
+    bitmap.pixels.resize(static_cast<std::size_t>(g->bitmap.width) * g->bitmap.rows);
+    for (unsigned int row = 0; row < g->bitmap.rows; row++)
     {
-        for (wchar_t ch = block.first, e = block.last; ch <= e; ch++)
-        {
-            Glyph c;
-            if (!loadGlyphInfo(ch, c))
-                GetLogger()->warn("Loading character {:x} failed!\n", static_cast<unsigned>(ch));
-            m_glyphs.push_back(c); // still pushing empty
-        }
+        std::copy_n(g->bitmap.buffer + static_cast<std::ptrdiff_t>(row) * g->bitmap.pitch,
+                    g->bitmap.width,
+                    bitmap.pixels.begin() + static_cast<std::ptrdiff_t>(row) * g->bitmap.width);
     }
+
+    if (!m_cachePath.empty())
+        m_cacheDirty = true;
+    return &bitmap;
 }
 
-void
-TextureFontPrivate::computeTextureSize()
+bool
+TextureFontPrivate::loadGlyph(wchar_t ch, Glyph &c)
 {
-    int roww = 0;
-    int rowh = 0;
-    int w    = 0;
-    int h    = 0;
-
-    // Find minimum size for a texture holding all visible ASCII characters
-    for (const auto &c : m_glyphs)
+    const GlyphBitmap *bitmap = rasterize(ch);
+    if (bitmap == nullptr)
     {
-        if (c.ch == 0) continue; // skip bad glyphs
-
-        if (roww + c.bw + 1 >= m_maxTextureSize)
-        {
-            w = std::max(w, roww);
-            h += rowh;
-            roww = 0;
-            rowh = 0;
-        }
-        roww += c.bw + 1;
-        rowh = std::max(rowh, static_cast<int>(c.bh));
+        c = g_badGlyph;
+        return false;
     }
 
-    w = std::max(w, roww);
-    h += rowh;
+    c = bitmap->glyph;
+    if (c.bw == 0 || c.bh == 0)
+        return true;
 
-    m_texWidth  = w;
-    m_texHeight = h;
+    return addToAtlas(c, bitmap->pixels.data());
 }
 
 bool
-TextureFontPrivate::buildAtlas()
+TextureFontPrivate::addPage()
 {
-    FT_GlyphSlot g = m_face->glyph;
-
-    initCommonGlyphs();
-    computeTextureSize();
-
-    // Create a texture that will be used to hold all glyphs
+    AtlasPage page;
     glActiveTexture(GL_TEXTURE0);
-    if (m_texName != 0) glDeleteTextures(1, &m_texName);
-    glGenTextures(1, &m_texName);
-    if (m_texName == 0) return false;
+    glGenTextures(1, &page.texName);
+    if (page.texName == 0) return false;
+
+    // Clear the page, so that filtering doesn't pick up garbage from the
+    // gaps between glyphs
+    std::vector<std::uint8_t> blank(static_cast<std::size_t>(m_pageSize) * m_pageSize, 0);
 
-    glBindTexture(GL_TEXTURE_2D, m_texName);
+    glBindTexture(GL_TEXTURE_2D, page.texName);
     glTexImage2D(GL_TEXTURE_2D,
                  0,
                  GL_ALPHA,
-                 m_texWidth,
-                 m_texHeight,
+                 m_pageSize,
+                 m_pageSize,
                  0,
                  GL_ALPHA,
                  GL_UNSIGNED_BYTE,
-                 nullptr);
-
-    // We require 1 byte alignment when uploading texture data
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                 blank.data());
 
     // Clamping to edges is important to prevent artifacts when scaling
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -251,70 +243,99 @@ TextureFontPrivate::buildAtlas()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Paste all glyph bitmaps into the texture, remembering the offset
-    int ox = 0;
-    int oy = 0;
-
-    int rowh = 0;
+    m_pages.push_back(std::move(page));
+    return true;
+}
 
-    for (auto &c : m_glyphs)
+/*
+ * Copy a glyph bitmap into the first free spot of the last atlas page,
+ * starting a new page when it is full.
+ */
+bool
+TextureFontPrivate::addToAtlas(Glyph &c, const std::uint8_t *pixels)
+{
+    auto bw = static_cast<int>(c.bw);
+    auto bh = static_cast<int>(c.bh);
+    if (bw >= m_pageSize || bh >= m_pageSize)
     {
-        if (c.ch == 0) continue; // skip bad glyphs
+        GetLogger()->warn("Character {:x} is too large for the font atlas!\n", static_cast<unsigned>(c.ch));
+        c = g_badGlyph;
+        return false;
+    }
 
-        if (FT_Load_Char(m_face, c.ch, FT_LOAD_RENDER) != 0)
-        {
-            GetLogger()->warn("Loading character {:x} failed!\n", static_cast<unsigned>(c.ch));
-            c.ch = 0;
-            continue;
-        }
+    AtlasPage *page = m_pages.empty() ? nullptr : &m_pages.back();
+    if (page != nullptr && page->shelfX + bw >= m_pageSize)
+    {
+        page->shelfY += page->shelfHeight + 1;
+        page->shelfX = 0;
+        page->shelfHeight = 0;
+    }
 
-        if (ox + int(g->bitmap.width) > int(m_texWidth))
+    if (page == nullptr || page->shelfY + bh >= m_pageSize)
+    {
+        if (!addPage())
         {
-            oy += rowh;
-            rowh = 0;
-            ox   = 0;
+            c = g_badGlyph;
+            return false;
         }
-
-        glTexSubImage2D(GL_TEXTURE_2D,
-                        0,
-                        ox,
-                        oy,
-                        g->bitmap.width,
-                        g->bitmap.rows,
-                        GL_ALPHA,
-                        GL_UNSIGNED_BYTE,
-                        g->bitmap.buffer);
-        c.tx = static_cast<float>(ox) / static_cast<float>(m_texWidth);
-        c.ty = static_cast<float>(oy) / static_cast<float>(m_texHeight);
-
-        rowh = std::max(rowh, static_cast<int>(g->bitmap.rows));
-        ox += g->bitmap.width + 1;
+        page = &m_pages.back();
     }
 
-#if DUMP_TEXTURE
-    fmt::print("Generated a {} x {} ({} kb) texture atlas\n",
-               m_texWidth, m_texHeight,
-               m_texWidth * m_texHeight / 1024);
-    size_t   img_size = sizeof(uint8_t) * m_texWidth * m_texHeight * 4;
-    uint8_t *raw_img  = new uint8_t[img_size];
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, raw_img);
-    ofstream f(fmt::format("/tmp/texture_{}x{}.data", m_texWidth, m_texHeight), ios::binary);
-    f.write(reinterpret_cast<char *>(raw_img), img_size);
-    f.close();
-    delete[] raw_img;
-#endif
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, page->texName);
+
+    // We require 1 byte alignment when uploading texture data
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D,
+                    0,
+                    page->shelfX,
+                    page->shelfY,
+                    bw,
+                    bh,
+                    GL_ALPHA,
+                    GL_UNSIGNED_BYTE,
+                    pixels);
+
+    c.tx   = static_cast<float>(page->shelfX) / static_cast<float>(m_pageSize);
+    c.ty   = static_cast<float>(page->shelfY) / static_cast<float>(m_pageSize);
+    c.page = static_cast<int>(m_pages.size() - 1);
+
+    page->shelfX += bw + 1;
+    page->shelfHeight = std::max(page->shelfHeight, bh);
     return true;
 }
 
-int
-TextureFontPrivate::getCommonGlyphsCount()
+bool
+TextureFontPrivate::buildAtlas()
 {
-    if (m_commonGlyphsCount == 0)
+    // Pages are square and large enough for a few hundred glyphs
+    int lineHeight = static_cast<int>((m_face->size->metrics.ascender - m_face->size->metrics.descender) >> 6);
+    m_pageSize = 256;
+    while (m_pageSize < 16 * lineHeight && m_pageSize < m_maxTextureSize)
+        m_pageSize *= 2;
+    m_pageSize = std::min(m_pageSize, static_cast<int>(m_maxTextureSize));
+
+    readGlyphCache();
+    if (!addPage()) return false;
+
+    int count = 0;
+    for (auto const &block : m_unicodeBlocks)
+        count += block.last - block.first + 1;
+
+    m_glyphs.resize(count);
+    for (auto const &block : m_unicodeBlocks)
     {
-        for (auto const &block : m_unicodeBlocks)
-            m_commonGlyphsCount += (block.last - block.first + 1);
+        for (wchar_t ch = block.first, e = block.last; ch <= e; ch++)
+        {
+            if (!loadGlyph(ch, m_glyphs[toPos(ch)]))
+                GetLogger()->warn("Loading character {:x} failed!\n", static_cast<unsigned>(ch));
+        }
     }
-    return m_commonGlyphsCount;
+
+#if DUMP_TEXTURE
+    fmt::print("Generated {} {} x {} texture atlas pages\n", m_pages.size(), m_pageSize, m_pageSize);
+#endif
+    return true;
 }
 
 int
@@ -351,44 +372,59 @@ TextureFontPrivate::getGlyph(wchar_t ch)
     if (auto pos = toPos(ch); pos != -1)
         return m_glyphs[pos];
 
-    auto it = find_if(m_glyphs.begin() + getCommonGlyphsCount(),
-                      m_glyphs.end(),
-                      [ch](const Glyph &g) { return g.ch == ch; });
-
-    if (it != m_glyphs.end())
-        return *it;
-
-    Glyph c;
-    if (!loadGlyphInfo(ch, c))
-        return g_badGlyph;
-
-    flush(); // render text to avoid garbled output due to changed texture
+    auto [it, inserted] = m_otherGlyphs.try_emplace(ch);
+    if (inserted)
+    {
+        // Characters that fail to load are remembered as bad glyphs, so
+        // they aren't retried every time they're drawn.
+        loadGlyph(ch, it->second);
+    }
 
-    m_glyphs.push_back(c);
-    if (++m_inserted == 10) optimize();
-    buildAtlas();
+    return it->second;
+}
 
-    return m_glyphs.back();
+void
+TextureFontPrivate::setVertexColors(bool vertexColors)
+{
+    if (vertexColors != m_vertexColors)
+    {
+        flush();
+        m_vertexColors = vertexColors;
+    }
 }
 
 void
-TextureFontPrivate::optimize()
+TextureFontPrivate::addQuad(const Glyph &g, float x1, float y1, float z, Color color)
 {
-    m_inserted = 0;
+    // Skip glyphs that have no pixels
+    if (g.page < 0) return;
+
+    const float x2 = x1 + static_cast<float>(g.bw);
+    const float y2 = y1 + static_cast<float>(g.bh);
+
+    const float tx1 = g.tx;
+    const float ty1 = g.ty;
+    const float tx2 = tx1 + static_cast<float>(g.bw) / static_cast<float>(m_pageSize);
+    const float ty2 = ty1 + static_cast<float>(g.bh) / static_cast<float>(m_pageSize);
+
+    auto &vertices = m_pages[g.page].vertices;
+    vertices.emplace_back(x1, y1, z, tx1, ty2, color);
+    vertices.emplace_back(x2, y1, z, tx2, ty2, color);
+    vertices.emplace_back(x1, y2, z, tx1, ty1, color);
+    vertices.emplace_back(x2, y2, z, tx2, ty1, color);
 }
 
 /*
  * Render text using the currently loaded font and currently set font size.
- * Rendering starts at coordinates (x, y), z is always 0.
- * The pixel coordinates that the FreeType2 library uses are scaled by (sx, sy).
+ * Rendering starts at coordinates (x, y, z). When vertexColors is set, the
+ * text is drawn with the given color rather than the current one.
  */
 float
-TextureFontPrivate::render(std::string_view s, float x, float y)
+TextureFontPrivate::render(std::string_view s, float x, float y, float z, bool vertexColors, Color color)
 {
-    if (m_texName == 0) return 0;
+    if (m_pages.empty()) return 0;
 
-    // Use the texture containing the atlas
-    glBindTexture(GL_TEXTURE_2D, m_texName);
+    setVertexColors(vertexColors);
 
     // Loop through all characters
     int  len       = s.length();
@@ -404,30 +440,12 @@ TextureFontPrivate::render(std::string_view s, float x, float y)
 
         auto &g = getGlyph(ch, L'?');
 
-        // Calculate the vertex and texture coordinates
-        const float x1 = x + g.bl;
-        const float y1 = y + g.bt - g.bh;
-        const float w  = g.bw;
-        const float h  = g.bh;
-        const float x2 = x1 + w;
-        const float y2 = y1 + h;
+        // Calculate the vertex coordinates
+        addQuad(g, x + g.bl, y + g.bt - static_cast<float>(g.bh), z, color);
 
         // Advance the cursor to the start of the next character
         x += g.ax;
         y += g.ay;
-
-        // Skip glyphs that have no pixels
-        if (g.bw == 0 || g.bh == 0) continue;
-
-        const float tx1 = g.tx;
-        const float ty1 = g.ty;
-        const float tx2 = tx1 + w / m_texWidth;
-        const float ty2 = ty1 + h / m_texHeight;
-
-        m_fontVertices.emplace_back(x1, y1, tx1, ty2);
-        m_fontVertices.emplace_back(x2, y1, tx2, ty2);
-        m_fontVertices.emplace_back(x1, y2, tx1, ty1);
-        m_fontVertices.emplace_back(x2, y2, tx2, ty1);
     }
 
     return x;
@@ -436,23 +454,10 @@ TextureFontPrivate::render(std::string_view s, float x, float y)
 float
 TextureFontPrivate::render(wchar_t ch, float xoffset, float yoffset)
 {
-    auto &g = getGlyph(ch, L'?');
-
-    // Calculate the vertex and texture coordinates
-    const float x1 = xoffset + g.bl;
-    const float y1 = yoffset + g.bt - g.bh;
-    const float x2 = x1 + g.bw;
-    const float y2 = y1 + g.bh;
+    setVertexColors(false);
 
-    const float tx1 = g.tx;
-    const float ty1 = g.ty;
-    const float tx2 = tx1 + static_cast<float>(g.bw) / m_texWidth;
-    const float ty2 = ty1 + static_cast<float>(g.bh) / m_texHeight;
-
-    m_fontVertices.emplace_back(x1, y1, tx1, ty2);
-    m_fontVertices.emplace_back(x2, y1, tx2, ty2);
-    m_fontVertices.emplace_back(x1, y2, tx1, ty1);
-    m_fontVertices.emplace_back(x2, y2, tx2, ty1);
+    auto &g = getGlyph(ch, L'?');
+    addQuad(g, xoffset + g.bl, yoffset + g.bt - static_cast<float>(g.bh), 0.0f, Color());
 
     return g.ax;
 }
@@ -465,42 +470,113 @@ TextureFontPrivate::getProgram()
     return m_prog;
 }
 
+/*
+ * Draw all queued text, with one draw call for each atlas page in use.
+ */
 void
 TextureFontPrivate::flush()
 {
-    if (m_fontVertices.size() < 4) return;
+    auto *prog = getProgram();
+    bool programSet = false;
 
-    std::vector<unsigned short> indexes;
-    indexes.reserve(m_fontVertices.size() / 4 * 6);
-    for (unsigned short index = 0; index < static_cast<unsigned short>(m_fontVertices.size()); index += 4)
+    for (auto &page : m_pages)
     {
-        indexes.push_back(index + 0);
-        indexes.push_back(index + 1);
-        indexes.push_back(index + 2);
-        indexes.push_back(index + 1);
-        indexes.push_back(index + 3);
-        indexes.push_back(index + 2);
+        if (page.vertices.size() < 4) continue;
+
+        // Other programs may have been used since the text was queued
+        if (!programSet)
+        {
+            if (prog == nullptr) break;
+            prog->use();
+            prog->samplerParam("atlasTex") = 0;
+            prog->setMVPMatrices(m_projection, m_modelView);
+            programSet = true;
+
+            glEnableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
+            glEnableVertexAttribArray(CelestiaGLProgram::TextureCoord0AttributeIndex);
+            if (m_vertexColors)
+                glEnableVertexAttribArray(CelestiaGLProgram::ColorAttributeIndex);
+        }
+
+        std::size_t quadCount = page.vertices.size() / 4;
+        std::size_t indexCount = std::min(quadCount, MaxQuadsPerDraw) * 6;
+        for (auto index = static_cast<unsigned int>(m_indexes.size() / 6 * 4); m_indexes.size() < indexCount; index += 4)
+        {
+            m_indexes.push_back(static_cast<unsigned short>(index + 0));
+            m_indexes.push_back(static_cast<unsigned short>(index + 1));
+            m_indexes.push_back(static_cast<unsigned short>(index + 2));
+            m_indexes.push_back(static_cast<unsigned short>(index + 1));
+            m_indexes.push_back(static_cast<unsigned short>(index + 3));
+            m_indexes.push_back(static_cast<unsigned short>(index + 2));
+        }
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, page.texName);
+
+        for (std::size_t first = 0; first < quadCount; first += MaxQuadsPerDraw)
+        {
+            const FontVertex &v = page.vertices[first * 4];
+            glVertexAttribPointer(CelestiaGLProgram::VertexCoordAttributeIndex,
+                                  3,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  sizeof(FontVertex),
+                                  &v.x);
+            glVertexAttribPointer(CelestiaGLProgram::TextureCoord0AttributeIndex,
+                                  2,
+                                  GL_FLOAT,
+                                  GL_FALSE,
+                                  sizeof(FontVertex),
+                                  &v.u);
+            if (m_vertexColors)
+            {
+                glVertexAttribPointer(CelestiaGLProgram::ColorAttributeIndex,
+                                      4,
+                                      GL_UNSIGNED_BYTE,
+                                      GL_TRUE,
+                                      sizeof(FontVertex),
+                                      v.color.data());
+            }
+
+            auto count = std::min(quadCount - first, MaxQuadsPerDraw) * 6;
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(count), GL_UNSIGNED_SHORT, m_indexes.data());
+        }
+
+        page.vertices.clear();
     }
 
-    glEnableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
-    glEnableVertexAttribArray(CelestiaGLProgram::TextureCoord0AttributeIndex);
-    glVertexAttribPointer(CelestiaGLProgram::VertexCoordAttributeIndex,
-                          2,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(FontVertex),
-                          &m_fontVertices[0].x);
-    glVertexAttribPointer(CelestiaGLProgram::TextureCoord0AttributeIndex,
-                          2,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          sizeof(FontVertex),
-                          &m_fontVertices[0].u);
-    glDrawElements(GL_TRIANGLES, indexes.size(), GL_UNSIGNED_SHORT, indexes.data());
-    glDisableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
-    glDisableVertexAttribArray(CelestiaGLProgram::TextureCoord0AttributeIndex);
-
-    m_fontVertices.clear();
+    if (programSet)
+    {
+        glDisableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
+        glDisableVertexAttribArray(CelestiaGLProgram::TextureCoord0AttributeIndex);
+        if (m_vertexColors)
+            glDisableVertexAttribArray(CelestiaGLProgram::ColorAttributeIndex);
+    }
+}
+
+void
+TextureFontPrivate::readGlyphCache()
+{
+    if (m_cachePath.empty()) return;
+
+    std::ifstream in(m_cachePath, std::ios::in | std::ios::binary);
+    if (!in.good()) return;
+
+    if (ReadGlyphCache(in, m_cacheKey, static_cast<unsigned int>(m_maxTextureSize), m_bitmaps) == GlyphCacheStatus::Damaged)
+        GetLogger()->warn("Glyph cache {} is damaged\n", m_cachePath);
+}
+
+void
+TextureFontPrivate::writeGlyphCache() const
+{
+    if (m_cachePath.empty()) return;
+
+    std::error_code ec;
+    fs::create_directories(m_cachePath.parent_path(), ec);
+
+    std::ofstream out(m_cachePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.good() || !WriteGlyphCache(out, m_cacheKey, m_bitmaps))
+        GetLogger()->warn("Could not write glyph cache {}\n", m_cachePath);
 }
 
 TextureFont::TextureFont(const Renderer *renderer) :
@@ -537,7 +613,25 @@ TextureFont::render(wchar_t ch, float xoffset, float yoffset) const
 float
 TextureFont::render(std::string_view s, float xoffset, float yoffset) const
 {
-    return impl->render(s, xoffset, yoffset);
+    return impl->render(s, xoffset, yoffset, 0.0f, false, Color());
+}
+
+/**
+ * Queue a string for rendering with its own color
+ *
+ * Queue a string at the specified offset, which includes the depth, and
+ * with the specified color rather than the current one. Strings queued
+ * this way are batched together, so that drawing many labels with the same
+ * matrices takes a single draw call for each atlas page.
+ *
+ * @param s -- string to render
+ * @param offset -- position of the start of the string
+ * @param color -- text color
+ */
+float
+TextureFont::render(std::string_view s, const Eigen::Vector3f &offset, Color color) const
+{
+    return impl->render(s, offset.x(), offset.y(), offset.z(), true, color);
 }
 
 /**
@@ -635,10 +729,10 @@ TextureFont::bind()
     auto *prog = impl->getProgram();
     if (prog == nullptr) return;
 
-    if (impl->m_texName != 0)
+    if (!impl->m_pages.empty())
     {
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, impl->m_texName);
+        glBindTexture(GL_TEXTURE_2D, impl->m_pages.front().texName);
         prog->use();
         prog->samplerParam("atlasTex") = 0;
         impl->m_shaderInUse            = true;
@@ -747,6 +841,16 @@ ParseFontName(const fs::path &filename, int &index, int &size)
 
 using FontCache = std::map<fs::path, std::weak_ptr<TextureFont>>;
 
+/**
+ * Set the directory where rasterized glyphs are cached between runs; an
+ * empty path disables the cache. Only affects fonts loaded afterwards.
+ */
+void
+SetGlyphCacheDirectory(const fs::path &dir)
+{
+    g_glyphCacheDirectory = dir;
+}
+
 std::shared_ptr<TextureFont>
 LoadTextureFont(const Renderer *r, const fs::path &filename, int index, int size)
 {
@@ -781,6 +885,22 @@ LoadTextureFont(const Renderer *r, const fs::path &filename, int index, int size
         ret = std::make_shared<TextureFont>(r);
         ret->impl->m_face = face;
 
+        if (!g_glyphCacheDirectory.empty())
+        {
+            // Key the glyph cache by everything that affects rasterization
+            std::error_code ec;
+            auto fileSize = fs::file_size(nameonly, ec);
+            auto &key = ret->impl->m_cacheKey;
+            key = fmt::format("{}|{}|{}|{}|{}|{}.{}.{}",
+                              nameonly.string(),
+                              face->face_index,
+                              face->size->metrics.x_ppem,
+                              face->size->metrics.y_ppem,
+                              ec ? 0 : fileSize,
+                              FREETYPE_MAJOR, FREETYPE_MINOR, FREETYPE_PATCH);
+            ret->impl->m_cachePath = g_glyphCacheDirectory / GetGlyphCacheFileName(key);
+        }
+
         if (!ret->impl->buildAtlas())
         {
             FT_Done_Face(face);
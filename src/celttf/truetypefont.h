@@ -11,6 +11,7 @@
 
 #include <Eigen/Core>
 #include <celcompat/filesystem.h>
+#include <celutil/color.h>
 #include <string_view>
 
 class Renderer;
@@ -19,6 +20,8 @@ class TextureFont;
 std::shared_ptr<TextureFont>
 LoadTextureFont(const Renderer *, const fs::path &, int index = 0, int size = 0);
 
+void SetGlyphCacheDirectory(const fs::path &);
+
 struct TextureFontPrivate;
 class TextureFont
 {
@@ -36,6 +39,7 @@ class TextureFont
 
     float render(wchar_t c, float xoffset = 0.0f, float yoffset = 0.0f) const;
     float render(std::string_view str, float xoffset = 0.0f, float yoffset = 0.0f) const;
+    float render(std::string_view str, const Eigen::Vector3f &offset, Color color) const;
 
     int getWidth(std::string_view) const;
     int getWidth(int c) const;
@@ -0,0 +1,109 @@
+// array_span.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Writable view of array-like containers.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>     // std::size_t
+
+namespace celestia::util
+{
+
+/**
+ * Writable view of array-like containers similar to C++20's std::span;
+ * the counterpart of array_view for output arrays.
+ */
+template<typename T>
+class array_span
+{
+ public:
+    /**
+     * Create an empty span.
+     */
+    constexpr array_span() noexcept :
+        m_ptr(nullptr),
+        m_size(0)
+    {}
+
+    /**
+     * Wrap size elements starting at ptr.
+     */
+    constexpr array_span(T* ptr, std::size_t size) noexcept :
+        m_ptr(ptr),
+        m_size(size)
+    {}
+
+    /**
+     * Wrap a std::array or std::vector or other classes which have the same
+     * memory layout and interface.
+     */
+    template<typename C> constexpr array_span(C &ary) noexcept :
+        m_ptr(ary.data()),
+        m_size(ary.size())
+    {}
+
+    /**
+     * Direct access to the underlying array.
+     */
+    constexpr T* data() const noexcept
+    {
+        return m_ptr;
+    }
+
+    /**
+     * Return the number of elements.
+     */
+    constexpr std::size_t size() const noexcept
+    {
+        return m_size;
+    }
+
+    /**
+     * Check whether the span is empty.
+     */
+    constexpr bool empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    /**
+     * Return a reference to the element at the specified position. No
+     * bounds checking performed.
+     */
+    constexpr T& operator[](std::size_t pos) const noexcept
+    {
+        return m_ptr[pos];
+    }
+
+    /**
+     * Return a span of count elements starting at offset. No bounds
+     * checking performed.
+     */
+    constexpr array_span<T> subspan(std::size_t offset, std::size_t count) const noexcept
+    {
+        return array_span<T>(m_ptr + offset, count);
+    }
+
+    constexpr T* begin() const noexcept
+    {
+        return m_ptr;
+    }
+
+    constexpr T* end() const noexcept
+    {
+        return m_ptr + m_size;
+    }
+
+ private:
+    T* m_ptr;
+    std::size_t m_size;
+};
+
+} // end namespace celestia::util
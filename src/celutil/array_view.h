@@ -44,6 +44,14 @@ class array_view
         m_size(N)
     {};
 
+    /**
+     * Wrap size elements starting at ptr.
+     */
+    constexpr array_view(const T* ptr, std::size_t size) noexcept :
+        m_ptr(ptr),
+        m_size(size)
+    {};
+
     /**
      * Wrap a std::array or std::vector or other classes which have the same
      * memory layout and interface.
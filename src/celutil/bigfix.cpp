@@ -21,6 +21,12 @@
 #include "bigfix.h"
 #include "logger.h"
 
+// Define BIGFIX_NO_INT128 to use the portable arithmetic even where the
+// compiler has 128-bit integers, e.g. to test it
+#if defined(__SIZEOF_INT128__) && !defined(BIGFIX_NO_INT128)
+#define BIGFIX_HAVE_INT128
+#endif
+
 using namespace std::string_view_literals;
 
 using celestia::util::GetLogger;
@@ -55,6 +61,58 @@ DecoderArray createBase64Decoder()
     return decoder;
 }
 
+#ifdef BIGFIX_HAVE_INT128
+// Native 128-bit integers, where the compiler provides them, let the
+// conversions and multiplications work on the whole value at once instead
+// of 32-bit words.
+__extension__ typedef unsigned __int128 uint128;
+__extension__ typedef __int128 int128;
+
+constexpr double POW2_63 = 0x1p+63; // 2^63
+constexpr double POW2_64 = 0x1p+64; // 2^64
+
+inline uint128 toUInt128(std::uint64_t hi, std::uint64_t lo)
+{
+    return (static_cast<uint128>(hi) << 64) | lo;
+}
+
+// Multiply two unsigned 64.64 values, keeping the bits of the 128.128
+// product that form a 64.64 value; higher bits are discarded.
+inline uint128 mulFixed(std::uint64_t ah, std::uint64_t al,
+                        std::uint64_t bh, std::uint64_t bl)
+{
+    uint128 ll = static_cast<uint128>(al) * bl;
+    uint128 lh = static_cast<uint128>(al) * bh;
+    uint128 hl = static_cast<uint128>(ah) * bl;
+    std::uint64_t hh = ah * bh;
+
+    return (static_cast<uint128>(hh) << 64) + lh + hl + (ll >> 64);
+}
+
+// Multiply an unsigned 64.64 value by m * 2^e, where m is a 53-bit integer,
+// truncating the result.
+inline uint128 mulScaled(std::uint64_t hi, std::uint64_t lo, std::uint64_t m, int e)
+{
+    uint128 pl = static_cast<uint128>(lo) * m;
+    uint128 ph = static_cast<uint128>(hi) * m;
+
+    // The 192-bit product is (top << 128) + low
+    uint128 low = pl + (ph << 64);
+    auto top = static_cast<std::uint64_t>(ph >> 64) +
+               static_cast<std::uint64_t>(low < pl);
+
+    if (e >= 0)
+        return e < 128 ? low << e : 0;
+
+    int k = -e;
+    if (k >= 192)
+        return 0;
+    if (k >= 128)
+        return static_cast<uint128>(top >> (k - 128));
+    return (low >> k) | (static_cast<uint128>(top) << (128 - k));
+}
+#endif
+
 } // end unnamed namespace
 
 /*** Constructors ***/
@@ -73,6 +131,27 @@ BigFix::BigFix(std::uint64_t i)
 
 BigFix::BigFix(double d)
 {
+#ifdef BIGFIX_HAVE_INT128
+    // Both the integer part and the fraction of a double are exact, as is
+    // scaling the fraction by 2^64; the conversion of the scaled fraction
+    // truncates the bits of the value below 2^-64.
+    double m = std::abs(d);
+    if (m < POW2_63)
+    {
+        auto ipart = static_cast<std::uint64_t>(static_cast<std::int64_t>(m));
+        auto fpart = static_cast<std::uint64_t>((m - static_cast<double>(ipart)) * POW2_64);
+        uint128 v = toUInt128(ipart, fpart);
+        if (d < 0)
+            v = -v;
+        hi = static_cast<std::uint64_t>(v >> 64);
+        lo = static_cast<std::uint64_t>(v);
+    }
+    else
+    {
+        GetLogger()->error("Too big value {} passed to BigFix::BigFix()\n", d);
+        hi = lo = 0;
+    }
+#else
     bool isNegative = false;
 
     // Handle negative values by inverting them before conversion,
@@ -109,10 +188,23 @@ BigFix::BigFix(double d)
       GetLogger()->error("Too big value {} passed to BigFix::BigFix()\n", d);
       hi = lo = 0;
     }
+#endif
 }
 
 BigFix::operator double() const
 {
+#ifdef BIGFIX_HAVE_INT128
+    // Both halves of a value that fits in a double convert exactly, and so
+    // does their sum.
+    uint128 v = toUInt128(hi, lo);
+    bool negative = isNegative();
+    if (negative)
+        v = -v;
+
+    double d = static_cast<double>(static_cast<std::uint64_t>(v >> 64)) +
+               static_cast<double>(static_cast<std::uint64_t>(v)) * WORD0_FACTOR;
+    return negative ? -d : d;
+#else
     // Handle negative values by inverting them before conversion,
     // then inverting the converted value.
     int sign = 1;
@@ -139,6 +231,7 @@ BigFix::operator double() const
          w3 * WORD3_FACTOR) * sign;
 
     return d;
+#endif
 }
 
 BigFix::operator float() const
@@ -158,11 +251,15 @@ bool operator!=(const BigFix& a, const BigFix& b)
 
 bool operator<(const BigFix& a, const BigFix& b)
 {
+#ifdef BIGFIX_HAVE_INT128
+    return static_cast<int128>(toUInt128(a.hi, a.lo)) < static_cast<int128>(toUInt128(b.hi, b.lo));
+#else
     if (a.isNegative() == b.isNegative())
     {
         return a.hi == b.hi ? a.lo < b.lo : a.hi < b.hi;
     }
     return a.isNegative();
+#endif
 }
 
 bool operator>(const BigFix& a, const BigFix& b)
@@ -170,10 +267,39 @@ bool operator>(const BigFix& a, const BigFix& b)
     return b < a;
 }
 
-// TODO: probably faster to do this by converting the double to fixed
-// point and using the fix*fix multiplication.
 BigFix operator*(BigFix f, double d)
 {
+#ifdef BIGFIX_HAVE_INT128
+    // Split d into a 53-bit integer mantissa and an exponent, and multiply
+    // exactly, truncating only the final result.
+    int e;
+    double m = std::frexp(std::abs(d), &e);
+    if (!std::isfinite(m))
+    {
+        GetLogger()->error("Invalid value {} passed to BigFix::operator*()\n", d);
+        return BigFix();
+    }
+
+    auto mi = static_cast<std::uint64_t>(std::ldexp(m, 53));
+
+    bool negative = f.isNegative() != (d < 0);
+    if (f.isNegative())
+        BigFix::negate128(f.hi, f.lo);
+
+    uint128 v = mulScaled(f.hi, f.lo, mi, e - 53);
+    if (negative)
+        v = -v;
+
+    BigFix c;
+    c.hi = static_cast<std::uint64_t>(v >> 64);
+    c.lo = static_cast<std::uint64_t>(v);
+    return c;
+#else
+    // The words are multiplied as unsigned values, so work on the magnitude.
+    bool negative = f.isNegative();
+    if (negative)
+        BigFix::negate128(f.hi, f.lo);
+
     // Need to break the number into 32-bit chunks because a 64-bit
     // integer has more bits of precision than a double.
     std::uint32_t w0 = static_cast<std::uint32_t>(f.lo);
@@ -181,10 +307,12 @@ BigFix operator*(BigFix f, double d)
     std::uint32_t w2 = static_cast<std::uint32_t>(f.hi);
     std::uint32_t w3 = static_cast<std::uint32_t>(f.hi >> 32);
 
-    return BigFix(w0 * d * WORD0_FACTOR) +
-           BigFix(w1 * d * WORD1_FACTOR) +
-           BigFix(w2 * d * WORD2_FACTOR) +
-           BigFix(w3 * d * WORD3_FACTOR);
+    BigFix c = BigFix(w0 * d * WORD0_FACTOR) +
+               BigFix(w1 * d * WORD1_FACTOR) +
+               BigFix(w2 * d * WORD2_FACTOR) +
+               BigFix(w3 * d * WORD3_FACTOR);
+    return negative ? -c : c;
+#endif
 }
 
 /*! Multiply two BigFix values together. This function does not check for
@@ -205,6 +333,12 @@ BigFix operator*(const BigFix& a, const BigFix& b)
     if (b.isNegative())
         BigFix::negate128(bh, bl);
 
+#ifdef BIGFIX_HAVE_INT128
+    uint128 v = mulFixed(ah, al, bh, bl);
+    BigFix c;
+    c.hi = static_cast<std::uint64_t>(v >> 64);
+    c.lo = static_cast<std::uint64_t>(v);
+#else
     // Break the values down into 32-bit words so that the partial products
     // will fit into 64-bit words.
     std::uint64_t aw[4];
@@ -258,6 +392,7 @@ BigFix operator*(const BigFix& a, const BigFix& b)
     BigFix c;
     c.lo = static_cast<std::uint64_t>(result[2]) + (static_cast<std::uint64_t>(result[3]) << 32);
     c.hi = static_cast<std::uint64_t>(result[4]) + (static_cast<std::uint64_t>(result[5]) << 32);
+#endif
 
     bool resultNegative = a.isNegative() != b.isNegative();
     return resultNegative ?  -c : c;
@@ -0,0 +1,38 @@
+// fnv.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Fowler-Noll-Vo hash, for naming cache files. Unlike std::hash, the
+// result is the same for every platform, compiler and run.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+
+namespace celestia::util
+{
+
+constexpr std::uint64_t FNV1aOffsetBasis = UINT64_C(0xcbf29ce484222325);
+
+// 64-bit FNV-1a. A hash of several strings can be computed by passing the
+// hash of the previous ones as the seed.
+constexpr std::uint64_t
+FNV1a64(std::string_view data, std::uint64_t seed = FNV1aOffsetBasis)
+{
+    std::uint64_t h = seed;
+    for (char c : data)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= UINT64_C(0x100000001b3);
+    }
+    return h;
+}
+
+} // end namespace celestia::util
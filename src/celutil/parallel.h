@@ -0,0 +1,77 @@
+// parallel.h
+//
+// Copyright (C) 2023-present, Celestia Development Team.
+//
+// Minimal helpers for splitting independent work across threads.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace celestia::util
+{
+
+/**
+ * Return the number of worker threads to use for a request of
+ * @p requested threads. Zero means one per hardware thread.
+ */
+inline unsigned int
+GetWorkerCount(unsigned int requested = 0)
+{
+    if (requested > 0)
+        return requested;
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+/**
+ * Call func(begin, end) for contiguous chunks covering [0, count). The
+ * chunks are processed on up to @p workers threads (zero means one per
+ * hardware thread); the calling thread handles the first chunk itself.
+ * No chunk is smaller than @p minChunk items, so small inputs are processed
+ * without spawning any threads. Returns after all chunks are done.
+ */
+template<typename F>
+void
+ParallelFor(std::size_t count, F&& func, unsigned int workers = 0, std::size_t minChunk = 1)
+{
+    if (count == 0)
+        return;
+
+    std::size_t nChunks = std::min<std::size_t>(GetWorkerCount(workers),
+                                                (count + minChunk - 1) / std::max<std::size_t>(minChunk, 1));
+    if (nChunks <= 1)
+    {
+        func(std::size_t(0), count);
+        return;
+    }
+
+    std::size_t chunkSize = count / nChunks;
+    std::size_t remainder = count % nChunks;
+
+    std::vector<std::thread> threads;
+    threads.reserve(nChunks - 1);
+
+    std::size_t firstEnd = chunkSize + (remainder > 0 ? 1 : 0);
+    std::size_t begin = firstEnd;
+    for (std::size_t i = 1; i < nChunks; ++i)
+    {
+        std::size_t end = begin + chunkSize + (i < remainder ? 1 : 0);
+        threads.emplace_back([&func, begin, end]() { func(begin, end); });
+        begin = end;
+    }
+
+    func(std::size_t(0), firstEnd);
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+} // end namespace celestia::util
@@ -25,6 +25,7 @@ using celestia::util::GetLogger;
 namespace
 {
 constexpr std::string::size_type maxTokenLength = 1024;
+constexpr std::size_t streamBufferSize = 65536;
 
 enum class State
 {
@@ -50,7 +51,7 @@ bool isSeparator(unsigned char u)
 }
 
 
-bool tryPushBack(std::string& s, char c)
+bool tryPushBack(std::string& s, char c, const celestia::util::Logger* logger)
 {
     if (s.size() < maxTokenLength)
     {
@@ -58,12 +59,12 @@ bool tryPushBack(std::string& s, char c)
         return true;
     }
 
-    GetLogger()->error("Token too long\n");
+    logger->error("Token too long\n");
     return false;
 }
 
 
-bool handleUtf8Error(std::string& s, UTF8Status status)
+bool handleUtf8Error(std::string& s, UTF8Status status, const celestia::util::Logger* logger)
 {
     if (status == UTF8Status::InvalidTrailingByte)
     {
@@ -84,14 +85,16 @@ bool handleUtf8Error(std::string& s, UTF8Status status)
         return true;
     }
 
-    GetLogger()->error("Token too long\n");
+    logger->error("Token too long\n");
     return false;
 }
 } // end unnamed namespace
 
 
-Tokenizer::Tokenizer(std::istream* _in) :
-    in(_in)
+Tokenizer::Tokenizer(std::istream* _in, const celestia::util::Logger* _logger) :
+    in(_in),
+    logger(_logger != nullptr ? _logger : GetLogger()),
+    buffer(std::make_unique<char[]>(streamBufferSize))
 {
     textToken.reserve(maxTokenLength);
 }
@@ -135,14 +138,14 @@ Tokenizer::TokenType Tokenizer::nextToken()
         else
         {
             utf8Status = UTF8Status::Ok;
-            in->get(nextChar);
-            if (in->eof())
+            ReadStatus status = readChar();
+            if (status == ReadStatus::Eof)
             {
                 isEof = true;
             }
-            else if (in->fail())
+            else if (status == ReadStatus::Error)
             {
-                GetLogger()->error("Unexpected error reading stream\n");
+                logger->error("Unexpected error reading stream\n");
                 newToken = TokenError;
                 break;
             }
@@ -152,7 +155,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
                 utf8Status = validator.check(uNextChar);
                 if (utf8Status != UTF8Status::Ok && !hasUtf8Errors)
                 {
-                    GetLogger()->error("Invalid UTF-8 sequence detected\n");
+                    logger->error("Invalid UTF-8 sequence detected\n");
                     hasUtf8Errors = true;
                 }
                 else if (nextChar == '\n')
@@ -239,7 +242,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                GetLogger()->error("Bad character in stream\n");
+                logger->error("Bad character in stream\n");
                 newToken = TokenError;
             }
             break;
@@ -247,12 +250,12 @@ Tokenizer::TokenType Tokenizer::nextToken()
         case State::NumberSigned:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in number\n");
+                logger->error("Unexpected EOF in number\n");
                 newToken = TokenError;
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
                 state = State::Number;
             }
             else if (nextChar == '.')
@@ -264,13 +267,13 @@ Tokenizer::TokenType Tokenizer::nextToken()
                 }
                 else
                 {
-                    GetLogger()->error("Token too long\n");
+                    logger->error("Token too long\n");
                     newToken = TokenError;
                 }
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -282,16 +285,16 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
             }
             else if (nextChar == '.')
             {
-                if (!tryPushBack(textToken, '.')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, '.', logger)) { newToken = TokenError; }
                 state = State::Fraction;
             }
             else if (nextChar == 'e' || nextChar == 'E')
             {
-                if (!tryPushBack(textToken, 'e')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, 'e', logger)) { newToken = TokenError; }
                 state = State::ExponentStart;
             }
             else if (isSeparator(uNextChar))
@@ -301,7 +304,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -313,11 +316,11 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
             }
             else if (nextChar == 'e' || nextChar == 'E')
             {
-                if (!tryPushBack(textToken, 'e')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, 'e', logger)) { newToken = TokenError; }
                 state = State::ExponentStart;
             }
             else if (isSeparator(uNextChar))
@@ -327,7 +330,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -335,22 +338,22 @@ Tokenizer::TokenType Tokenizer::nextToken()
         case State::ExponentStart:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in number\n");
+                logger->error("Unexpected EOF in number\n");
                 newToken = TokenError;
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
                 state = State::Exponent;
             }
             else if (nextChar == '+' || nextChar == '-')
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
                 state = State::ExponentSigned;
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -358,17 +361,17 @@ Tokenizer::TokenType Tokenizer::nextToken()
         case State::ExponentSigned:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in number\n");
+                logger->error("Unexpected EOF in number\n");
                 newToken = TokenError;
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
                 state = State::Exponent;
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -380,7 +383,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else if (std::isdigit(uNextChar))
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
             }
             else if (isSeparator(uNextChar))
             {
@@ -389,7 +392,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                GetLogger()->error("Bad character in number\n");
+                logger->error("Bad character in number\n");
                 newToken = TokenError;
             }
             break;
@@ -401,7 +404,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else if (std::isalpha(uNextChar) || std::isdigit(uNextChar) || nextChar == '_')
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
             }
             else
             {
@@ -413,12 +416,12 @@ Tokenizer::TokenType Tokenizer::nextToken()
         case State::String:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in string\n");
+                logger->error("Unexpected EOF in string\n");
                 newToken = TokenError;
             }
             else if (utf8Status != UTF8Status::Ok)
             {
-                if (!handleUtf8Error(textToken, utf8Status)) { newToken = TokenError; }
+                if (!handleUtf8Error(textToken, utf8Status, logger)) { newToken = TokenError; }
             }
             else if (nextChar == '\\')
             {
@@ -430,29 +433,29 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                if (!tryPushBack(textToken, nextChar)) { newToken = TokenError; }
+                if (!tryPushBack(textToken, nextChar, logger)) { newToken = TokenError; }
             }
             break;
 
         case State::StringEscape:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in string\n");
+                logger->error("Unexpected EOF in string\n");
                 newToken = TokenError;
             }
             else if (nextChar == '\\')
             {
-                if (!tryPushBack(textToken, '\\')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, '\\', logger)) { newToken = TokenError; }
                 state = State::String;
             }
             else if (nextChar == 'n')
             {
-                if (!tryPushBack(textToken, '\n')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, '\n', logger)) { newToken = TokenError; }
                 state = State::String;
             }
             else if (nextChar == '"')
             {
-                if (!tryPushBack(textToken, '"')) { newToken = TokenError; }
+                if (!tryPushBack(textToken, '"', logger)) { newToken = TokenError; }
                 state = State::String;
             }
             else if (nextChar == 'u')
@@ -462,7 +465,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
             }
             else
             {
-                GetLogger()->error("Invalid string escape sequence\n");
+                logger->error("Invalid string escape sequence\n");
                 newToken = TokenError;
             }
             break;
@@ -470,7 +473,7 @@ Tokenizer::TokenType Tokenizer::nextToken()
         case State::UnicodeEscape:
             if (isEof)
             {
-                GetLogger()->error("Unexpected EOF in string\n");
+                logger->error("Unexpected EOF in string\n");
                 newToken = TokenError;
             }
             else if (std::isxdigit(uNextChar))
@@ -486,14 +489,14 @@ Tokenizer::TokenType Tokenizer::nextToken()
                     }
                     else
                     {
-                        GetLogger()->error("Token too long\n");
+                        logger->error("Token too long\n");
                         newToken = TokenError;
                     }
                 }
             }
             else
             {
-                GetLogger()->error("Bad character in Unicode escape\n");
+                logger->error("Bad character in Unicode escape\n");
                 newToken = TokenError;
             }
             break;
@@ -520,22 +523,22 @@ Tokenizer::TokenType Tokenizer::nextToken()
             tokenValue = value;
             if (p != textToken.data() + textToken.size())
             {
-                GetLogger()->warn("Incomplete parsing of numeric token");
+                logger->warn("Incomplete parsing of numeric token");
             }
         }
         else if (ec == std::errc::invalid_argument)
         {
-            GetLogger()->error("Could not parse number\n");
+            logger->error("Could not parse number\n");
             newToken = TokenError;
         }
         else if (ec == std::errc::result_out_of_range)
         {
-            GetLogger()->error("Number out of range\n");
+            logger->error("Number out of range\n");
             newToken = TokenError;
         }
         else
         {
-            GetLogger()->error("Unexpected error parsing number\n");
+            logger->error("Unexpected error parsing number\n");
             newToken = TokenError;
         }
     }
@@ -593,20 +596,20 @@ bool Tokenizer::skipUtf8Bom()
 {
     for (int i = 0; i < 3; ++i)
     {
-        in->get(nextChar);
-        if (in->eof())
+        ReadStatus status = readChar();
+        if (status == ReadStatus::Eof)
         {
             if (i == 0)
             {
                 return true;
             }
 
-            GetLogger()->error("Incomplete UTF-8 sequence\n");
+            logger->error("Incomplete UTF-8 sequence\n");
             return false;
         }
-        else if (in->fail())
+        else if (status == ReadStatus::Error)
         {
-            GetLogger()->error("Unexpected error reading stream\n");
+            logger->error("Unexpected error reading stream\n");
             return false;
         }
         else if (i == 0)
@@ -620,10 +623,33 @@ bool Tokenizer::skipUtf8Bom()
         }
         else if ((i == 1 && nextChar != '\273') || (i == 2 && nextChar != '\277'))
         {
-            GetLogger()->error("Bad character in stream\n");
+            logger->error("Bad character in stream\n");
             return false;
         }
     }
 
     return true;
 }
+
+
+Tokenizer::ReadStatus Tokenizer::readChar()
+{
+    if (current == end)
+    {
+        if (!fillBuffer())
+            return in->bad() || !in->eof() ? ReadStatus::Error : ReadStatus::Eof;
+    }
+
+    nextChar = *current++;
+    return ReadStatus::Ok;
+}
+
+
+bool Tokenizer::fillBuffer()
+{
+    in->read(buffer.get(), streamBufferSize);
+    auto count = static_cast<std::size_t>(in->gcount());
+    current = buffer.get();
+    end = current + count;
+    return count > 0;
+}
@@ -13,9 +13,15 @@
 #include <cmath>
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
 #include <string>
 #include <string_view>
 
+namespace celestia::util
+{
+class Logger;
+}
+
 class Tokenizer
 {
 public:
@@ -38,7 +44,10 @@ public:
         TokenEndUnits       = 14,
     };
 
-    Tokenizer(std::istream*);
+    // Reads from the stream in blocks, so the stream position after
+    // tokenizing is undefined. Errors are reported to logger, or to the
+    // global logger if it's nullptr.
+    Tokenizer(std::istream*, const celestia::util::Logger* logger = nullptr);
 
     TokenType nextToken();
     TokenType getTokenType() const;
@@ -51,7 +60,18 @@ public:
     int getLineNumber() const;
 
 private:
-    std::istream* in;
+    enum class ReadStatus
+    {
+        Ok,
+        Eof,
+        Error,
+    };
+
+    std::istream* in{ nullptr };
+    const celestia::util::Logger* logger{ nullptr };
+    std::unique_ptr<char[]> buffer{};
+    const char* current{ nullptr };
+    const char* end{ nullptr };
     TokenType tokenType{ TokenBegin };
     bool isStart{ true };
     bool isPushedBack{ false };
@@ -63,4 +83,6 @@ private:
     bool hasUtf8Errors{ false };
 
     bool skipUtf8Bom();
+    ReadStatus readChar();
+    bool fillBuffer();
 };
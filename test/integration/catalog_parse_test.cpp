@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include <celengine/parser.h>
+#include <celengine/value.h>
+#include <celutil/tokenizer.h>
+
+namespace
+{
+
+std::string ReadFile(const char* filename)
+{
+    std::ifstream f(filename, std::ios::in | std::ios::binary);
+    REQUIRE(f.good());
+    return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+void DumpValue(std::ostream& out, const Value* value, int indent)
+{
+    switch (value->getType())
+    {
+    case Value::NumberType:
+        out << value->getNumber();
+        break;
+    case Value::StringType:
+        out << '"' << value->getString() << '"';
+        break;
+    case Value::BooleanType:
+        out << (value->getBoolean() ? "true" : "false");
+        break;
+    case Value::ArrayType:
+        out << "[\n";
+        for (const Value* element : *value->getArray())
+        {
+            out << std::string(indent + 2, ' ');
+            DumpValue(out, element, indent + 2);
+            out << '\n';
+        }
+        out << std::string(indent, ' ') << ']';
+        break;
+    case Value::HashType:
+        {
+            // Keys are written in sorted order, so the output doesn't depend
+            // on the order in which a Hash iterates over its properties.
+            const Hash* hash = value->getHash();
+            std::vector<std::pair<std::string, const Value*>> properties;
+            for (auto iter = hash->begin(); iter != hash->end(); ++iter)
+                properties.emplace_back(iter->first, iter->second);
+            std::sort(properties.begin(), properties.end(),
+                      [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            out << "{\n";
+            for (const auto& [key, property] : properties)
+            {
+                out << std::string(indent + 2, ' ') << key << " = ";
+                DumpValue(out, property, indent + 2);
+                out << '\n';
+            }
+            out << std::string(indent, ' ') << '}';
+        }
+        break;
+    default:
+        out << "null";
+        break;
+    }
+}
+
+// Write the tokens of a catalog file, with each property group replaced by
+// the value the parser reads from it, as the catalog loaders do.
+std::string DumpCatalog(const char* filename)
+{
+    std::ifstream f(filename, std::ios::in | std::ios::binary);
+    REQUIRE(f.good());
+
+    Tokenizer tokenizer(&f);
+    Parser parser(&tokenizer);
+
+    std::ostringstream out;
+    out.precision(17);
+    for (;;)
+    {
+        auto tokenType = tokenizer.nextToken();
+        REQUIRE(tokenType != Tokenizer::TokenError);
+        if (tokenType == Tokenizer::TokenEnd)
+            break;
+
+        out << tokenizer.getLineNumber() << ": ";
+        switch (tokenType)
+        {
+        case Tokenizer::TokenNumber:
+            out << tokenizer.getNumberValue() << '\n';
+            break;
+        case Tokenizer::TokenString:
+            out << '"' << tokenizer.getStringValue() << "\"\n";
+            break;
+        case Tokenizer::TokenName:
+            out << tokenizer.getStringValue() << '\n';
+            break;
+        case Tokenizer::TokenBeginGroup:
+            {
+                tokenizer.pushBack();
+                std::unique_ptr<Value> value(parser.readValue());
+                REQUIRE(value != nullptr);
+                DumpValue(out, value.get(), 0);
+                out << '\n';
+            }
+            break;
+        default:
+            out << "token " << static_cast<int>(tokenType) << '\n';
+            break;
+        }
+    }
+
+    return out.str();
+}
+
+} // end unnamed namespace
+
+// The expected files were written by the original std::istream::get() based
+// tokenizer and std::map based Hash.
+TEST_CASE("Catalog parsing matches the baseline parser output", "[Parser] [integration]")
+{
+    REQUIRE(DumpCatalog("nearstars.stc") == ReadFile("nearstars.stc.expected"));
+    REQUIRE(DumpCatalog("iss.ssc") == ReadFile("iss.ssc.expected"));
+    REQUIRE(DumpCatalog("catalog_parse.ssc") == ReadFile("catalog_parse.ssc.expected"));
+}
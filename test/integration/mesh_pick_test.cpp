@@ -0,0 +1,164 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <catch.hpp>
+
+#include <celcompat/filesystem.h>
+#include <celmodel/mesh.h>
+#include <celmodel/model.h>
+#include <celmodel/modelfile.h>
+#include <celutil/reshandle.h>
+
+namespace cmod
+{
+
+// Gives the tests access to the exhaustive reference pick
+struct MeshPickTest
+{
+    static bool pickExhaustive(const Mesh& mesh,
+                               const Eigen::Vector3d& origin,
+                               const Eigen::Vector3d& direction,
+                               Mesh::PickResult* result)
+    {
+        return mesh.pickExhaustive(origin, direction, result);
+    }
+};
+
+} // end namespace cmod
+
+namespace
+{
+
+// Cast rays from random points around the mesh through random points in its
+// bounding box and check that the accelerated and exhaustive picks agree.
+// Returns the number of rays that hit the mesh.
+int
+ComparePicks(const cmod::Mesh& mesh, int rayCount)
+{
+    Eigen::AlignedBox<float, 3> bbox = mesh.getBoundingBox();
+    Eigen::Vector3d center = bbox.center().cast<double>();
+    double radius = bbox.sizes().norm();
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> unitPos(0.0, 1.0);
+
+    int hits = 0;
+    for (int i = 0; i < rayCount; i++)
+    {
+        Eigen::Vector3d origin = center + Eigen::Vector3d(unit(rng), unit(rng), unit(rng)).normalized() * radius;
+        Eigen::Vector3d target = bbox.min().cast<double>() +
+            Eigen::Vector3d(unitPos(rng), unitPos(rng), unitPos(rng)).cwiseProduct(bbox.sizes().cast<double>());
+        Eigen::Vector3d direction = (target - origin).normalized();
+
+        cmod::Mesh::PickResult accelerated;
+        cmod::Mesh::PickResult exhaustive;
+        bool hitAccelerated = mesh.pick(origin, direction, &accelerated);
+        bool hitExhaustive = cmod::MeshPickTest::pickExhaustive(mesh, origin, direction, &exhaustive);
+
+        REQUIRE(hitAccelerated == hitExhaustive);
+        if (hitAccelerated)
+        {
+            REQUIRE(accelerated.group == exhaustive.group);
+            REQUIRE(accelerated.primitiveIndex == exhaustive.primitiveIndex);
+            REQUIRE(accelerated.distance == exhaustive.distance);
+            ++hits;
+        }
+    }
+
+    return hits;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Mesh pick matches exhaustive pick on a model", "[cmod] [integration]")
+{
+    std::vector<fs::path> paths;
+    cmod::HandleGetter handleGetter = [&](const fs::path& path)
+    {
+        paths.push_back(path);
+        return static_cast<ResourceHandle>(paths.size() - 1);
+    };
+
+    std::ifstream f("iss.cmod", std::ios::in | std::ios::binary);
+    REQUIRE(f.good());
+
+    std::unique_ptr<cmod::Model> model = cmod::LoadModel(f, handleGetter);
+    REQUIRE(model != nullptr);
+    REQUIRE(model->getMeshCount() > 0);
+
+    int hits = 0;
+    for (unsigned int i = 0; i < model->getMeshCount(); i++)
+        hits += ComparePicks(*model->getMesh(i), 200);
+
+    REQUIRE(hits > 0);
+}
+
+
+TEST_CASE("Mesh pick handles strips and fans", "[cmod] [integration]")
+{
+    // A grid of vertices on the z = 0 plane
+    constexpr unsigned int GridSize = 16;
+    std::vector<cmod::VWord> vertexData;
+    for (unsigned int y = 0; y < GridSize; y++)
+    {
+        for (unsigned int x = 0; x < GridSize; x++)
+        {
+            float position[3] = { static_cast<float>(x), static_cast<float>(y),
+                                  0.1f * std::sin(static_cast<float>(x + y)) };
+            cmod::VWord words[3];
+            std::memcpy(words, position, sizeof(position));
+            vertexData.insert(vertexData.end(), words, words + 3);
+        }
+    }
+
+    cmod::Mesh mesh;
+    std::vector<cmod::VertexAttribute> attributes;
+    attributes.emplace_back(cmod::VertexAttributeSemantic::Position, cmod::VertexAttributeFormat::Float3, 0);
+    REQUIRE(mesh.setVertexDescription(cmod::VertexDescription(std::move(attributes))));
+    mesh.setVertices(GridSize * GridSize, std::move(vertexData));
+
+    // Strips covering the lower half of the grid, one per row
+    for (unsigned int y = 0; y < GridSize / 2; y++)
+    {
+        std::vector<cmod::Index32> indices;
+        for (unsigned int x = 0; x < GridSize; x++)
+        {
+            indices.push_back(y * GridSize + x);
+            indices.push_back((y + 1) * GridSize + x);
+        }
+        mesh.addGroup(cmod::PrimitiveGroupType::TriStrip, 0, std::move(indices));
+    }
+
+    // A fan covering part of the upper half
+    std::vector<cmod::Index32> fan;
+    fan.push_back((GridSize / 2) * GridSize);
+    for (unsigned int x = 1; x < GridSize; x++)
+        fan.push_back((GridSize - 1) * GridSize + x);
+    mesh.addGroup(cmod::PrimitiveGroupType::TriFan, 0, std::move(fan));
+
+    REQUIRE(ComparePicks(mesh, 1000) > 0);
+
+    // Hit the middle of the second strip and the fan from above
+    cmod::Mesh::PickResult result;
+    REQUIRE(mesh.pick(Eigen::Vector3d(5.25, 1.5, 10.0), -Eigen::Vector3d::UnitZ(), &result));
+    REQUIRE(result.group == std::as_const(mesh).getGroup(1));
+    REQUIRE(mesh.pick(Eigen::Vector3d(8.0, 14.0, 10.0), -Eigen::Vector3d::UnitZ(), &result));
+    REQUIRE(result.group == std::as_const(mesh).getGroup(GridSize / 2));
+
+    // Changing the geometry must discard the cached hierarchy
+    mesh.transform(Eigen::Vector3f(100.0f, 0.0f, 0.0f), 1.0f);
+    REQUIRE(!mesh.pick(Eigen::Vector3d(5.25, 1.5, 10.0), -Eigen::Vector3d::UnitZ(), &result));
+    REQUIRE(ComparePicks(mesh, 200) > 0);
+}
@@ -0,0 +1,169 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celengine/univcoord.h>
+#include <celutil/bigfix.h>
+
+namespace
+{
+
+// The value of d as stored in a 64.64 fixed point number, which truncates
+// the bits below 2^-64.
+double truncateToFixed(double d)
+{
+    return std::ldexp(std::trunc(std::ldexp(d, 64)), -64);
+}
+
+std::vector<double> mantissas()
+{
+    std::vector<double> values{ 1.0, 1.5, 1.9999999999999998, 1.0000000000000002 };
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> dist(1.0, 2.0);
+    for (int i = 0; i < 64; i++)
+        values.push_back(dist(rng));
+    return values;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("BigFix conversions", "[BigFix]")
+{
+    SECTION("Doubles round trip for every exponent")
+    {
+        const auto ms = mantissas();
+        for (int e = -70; e < 63; e++)
+        {
+            for (double m : ms)
+            {
+                double d = std::ldexp(m, e);
+                INFO("Value " << d);
+                REQUIRE(static_cast<double>(BigFix(d)) == truncateToFixed(d));
+                REQUIRE(static_cast<double>(BigFix(-d)) == -truncateToFixed(d));
+            }
+        }
+    }
+
+    SECTION("Zero and out of range values")
+    {
+        REQUIRE(BigFix(0.0) == BigFix());
+        REQUIRE(BigFix(-0.0) == BigFix());
+        REQUIRE(BigFix(0x1p+63) == BigFix());
+        REQUIRE(BigFix(std::nan("")) == BigFix());
+        REQUIRE(static_cast<double>(BigFix(-0x1p+62)) == -0x1p+62);
+    }
+
+    SECTION("Base64 round trip")
+    {
+        std::mt19937_64 rng(7);
+        std::uniform_real_distribution<double> dist(-1.0e18, 1.0e18);
+        for (int i = 0; i < 1000; i++)
+        {
+            BigFix f(dist(rng));
+            REQUIRE(BigFix::fromBase64(f.toBase64()) == f);
+        }
+    }
+}
+
+
+TEST_CASE("BigFix arithmetic", "[BigFix]")
+{
+    std::mt19937_64 rng(1);
+    // 26-bit integers scaled by 2^-20, so that products are exact doubles
+    std::uniform_int_distribution<std::int64_t> dist(-(INT64_C(1) << 26), INT64_C(1) << 26);
+    auto value = [&]() { return std::ldexp(static_cast<double>(dist(rng)), -20); };
+
+    SECTION("Multiplication")
+    {
+        for (int i = 0; i < 10000; i++)
+        {
+            double a = value();
+            double b = value();
+            INFO(a << " * " << b);
+            REQUIRE(static_cast<double>(BigFix(a) * BigFix(b)) == a * b);
+            REQUIRE(static_cast<double>(BigFix(a) * b) == a * b);
+        }
+
+        REQUIRE(BigFix(3.0) * BigFix(0.5) == BigFix(1.5));
+        REQUIRE(BigFix(-3.0) * 0.5 == BigFix(-1.5));
+        REQUIRE(BigFix(1.0e12) * 1.0e-30 == BigFix(truncateToFixed(1.0e-18)));
+    }
+
+    SECTION("Addition and comparison")
+    {
+        for (int i = 0; i < 10000; i++)
+        {
+            double a = value();
+            double b = value();
+            INFO(a << ", " << b);
+            REQUIRE(static_cast<double>(BigFix(a) + BigFix(b)) == a + b);
+            REQUIRE(static_cast<double>(BigFix(a) - BigFix(b)) == a - b);
+            REQUIRE((BigFix(a) < BigFix(b)) == (a < b));
+            REQUIRE((BigFix(a) > BigFix(b)) == (a > b));
+            REQUIRE(BigFix(a).sign() == (a > 0.0) - (a < 0.0));
+        }
+    }
+}
+
+
+TEST_CASE("BigFix benchmark", "[.][benchmark][BigFix]")
+{
+    std::mt19937_64 rng(5);
+    std::uniform_real_distribution<double> dist(-1.0e12, 1.0e12);
+
+    std::vector<double> doubles(4096);
+    for (double& d : doubles)
+        d = dist(rng);
+
+    std::vector<UniversalCoord> coords;
+    for (std::size_t i = 0; i < doubles.size(); i += 3)
+        coords.emplace_back(doubles[i], doubles[(i + 1) % doubles.size()], doubles[(i + 2) % doubles.size()]);
+    UniversalCoord origin(1.0e9, -2.0e9, 3.0e9);
+    std::vector<Eigen::Vector3d> offsets(coords.size());
+
+    BENCHMARK("Conversion from double")
+    {
+        BigFix sum;
+        for (double d : doubles)
+            sum += BigFix(d);
+        return sum;
+    };
+
+    BENCHMARK("Conversion to double")
+    {
+        double sum = 0.0;
+        for (const auto& uc : coords)
+            sum += static_cast<double>(uc.x) + static_cast<double>(uc.y) + static_cast<double>(uc.z);
+        return sum;
+    };
+
+    BENCHMARK("Multiplication by BigFix")
+    {
+        BigFix scale(0.7071067811865476);
+        BigFix sum;
+        for (const auto& uc : coords)
+            sum += uc.x * scale;
+        return sum;
+    };
+
+    BENCHMARK("Multiplication by double")
+    {
+        BigFix sum;
+        for (const auto& uc : coords)
+            sum += uc.x * 0.7071067811865476;
+        return sum;
+    };
+
+    BENCHMARK("Offsets in kilometers")
+    {
+        for (std::size_t i = 0; i < coords.size(); i++)
+            offsets[i] = origin.offsetFromKm(coords[i]);
+        return offsets.back();
+    };
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celengine/bodyindex.h>
+
+namespace
+{
+
+// The per-body view cone test used by the renderer
+bool
+insideCone(const BodySpatialIndex::Entry& entry,
+           const Eigen::Vector3d& apex,
+           const Eigen::Vector3d& axis,
+           double cosHalfAngle)
+{
+    Eigen::Vector3d v = entry.position - apex;
+    double dist = axis.dot(v);
+    if (dist <= -entry.radius)
+        return false;
+
+    double sinHalfAngle = std::sqrt(1.0 - cosHalfAngle * cosHalfAngle);
+    double maxPerpDist = (entry.radius + dist * sinHalfAngle) / cosHalfAngle;
+    return (v - dist * axis).squaredNorm() < maxPerpDist * maxPerpDist;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Body spatial index", "[BodySpatialIndex]")
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    std::uniform_real_distribution<double> radiusDist(0.1, 1000.0);
+
+    // An asteroid belt-like distribution: a thick ring a few AU across
+    std::vector<BodySpatialIndex::Entry> entries;
+    for (unsigned int i = 0; i < 5000; i++)
+    {
+        double angle = unit(rng) * 3.14159265358979;
+        double distance = 4.0e8 + 1.0e8 * unit(rng);
+        Eigen::Vector3d position(distance * std::cos(angle), distance * std::sin(angle), 2.0e7 * unit(rng));
+        // Leave gaps in the child numbering, as for inactive phases
+        entries.push_back({ position, radiusDist(rng), 2 * i });
+    }
+
+    std::vector<unsigned int> alwaysVisited{ 3, 7777 };
+    std::vector<BodySpatialIndex::Entry> reference = entries;
+    BodySpatialIndex index(std::move(entries), std::vector<unsigned int>(alwaysVisited), 100.0, 0.5);
+    REQUIRE(index.getEntryCount() == reference.size());
+    REQUIRE(index.getTime() == 100.0);
+
+    SECTION("The index may be used for less than its maximum age")
+    {
+        REQUIRE(index.isValidAt(100.0));
+        REQUIRE(index.isValidAt(100.25));
+        REQUIRE(index.isValidAt(99.75));
+        REQUIRE_FALSE(index.isValidAt(100.5));
+        REQUIRE_FALSE(index.isValidAt(99.0));
+
+        BodySpatialIndex instant(std::vector<BodySpatialIndex::Entry>(reference), {}, 100.0);
+        REQUIRE(instant.isValidAt(100.0));
+        REQUIRE_FALSE(instant.isValidAt(100.0 + 1.0e-9));
+    }
+
+    SECTION("Cone queries find every body in the cone in child order")
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            Eigen::Vector3d apex = Eigen::Vector3d(unit(rng), unit(rng), unit(rng)) * 6.0e8;
+            Eigen::Vector3d axis = Eigen::Vector3d(unit(rng), unit(rng), unit(rng)).normalized();
+            double cosHalfAngle = std::cos(0.5 * (i % 2 == 0 ? 1.0e-3 : 0.8));
+
+            std::vector<unsigned int> found;
+            index.findInCone(apex, axis, cosHalfAngle, found);
+            REQUIRE(std::is_sorted(found.begin(), found.end()));
+            REQUIRE(std::binary_search(found.begin(), found.end(), 3u));
+            REQUIRE(std::binary_search(found.begin(), found.end(), 7777u));
+
+            for (const auto& entry : reference)
+            {
+                if (insideCone(entry, apex, axis, cosHalfAngle))
+                    REQUIRE(std::binary_search(found.begin(), found.end(), entry.child));
+            }
+
+            // The index shouldn't report much more than the exact test
+            std::size_t exact = std::count_if(reference.begin(), reference.end(),
+                                              [&](const BodySpatialIndex::Entry& entry)
+                                              { return insideCone(entry, apex, axis, cosHalfAngle); });
+            REQUIRE(found.size() <= exact + alwaysVisited.size());
+        }
+    }
+
+    SECTION("Wide cones accept everything")
+    {
+        std::vector<unsigned int> found;
+        index.findInCone(Eigen::Vector3d::Zero(), Eigen::Vector3d::UnitX(), 0.0, found);
+        REQUIRE(found.size() == reference.size() + alwaysVisited.size());
+        REQUIRE(std::is_sorted(found.begin(), found.end()));
+    }
+}
@@ -0,0 +1,128 @@
+#include <memory>
+#include <string>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celephem/customorbit.h>
+#include <celephem/orbit.h>
+
+namespace
+{
+
+struct ReferencePosition
+{
+    const char* name;
+    double jd;
+    Eigen::Vector3d position;
+};
+
+// Positions computed by the satellite theories before their common
+// arguments were shared between satellites
+const ReferencePosition referencePositions[] =
+{
+    { "io", 2451545, { 321012.19005009125, 197.20159670908888, -271026.09633935225 } },
+    { "io", 2460000.25, { -368079.62168437924, -313.84422691529056, -208703.88994710124 } },
+    { "io", 2378497, { 385463.94404759543, 196.86853941948203, 172402.09212908553 } },
+    { "io", 2524593.75, { -96322.574271682068, -260.37846418559161, 412151.29715843627 } },
+    { "europa", 2451545, { -384767.52541085344, 2994.5852988670522, 541906.80506752513 } },
+    { "europa", 2460000.25, { -476110.16496789304, -4875.7408015522496, 475448.32437901839 } },
+    { "europa", 2378497, { -575343.09754035831, 3163.830816032335, 338136.02728814486 } },
+    { "europa", 2524593.75, { 612940.49588958197, -424.77458138069244, 276658.39448791277 } },
+    { "ganymede", 2451545, { -500953.46229484642, 2022.2799613415059, 945448.34262469341 } },
+    { "ganymede", 2460000.25, { -1057760.4129748356, 1949.4699877942217, -177218.33981936218 } },
+    { "ganymede", 2378497, { -553657.50853160338, 2000.6144985745191, 916556.07740729873 } },
+    { "ganymede", 2524593.75, { 249012.1233844517, 2738.9188004171542, 1043015.9063736554 } },
+    { "callisto", 2451545, { -399637.32937297854, -6355.9775917240013, -1838210.2493878473 } },
+    { "callisto", 2460000.25, { 1621073.8564376689, 5077.0603686151208, 942930.82105525525 } },
+    { "callisto", 2378497, { -147399.5426579084, -12675.909130393222, -1887478.7231910566 } },
+    { "callisto", 2524593.75, { -1035341.633536145, -16490.841117187338, -1557057.2765339522 } },
+    { "mimas", 2451545, { -158320.97339532987, 1425.8609310672525, -91354.464167712504 } },
+    { "mimas", 2460000.25, { 175043.15333495903, 4239.7933376415604, -61033.21281095023 } },
+    { "mimas", 2378497, { -120571.36888378106, 4542.9022770100637, -137878.55933068911 } },
+    { "mimas", 2524593.75, { 89305.409816643107, -3272.2144528078366, -160773.7897543353 } },
+    { "enceladus", 2451545, { -187763.79378556987, -85.290872244571517, -144032.37075081011 } },
+    { "enceladus", 2460000.25, { 165391.13576152278, 86.457400576036079, -170105.6221566828 } },
+    { "enceladus", 2378497, { 107636.0824950105, 6.7194725880479762, -212994.97667481363 } },
+    { "enceladus", 2524593.75, { 118128.4926426741, -94.861886895462774, -206138.26125835255 } },
+    { "tethys", 2451545, { -247226.37247995782, -5429.4299625276681, -159883.02538341616 } },
+    { "tethys", 2460000.25, { -95681.808494487574, 4886.0186149076926, -278449.38159455458 } },
+    { "tethys", 2378497, { -109604.62101539187, -2081.4385582167183, 273304.65497439227 } },
+    { "tethys", 2524593.75, { -289482.70201880601, 1720.3901916522686, 53942.054600752112 } },
+    { "dione", 2451545, { -274347.99734300195, -9.6310811566191035, -257682.14309809939 } },
+    { "dione", 2460000.25, { -78746.472438991143, -87.000208505751402, 368597.8885437299 } },
+    { "dione", 2378497, { -373836.6620403034, -86.425746264209124, -43368.111107296958 } },
+    { "dione", 2524593.75, { -355334.29401467193, -3.7395883075851049, 123680.15753722476 } },
+    { "rhea", 2451545, { 520182.17855564546, 2840.1547152076837, -107715.62506796856 } },
+    { "rhea", 2460000.25, { -156962.4730302465, 548.15370037170942, 501320.25137255009 } },
+    { "rhea", 2378497, { 509815.93142529385, -1813.190648555769, -115825.09373998968 } },
+    { "rhea", 2524593.75, { 174066.22203508788, -1978.2862993735157, -502044.79092319577 } },
+    { "titan", 2451545, { 1069797.5778546534, 6350.838274878568, 654289.83637769485 } },
+    { "titan", 2460000.25, { 643388.7699322236, -4229.4157253285357, -1054554.374838281 } },
+    { "titan", 2378497, { 266029.51595449675, 12230.585628829989, 1217598.0946992768 } },
+    { "titan", 2524593.75, { 1067061.5762686599, -2105.8982658643154, -628761.34849322948 } },
+    { "hyperion", 2451545, { 41345.110823873969, 22711.313897217886, 1438240.1030815481 } },
+    { "hyperion", 2460000.25, { 1439660.9964833686, 11606.964494780073, -504465.44610392471 } },
+    { "hyperion", 2378497, { -1593705.3961857737, 19821.513847994738, -329874.57250260789 } },
+    { "hyperion", 2524593.75, { 1389169.1114512694, 23500.956236641683, 280141.09406476381 } },
+    { "iapetus", 2451545, { 2433022.907226522, -251699.73429359155, -2701861.1002965672 } },
+    { "iapetus", 2460000.25, { -519723.68940339354, 719177.2931044912, 3386275.4409485278 } },
+    { "iapetus", 2378497, { -1631028.8507541313, -748200.95372428512, -3006557.1265963376 } },
+    { "iapetus", 2524593.75, { 3423873.4865825209, 792911.67085641145, 841052.33096691291 } }
+};
+
+constexpr double Tolerance = 1.0e-6; // km
+
+} // end unnamed namespace
+
+
+TEST_CASE("Galilean and Saturnian satellite theories", "[CustomOrbit]")
+{
+    SECTION("Positions match the reference values")
+    {
+        for (const auto& ref : referencePositions)
+        {
+            std::unique_ptr<Orbit> orbit(GetCustomOrbit(ref.name));
+            REQUIRE(orbit != nullptr);
+
+            INFO(ref.name << " at " << ref.jd);
+            Eigen::Vector3d pos = orbit->positionAtTime(ref.jd);
+            REQUIRE((pos - ref.position).norm() < Tolerance);
+        }
+    }
+
+    SECTION("Satellites evaluated at different times do not interfere")
+    {
+        std::unique_ptr<Orbit> io(GetCustomOrbit("io"));
+        std::unique_ptr<Orbit> callisto(GetCustomOrbit("callisto"));
+        std::unique_ptr<Orbit> titan(GetCustomOrbit("titan"));
+        std::unique_ptr<Orbit> iapetus(GetCustomOrbit("iapetus"));
+
+        for (const auto& ref : referencePositions)
+        {
+            Orbit* orbit = nullptr;
+            std::string name(ref.name);
+            if (name == "io")
+                orbit = io.get();
+            else if (name == "callisto")
+                orbit = callisto.get();
+            else if (name == "titan")
+                orbit = titan.get();
+            else if (name == "iapetus")
+                orbit = iapetus.get();
+            else
+                continue;
+
+            // Evaluate a sibling at another time in between
+            if (orbit == io.get())
+                callisto->positionAtTime(ref.jd + 0.5);
+            else if (orbit == titan.get())
+                iapetus->positionAtTime(ref.jd - 0.5);
+
+            INFO(ref.name << " at " << ref.jd);
+            Eigen::Vector3d pos = orbit->positionAtTime(ref.jd);
+            REQUIRE((pos - ref.position).norm() < Tolerance);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <celimage/dds_decompress.h>
+
+#include <catch.hpp>
+
+namespace
+{
+
+using BlockFunc = void (*)(uint32_t, uint32_t, uint32_t, const uint8_t*, bool, uint32_t*);
+using RowFunc = void (*)(const uint8_t*, uint32_t, bool, uint32_t*, uint32_t);
+
+std::vector<uint8_t> RandomBlocks(std::size_t size)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> data(size);
+    for (auto& b : data)
+        b = static_cast<uint8_t>(dist(gen));
+    return data;
+}
+
+std::vector<uint32_t> DecodeByBlock(BlockFunc func, const std::vector<uint8_t>& data,
+                                    uint32_t width, uint32_t height, std::size_t blockSize, bool transparent0)
+{
+    std::vector<uint32_t> pixels(width * height);
+    const uint8_t* block = data.data();
+    for (uint32_t y = 0; y < height; y += 4)
+    {
+        for (uint32_t x = 0; x < width; x += 4)
+        {
+            func(x, y, width, block, transparent0, pixels.data());
+            block += blockSize;
+        }
+    }
+    return pixels;
+}
+
+std::vector<uint32_t> DecodeByRow(RowFunc func, const std::vector<uint8_t>& data,
+                                  uint32_t width, uint32_t height, std::size_t blockSize, bool transparent0)
+{
+    std::vector<uint32_t> pixels(width * height);
+    for (uint32_t by = 0; by < height / 4; ++by)
+        func(data.data() + by * (width / 4) * blockSize, width / 4, transparent0, pixels.data() + by * 4 * width, width);
+    return pixels;
+}
+
+} // end unnamed namespace
+
+TEST_CASE("DXT row decoders match block decoders", "[DDS]")
+{
+    constexpr uint32_t width = 64;
+    constexpr uint32_t height = 32;
+
+    SECTION("DXT1")
+    {
+        auto data = RandomBlocks(width * height / 2);
+        // Force some blocks into each of the palette modes
+        data[0] = data[2] = 0x12; data[1] = data[3] = 0x34;
+        data[8] = 0x00; data[9] = 0x00; data[10] = 0xff; data[11] = 0xff;
+        for (bool transparent0 : { false, true })
+        {
+            REQUIRE(DecodeByRow(DecompressBlockRowDXT1, data, width, height, 8, transparent0)
+                    == DecodeByBlock(DecompressBlockDXT1, data, width, height, 8, transparent0));
+        }
+    }
+
+    SECTION("DXT3")
+    {
+        auto data = RandomBlocks(width * height);
+        for (bool transparent0 : { false, true })
+        {
+            REQUIRE(DecodeByRow(DecompressBlockRowDXT3, data, width, height, 16, transparent0)
+                    == DecodeByBlock(DecompressBlockDXT3, data, width, height, 16, transparent0));
+        }
+    }
+
+    SECTION("DXT5")
+    {
+        auto data = RandomBlocks(width * height);
+        data[0] = 0x10; data[1] = 0x80;
+        data[16] = 0x80; data[17] = 0x80;
+        REQUIRE(DecodeByRow(DecompressBlockRowDXT5, data, width, height, 16, false)
+                == DecodeByBlock(DecompressBlockDXT5, data, width, height, 16, false));
+    }
+}
+
+TEST_CASE("DXT decoder benchmark", "[.][benchmark][DDS]")
+{
+    constexpr uint32_t width = 2048;
+    constexpr uint32_t height = 2048;
+    auto data = RandomBlocks(width * height);
+
+    BENCHMARK("DXT5 block decoder")
+    {
+        return DecodeByBlock(DecompressBlockDXT5, data, width, height, 16, false);
+    };
+
+    BENCHMARK("DXT5 row decoder")
+    {
+        return DecodeByRow(DecompressBlockRowDXT5, data, width, height, 16, false);
+    };
+
+    BENCHMARK("DXT1 block decoder")
+    {
+        return DecodeByBlock(DecompressBlockDXT1, data, width, height, 8, true);
+    };
+
+    BENCHMARK("DXT1 row decoder")
+    {
+        return DecodeByRow(DecompressBlockRowDXT1, data, width, height, 8, true);
+    };
+}
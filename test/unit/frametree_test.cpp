@@ -0,0 +1,374 @@
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <catch.hpp>
+
+#include <celengine/body.h>
+#include <celengine/flatframetree.h>
+#include <celengine/frame.h>
+#include <celengine/frametree.h>
+#include <celengine/scenesnapshot.h>
+#include <celengine/solarsys.h>
+#include <celengine/star.h>
+#include <celengine/timeline.h>
+#include <celengine/timelinephase.h>
+#include <celephem/orbit.h>
+#include <celephem/rotation.h>
+
+namespace
+{
+
+constexpr double StartTime = 2451545.0 - 365250.0;
+constexpr double EndTime = 2451545.0 + 365250.0;
+
+// A synthetic solar system: a belt of asteroids on elliptical orbits around
+// the star, with a few moons around some of them.
+class SyntheticSystem
+{
+ public:
+    SyntheticSystem(unsigned int asteroidCount, unsigned int moonSpacing) :
+        solarSystem(&star)
+    {
+        std::mt19937 rng(1701);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        auto starFrame = std::make_shared<J2000EclipticFrame>(Selection(&star));
+        for (unsigned int i = 0; i < asteroidCount; i++)
+        {
+            double pericenter = (2.0 + unit(rng)) * 1.496e8;
+            double period = 365.25 * std::pow(pericenter / 1.496e8, 1.5);
+            Body* asteroid = addBody("Asteroid " + std::to_string(i), starFrame, solarSystem.getFrameTree(),
+                                     new EllipticalOrbit(0.2 * unit(rng), pericenter, 0.3 * unit(rng),
+                                                         6.28 * unit(rng), 6.28 * unit(rng),
+                                                         6.28 * unit(rng), period));
+            if (moonSpacing == 0 || i % moonSpacing != 0)
+                continue;
+
+            auto asteroidFrame = std::make_shared<J2000EclipticFrame>(Selection(asteroid));
+            for (unsigned int j = 0; j < 3; j++)
+            {
+                addBody("Moon " + std::to_string(i) + "/" + std::to_string(j), asteroidFrame,
+                        asteroid->getOrCreateFrameTree(),
+                        new EllipticalOrbit(0.0, 100.0 * (j + 1), 0.0, 0.0, 0.0, 0.0, j + 1.0));
+            }
+        }
+
+        FrameTree* tree = solarSystem.getFrameTree();
+        tree->recomputeBoundingSphere();
+        tree->markUpdated();
+    }
+
+    ~SyntheticSystem()
+    {
+        // Delete the most recently added bodies first, so that moons go
+        // before the asteroids whose frame trees contain them.
+        for (auto iter = bodies.rbegin(); iter != bodies.rend(); ++iter)
+            delete *iter;
+    }
+
+    SyntheticSystem(const SyntheticSystem&) = delete;
+    SyntheticSystem& operator=(const SyntheticSystem&) = delete;
+
+    FrameTree* getFrameTree() const { return solarSystem.getFrameTree(); }
+    std::size_t getBodyCount() const { return bodies.size(); }
+
+ private:
+    Body* addBody(const std::string& name,
+                  const ReferenceFrame::SharedConstPtr& frame,
+                  FrameTree* tree,
+                  Orbit* orbit)
+    {
+        auto* body = new Body(solarSystem.getPlanets(), name);
+        orbits.emplace_back(orbit);
+        auto phase = std::make_shared<const TimelinePhase>(body, StartTime, EndTime, frame, orbit, frame,
+                                                           &rotation, tree);
+        tree->addChild(phase);
+
+        auto* timeline = new Timeline();
+        timeline->appendPhase(phase);
+        body->setTimeline(timeline);
+        bodies.push_back(body);
+        return body;
+    }
+
+    Star star;
+    SolarSystem solarSystem;
+    ConstantOrientation rotation{ Eigen::Quaterniond::Identity() };
+    std::vector<std::unique_ptr<Orbit>> orbits;
+    std::vector<Body*> bodies;
+};
+
+
+// Sum of the astrocentric positions of all bodies active at tdb, found by
+// walking the frame tree.
+Eigen::Vector3d
+SumPositions(const FrameTree& tree, const Eigen::Vector3d& center, double tdb)
+{
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    for (unsigned int i = 0; i < tree.childCount(); i++)
+    {
+        auto phase = tree.getChild(i);
+        if (!phase->includes(tdb))
+            continue;
+
+        Eigen::Vector3d p = center + phase->orbitFrame()->getOrientation(tdb).conjugate() *
+                                     phase->orbit()->positionAtTime(tdb);
+        sum += p;
+        if (const FrameTree* subtree = phase->body()->getFrameTree(); subtree != nullptr)
+            sum += SumPositions(*subtree, p, tdb);
+    }
+
+    return sum;
+}
+
+
+// The same sum, found by walking the flattened tree.
+Eigen::Vector3d
+SumPositions(const FlatFrameTree& flatTree, std::uint32_t parentNode, const Eigen::Vector3d& center, double tdb)
+{
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    const FlatFrameTree::Node& parent = flatTree.getNode(parentNode);
+    for (std::uint32_t i = parent.firstChild; i < parent.firstChild + parent.childCount; i++)
+    {
+        const FlatFrameTree::Node& node = flatTree.getNode(i);
+        if (!node.includes(tdb))
+            continue;
+
+        Eigen::Vector3d p = center + node.orbitFrame->getOrientation(tdb).conjugate() *
+                                     node.orbit->positionAtTime(tdb);
+        sum += p;
+        if (node.subtree != nullptr)
+            sum += SumPositions(flatTree, i, p, tdb);
+    }
+
+    return sum;
+}
+
+
+// Number of bodies active at tdb whose culling sphere is larger than
+// minRadius; stands in for the per-body tests of a culling pass.
+unsigned int
+CountLargeBodies(const FrameTree& tree, float minRadius, double tdb)
+{
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < tree.childCount(); i++)
+    {
+        auto phase = tree.getChild(i);
+        if (!phase->includes(tdb))
+            continue;
+
+        if (phase->body()->getCullingRadius() > minRadius)
+            ++count;
+        if (const FrameTree* subtree = phase->body()->getFrameTree(); subtree != nullptr)
+            count += CountLargeBodies(*subtree, minRadius, tdb);
+    }
+
+    return count;
+}
+
+
+unsigned int
+CountLargeBodies(const FlatFrameTree& flatTree, std::uint32_t parentNode, float minRadius, double tdb)
+{
+    unsigned int count = 0;
+    const FlatFrameTree::Node& parent = flatTree.getNode(parentNode);
+    for (std::uint32_t i = parent.firstChild; i < parent.firstChild + parent.childCount; i++)
+    {
+        const FlatFrameTree::Node& node = flatTree.getNode(i);
+        if (!node.includes(tdb))
+            continue;
+
+        if (node.cullingRadius > minRadius)
+            ++count;
+        if (node.subtree != nullptr)
+            count += CountLargeBodies(flatTree, i, minRadius, tdb);
+    }
+
+    return count;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Flattened frame tree", "[FrameTree]")
+{
+    SyntheticSystem system(1000, 100);
+    const FrameTree& tree = *system.getFrameTree();
+    const FlatFrameTree& flatTree = tree.getFlattened();
+
+    // One node for the root, and one for each body
+    REQUIRE(flatTree.getNodeCount() == system.getBodyCount() + 1);
+    REQUIRE(&tree.getFlattened() == &flatTree);
+
+    const FlatFrameTree::Node& root = flatTree.getNode(0);
+    REQUIRE(root.body == nullptr);
+    REQUIRE(root.subtree == &tree);
+    REQUIRE(root.parent == FlatFrameTree::NoParent);
+    REQUIRE(root.childCount == tree.childCount());
+
+    for (unsigned int i = 0; i < tree.childCount(); i++)
+    {
+        auto phase = tree.getChild(i);
+        const FlatFrameTree::Node& node = flatTree.getNode(root.firstChild + i);
+        REQUIRE(node.body == phase->body());
+        REQUIRE(node.orbit == phase->orbit());
+        REQUIRE(node.orbitFrame == phase->orbitFrame().get());
+        REQUIRE(node.subtree == phase->body()->getFrameTree());
+        REQUIRE(node.parent == 0);
+        REQUIRE(node.cullingRadius == phase->body()->getCullingRadius());
+
+        if (node.subtree != nullptr)
+        {
+            REQUIRE(node.childCount == node.subtree->childCount());
+            for (std::uint32_t j = node.firstChild; j < node.firstChild + node.childCount; j++)
+                REQUIRE(flatTree.getNode(j).parent == root.firstChild + i);
+        }
+    }
+
+    double tdb = 2451545.0 + 1234.5;
+    Eigen::Vector3d expected = SumPositions(tree, Eigen::Vector3d::Zero(), tdb);
+    REQUIRE(SumPositions(flatTree, 0, Eigen::Vector3d::Zero(), tdb) == expected);
+    REQUIRE(CountLargeBodies(flatTree, 0, 0.0f, tdb) == CountLargeBodies(tree, 0.0f, tdb));
+
+    SECTION("Changes to the tree discard the flattened copy")
+    {
+        std::uint64_t id = flatTree.getId();
+        auto phase = tree.getChild(1);
+        Body* body = phase->body();
+        FrameTree* subtree = body->getOrCreateFrameTree();
+        REQUIRE(system.getFrameTree()->updateRequired());
+
+        system.getFrameTree()->recomputeBoundingSphere();
+        system.getFrameTree()->markUpdated();
+        const FlatFrameTree& rebuilt = tree.getFlattened();
+        REQUIRE(rebuilt.getNode(rebuilt.getNode(0).firstChild + 1).subtree == subtree);
+        REQUIRE(rebuilt.getId() != id);
+    }
+
+    SECTION("Scene snapshots match direct evaluation")
+    {
+        SceneSnapshot snapshot;
+        snapshot.reset(tdb);
+        for (std::uint32_t i = 1; i < flatTree.getNodeCount(); i++)
+        {
+            const FlatFrameTree::Node& node = flatTree.getNode(i);
+            if (!node.includes(tdb))
+                continue;
+
+            const Eigen::Vector3d& p = snapshot.getNodePosition(flatTree, i);
+            REQUIRE(p == node.body->getAstrocentricPosition(tdb));
+            REQUIRE(&snapshot.getNodePosition(flatTree, i) == &p);
+            REQUIRE(snapshot.getAstrocentricPosition(*node.body, tdb) == p);
+        }
+
+        // Other times are evaluated directly
+        const Body* body = flatTree.getNode(1).body;
+        REQUIRE(snapshot.getAstrocentricPosition(*body, tdb + 1.0) == body->getAstrocentricPosition(tdb + 1.0));
+
+        snapshot.reset(tdb + 1.0);
+        REQUIRE(snapshot.getNodePosition(flatTree, 1) == body->getAstrocentricPosition(tdb + 1.0));
+    }
+
+    SECTION("Batch evaluation matches direct evaluation")
+    {
+        std::vector<std::uint32_t> nodes;
+        for (std::uint32_t i = 1; i < flatTree.getNodeCount(); i++)
+        {
+            if (flatTree.getNode(i).includes(tdb))
+                nodes.push_back(i);
+        }
+
+        SceneSnapshot snapshot;
+        snapshot.reset(tdb);
+        snapshot.computeNodePositions(flatTree, nodes);
+        for (std::uint32_t i : nodes)
+        {
+            Eigen::Vector3d expected = flatTree.getNode(i).body->getAstrocentricPosition(tdb);
+            REQUIRE((snapshot.getNodePosition(flatTree, i) - expected).norm() <= 1.0e-12 * expected.norm());
+        }
+
+        // Incremental evaluation over consecutive frames
+        snapshot.setIncrementalOrbits(true);
+        for (int frame = 0; frame < 10; frame++)
+        {
+            double t = tdb + frame / 86400.0;
+            snapshot.reset(t);
+            snapshot.computeNodePositions(flatTree, nodes);
+            for (std::uint32_t i : nodes)
+            {
+                Eigen::Vector3d expected = flatTree.getNode(i).body->getAstrocentricPosition(t);
+                REQUIRE((snapshot.getNodePosition(flatTree, i) - expected).norm() <= 1.0e-11 * expected.norm());
+            }
+        }
+    }
+}
+
+
+TEST_CASE("Frame tree traversal benchmark", "[.][benchmark][FrameTree]")
+{
+    SyntheticSystem system(100000, 1000);
+    const FrameTree& tree = *system.getFrameTree();
+    double tdb = 2451545.0;
+
+    BENCHMARK("Frame tree scan")
+    {
+        return CountLargeBodies(tree, 0.5f, tdb);
+    };
+
+    BENCHMARK("Flattened frame tree scan")
+    {
+        return CountLargeBodies(tree.getFlattened(), 0, 0.5f, tdb);
+    };
+
+    BENCHMARK("Frame tree positions")
+    {
+        return SumPositions(tree, Eigen::Vector3d::Zero(), tdb);
+    };
+
+    BENCHMARK("Flattened frame tree positions")
+    {
+        return SumPositions(tree.getFlattened(), 0, Eigen::Vector3d::Zero(), tdb);
+    };
+
+    const FlatFrameTree& flatTree = tree.getFlattened();
+    std::vector<std::uint32_t> nodes;
+    for (std::uint32_t i = 1; i < flatTree.getNodeCount(); i++)
+        nodes.push_back(i);
+    SceneSnapshot snapshot;
+
+    BENCHMARK("Body astrocentric positions")
+    {
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        for (std::uint32_t i : nodes)
+            sum += flatTree.getNode(i).body->getAstrocentricPosition(tdb);
+        return sum;
+    };
+
+    BENCHMARK("Scene snapshot node positions")
+    {
+        snapshot.reset(tdb);
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        for (std::uint32_t i : nodes)
+            sum += snapshot.getNodePosition(flatTree, i);
+        return sum;
+    };
+
+    BENCHMARK("Scene snapshot batch positions")
+    {
+        snapshot.reset(tdb);
+        snapshot.computeNodePositions(flatTree, nodes);
+        return snapshot.getNodePosition(flatTree, nodes.back());
+    };
+
+    BENCHMARK("Flattening")
+    {
+        return FlatFrameTree(tree).getNodeCount();
+    };
+}
@@ -0,0 +1,98 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <celttf/glyphcache.h>
+
+#include <catch.hpp>
+
+namespace
+{
+
+GlyphBitmap
+makeBitmap(wchar_t ch, unsigned int width, unsigned int height)
+{
+    GlyphBitmap bitmap;
+    bitmap.glyph = { ch, static_cast<int>(width) + 1, 0, width, height, -1, static_cast<int>(height), 0.0f, 0.0f, -1 };
+    for (unsigned int i = 0; i < width * height; i++)
+        bitmap.pixels.push_back(static_cast<std::uint8_t>(i * 7 + static_cast<unsigned int>(ch)));
+    return bitmap;
+}
+
+GlyphBitmaps
+makeBitmaps()
+{
+    GlyphBitmaps bitmaps;
+    bitmaps[L'A'] = makeBitmap(L'A', 7, 9);
+    bitmaps[L' '] = makeBitmap(L' ', 0, 0);
+    bitmaps[0x03b1] = makeBitmap(0x03b1, 6, 6);
+    return bitmaps;
+}
+
+} // end unnamed namespace
+
+TEST_CASE("Glyph cache", "[GlyphCache]")
+{
+    const std::string key = "DejaVuSans.ttf|0|12|12|756072|2.12.1";
+    GlyphBitmaps original = makeBitmaps();
+
+    std::ostringstream out;
+    REQUIRE(WriteGlyphCache(out, key, original));
+    const std::string data = out.str();
+
+    SECTION("Bitmaps survive a round trip")
+    {
+        std::istringstream in(data);
+        GlyphBitmaps bitmaps;
+        REQUIRE(ReadGlyphCache(in, key, 64, bitmaps) == GlyphCacheStatus::Loaded);
+        REQUIRE(bitmaps.size() == original.size());
+        for (const auto& [ch, expected] : original)
+        {
+            const GlyphBitmap& bitmap = bitmaps.at(ch);
+            REQUIRE(bitmap.glyph.ch == ch);
+            REQUIRE(bitmap.glyph.ax == expected.glyph.ax);
+            REQUIRE(bitmap.glyph.ay == expected.glyph.ay);
+            REQUIRE(bitmap.glyph.bw == expected.glyph.bw);
+            REQUIRE(bitmap.glyph.bh == expected.glyph.bh);
+            REQUIRE(bitmap.glyph.bl == expected.glyph.bl);
+            REQUIRE(bitmap.glyph.bt == expected.glyph.bt);
+            REQUIRE(bitmap.glyph.page == -1);
+            REQUIRE(bitmap.pixels == expected.pixels);
+        }
+    }
+
+    SECTION("Caches for another key are outdated")
+    {
+        std::istringstream in(data);
+        GlyphBitmaps bitmaps = makeBitmaps();
+        bitmaps.erase(L'A');
+        REQUIRE(ReadGlyphCache(in, "DejaVuSans.ttf|0|14|14|756072|2.12.1", 64, bitmaps) == GlyphCacheStatus::Outdated);
+        REQUIRE(bitmaps.size() == 2);
+    }
+
+    SECTION("Truncated caches are damaged")
+    {
+        for (std::size_t length : { data.size() - 1, data.size() - 20, data.size() / 2 })
+        {
+            std::istringstream in(data.substr(0, length));
+            GlyphBitmaps bitmaps;
+            REQUIRE(ReadGlyphCache(in, key, 64, bitmaps) == GlyphCacheStatus::Damaged);
+            REQUIRE(bitmaps.empty());
+        }
+    }
+
+    SECTION("Oversized glyphs are damage")
+    {
+        std::istringstream in(data);
+        GlyphBitmaps bitmaps;
+        REQUIRE(ReadGlyphCache(in, key, 8, bitmaps) == GlyphCacheStatus::Damaged);
+    }
+
+    SECTION("File names are stable")
+    {
+        REQUIRE(GetGlyphCacheFileName("") == fs::path("cbf29ce484222325.glyphs"));
+        REQUIRE(GetGlyphCacheFileName("a") == fs::path("af63dc4c8601ec8c.glyphs"));
+        REQUIRE(GetGlyphCacheFileName(key) == GetGlyphCacheFileName(std::string(key)));
+        REQUIRE(GetGlyphCacheFileName(key) != GetGlyphCacheFileName(key + "x"));
+    }
+}
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celcompat/numbers.h>
+#include <celephem/kepler.h>
+#include <celephem/orbit.h>
+#include <celmath/mathlib.h>
+#include <celmath/solve.h>
+
+using celestia::ephem::AdvanceKeplerElliptical;
+using celestia::ephem::KeplerState;
+using celestia::ephem::SolveKeplerElliptical;
+using celestia::ephem::SolveKeplerHyperbolic;
+
+namespace
+{
+
+// The scalar solvers used by EllipticalOrbit before the batch solver
+double legacyEccentricAnomaly(double ecc, double M)
+{
+    using celmath::sign;
+    using celmath::solve_iteration_fixed;
+
+    if (ecc == 0.0)
+        return M;
+
+    if (ecc < 0.2)
+        return solve_iteration_fixed([=](double x) { return M + ecc * std::sin(x); }, M, 5).first;
+
+    if (ecc < 0.9)
+    {
+        return solve_iteration_fixed([=](double x) { return x + (M + ecc * std::sin(x) - x) / (1 - ecc * std::cos(x)); },
+                                     M, 6).first;
+    }
+
+    auto laguerreConway = [=](double x)
+    {
+        double s = ecc * (ecc < 1.0 ? std::sin(x) : std::sinh(x));
+        double c = ecc * (ecc < 1.0 ? std::cos(x) : std::cosh(x));
+        double f = ecc < 1.0 ? x - s - M : s - x - M;
+        double f1 = ecc < 1.0 ? 1 - c : c - 1;
+        double f2 = s;
+        return x - 5 * f / (f1 + sign(f1) * std::sqrt(std::abs(16 * f1 * f1 - 20 * f * f2)));
+    };
+
+    if (ecc < 1.0)
+        return solve_iteration_fixed(laguerreConway, M + 0.85 * ecc * sign(std::sin(M)), 8).first;
+    return solve_iteration_fixed(laguerreConway, std::log(2 * M / ecc + 1.85), 30).first;
+}
+
+// Error of a solution of Kepler's equation, relative to the mean anomaly
+// where it is larger than one radian
+double ellipticalError(double ecc, double M, double E)
+{
+    return std::abs(std::remainder(E - ecc * std::sin(E) - M, 2.0 * celestia::numbers::pi)) / std::max(1.0, std::abs(M));
+}
+
+double hyperbolicError(double ecc, double M, double H)
+{
+    return std::abs(ecc * std::sinh(H) - H - M) / std::max(1.0, std::abs(M));
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Kepler equation", "[Kepler]")
+{
+    SECTION("Elliptical orbits")
+    {
+        std::vector<double> M;
+        for (int i = -1000; i <= 1000; i++)
+            M.push_back(i * 0.0031416);
+        for (int i = -100; i <= 100; i++)
+            M.push_back(std::copysign(std::pow(10.0, -std::abs(i) / 10.0), i));
+        M.push_back(100.5);
+        M.push_back(-1.0e5);
+
+        for (double ecc : { 0.0, 0.01, 0.1, 0.19, 0.2, 0.5, 0.8, 0.89, 0.9, 0.95, 0.99, 0.999, 0.9999 })
+        {
+            std::vector<double> e(M.size(), ecc);
+            std::vector<double> E(M.size());
+            SolveKeplerElliptical(e.data(), M.data(), E.data(), M.size());
+            for (std::size_t i = 0; i < M.size(); i++)
+            {
+                INFO("Eccentricity " << ecc << ", mean anomaly " << M[i]);
+                double legacyE = legacyEccentricAnomaly(ecc, M[i]);
+                double legacyError = ellipticalError(ecc, M[i], legacyE);
+                REQUIRE(ellipticalError(ecc, M[i], E[i]) <= std::max(legacyError, 1.0e-14));
+                REQUIRE(std::abs(E[i]) <= celestia::numbers::pi);
+
+                // Where the old solver converged, both agree to within the
+                // conditioning of the equation
+                if (legacyError < 1.0e-14)
+                    REQUIRE(std::abs(std::remainder(E[i] - legacyE, 2.0 * celestia::numbers::pi)) < 1.0e-9);
+            }
+        }
+    }
+
+    SECTION("Hyperbolic orbits")
+    {
+        std::vector<double> M;
+        for (int i = -400; i <= 400; i++)
+            M.push_back(std::copysign(std::pow(10.0, std::abs(i) / 50.0 - 4.0), i));
+
+        for (double ecc : { 1.0001, 1.01, 1.1, 1.5, 2.0, 5.0, 100.0 })
+        {
+            std::vector<double> e(M.size(), ecc);
+            std::vector<double> H(M.size());
+            SolveKeplerHyperbolic(e.data(), M.data(), H.data(), M.size());
+            for (std::size_t i = 0; i < M.size(); i++)
+            {
+                INFO("Eccentricity " << ecc << ", mean anomaly " << M[i]);
+                REQUIRE(hyperbolicError(ecc, M[i], H[i]) <= 1.0e-14);
+                if (M[i] > 0.0)
+                {
+                    double legacyError = hyperbolicError(ecc, M[i], legacyEccentricAnomaly(ecc, M[i]));
+                    REQUIRE(hyperbolicError(ecc, M[i], H[i]) <= std::max(legacyError, 1.0e-14));
+                }
+            }
+        }
+    }
+
+    SECTION("Batches of orbits")
+    {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<double> angle(0.0, 2.0 * celestia::numbers::pi);
+        std::uniform_real_distribution<double> eccentricity(0.0, 1.5);
+
+        std::vector<std::unique_ptr<EllipticalOrbit>> orbits;
+        std::vector<const EllipticalOrbit*> orbitPointers;
+        for (int i = 0; i < 1000; i++)
+        {
+            double ecc = i % 100 == 0 ? 1.0 : eccentricity(rng);
+            orbits.push_back(std::make_unique<EllipticalOrbit>(1.0e8, ecc, angle(rng), angle(rng), angle(rng),
+                                                               angle(rng), 100.0 + i, 2451545.0));
+            orbitPointers.push_back(orbits.back().get());
+        }
+
+        std::vector<Eigen::Vector3d> positions(orbits.size());
+        EllipticalOrbit::positionsAtTime(orbitPointers, 2460000.5, positions);
+        for (std::size_t i = 0; i < orbits.size(); i++)
+        {
+            Eigen::Vector3d expected = orbits[i]->positionAtTime(2460000.5);
+            REQUIRE((positions[i] - expected).norm() <= 1.0e-12 * std::max(1.0, expected.norm()));
+        }
+    }
+}
+
+
+TEST_CASE("Incremental Kepler equation solutions", "[Kepler]")
+{
+    const std::vector<double> eccentricities{ 0.0, 0.05, 0.2, 0.5, 0.8, 0.95, 0.99, 0.999 };
+    std::vector<double> e;
+    std::vector<double> M0;
+    for (double ecc : eccentricities)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            e.push_back(ecc);
+            M0.push_back(i * 0.4 - 3.0);
+        }
+    }
+
+    // Steps of a small fraction of the orbit interspersed with jumps
+    std::vector<KeplerState> states(e.size());
+    std::vector<double> M(e.size());
+    std::vector<double> E(e.size());
+    std::uint32_t incrementalSteps = 0;
+    for (int step = 0; step < 2000; step++)
+    {
+        double dM = step % 500 == 499 ? 2.5 + step * 1.0e-3 : step * 1.0e-4;
+        for (std::size_t i = 0; i < e.size(); i++)
+            M[i] = M0[i] + dM;
+
+        AdvanceKeplerElliptical(e.data(), M.data(), states.data(), e.size());
+        SolveKeplerElliptical(e.data(), M.data(), E.data(), e.size());
+        for (std::size_t i = 0; i < e.size(); i++)
+        {
+            INFO("Eccentricity " << e[i] << ", mean anomaly " << M[i] << ", step " << step);
+            const KeplerState& state = states[i];
+            REQUIRE(state.meanAnomaly == M[i]);
+            REQUIRE(std::abs(state.sinE - std::sin(E[i])) <= 1.0e-12);
+            REQUIRE(std::abs(state.cosE - std::cos(E[i])) <= 1.0e-12);
+            REQUIRE(std::abs(std::remainder(state.eccentricAnomaly - E[i], 2.0 * celestia::numbers::pi)) <= 1.0e-12);
+            if (state.steps != 0)
+                incrementalSteps++;
+        }
+    }
+
+    // Most steps of the smaller eccentricities are incremental
+    REQUIRE(incrementalSteps > e.size() * 1000);
+
+    SECTION("Positions of orbits")
+    {
+        std::vector<std::unique_ptr<EllipticalOrbit>> orbits;
+        std::vector<const EllipticalOrbit*> orbitPointers;
+        for (std::size_t i = 0; i < e.size(); i++)
+        {
+            orbits.push_back(std::make_unique<EllipticalOrbit>(4.0e8, e[i], 0.1, 0.2, 0.3, M0[i], 1500.0, 2451545.0));
+            orbitPointers.push_back(orbits.back().get());
+        }
+
+        std::vector<KeplerState> orbitStates(orbits.size());
+        std::vector<Eigen::Vector3d> positions(orbits.size());
+        for (int frame = 0; frame < 600; frame++)
+        {
+            double t = 2460000.0 + frame * (1.0 / 1440.0);
+            EllipticalOrbit::positionsAtTime(orbitPointers, t, positions, orbitStates);
+            for (std::size_t i = 0; i < orbits.size(); i++)
+            {
+                Eigen::Vector3d expected = orbits[i]->positionAtTime(t);
+                REQUIRE((positions[i] - expected).norm() <= 1.0e-11 * expected.norm());
+            }
+        }
+    }
+}
+
+
+TEST_CASE("Kepler equation benchmark", "[.][benchmark][Kepler]")
+{
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> angle(-celestia::numbers::pi, celestia::numbers::pi);
+    std::uniform_real_distribution<double> eccentricity(0.0, 0.3);
+
+    std::vector<double> e(10000);
+    std::vector<double> M(e.size());
+    std::vector<double> E(e.size());
+    for (std::size_t i = 0; i < e.size(); i++)
+    {
+        e[i] = eccentricity(rng);
+        M[i] = angle(rng);
+    }
+
+    BENCHMARK("Scalar solver")
+    {
+        for (std::size_t i = 0; i < e.size(); i++)
+            E[i] = legacyEccentricAnomaly(e[i], M[i]);
+        return E.back();
+    };
+
+    BENCHMARK("Batch solver")
+    {
+        SolveKeplerElliptical(e.data(), M.data(), E.data(), e.size());
+        return E.back();
+    };
+
+    std::vector<KeplerState> states(e.size());
+    SolveKeplerElliptical(e.data(), M.data(), E.data(), e.size());
+    BENCHMARK("Incremental solver")
+    {
+        // One frame at an hour per second
+        for (double& m : M)
+            m += 1.0e-6;
+        AdvanceKeplerElliptical(e.data(), M.data(), states.data(), e.size());
+        return states.back().sinE;
+    };
+}
@@ -0,0 +1,145 @@
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celengine/labelmanager.h>
+#include <celengine/render.h>
+#include <celutil/color.h>
+
+#include <catch.hpp>
+
+namespace
+{
+
+constexpr int FontHeight = 10;
+constexpr int WindowWidth = 800;
+constexpr int WindowHeight = 600;
+
+// Objects the labels belong to; only their addresses are used
+int objects[8];
+
+Renderer::Annotation
+makeLabel(const std::string& text, int object, float x, float y, float opacity)
+{
+    Renderer::Annotation a;
+    a.labelText = text;
+    a.markerRep = nullptr;
+    a.color = Color(1.0f, 1.0f, 1.0f, opacity);
+    a.position = Eigen::Vector3f(x, y, 0.0f);
+    a.halign = Renderer::AlignLeft;
+    a.valign = Renderer::VerticalAlignBottom;
+    a.size = 0.0f;
+    a.object = &objects[object];
+    a.labelWidth = 8 * static_cast<int>(text.size());
+    return a;
+}
+
+bool
+isShown(const std::vector<Renderer::Annotation>& annotations, int object)
+{
+    for (const auto& a : annotations)
+    {
+        if (a.object == &objects[object])
+            return !a.getLabelText().empty();
+    }
+    return false;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("LabelManager declutters labels", "[LabelManager]")
+{
+    LabelManager labelManager;
+
+    SECTION("Separate labels are all kept")
+    {
+        std::vector<Renderer::Annotation> annotations{
+            makeLabel("Sirius", 0, 100.0f, 100.0f, 0.5f),
+            makeLabel("Vega", 1, 100.0f, 200.0f, 0.5f),
+            makeLabel("Deneb", 2, 300.0f, 100.0f, 0.5f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(annotations.size() == 3);
+        REQUIRE(isShown(annotations, 0));
+        REQUIRE(isShown(annotations, 1));
+        REQUIRE(isShown(annotations, 2));
+    }
+
+    SECTION("Overlapping labels are hidden in order of opacity")
+    {
+        std::vector<Renderer::Annotation> annotations{
+            makeLabel("Alcor", 0, 100.0f, 100.0f, 0.3f),
+            makeLabel("Mizar", 1, 110.0f, 104.0f, 0.9f),
+            makeLabel("Sirius", 2, 400.0f, 300.0f, 0.1f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(annotations.size() == 2);
+        REQUIRE_FALSE(isShown(annotations, 0));
+        REQUIRE(isShown(annotations, 1));
+        REQUIRE(isShown(annotations, 2));
+    }
+
+    SECTION("Labels touching only across the padding overlap")
+    {
+        // "Alcor" is 40 pixels wide; with one pixel of padding around each
+        // label, a label starting 41 pixels further right still overlaps.
+        std::vector<Renderer::Annotation> annotations{
+            makeLabel("Alcor", 0, 100.0f, 100.0f, 0.9f),
+            makeLabel("Mizar", 1, 141.0f, 100.0f, 0.3f),
+            makeLabel("Vega", 2, 143.0f, 200.0f, 0.3f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(isShown(annotations, 0));
+        REQUIRE_FALSE(isShown(annotations, 1));
+        REQUIRE(isShown(annotations, 2));
+    }
+
+    SECTION("Hidden labels keep their markers and other annotations are untouched")
+    {
+        celestia::MarkerRepresentation marker(celestia::MarkerRepresentation::Circle);
+        std::vector<Renderer::Annotation> annotations{
+            makeLabel("M 31", 0, 100.0f, 100.0f, 0.9f),
+            makeLabel("M 32", 1, 102.0f, 101.0f, 0.3f),
+            makeLabel("10h", 2, 101.0f, 100.0f, 0.1f),
+        };
+        annotations[1].markerRep = &marker;
+        annotations[2].object = nullptr;
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(annotations.size() == 3);
+        REQUIRE(isShown(annotations, 0));
+        REQUIRE(annotations[1].markerRep == &marker);
+        REQUIRE(annotations[1].getLabelText().empty());
+        REQUIRE(annotations[2].getLabelText() == "10h");
+    }
+
+    SECTION("Labels shown in the previous frame are favored")
+    {
+        std::vector<Renderer::Annotation> annotations{
+            makeLabel("Alcor", 0, 100.0f, 100.0f, 0.6f),
+            makeLabel("Mizar", 1, 110.0f, 104.0f, 0.5f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(isShown(annotations, 0));
+        REQUIRE_FALSE(isShown(annotations, 1));
+
+        // Mizar becomes slightly brighter, but not enough to displace Alcor
+        annotations = {
+            makeLabel("Alcor", 0, 101.0f, 100.0f, 0.6f),
+            makeLabel("Mizar", 1, 111.0f, 104.0f, 0.7f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE(isShown(annotations, 0));
+        REQUIRE_FALSE(isShown(annotations, 1));
+
+        // Much brighter, it does
+        annotations = {
+            makeLabel("Alcor", 0, 102.0f, 100.0f, 0.2f),
+            makeLabel("Mizar", 1, 112.0f, 104.0f, 0.9f),
+        };
+        labelManager.declutter(annotations, FontHeight, WindowWidth, WindowHeight);
+        REQUIRE_FALSE(isShown(annotations, 0));
+        REQUIRE(isShown(annotations, 1));
+    }
+}
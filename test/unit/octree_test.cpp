@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celengine/octree.h>
+#include <celengine/visibleobjectcache.h>
+
+namespace
+{
+
+struct TestObject
+{
+    Eigen::Vector3d position;
+};
+
+using DynamicTestOctree = DynamicOctree<TestObject, double>;
+using TestOctree = StaticOctree<TestObject, double>;
+
+constexpr double RootSize = 1000.0;
+
+bool
+neverLimited(const TestObject&, const float)
+{
+    return false;
+}
+
+bool
+neverStraddles(const Eigen::Vector3d&, const TestObject&, const float)
+{
+    return false;
+}
+
+double
+noDecay(const double excludingFactor)
+{
+    return excludingFactor;
+}
+
+} // end unnamed namespace
+
+template<> unsigned int DynamicTestOctree::SPLIT_THRESHOLD = 8;
+template<> DynamicTestOctree::LimitingFactorPredicate*
+           DynamicTestOctree::limitingFactorPredicate = neverLimited;
+template<> DynamicTestOctree::StraddlingPredicate*
+           DynamicTestOctree::straddlingPredicate = neverStraddles;
+template<> DynamicTestOctree::ExclusionFactorDecayFunction*
+           DynamicTestOctree::decayFunction = noDecay;
+
+template<>
+DynamicTestOctree*
+DynamicTestOctree::getChild(const TestObject& obj, const Eigen::Vector3d& cellCenterPos)
+{
+    int child = 0;
+    child |= obj.position.x() < cellCenterPos.x() ? 0 : XPos;
+    child |= obj.position.y() < cellCenterPos.y() ? 0 : YPos;
+    child |= obj.position.z() < cellCenterPos.z() ? 0 : ZPos;
+    return _children[child];
+}
+
+template<>
+TestOctree::PointType
+TestOctree::objectPosition(const TestObject& obj)
+{
+    return obj.position;
+}
+
+template<>
+void
+TestOctree::processNodeObjects(OctreeProcessor<TestObject, double>& processor,
+                               const Eigen::Vector3d& obsPosition,
+                               float /*limitingFactor*/,
+                               double /*minDistance*/) const
+{
+    for (unsigned int i = 0; i < nObjects; ++i)
+        processor.process(_firstObject[i], (_firstObject[i].position - obsPosition).norm(), 0.0f);
+}
+
+namespace
+{
+
+struct TestTree
+{
+    std::vector<TestObject> objects;
+    std::unique_ptr<TestObject[]> sorted;
+    TestOctree* root{ nullptr };
+
+    explicit TestTree(std::size_t count)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> coord(-RootSize, RootSize);
+        for (std::size_t i = 0; i < count; ++i)
+            objects.push_back({ Eigen::Vector3d(coord(rng), coord(rng), coord(rng)) });
+
+        DynamicTestOctree dynamicRoot(Eigen::Vector3d::Zero(), 0.0f);
+        for (const auto& obj : objects)
+            dynamicRoot.insertObject(obj, RootSize);
+
+        sorted = std::make_unique<TestObject[]>(count);
+        TestObject* first = sorted.get();
+        dynamicRoot.rebuildAndSort(root, first);
+    }
+
+    ~TestTree() { delete root; }
+};
+
+std::vector<double>
+BruteForceNearest(const std::vector<TestObject>& objects,
+                  const Eigen::Vector3d& position,
+                  std::size_t count,
+                  double maxDistance)
+{
+    std::vector<double> distances;
+    for (const auto& obj : objects)
+    {
+        double distance = (obj.position - position).norm();
+        if (distance <= maxDistance)
+            distances.push_back(distance);
+    }
+    std::sort(distances.begin(), distances.end());
+    if (distances.size() > count)
+        distances.resize(count);
+    return distances;
+}
+
+double
+AngleToRay(const TestObject& obj, const Eigen::Vector3d& origin, const Eigen::Vector3d& direction)
+{
+    Eigen::Vector3d v = (obj.position - origin).normalized();
+    return std::atan2(v.cross(direction).norm(), v.dot(direction));
+}
+
+// Picks the object closest in angle to a ray, like the star and DSO pickers
+class TestRayPicker : public OctreeRayProcessor<TestObject, double>
+{
+ public:
+    TestRayPicker(const Eigen::Vector3d& _origin, const Eigen::Vector3d& _direction, double tolerance) :
+        origin(_origin), direction(_direction), closestAngle(tolerance)
+    {
+    }
+
+    void process(const TestObject& obj, double, float) override
+    {
+        ++processed;
+        double angle = AngleToRay(obj, origin, direction);
+        if (angle < closestAngle)
+        {
+            closestAngle = angle;
+            picked = &obj;
+        }
+    }
+
+    double maxAngle() const override { return closestAngle; }
+
+    Eigen::Vector3d origin;
+    Eigen::Vector3d direction;
+    double closestAngle;
+    const TestObject* picked{ nullptr };
+    std::size_t processed{ 0 };
+};
+
+// Records the objects passed to it, in order
+class TestRecorder : public OctreeProcessor<TestObject, double>
+{
+ public:
+    void process(const TestObject& obj, double distance, float) override
+    {
+        objects.emplace_back(&obj, distance);
+    }
+
+    std::vector<std::pair<const TestObject*, double>> objects;
+};
+
+} // end unnamed namespace
+
+TEST_CASE("Octree nearest object search", "[octree]")
+{
+    TestTree tree(5000);
+    REQUIRE(tree.root->countObjects() == 5000);
+
+    const Eigen::Vector3d queries[] =
+    {
+        Eigen::Vector3d::Zero(),
+        Eigen::Vector3d(500.0, -250.0, 125.0),
+        Eigen::Vector3d(-999.0, 999.0, -999.0),
+        Eigen::Vector3d(3000.0, 0.0, 0.0),
+    };
+
+    for (const auto& position : queries)
+    {
+        for (unsigned int count : { 1u, 10u, 100u })
+        {
+            for (double maxDistance : { 50.0, 400.0, 1.0e6 })
+            {
+                std::vector<std::pair<const TestObject*, double>> nearest;
+                tree.root->findNearestObjects(position, count, maxDistance, RootSize, nearest);
+
+                auto expected = BruteForceNearest(tree.objects, position, count, maxDistance);
+                REQUIRE(nearest.size() == expected.size());
+                for (std::size_t i = 0; i < nearest.size(); ++i)
+                {
+                    REQUIRE(nearest[i].second == Approx(expected[i]));
+                    REQUIRE((nearest[i].first->position - position).norm() == Approx(nearest[i].second));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Octree cone search", "[octree]")
+{
+    TestTree tree(5000);
+
+    Eigen::Vector3d origin(100.0, 200.0, -300.0);
+    Eigen::Vector3d direction = Eigen::Vector3d(1.0, -1.0, 0.5).normalized();
+
+    for (double halfAngle : { 0.05, 0.3, 1.5, 3.0 })
+    {
+        for (double maxDistance : { 200.0, 1.0e6 })
+        {
+            std::vector<std::pair<const TestObject*, double>> found;
+            tree.root->findObjectsInCone(origin, direction, halfAngle, maxDistance, RootSize, found);
+
+            std::size_t expected = 0;
+            for (const auto& obj : tree.objects)
+            {
+                Eigen::Vector3d v = obj.position - origin;
+                double distance = v.norm();
+                if (distance <= maxDistance && v.dot(direction) >= std::cos(halfAngle) * distance)
+                    ++expected;
+            }
+
+            REQUIRE(found.size() == expected);
+            for (const auto& [obj, distance] : found)
+            {
+                Eigen::Vector3d v = obj->position - origin;
+                REQUIRE(distance <= maxDistance);
+                REQUIRE(v.dot(direction) >= std::cos(halfAngle) * distance);
+            }
+        }
+    }
+}
+
+TEST_CASE("Octree ray traversal", "[octree]")
+{
+    TestTree tree(5000);
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> coord(-1.5 * RootSize, 1.5 * RootSize);
+    std::normal_distribution<double> normal;
+
+    for (int i = 0; i < 200; ++i)
+    {
+        Eigen::Vector3d origin(coord(rng), coord(rng), coord(rng));
+        Eigen::Vector3d direction = Eigen::Vector3d(normal(rng), normal(rng), normal(rng)).normalized();
+
+        for (double tolerance : { 0.001, 0.05, 0.5 })
+        {
+            TestRayPicker picker(origin, direction, tolerance);
+            tree.root->processObjectsAlongRay(picker, origin, direction, 1.0e3f, RootSize);
+
+            const TestObject* expected = nullptr;
+            double expectedAngle = tolerance;
+            for (const auto& obj : tree.objects)
+            {
+                double angle = AngleToRay(obj, origin, direction);
+                if (angle < expectedAngle)
+                {
+                    expectedAngle = angle;
+                    expected = &obj;
+                }
+            }
+
+            REQUIRE((picker.picked == nullptr) == (expected == nullptr));
+            if (expected != nullptr)
+            {
+                REQUIRE(picker.closestAngle == Approx(expectedAngle));
+                REQUIRE(picker.picked->position == expected->position);
+            }
+            REQUIRE(picker.processed < tree.objects.size());
+        }
+    }
+}
+
+TEST_CASE("Visible object cache", "[octree]")
+{
+    TestTree tree(100);
+
+    using Cache = VisibleObjectCache<TestObject, double>;
+    Cache::Query query{ &tree, 100, Eigen::Vector3d(100.0, 0.0, 0.0),
+                        Eigen::Quaternionf::Identity(), 1.0f, 1.5f, 6.0f };
+
+    Cache cache;
+    REQUIRE(!cache.matches(query));
+
+    // Stand in for an octree query, which passes the objects it finds to
+    // the cache
+    TestRecorder recorded;
+    cache.record(query, recorded);
+    for (unsigned int i = 0; i < 100; i += 3)
+        cache.process(tree.sorted[i], tree.sorted[i].position.norm(), 0.0f);
+    REQUIRE(recorded.objects.size() == 34);
+    REQUIRE(cache.matches(query));
+
+    TestRecorder replayed;
+    cache.replay(replayed);
+    REQUIRE(replayed.objects == recorded.objects);
+
+    Cache::Query moved = query;
+    moved.position.x() += 1.0;
+    REQUIRE(!cache.matches(moved));
+    Cache::Query grown = query;
+    grown.objectCount++;
+    REQUIRE(!cache.matches(grown));
+
+    cache.invalidate();
+    REQUIRE(!cache.matches(query));
+
+    SECTION("Objects that are pointers are kept by value")
+    {
+        class PointerRecorder : public OctreeProcessor<const TestObject*, double>
+        {
+         public:
+            void process(const TestObject* const& obj, double, float) override
+            {
+                objects.push_back(obj);
+            }
+
+            std::vector<const TestObject*> objects;
+        };
+
+        VisibleObjectCache<const TestObject*, double> pointerCache;
+        PointerRecorder pointerRecorded;
+        pointerCache.record({ &tree, 100, Eigen::Vector3d::Zero(), Eigen::Quaternionf::Identity(),
+                              1.0f, 1.0f, 6.0f },
+                            pointerRecorded);
+        for (unsigned int i = 0; i < 100; i++)
+        {
+            // The octree passes pointers in temporaries
+            const TestObject* obj = &tree.sorted[i];
+            pointerCache.process(obj, 0.0, 0.0f);
+        }
+
+        PointerRecorder pointerReplayed;
+        pointerCache.replay(pointerReplayed);
+        REQUIRE(pointerReplayed.objects == pointerRecorded.objects);
+    }
+}
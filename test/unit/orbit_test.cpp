@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <catch.hpp>
+
+#include <celcompat/filesystem.h>
+#include <celephem/orbit.h>
+#include <celephem/samporbit.h>
+#include <celephem/vsop87.h>
+
+namespace
+{
+
+std::vector<double> evenTimes(double start, double step, std::size_t count)
+{
+    std::vector<double> times(count);
+    for (std::size_t i = 0; i < count; i++)
+        times[i] = start + step * static_cast<double>(i);
+    return times;
+}
+
+// Check that the batch positions match those from positionAtTime to within
+// a tolerance relative to the distance from the center
+void requireBatchMatches(const Orbit& orbit, const std::vector<double>& times, double tolerance)
+{
+    std::vector<Eigen::Vector3d> positions(times.size());
+    orbit.positionsAtTimes(times, positions);
+    for (std::size_t i = 0; i < times.size(); i++)
+    {
+        Eigen::Vector3d expected = orbit.positionAtTime(times[i]);
+        INFO("Time " << times[i]);
+        REQUIRE((positions[i] - expected).norm() <= tolerance * expected.norm());
+    }
+}
+
+// Create a sampled trajectory of a circular orbit, with samples every day
+std::unique_ptr<Orbit> sampledOrbit(TrajectoryInterpolation interpolation)
+{
+    fs::path path = fs::temp_directory_path() / "celestia_orbit_test.xyz";
+    {
+        std::ofstream out(path);
+        out.precision(17);
+        for (int i = 0; i <= 400; i++)
+        {
+            double t = 2451545.0 + i;
+            out << t << ' ' << 1.0e6 * std::cos(i * 0.05) << ' '
+                << 1.0e6 * std::sin(i * 0.05) << ' ' << 1.0e3 * i << '\n';
+        }
+    }
+
+    std::unique_ptr<Orbit> orbit(LoadSampledTrajectoryDoublePrec(path, interpolation));
+    fs::remove(path);
+    return orbit;
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Orbit batch positions", "[Orbit]")
+{
+    SECTION("Elliptical orbits")
+    {
+        for (double e : { 0.0, 0.1, 0.5, 0.9, 0.99, 1.5, 3.0 })
+        {
+            INFO("Eccentricity " << e);
+            EllipticalOrbit orbit(1.0e8, e, 0.3, 1.1, 2.5, 0.7, 365.25, 2451545.0);
+            requireBatchMatches(orbit, evenTimes(2451545.0, 3.7, 200), 1.0e-12);
+        }
+    }
+
+    SECTION("VSOP87 orbits")
+    {
+        for (const char* name : { "vsop87-mercury", "vsop87-earth", "vsop87-neptune", "vsop87-sun" })
+        {
+            INFO("Orbit " << name);
+            std::unique_ptr<Orbit> orbit(CreateVSOP87Orbit(name));
+            REQUIRE(orbit != nullptr);
+
+            // Evenly spaced times, a spacing which isn't exactly representable,
+            // and times which aren't evenly spaced
+            requireBatchMatches(*orbit, evenTimes(2451545.0, 1.0, 300), 1.0e-12);
+            requireBatchMatches(*orbit, evenTimes(2400000.5, 0.1, 300), 1.0e-12);
+            requireBatchMatches(*orbit, { 2451545.0, 2451546.0, 2460000.0, 2460000.5, 2300000.0, 2451545.25 }, 1.0e-12);
+        }
+    }
+
+    SECTION("Sampled orbits")
+    {
+        for (auto interpolation : { TrajectoryInterpolationLinear, TrajectoryInterpolationCubic })
+        {
+            auto orbit = sampledOrbit(interpolation);
+            REQUIRE(orbit != nullptr);
+
+            // Increasing times, including some outside the time range
+            requireBatchMatches(*orbit, evenTimes(2451540.0, 0.37, 1200), 1.0e-14);
+            // Times out of order
+            requireBatchMatches(*orbit, { 2451700.5, 2451600.25, 2451600.75, 2451545.0, 2451945.0, 2451800.0 }, 1.0e-14);
+        }
+    }
+}
+
+
+TEST_CASE("Elliptical orbit maximum speed", "[Orbit]")
+{
+    for (double e : { 0.0, 0.1, 0.5, 0.9 })
+    {
+        INFO("Eccentricity " << e);
+        EllipticalOrbit orbit(1.0e8, e, 0.3, 1.1, 2.5, 0.7, 365.25, 2451545.0);
+        double maxSpeed = orbit.getMaximumSpeed();
+        double fastest = 0.0;
+        for (double t : evenTimes(2451545.0, 0.25, 1461))
+            fastest = std::max(fastest, orbit.velocityAtTime(t).norm());
+
+        REQUIRE(fastest <= maxSpeed * (1.0 + 1.0e-12));
+        REQUIRE(fastest >= maxSpeed * 0.99);
+    }
+
+    EllipticalOrbit hyperbolic(1.0e8, 1.5, 0.3, 1.1, 2.5, 0.7, 365.25, 2451545.0);
+    REQUIRE(std::isinf(hyperbolic.getMaximumSpeed()));
+}
+
+
+TEST_CASE("Orbit benchmark", "[.][benchmark][Orbit]")
+{
+    auto times = evenTimes(2451545.0, 0.25, 1000);
+    std::vector<Eigen::Vector3d> positions(times.size());
+
+    EllipticalOrbit elliptical(1.0e8, 0.2, 0.3, 1.1, 2.5, 0.7, 365.25, 2451545.0);
+    std::unique_ptr<Orbit> vsop87(CreateVSOP87Orbit("vsop87-earth"));
+    auto sampled = sampledOrbit(TrajectoryInterpolationCubic);
+
+    for (const auto& [name, orbit] : { std::make_pair("Elliptical", static_cast<const Orbit*>(&elliptical)),
+                                       std::make_pair("VSOP87", static_cast<const Orbit*>(vsop87.get())),
+                                       std::make_pair("Sampled", static_cast<const Orbit*>(sampled.get())) })
+    {
+        BENCHMARK(std::string(name) + " positionAtTime")
+        {
+            for (std::size_t i = 0; i < times.size(); i++)
+                positions[i] = orbit->positionAtTime(times[i]);
+            return positions.back();
+        };
+
+        BENCHMARK(std::string(name) + " positionsAtTimes")
+        {
+            orbit->positionsAtTimes(times, positions);
+            return positions.back();
+        };
+    }
+}
@@ -0,0 +1,117 @@
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <celengine/parsedcatalog.h>
+#include <celengine/value.h>
+#include <celutil/logger.h>
+
+#include <catch.hpp>
+
+using celestia::util::Level;
+using celestia::util::Logger;
+
+TEST_CASE("ParsedCatalog", "[ParsedCatalog]")
+{
+    SECTION("Reads tokens and property groups")
+    {
+        std::istringstream input("Modify 71683 \"ALF Cen A\"\n"
+                                 "{\n"
+                                 "    Radius 695700\n"
+                                 "    Category [ \"Nearby stars\" ]\n"
+                                 "}\n"
+                                 "\"Moon\" \"Sol/Earth\" { Mass 0.0123 }\n");
+        ParsedCatalog catalog(input);
+
+        REQUIRE(catalog.getTokenType() == Tokenizer::TokenBegin);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenName);
+        REQUIRE(catalog.getStringValue() == "Modify");
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenNumber);
+        REQUIRE(catalog.getNumberValue() == 71683.0);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.getStringValue() == "ALF Cen A");
+        REQUIRE(catalog.getLineNumber() == 1);
+
+        // The star catalog loader reads the group token, then pushes it
+        // back before reading the group
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenBeginGroup);
+        catalog.pushBack();
+        std::unique_ptr<Value> star(catalog.readValue());
+        REQUIRE(star != nullptr);
+        REQUIRE(star->getType() == Value::HashType);
+        double radius = 0.0;
+        REQUIRE(star->getHash()->getNumber("Radius", radius));
+        REQUIRE(radius == 695700.0);
+        REQUIRE(star->getHash()->getValue("Category")->getType() == Value::ArrayType);
+        REQUIRE(catalog.getLineNumber() == 5);
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.getStringValue() == "Moon");
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.getStringValue() == "Sol/Earth");
+        std::unique_ptr<Value> moon(catalog.readValue());
+        REQUIRE(moon != nullptr);
+        REQUIRE(moon->getType() == Value::HashType);
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenEnd);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenEnd);
+    }
+
+    SECTION("Values are only returned for property groups")
+    {
+        std::istringstream input("\"Moon\" \"Sol/Earth\" [ 1 2 ]\n");
+        ParsedCatalog catalog(input);
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.readValue() == nullptr);
+        REQUIRE(catalog.getTokenType() == Tokenizer::TokenBeginArray);
+    }
+
+    SECTION("Parsing stops at a group that can't be read")
+    {
+        std::istringstream input("\"A\" \"Sol\" { Radius 1 }\n"
+                                 "\"B\" \"Sol\" { Radius }\n"
+                                 "\"C\" \"Sol\" { Radius 3 }\n");
+        ParsedCatalog catalog(input);
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        std::unique_ptr<Value> a(catalog.readValue());
+        REQUIRE(a != nullptr);
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.getStringValue() == "B");
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.readValue() == nullptr);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenError);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenError);
+    }
+
+    SECTION("Tokenizer errors are logged when they are reached")
+    {
+        std::ostringstream log;
+        std::ostringstream err;
+        Logger logger(Level::Info, log, err);
+        Logger* previousLogger = Logger::g_logger;
+        Logger::g_logger = &logger;
+
+        std::istringstream input("\"A\" \"Sol\" { Radius 1 }\n"
+                                 "\"B\" \"Sol\" { Texture \"bad \\q escape\" }\n");
+        ParsedCatalog catalog(input);
+        REQUIRE(err.str().empty());
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        std::unique_ptr<Value> a(catalog.readValue());
+        REQUIRE(a != nullptr);
+        REQUIRE(err.str().empty());
+
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.nextToken() == Tokenizer::TokenString);
+        REQUIRE(catalog.readValue() == nullptr);
+        std::string errors = err.str();
+        Logger::g_logger = previousLogger;
+        REQUIRE(errors == "Invalid string escape sequence\n");
+    }
+}
@@ -0,0 +1,325 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <celcompat/filesystem.h>
+#include <celengine/value.h>
+#include <celscript/common/scriptmaps.h>
+#include <celscript/legacy/scriptcache.h>
+
+#include <catch.hpp>
+
+using namespace celestia::scripts;
+
+namespace
+{
+
+const std::string Source = "{\nwait { duration 2 }\nset { name \"FOV\" value 30 }\n}\n";
+
+// Offset of the first command name in a cache file: the header, version,
+// source size, source check and command count
+constexpr std::size_t CommandsOffset = 8 + 4 + 8 + 8 + 4;
+
+ParsedScript
+makeScript()
+{
+    ParsedScript script(2);
+    script[0].name = "wait";
+    script[0].parameters.addValue("duration", *new Value(2.0));
+
+    auto* array = new Array();
+    array->push_back(new Value(1.5));
+    array->push_back(new Value("text"));
+    auto* nested = new Hash();
+    nested->addValue("flag", *new Value(true));
+    nested->addValue("none", *new Value());
+
+    script[1].name = "set";
+    script[1].parameters.addValue("name", *new Value("FOV"));
+    script[1].parameters.addValue("value", *new Value(30.0));
+    script[1].parameters.addValue("list", *new Value(array));
+    script[1].parameters.addValue("nested", *new Value(nested));
+    return script;
+}
+
+std::string
+writeScript(const ParsedScript& script)
+{
+    std::ostringstream out;
+    REQUIRE(WriteParsedScript(out, Source, script));
+    return out.str();
+}
+
+void
+writeLE32(std::string& data, std::size_t offset, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        data[offset + i] = static_cast<char>((value >> (i * 8)) & 0xff);
+}
+
+// Temporary script directory, removed at the end of the test
+struct ScriptDirectory
+{
+    ScriptDirectory() : path(fs::temp_directory_path() / "celestia_scriptcache_test")
+    {
+        fs::remove_all(path);
+        fs::create_directories(path);
+    }
+
+    ~ScriptDirectory()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    void write(const fs::path& name, const std::string& data) const
+    {
+        std::ofstream out(path / name, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(data.data(), data.size());
+    }
+
+    fs::path path;
+};
+
+} // end unnamed namespace
+
+
+TEST_CASE("Parsed script cache format", "[ScriptCache]")
+{
+    const std::string data = writeScript(makeScript());
+
+    SECTION("Parsed scripts survive a round trip")
+    {
+        std::istringstream in(data);
+        ParsedScript script;
+        REQUIRE(ReadParsedScript(in, Source, script));
+        REQUIRE(script.size() == 2);
+
+        double number = 0.0;
+        std::string text;
+        REQUIRE(script[0].name == "wait");
+        REQUIRE(script[0].parameters.getNumber("duration", number));
+        REQUIRE(number == 2.0);
+
+        REQUIRE(script[1].name == "set");
+        REQUIRE(script[1].parameters.getString("name", text));
+        REQUIRE(text == "FOV");
+        REQUIRE(script[1].parameters.getNumber("value", number));
+        REQUIRE(number == 30.0);
+
+        const Value* list = script[1].parameters.getValue("list");
+        REQUIRE(list != nullptr);
+        REQUIRE(list->getType() == Value::ArrayType);
+        REQUIRE(list->getArray()->size() == 2);
+        REQUIRE(list->getArray()->at(0)->getNumber() == 1.5);
+        REQUIRE(list->getArray()->at(1)->getString() == "text");
+
+        const Value* nested = script[1].parameters.getValue("nested");
+        REQUIRE(nested != nullptr);
+        REQUIRE(nested->getType() == Value::HashType);
+        bool flag = false;
+        REQUIRE(nested->getHash()->getBoolean("flag", flag));
+        REQUIRE(flag);
+        REQUIRE(nested->getHash()->getValue("none")->getType() == Value::NullType);
+
+        // Writing the script again gives the same file
+        REQUIRE(writeScript(script) == data);
+    }
+
+    SECTION("Parsed scripts for another source are rejected")
+    {
+        std::istringstream in(data);
+        ParsedScript script = makeScript();
+        REQUIRE_FALSE(ReadParsedScript(in, Source + " ", script));
+        REQUIRE(script.size() == 2);
+    }
+
+    SECTION("Truncated files are rejected")
+    {
+        for (std::size_t length : { std::size_t(0), std::size_t(8), CommandsOffset, data.size() / 2, data.size() - 1 })
+        {
+            INFO("Length " << length);
+            std::istringstream in(data.substr(0, length));
+            ParsedScript script;
+            REQUIRE_FALSE(ReadParsedScript(in, Source, script));
+            REQUIRE(script.empty());
+        }
+    }
+
+    SECTION("Files exceeding the bounds are rejected")
+    {
+        // The parameter count of the first command, after its name
+        const std::size_t countOffset = CommandsOffset + 4 + 4;
+        for (std::uint32_t count : { UINT32_C(0x10001), UINT32_C(0xffffffff) })
+        {
+            INFO("Count " << count);
+            std::string damaged = data;
+            writeLE32(damaged, countOffset, count);
+            std::istringstream in(damaged);
+            ParsedScript script;
+            REQUIRE_FALSE(ReadParsedScript(in, Source, script));
+        }
+
+        std::string damaged = data;
+        writeLE32(damaged, CommandsOffset - 4, UINT32_C(0x100001));
+        std::istringstream commandsIn(damaged);
+        ParsedScript script;
+        REQUIRE_FALSE(ReadParsedScript(commandsIn, Source, script));
+
+        damaged = data;
+        writeLE32(damaged, CommandsOffset, UINT32_C(0xffffffff));
+        std::istringstream nameIn(damaged);
+        REQUIRE_FALSE(ReadParsedScript(nameIn, Source, script));
+    }
+
+    SECTION("Scripts exceeding the bounds are not written")
+    {
+        ParsedScript script(1);
+        script[0].name = "mark";
+        auto* array = new Array();
+        for (int i = 0; i <= 0x10000; i++)
+            array->push_back(new Value(static_cast<double>(i)));
+        script[0].parameters.addValue("list", *new Value(array));
+
+        std::ostringstream out;
+        REQUIRE_FALSE(WriteParsedScript(out, Source, script));
+        REQUIRE(out.str().empty());
+
+        ParsedScript deep(1);
+        deep[0].name = "mark";
+        auto* hash = new Hash();
+        Hash* inner = hash;
+        for (int i = 0; i < 20; i++)
+        {
+            auto* child = new Hash();
+            inner->addValue("child", *new Value(child));
+            inner = child;
+        }
+        deep[0].parameters.addValue("nested", *new Value(hash));
+        REQUIRE_FALSE(WriteParsedScript(out, Source, deep));
+        REQUIRE(out.str().empty());
+    }
+}
+
+
+TEST_CASE("Script cache reloading", "[ScriptCache]")
+{
+    ScriptDirectory dir;
+    const fs::path path = dir.path / "test.cel";
+    dir.write("test.cel", Source);
+
+    auto scriptMaps = std::make_shared<ScriptMaps>();
+    ScriptCache cache;
+    std::string errorMsg;
+    auto script = cache.load(path, scriptMaps, errorMsg);
+    REQUIRE(script != nullptr);
+    REQUIRE(script->getCommands().size() == 2);
+
+    SECTION("Unchanged scripts are shared")
+    {
+        REQUIRE(cache.load(path, scriptMaps, errorMsg) == script);
+    }
+
+    SECTION("Scripts are loaded again after a size change")
+    {
+        dir.write("test.cel", "{\nwait { duration 2 }\n}\n");
+        auto reloaded = cache.load(path, scriptMaps, errorMsg);
+        REQUIRE(reloaded != nullptr);
+        REQUIRE(reloaded != script);
+        REQUIRE(reloaded->getCommands().size() == 1);
+    }
+
+    SECTION("Scripts are loaded again after a modification time change")
+    {
+        fs::last_write_time(path, fs::last_write_time(path) - std::chrono::hours(1));
+        auto reloaded = cache.load(path, scriptMaps, errorMsg);
+        REQUIRE(reloaded != nullptr);
+        REQUIRE(reloaded != script);
+        REQUIRE(cache.load(path, scriptMaps, errorMsg) == reloaded);
+    }
+
+    SECTION("Parsed scripts are stored in the cache directory")
+    {
+        const fs::path cacheDir = dir.path / "cache";
+        ScriptCache stored;
+        stored.setDirectory(cacheDir);
+        REQUIRE(stored.load(path, scriptMaps, errorMsg) != nullptr);
+
+        std::size_t files = 0;
+        for (const auto& entry : fs::directory_iterator(cacheDir))
+        {
+            REQUIRE(entry.path().extension() == ".cmd");
+            std::ifstream in(entry.path(), std::ios::in | std::ios::binary);
+            ParsedScript parsed;
+            REQUIRE(ReadParsedScript(in, Source, parsed));
+            REQUIRE(parsed.size() == 2);
+            files++;
+        }
+        REQUIRE(files == 1);
+
+        ScriptCache reopened;
+        reopened.setDirectory(cacheDir);
+        auto loaded = reopened.load(path, scriptMaps, errorMsg);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->getCommands().size() == 2);
+    }
+}
+
+
+TEST_CASE("Script cache pruning", "[ScriptCache]")
+{
+    ScriptDirectory dir;
+    const fs::path cacheDir = dir.path / "cache";
+    dir.write("first.cel", Source);
+    dir.write("second.cel", "{\nwait { duration 2 }\n}\n");
+
+    auto scriptMaps = std::make_shared<ScriptMaps>();
+    std::string errorMsg;
+    {
+        ScriptCache cache;
+        cache.setDirectory(cacheDir);
+        REQUIRE(cache.load(dir.path / "first.cel", scriptMaps, errorMsg) != nullptr);
+        REQUIRE(cache.load(dir.path / "second.cel", scriptMaps, errorMsg) != nullptr);
+    }
+    dir.write(fs::path("cache") / "0123456789abcdef.cmd", "CELSCRPT");
+    dir.write(fs::path("cache") / "readme.txt", "not a script");
+
+    auto countFiles = [&cacheDir]()
+    {
+        std::size_t count = 0;
+        for (const auto& entry : fs::directory_iterator(cacheDir))
+        {
+            if (entry.path().extension() == ".cmd")
+                count++;
+        }
+        return count;
+    };
+    REQUIRE(countFiles() == 3);
+
+    ScriptCache cache;
+    cache.setDirectory(cacheDir);
+
+    SECTION("Damaged files are removed")
+    {
+        cache.prune();
+        REQUIRE(countFiles() == 2);
+        REQUIRE(fs::exists(cacheDir / "readme.txt"));
+    }
+
+    SECTION("Files unused for a long time are removed")
+    {
+        auto old = fs::file_time_type::clock::now() - std::chrono::hours(24 * 365);
+        for (const auto& entry : fs::directory_iterator(cacheDir))
+            fs::last_write_time(entry.path(), old);
+
+        // Loading a script from the cache marks its file as used
+        REQUIRE(cache.load(dir.path / "first.cel", scriptMaps, errorMsg) != nullptr);
+        cache.prune();
+        REQUIRE(countFiles() == 1);
+        REQUIRE(fs::exists(cacheDir / "readme.txt"));
+    }
+}
@@ -0,0 +1,233 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+#include <celengine/shadercache.h>
+#include <celengine/shadermanager.h>
+
+#include <catch.hpp>
+
+namespace
+{
+
+const std::string Driver = "Mesa|llvmpipe|4.5 (Core Profile) Mesa 23.0.4|4.50";
+const std::string VertexSource = "void main() { gl_Position = vec4(0.0); }";
+const std::string FragmentSource = "void main() { gl_FragColor = vec4(1.0); }";
+
+// Temporary cache directory, removed at the end of the test
+struct CacheDirectory
+{
+    CacheDirectory() : path(fs::temp_directory_path() / "celestia_shadercache_test")
+    {
+        fs::remove_all(path);
+    }
+
+    ~CacheDirectory()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    std::vector<fs::path> binaries() const
+    {
+        std::vector<fs::path> result;
+        for (const auto& entry : fs::directory_iterator(path))
+        {
+            if (entry.path().extension() == ".bin")
+                result.push_back(entry.path());
+        }
+        return result;
+    }
+
+    fs::path path;
+};
+
+std::vector<char>
+makeBinary(std::size_t size)
+{
+    std::vector<char> binary;
+    for (std::size_t i = 0; i < size; i++)
+        binary.push_back(static_cast<char>(i * 13 + 5));
+    return binary;
+}
+
+std::string
+readFile(const fs::path& path)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void
+writeFile(const fs::path& path, const std::string& data)
+{
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+} // end unnamed namespace
+
+
+TEST_CASE("Shader cache binaries", "[ShaderCache]")
+{
+    CacheDirectory dir;
+    ShaderCache cache(dir.path, Driver);
+    const std::vector<char> original = makeBinary(1000);
+    cache.storeBinary(VertexSource, FragmentSource, 0x8741, original);
+    REQUIRE(dir.binaries().size() == 1);
+
+    std::uint32_t format = 0;
+    std::vector<char> binary;
+
+    SECTION("Binaries survive a round trip")
+    {
+        REQUIRE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        REQUIRE(format == 0x8741);
+        REQUIRE(binary == original);
+
+        ShaderCache reopened(dir.path, Driver);
+        REQUIRE(reopened.loadBinary(VertexSource, FragmentSource, format, binary));
+        REQUIRE(binary == original);
+    }
+
+    SECTION("Binaries are not found for other sources")
+    {
+        REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource + " ", format, binary));
+        REQUIRE_FALSE(cache.loadBinary(FragmentSource, VertexSource, format, binary));
+    }
+
+    SECTION("Binaries from another driver are rejected")
+    {
+        ShaderCache other(dir.path, Driver + ".1");
+        REQUIRE_FALSE(other.loadBinary(VertexSource, FragmentSource, format, binary));
+    }
+
+    SECTION("Binaries in another format version are rejected")
+    {
+        fs::path path = dir.binaries().front();
+        std::string data = readFile(path);
+        data[8] = static_cast<char>(data[8] + 1);
+        writeFile(path, data);
+        REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+    }
+
+    SECTION("Truncated or corrupt binaries are rejected")
+    {
+        fs::path path = dir.binaries().front();
+        const std::string data = readFile(path);
+        for (std::size_t length : { std::size_t(0), std::size_t(10), std::size_t(30), data.size() - 1 })
+        {
+            INFO("Length " << length);
+            writeFile(path, data.substr(0, length));
+            REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        }
+
+        std::string corrupt = data;
+        corrupt[0] = 'X';
+        writeFile(path, corrupt);
+        REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+    }
+
+    SECTION("Binaries with an oversized length are rejected")
+    {
+        // The binary length follows the header, driver hash, source lengths,
+        // source check and format
+        constexpr std::size_t lengthOffset = 8 + 4 + 8 + 8 + 8 + 8 + 4;
+        fs::path path = dir.binaries().front();
+        std::string data = readFile(path);
+        for (int i = 0; i < 4; i++)
+            data[lengthOffset + i] = '\xff';
+        writeFile(path, data);
+        REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        REQUIRE(binary.capacity() < 0x10000);
+    }
+}
+
+
+TEST_CASE("Shader cache pruning", "[ShaderCache]")
+{
+    CacheDirectory dir;
+    ShaderCache cache(dir.path, Driver);
+    ShaderCache other(dir.path, Driver + ".1");
+    cache.storeBinary(VertexSource, FragmentSource, 1, makeBinary(100));
+    cache.storeBinary(VertexSource, FragmentSource + "\n", 1, makeBinary(100));
+    other.storeBinary(VertexSource, FragmentSource, 1, makeBinary(100));
+    writeFile(dir.path / "0123456789abcdef.bin", "CELSHBIN");
+    writeFile(dir.path / "readme.txt", "not a shader");
+    REQUIRE(dir.binaries().size() == 4);
+
+    std::uint32_t format;
+    std::vector<char> binary;
+
+    SECTION("Binaries from other drivers and damaged files are removed")
+    {
+        cache.prune();
+        REQUIRE(dir.binaries().size() == 2);
+        REQUIRE(fs::exists(dir.path / "readme.txt"));
+        REQUIRE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        REQUIRE(cache.loadBinary(VertexSource, FragmentSource + "\n", format, binary));
+    }
+
+    SECTION("Binaries unused for a long time are removed")
+    {
+        auto old = fs::file_time_type::clock::now() - std::chrono::hours(24 * 365);
+        for (const fs::path& path : dir.binaries())
+            fs::last_write_time(path, old);
+
+        // Loading a binary marks it as used
+        REQUIRE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        cache.prune();
+        REQUIRE(dir.binaries().size() == 1);
+        REQUIRE(cache.loadBinary(VertexSource, FragmentSource, format, binary));
+        REQUIRE_FALSE(cache.loadBinary(VertexSource, FragmentSource + "\n", format, binary));
+    }
+}
+
+
+TEST_CASE("Shader cache variants", "[ShaderCache]")
+{
+    CacheDirectory dir;
+    ShaderCache cache(dir.path, Driver);
+    REQUIRE(cache.readVariants().empty());
+
+    std::vector<ShaderProperties> variants(3);
+    variants[0].texUsage = ShaderProperties::DiffuseTexture;
+    variants[0].nLights = 1;
+    variants[0].lightModel = ShaderProperties::DiffuseModel;
+    variants[1].texUsage = ShaderProperties::DiffuseTexture | ShaderProperties::NormalTexture;
+    variants[1].nLights = 2;
+    variants[1].lightModel = ShaderProperties::DiffuseModel;
+    variants[1].shadowCounts = 3;
+    variants[2].nLights = 0;
+    variants[2].lightModel = ShaderProperties::EmissiveModel;
+    variants[2].fishEyeOverride = ShaderProperties::FisheyeOverrideModeDisabled;
+    cache.writeVariants(variants);
+
+    SECTION("Variants survive a round trip")
+    {
+        std::vector<ShaderProperties> loaded = ShaderCache(dir.path, Driver).readVariants();
+        REQUIRE(loaded.size() == variants.size());
+        for (std::size_t i = 0; i < variants.size(); i++)
+        {
+            INFO("Variant " << i);
+            REQUIRE(loaded[i].texUsage == variants[i].texUsage);
+            REQUIRE(loaded[i].nLights == variants[i].nLights);
+            REQUIRE(loaded[i].lightModel == variants[i].lightModel);
+            REQUIRE(loaded[i].effects == variants[i].effects);
+            REQUIRE(loaded[i].shadowCounts == variants[i].shadowCounts);
+            REQUIRE(loaded[i].fishEyeOverride == variants[i].fishEyeOverride);
+        }
+    }
+
+    SECTION("Damaged variant lists are ignored")
+    {
+        fs::path path = dir.path / "variants.dat";
+        std::string data = readFile(path);
+        writeFile(path, data.substr(0, data.size() - 3));
+        REQUIRE(cache.readVariants().empty());
+    }
+}
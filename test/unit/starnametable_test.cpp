@@ -0,0 +1,58 @@
+#include <string>
+#include <string_view>
+
+#include <catch.hpp>
+
+#include <celengine/name.h>
+#include <celengine/starnametable.h>
+
+
+TEST_CASE("Star name table", "[StarNameTable]")
+{
+    NameDatabase namesDB;
+    namesDB.add(32349, "Sirius");
+    namesDB.add(32349, "ALF CMa");
+    namesDB.add(32349, "9 CMa");
+    namesDB.add(71683, "Rigil Kentaurus");
+    namesDB.add(71683, "ALF1 Cen");
+    namesDB.add(70890, "Proxima Centauri");
+    namesDB.add(5, "9 CMa");
+
+    StarNameTable table(namesDB);
+    REQUIRE(table.getNameCount() == 7);
+
+    SECTION("Names keep the order of the name database")
+    {
+        for (AstroCatalog::IndexNumber catalogNumber : { 5u, 32349u, 70890u, 71683u })
+        {
+            auto [first, last] = table.findNames(catalogNumber);
+            auto iter = namesDB.getFirstNameIter(catalogNumber);
+            for (auto i = first; i < last; i++, ++iter)
+            {
+                REQUIRE(iter != namesDB.getFinalNameIter());
+                REQUIRE(iter->first == catalogNumber);
+                REQUIRE(table.getName(i, false) == iter->second);
+            }
+            REQUIRE((iter == namesDB.getFinalNameIter() || iter->first != catalogNumber));
+        }
+
+        REQUIRE(table.getFirstName(32349, false) == "Sirius");
+        REQUIRE(table.getFirstName(71683, true) == "Rigil Kentaurus");
+    }
+
+    SECTION("Missing stars have no names")
+    {
+        auto [first, last] = table.findNames(1);
+        REQUIRE(first == last);
+        REQUIRE(table.getFirstName(1, false).empty());
+        REQUIRE(table.getFirstName(AstroCatalog::InvalidIndex, true).empty());
+    }
+
+    SECTION("Repeated strings are stored once")
+    {
+        std::string_view a = table.getFirstName(5, false);
+        std::string_view b = table.getName(table.findNames(32349).first + 2, false);
+        REQUIRE(a == b);
+        REQUIRE(a.data() == b.data());
+    }
+}